@@ -135,8 +135,14 @@ typedef union owiz_sysconf_result {
  */
 OWIZ_API union owiz_sysconf_result owiz_sysconf(int name) OWIZ_NOEXCEPT;
 
-#define OWIZ_CTL_STACKSIZE      1 ///< Set stack size (number of objects). Value: pointer to integer.
+#define OWIZ_CTL_STACKSIZE      1 ///< Set max stack size (number of objects). Value: pointer to integer.
 #define OWIZ_CTL_DEFAULTPATH    2 ///< Default module paths. Value: `"path_1\0path_2\0...path_n\0"`.
+#define OWIZ_CTL_JIT            3 ///< Set JIT threshold (call and loop count), or `0` to disable JIT (default). Value: pointer to integer.
+#define OWIZ_CTL_JITTRACE       4 ///< Set loop tracing threshold (iteration count), or `0` to disable tracing (default). Value: pointer to integer.
+#define OWIZ_CTL_OPTIMIZE       5 ///< Set compiler optimization level (`0` to `2`). Value: pointer to integer.
+#define OWIZ_CTL_GCSLICE        6 ///< Set number of objects marked in an incremental full GC slice, or `0` to mark in one pause. Value: pointer to integer.
+#define OWIZ_CTL_GCCONCURRENT   7 ///< Enable (`1`) or disable (`0`) marking old objects on a helper thread during incremental full GC. Value: pointer to integer.
+#define OWIZ_CTL_GCTHREADS      8 ///< Set number of threads that run a full GC, including the calling one (`1` to disable parallel GC). Value: pointer to integer.
 
 /**
  * @breif Write runtime parameters.
@@ -279,6 +285,26 @@ OWIZ_API void owiz_make_map(owiz_machine_t *om, size_t count) OWIZ_NOEXCEPT;
  */
 OWIZ_API int owiz_make_exception(owiz_machine_t *om, int type, const char *fmt, ...) OWIZ_NOEXCEPT;
 
+/**
+ * @brief Create a class from native definition and push it.
+ *
+ * @param om the instance
+ * @param def definition of the class
+ */
+OWIZ_API void owiz_make_class(owiz_machine_t *om, const owiz_native_class_def_t *def) OWIZ_NOEXCEPT;
+
+/**
+ * @brief Create an object of a class created with `owiz_make_class()` and push it.
+ * @details The data area of the object is filled with zeros.
+ *
+ * @param om the instance
+ * @param index index of local variable like param `index` in `owiz_load_local()`,
+ * or `0` to represent the top object on stack, which is the class
+ * @return On success, return 0. If `index` is out of range, return `OWIZ_ERR_INDEX`;
+ * if the object is not a class of such objects, return `OWIZ_ERR_TYPE`.
+ */
+OWIZ_API int owiz_make_object(owiz_machine_t *om, int index) OWIZ_NOEXCEPT;
+
 #define OWIZ_MKMOD_EMPTY    0x00 ///< Create an empty module.
 #define OWIZ_MKMOD_NATIVE   0x01 ///< Create a module from native definition.
 #define OWIZ_MKMOD_FILE     0x02 ///< Compile a module from file.
@@ -518,6 +544,21 @@ OWIZ_API size_t owiz_read_set(owiz_machine_t *om, int index, int op) OWIZ_NOEXCE
  */
 OWIZ_API size_t owiz_read_map(owiz_machine_t *om, int index, int key_idx) OWIZ_NOEXCEPT;
 
+/**
+ * @brief Get the data area of an object created with `owiz_make_object()`.
+ *
+ * @param om the instance
+ * @param index index of local variable like param `index` in `owiz_load_local()`,
+ * or `0` to represent the top object on stack
+ * @param data_p pointer to a variable to store the address of the data area
+ * @return On success, return 0. If `index` is out of range, return `OWIZ_ERR_INDEX`;
+ * if the object has no data area, return `OWIZ_ERR_TYPE`.
+ *
+ * @warning The object may be moved when a new object is created,
+ * after which the address is no longer valid.
+ */
+OWIZ_API int owiz_read_data(owiz_machine_t *om, int index, void **data_p) OWIZ_NOEXCEPT;
+
 /**
  * @brief Get or print contents of an exception.
  *
@@ -624,6 +665,7 @@ OWIZ_API int owiz_drop(owiz_machine_t *om, int count) OWIZ_NOEXCEPT;
 OWIZ_API int owiz_invoke(owiz_machine_t *om, int argc, int flags) OWIZ_NOEXCEPT;
 
 #define OWIZ_CMD_ADDPATH      0x0001 ///< Append a module search path. `const char *path`.
+#define OWIZ_CMD_AOTCOMPILE   0x0002 ///< Compile the module on stack top to a native module file. `const char *path`. On failure, the module is replaced with the exception.
 
 /**
  * @brief Execute a command.
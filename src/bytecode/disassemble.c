@@ -185,7 +185,8 @@ static const char *write_operand_comment(
     size_t offset, enum ow_opcode opcode, int operand,
     struct ow_func_obj *func, char *buf, size_t buf_sz
 ) {
-    if (opcode == OW_OPC_Call) {
+    opcode = ow_opcode_generic(opcode);
+    if (opcode == OW_OPC_Call || opcode == OW_OPC_TailCall) {
         assert(operand >= 0 && operand <= 0xff);
         const bool no_ret_val = operand & 0x80;
         const int argc = operand & 0x7f;
@@ -194,7 +195,8 @@ static const char *write_operand_comment(
     }
     if (opcode == OW_OPC_Jmp     || opcode == OW_OPC_JmpW ||
         opcode == OW_OPC_JmpWhen || opcode == OW_OPC_JmpWhenW ||
-        opcode == OW_OPC_JmpUnls || opcode == OW_OPC_JmpUnlsW
+        opcode == OW_OPC_JmpUnls || opcode == OW_OPC_JmpUnlsW ||
+        opcode == OW_OPC_ForIter || opcode == OW_OPC_ForIterW
     ) {
         snprintf(buf, buf_sz, "target=%04zx", (offset + (ptrdiff_t)operand));
         return buf;
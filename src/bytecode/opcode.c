@@ -23,3 +23,16 @@ const char *ow_opcode_name(enum ow_opcode opcode) {
         return NULL;
     return _opcode_names[index];
 }
+
+enum ow_opcode ow_opcode_generic(enum ow_opcode opcode) {
+    switch (opcode) {
+#define ELEM(NAME, GENERIC) case OW_OPC_##NAME : return OW_OPC_##GENERIC ;
+    OW_OPCODE_QUICKENED_LIST
+#undef ELEM
+#define ELEM(NAME, GENERIC, SEQUENCE) case OW_OPC_##NAME : return OW_OPC_##GENERIC ;
+    OW_OPCODE_FUSED_LIST
+#undef ELEM
+    default:
+        return opcode;
+    }
+}
@@ -3,9 +3,9 @@
 #define OW_OPCODE_LIST \
     /*   NAME       , CODE, OPERAND_INFO */ \
     ELEM(Nop        , 0x00,   0) \
-    ELEM(_01        , 0x01,   0) \
+    ELEM(AddFlt     , 0x01,   0) \
     ELEM(Trap       , 0x02,   0) \
-    ELEM(_03        , 0x03,   0) \
+    ELEM(SubFlt     , 0x03,   0) \
     ELEM(Swap       , 0x04,   0) \
     ELEM(SwapN      , 0x05,  u8) \
     ELEM(Drop       , 0x06,   0) \
@@ -17,7 +17,7 @@
     ELEM(LdInt      , 0x0c,  i8) \
     ELEM(LdIntW     , 0x0d, i16) \
     ELEM(LdFlt      , 0x0e,  i8) \
-    ELEM(_0f        , 0x0f,   0) \
+    ELEM(MulFlt     , 0x0f,   0) \
     ELEM(Add        , 0x10,   0) \
     ELEM(Sub        , 0x11,   0) \
     ELEM(Mul        , 0x12,   0) \
@@ -32,8 +32,8 @@
     ELEM(Inv        , 0x1b,   0) \
     ELEM(Not        , 0x1c,   0) \
     ELEM(Test       , 0x1d,   0) \
-    ELEM(_1e        , 0x1e,   0) \
-    ELEM(_1f        , 0x1f,   0) \
+    ELEM(AddInt     , 0x1e,   0) \
+    ELEM(SubInt     , 0x1f,   0) \
     ELEM(Is         , 0x20,   0) \
     ELEM(Cmp        , 0x21,   0) \
     ELEM(CmpLt      , 0x22,   0) \
@@ -77,8 +77,8 @@
     ELEM(RetNil     , 0x48,   0) \
     ELEM(RetLoc     , 0x49,  u8) \
     ELEM(Call       , 0x4a,  u8) \
-    ELEM(_4b        , 0x4b,   0) \
-    ELEM(_4c        , 0x4c,   0) \
+    ELEM(CallFunc   , 0x4b,  u8) \
+    ELEM(TailCall   , 0x4c,  u8) \
     ELEM(_4d        , 0x4d,   0) \
     ELEM(PrepMethY  , 0x4e,  u8) \
     ELEM(PrepMethYW , 0x4f, u16) \
@@ -90,8 +90,69 @@
     ELEM(MkSetW     , 0x55, u16) \
     ELEM(MkMap      , 0x56,  u8) \
     ELEM(MkMapW     , 0x57, u16) \
+    ELEM(MulInt     , 0x58,   0) \
+    ELEM(DivInt     , 0x59,   0) \
+    ELEM(DivFlt     , 0x5a,   0) \
+    ELEM(CmpLtInt   , 0x5b,   0) \
+    ELEM(CmpLeInt   , 0x5c,   0) \
+    ELEM(CmpGtInt   , 0x5d,   0) \
+    ELEM(CmpGeInt   , 0x5e,   0) \
+    ELEM(CmpEqInt   , 0x5f,   0) \
+    ELEM(CmpNeInt   , 0x60,   0) \
+    ELEM(LdLoc2     , 0x61,  u8) \
+    ELEM(IncLoc     , 0x62,  u8) \
+    ELEM(CmpLtJmp   , 0x63,   0) \
+    ELEM(CmpLeJmp   , 0x64,   0) \
+    ELEM(CmpGtJmp   , 0x65,   0) \
+    ELEM(CmpGeJmp   , 0x66,   0) \
+    ELEM(CmpEqJmp   , 0x67,   0) \
+    ELEM(CmpNeJmp   , 0x68,   0) \
+    ELEM(CallMethY  , 0x69,  u8) \
+    ELEM(PrepIter   , 0x6a,   0) \
+    ELEM(ForIter    , 0x6b,  i8) \
+    ELEM(ForIterW   , 0x6c, i16) \
 // ^^^ OW_OPCODE_LIST ^^^
 
+/// Quickened instructions and their generic forms. The compiler never emits
+/// them; the interpreter rewrites a generic instruction into a quickened one
+/// after observing its operands, and back when the guard of it fails.
+#define OW_OPCODE_QUICKENED_LIST \
+    /*   NAME       , GENERIC */ \
+    ELEM(AddFlt     , Add    ) \
+    ELEM(SubFlt     , Sub    ) \
+    ELEM(MulFlt     , Mul    ) \
+    ELEM(AddInt     , Add    ) \
+    ELEM(SubInt     , Sub    ) \
+    ELEM(CallFunc   , Call   ) \
+    ELEM(MulInt     , Mul    ) \
+    ELEM(DivInt     , Div    ) \
+    ELEM(DivFlt     , Div    ) \
+    ELEM(CmpLtInt   , CmpLt  ) \
+    ELEM(CmpLeInt   , CmpLe  ) \
+    ELEM(CmpGtInt   , CmpGt  ) \
+    ELEM(CmpGeInt   , CmpGe  ) \
+    ELEM(CmpEqInt   , CmpEq  ) \
+    ELEM(CmpNeInt   , CmpNe  ) \
+// ^^^ OW_OPCODE_QUICKENED_LIST ^^^
+
+/// Superinstructions, their generic forms, and the sequences they stand for.
+/// The assembler writes a fused opcode over the first instruction of a sequence
+/// that is not split by a jump target, leaving the rest of the sequence in place.
+/// The interpreter runs the whole sequence at once when it can, and otherwise
+/// runs the first instruction as its generic form.
+#define OW_OPCODE_FUSED_LIST \
+    /*   NAME       , GENERIC  , SEQUENCE */ \
+    ELEM(LdLoc2     , LdLoc    , LdLoc a; LdLoc b                 ) \
+    ELEM(IncLoc     , LdLoc    , LdLoc a; LdInt k; Add; StLoc b   ) \
+    ELEM(CmpLtJmp   , CmpLt    , CmpLt; JmpUnls off               ) \
+    ELEM(CmpLeJmp   , CmpLe    , CmpLe; JmpUnls off               ) \
+    ELEM(CmpGtJmp   , CmpGt    , CmpGt; JmpUnls off               ) \
+    ELEM(CmpGeJmp   , CmpGe    , CmpGe; JmpUnls off               ) \
+    ELEM(CmpEqJmp   , CmpEq    , CmpEq; JmpUnls off               ) \
+    ELEM(CmpNeJmp   , CmpNe    , CmpNe; JmpUnls off               ) \
+    ELEM(CallMethY  , PrepMethY, PrepMethY name; Call argc        ) \
+// ^^^ OW_OPCODE_FUSED_LIST ^^^
+
 /// Opcodes.
 enum ow_opcode {
 #define ELEM(NAME, CODE, OPERAND_SIZE) OW_OPC_##NAME = CODE ,
@@ -102,3 +163,5 @@ enum ow_opcode {
 
 /// Get name of an opcode. Return NULL if not valid.
 const char *ow_opcode_name(enum ow_opcode opcode);
+/// Get the generic form of a quickened or fused opcode. Other opcodes are returned as is.
+enum ow_opcode ow_opcode_generic(enum ow_opcode opcode);
@@ -2,6 +2,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "opcode.h" // enum ow_opcode
 #include <utilities/attributes.h>
@@ -41,3 +42,25 @@ ow_static_forceinline bool ow_operand_type_signed(enum ow_operand_type type) {
 ow_static_forceinline unsigned int ow_operand_type_width(enum ow_operand_type type) {
     return (unsigned int)((int)type < 0 ? -(int)type : (int)type);
 }
+
+/// Read an operand of the given type from bytecode. Return 0 if there is no operand.
+ow_static_forceinline int ow_operand_read(const unsigned char *p, enum ow_operand_type type) {
+    switch (type) {
+    case OW_OPERAND_i8:
+        return *(const int8_t *)p;
+    case OW_OPERAND_u8:
+        return *(const uint8_t *)p;
+    case OW_OPERAND_i16: {
+        int16_t v;
+        memcpy(&v, p, 2);
+        return v;
+    }
+    case OW_OPERAND_u16: {
+        uint16_t v;
+        memcpy(&v, p, 2);
+        return v;
+    }
+    default:
+        return 0;
+    }
+}
@@ -13,13 +13,17 @@
 #include <objects/funcobj.h>
 #include <objects/intobj.h>
 #include <objects/objmem.h>
+#include <objects/smallint.h>
 #include <objects/stringobj.h>
 #include <objects/symbolobj.h>
 #include <utilities/array.h>
+#include <utilities/debuglog.h>
 #include <utilities/memalloc.h>
 #include <utilities/strings.h>
 #include <utilities/unreachable.h>
 
+#include <config/options.h>
+
 /// Representation of an instruction.
 struct instr_data {
     uint8_t opcode;
@@ -137,6 +141,16 @@ size_t ow_assembler_constant(struct ow_assembler *as, struct ow_assembler_consta
 
     for (size_t i = 0, cnt = ow_array_size(&as->constants); i < cnt; i++) {
         struct ow_object *const obj = ow_array_at(&as->constants, i);
+        if (ow_smallint_check(obj)) {
+            if (v.type == OW_AS_CONST_INT && ow_smallint_from_ptr(obj) == v.i)
+                return i;
+            continue;
+        }
+        if (ow_smallfloat_check(obj)) {
+            if (v.type == OW_AS_CONST_FLT && ow_smallfloat_try_to_ptr(v.f) == obj)
+                return i;
+            continue;
+        }
         if (ow_object_class(obj) != const_class)
             continue;
         switch (v.type) {
@@ -169,7 +183,7 @@ size_t ow_assembler_constant(struct ow_assembler *as, struct ow_assembler_consta
         obj = ow_object_from(ow_int_obj_or_smallint(om, v.i));
         break;
     case OW_AS_CONST_FLT:
-        obj = ow_object_from(ow_float_obj_new(om, v.f));
+        obj = ow_float_obj_or_smallfloat(om, v.f);
         break;
     case OW_AS_CONST_STR:
         obj = ow_object_from(ow_string_obj_new(om, v.s.p, v.s.n));
@@ -274,74 +288,367 @@ static enum ow_opcode _opcode_to_wide(enum ow_opcode opcode) {
     return opcode_w;
 }
 
-struct ow_func_obj *ow_assembler_output(
-    struct ow_assembler *as, const struct ow_assembler_output_spec *spec
+/// Get the instruction index of a placed label.
+static size_t label_instr_index(struct ow_assembler *as, size_t label_id) {
+    assert(label_id < ow_array_size(&as->labels));
+    const size_t lbl_instr_idx = (uintptr_t)ow_array_at(&as->labels, label_id);
+    assert(lbl_instr_idx != UINTPTR_MAX); // Has not been placed.
+    return lbl_instr_idx;
+}
+
+/// Check whether an instruction pushes a value without any side effect.
+static bool opcode_is_pure_push(enum ow_opcode opcode) {
+    switch (opcode) {
+    case OW_OPC_Dup:
+    case OW_OPC_LdNil:
+    case OW_OPC_LdBool:
+    case OW_OPC_LdInt:
+    case OW_OPC_LdIntW:
+    case OW_OPC_LdFlt:
+    case OW_OPC_LdCnst:
+    case OW_OPC_LdCnstW:
+    case OW_OPC_LdSym:
+    case OW_OPC_LdSymW:
+    case OW_OPC_LdArg:
+    case OW_OPC_LdLoc:
+    case OW_OPC_LdLocW:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// Check whether the next instruction is never reached by falling through.
+static bool opcode_is_terminator(enum ow_opcode opcode) {
+    return opcode == OW_OPC_Jmp || opcode == OW_OPC_JmpW ||
+        opcode == OW_OPC_Ret || opcode == OW_OPC_RetNil || opcode == OW_OPC_RetLoc;
+}
+
+/// Check whether two instructions access the same local variable, one loading
+/// and the other storing, or in the reverse order if `store_first` is true.
+static bool instrs_load_store_same_local(
+    const struct instr_data *a, const struct instr_data *b, bool store_first
+) {
+    const enum ow_opcode ld = store_first ? b->opcode : a->opcode;
+    const enum ow_opcode st = store_first ? a->opcode : b->opcode;
+    if (ld == OW_OPC_LdLoc && st == OW_OPC_StLoc)
+        return a->operand.u8 == b->operand.u8;
+    if (ld == OW_OPC_LdLocW && st == OW_OPC_StLocW)
+        return a->operand.u16 == b->operand.u16;
+    return false;
+}
+
+/// Check whether the instructions from `index` have the shape of superinstruction
+/// `IncLoc` (`LdLoc a; LdInt k; Add; StLoc b`). Peephole rewriting keeps such
+/// sequences so that they are fused when the code is written.
+static bool instrs_match_inc_loc(
+    struct ow_assembler *as, size_t index, const bool *removed
 ) {
+    static const uint8_t shape[] = {OW_OPC_LdLoc, OW_OPC_LdInt, OW_OPC_Add, OW_OPC_StLoc};
+    if (index + sizeof shape > instr_array_size(&as->instr_seq))
+        return false;
+    for (size_t i = 0; i < sizeof shape; i++) {
+        if (removed[index + i] ||
+                instr_array_ref(&as->instr_seq, index + i)->opcode != shape[i])
+            return false;
+    }
+    return true;
+}
+
+/// Run one round of optimizations on the instruction sequence: jump threading,
+/// dead code removal and peephole rewriting. Return whether anything changed.
+static bool optimize_instr_seq_once(struct ow_assembler *as) {
     const size_t instr_seq_len = instr_array_size(&as->instr_seq);
-    size_t *const addr_map = ow_malloc(sizeof(size_t) * (instr_seq_len + 1));
+    if (!instr_seq_len)
+        return false;
+    bool changed = false;
+
+    bool *const is_jump_target = ow_malloc(instr_seq_len + 1);
+    bool *const removed = ow_malloc(instr_seq_len);
+    memset(is_jump_target, 0, instr_seq_len + 1);
+    memset(removed, 0, instr_seq_len);
+    for (size_t i = 0; i < instr_seq_len; i++) {
+        const struct instr_data *const instr = instr_array_ref(&as->instr_seq, i);
+        if (instr->operand_is_label)
+            is_jump_target[label_instr_index(as, instr->operand.u16)] = true;
+    }
 
-    size_t code_seq_len = 0;
+    // Jump threading.
     for (size_t i = 0; i < instr_seq_len; i++) {
         struct instr_data *const instr = instr_array_ref(&as->instr_seq, i);
-        const size_t current_code_addr = code_seq_len;
-        addr_map[i] = current_code_addr;
-
-        if (instr->operand_is_label) {
-            const size_t label_id = instr->operand.u16;
-            assert(label_id < ow_array_size(&as->labels));
-            const size_t lbl_instr_idx =
-                (uintptr_t)ow_array_at(&as->labels, label_id);
-            assert(lbl_instr_idx != UINTPTR_MAX); // Has not been placed.
-
-            if (lbl_instr_idx <= i) {
-                const size_t code_addr = addr_map[lbl_instr_idx];
-                const ptrdiff_t offset = (ptrdiff_t)code_addr - (ptrdiff_t)current_code_addr;
-                assert(offset <= 0);
-                if (offset >= INT8_MIN) {
-                    instr->operand.i8 = (int8_t)offset;
-                    code_seq_len += 1 + 1;
-                } else if (offset >= INT16_MIN) {
-                    instr->operand.i16 = (int16_t)offset;
-                    code_seq_len += 1 + 2;
-                } else {
-                    abort(); // Too far.
-                }
-                instr->operand_is_label = false;
-            } else {
-                const size_t idx_diff = (size_t)(lbl_instr_idx - i);
-                const bool use_width_operand = idx_diff > (INT8_MAX / 3);
-                if (use_width_operand) {
-                    instr->opcode = (uint8_t)_opcode_to_wide(
-                        (enum ow_opcode)instr->opcode);
-                    code_seq_len += 1 + 2;
-                } else {
-                    code_seq_len += 1 + 1;
-                }
+        if (!instr->operand_is_label)
+            continue;
+        size_t label_id = instr->operand.u16;
+        for (size_t hops = 0; hops < instr_seq_len; hops++) {
+            const size_t target_idx = label_instr_index(as, label_id);
+            if (target_idx >= instr_seq_len)
+                break;
+            const struct instr_data *const target =
+                instr_array_ref(&as->instr_seq, target_idx);
+            if (target->opcode != OW_OPC_Jmp || target->operand.u16 == label_id)
+                break;
+            label_id = target->operand.u16;
+        }
+        if (label_id != instr->operand.u16) {
+            instr->operand.u16 = (uint16_t)label_id;
+            changed = true;
+        }
+        if (instr->opcode != OW_OPC_Jmp)
+            continue;
+        const size_t target_idx = label_instr_index(as, label_id);
+        if (target_idx == i + 1) {
+            removed[i] = true; // Jump to the next instruction.
+            changed = true;
+        } else if (target_idx < instr_seq_len) {
+            const struct instr_data *const target =
+                instr_array_ref(&as->instr_seq, target_idx);
+            if (target->opcode == OW_OPC_Ret ||
+                    target->opcode == OW_OPC_RetNil || target->opcode == OW_OPC_RetLoc) {
+                *instr = *target; // Jump to a return.
+                changed = true;
+            }
+        }
+    }
+
+    // Dead code removal.
+    for (size_t i = 0; i < instr_seq_len; i++) {
+        if (removed[i])
+            continue;
+        if (!opcode_is_terminator(instr_array_ref(&as->instr_seq, i)->opcode))
+            continue;
+        for (size_t j = i + 1; j < instr_seq_len && !is_jump_target[j]; j++) {
+            if (!removed[j]) {
+                removed[j] = true;
+                changed = true;
+            }
+            i = j;
+        }
+    }
+
+    // Peephole rewriting.
+    for (size_t i = 0; i + 1 < instr_seq_len; i++) {
+        const size_t j = i + 1;
+        if (removed[i] || removed[j] || is_jump_target[j])
+            continue;
+        struct instr_data *const a = instr_array_ref(&as->instr_seq, i);
+        struct instr_data *const b = instr_array_ref(&as->instr_seq, j);
+        if ((opcode_is_pure_push(a->opcode) && b->opcode == OW_OPC_Drop)
+                || (a->opcode == OW_OPC_Swap && b->opcode == OW_OPC_Swap)
+                || instrs_load_store_same_local(a, b, false)) {
+            // `LdXxx; Drop`, `Swap; Swap`, `LdLoc x; StLoc x`.
+            removed[i] = removed[j] = true;
+            changed = true;
+            i = j;
+        } else if (instrs_load_store_same_local(a, b, true) && !(j + 1 < instr_seq_len &&
+                instr_array_ref(&as->instr_seq, j + 1)->opcode == OW_OPC_Drop) &&
+                !(i >= 3 && instrs_match_inc_loc(as, i - 3, removed)) &&
+                !instrs_match_inc_loc(as, j, removed)) {
+            // `StLoc x; LdLoc x` => `Dup; StLoc x`, unless it splits an `IncLoc` shape.
+            *b = *a;
+            *a = (struct instr_data){.opcode = OW_OPC_Dup};
+            changed = true;
+            i = j;
+        }
+    }
+
+    // Remove instructions and move labels.
+    if (changed) {
+        size_t *const index_map = ow_malloc(sizeof(size_t) * (instr_seq_len + 1));
+        size_t new_len = 0;
+        for (size_t i = 0; i < instr_seq_len; i++) {
+            index_map[i] = new_len;
+            if (!removed[i])
+                *instr_array_ref(&as->instr_seq, new_len++) =
+                    *instr_array_ref(&as->instr_seq, i);
+        }
+        index_map[instr_seq_len] = new_len;
+        instr_array_drop(&as->instr_seq, instr_seq_len - new_len);
+        for (size_t i = 0, n = ow_array_size(&as->labels); i < n; i++) {
+            const size_t lbl_instr_idx = (uintptr_t)ow_array_at(&as->labels, i);
+            if (lbl_instr_idx == UINTPTR_MAX)
+                continue; // Not placed and not used.
+            ow_array_at(&as->labels, i) = (void *)(uintptr_t)index_map[lbl_instr_idx];
+        }
+        ow_free(index_map);
+    }
+
+    ow_free(is_jump_target);
+    ow_free(removed);
+    return changed;
+}
+
+/// Optimize the instruction sequence until nothing changes. Return number of rounds.
+static size_t optimize_instr_seq(struct ow_assembler *as) {
+    const size_t max_rounds = 16;
+    size_t rounds = 0;
+    while (rounds < max_rounds) {
+        rounds++;
+        if (!optimize_instr_seq_once(as))
+            break;
+    }
+    return rounds;
+}
+
+/// Compute instruction addresses. A jump is marked in `wide_jumps` if its
+/// offset does not fit in a narrow operand. Return the code size.
+static size_t layout_instr_seq(
+    struct ow_assembler *as, size_t *addr_map, bool *wide_jumps
+) {
+    const size_t instr_seq_len = instr_array_size(&as->instr_seq);
+    memset(wide_jumps, 0, instr_seq_len);
+    size_t code_seq_len;
+    while (true) {
+        code_seq_len = 0;
+        for (size_t i = 0; i < instr_seq_len; i++) {
+            const struct instr_data *const instr = instr_array_ref(&as->instr_seq, i);
+            addr_map[i] = code_seq_len;
+            code_seq_len += 1 + (wide_jumps[i] ? 2 : ow_operand_type_width(
+                ow_operand_type((enum ow_opcode)instr->opcode)));
+        }
+        addr_map[instr_seq_len] = code_seq_len;
+
+        // Widening a jump only makes offsets longer, so this terminates.
+        bool widened = false;
+        for (size_t i = 0; i < instr_seq_len; i++) {
+            const struct instr_data *const instr = instr_array_ref(&as->instr_seq, i);
+            if (!instr->operand_is_label || wide_jumps[i])
+                continue;
+            const size_t lbl_instr_idx = label_instr_index(as, instr->operand.u16);
+            const ptrdiff_t offset =
+                (ptrdiff_t)addr_map[lbl_instr_idx] - (ptrdiff_t)addr_map[i];
+            if (offset < INT8_MIN || offset > INT8_MAX) {
+                wide_jumps[i] = true;
+                widened = true;
             }
-        } else {
-            code_seq_len += 1 + ow_operand_type_width(
-                ow_operand_type((enum ow_opcode)instr->opcode));
         }
+        if (!widened)
+            return code_seq_len;
+    }
+}
+
+/// An instruction sequence that can be replaced with a superinstruction.
+/// See `OW_OPCODE_FUSED_LIST`.
+struct fusion_pattern {
+    uint8_t fused_opcode;
+    uint8_t length;
+    uint8_t sequence[4];
+};
+static const struct fusion_pattern fusion_patterns[] = {
+    {OW_OPC_IncLoc   , 4, {OW_OPC_LdLoc, OW_OPC_LdInt, OW_OPC_Add, OW_OPC_StLoc}},
+    {OW_OPC_LdLoc2   , 2, {OW_OPC_LdLoc, OW_OPC_LdLoc}},
+    {OW_OPC_CmpLtJmp , 2, {OW_OPC_CmpLt, OW_OPC_JmpUnls}},
+    {OW_OPC_CmpLeJmp , 2, {OW_OPC_CmpLe, OW_OPC_JmpUnls}},
+    {OW_OPC_CmpGtJmp , 2, {OW_OPC_CmpGt, OW_OPC_JmpUnls}},
+    {OW_OPC_CmpGeJmp , 2, {OW_OPC_CmpGe, OW_OPC_JmpUnls}},
+    {OW_OPC_CmpEqJmp , 2, {OW_OPC_CmpEq, OW_OPC_JmpUnls}},
+    {OW_OPC_CmpNeJmp , 2, {OW_OPC_CmpNe, OW_OPC_JmpUnls}},
+    {OW_OPC_CallMethY, 2, {OW_OPC_PrepMethY, OW_OPC_Call}},
+};
+
+/// Find a superinstruction for the instructions from `index`, whose opcodes are final.
+/// Return the pattern or NULL. The sequence must not be split by a label
+/// and must not contain wide jumps.
+static const struct fusion_pattern *find_fusion_pattern(
+    struct ow_assembler *as, size_t index,
+    const bool *is_label_target, const bool *wide_jumps
+) {
+#if OW_DEBUG_OPSTAT
+    // Count the original instructions.
+    ow_unused_var(as), ow_unused_var(index);
+    ow_unused_var(is_label_target), ow_unused_var(wide_jumps);
+    ow_unused_var(fusion_patterns);
+    return NULL;
+#else // !OW_DEBUG_OPSTAT
+    const size_t instr_seq_len = instr_array_size(&as->instr_seq);
+    for (size_t i = 0; i < sizeof fusion_patterns / sizeof fusion_patterns[0]; i++) {
+        const struct fusion_pattern *const pattern = &fusion_patterns[i];
+        if (index + pattern->length > instr_seq_len)
+            continue;
+        bool matched = true;
+        for (size_t j = 0; j < pattern->length; j++) {
+            if (instr_array_ref(&as->instr_seq, index + j)->opcode != pattern->sequence[j]
+                    || (j && is_label_target[index + j]) || wide_jumps[index + j]) {
+                matched = false;
+                break;
+            }
+        }
+        if (matched)
+            return pattern;
+    }
+    return NULL;
+#endif // OW_DEBUG_OPSTAT
+}
+
+struct ow_func_obj *ow_assembler_output(
+    struct ow_assembler *as, const struct ow_assembler_output_spec *spec
+) {
+#if OW_DEBUG_CODEGEN && OW_DEBUG_LOGGING
+    const size_t orig_instr_seq_len = instr_array_size(&as->instr_seq);
+    size_t orig_code_seq_len;
+    {
+        size_t *const addr_map = ow_malloc(sizeof(size_t) * (orig_instr_seq_len + 1));
+        bool *const wide_jumps = ow_malloc(orig_instr_seq_len + 1);
+        orig_code_seq_len = layout_instr_seq(as, addr_map, wide_jumps);
+        ow_free(addr_map);
+        ow_free(wide_jumps);
+    }
+#endif // OW_DEBUG_CODEGEN && OW_DEBUG_LOGGING
+
+    const size_t opt_rounds = optimize_instr_seq(as);
+    ow_unused_var(opt_rounds);
+
+    const size_t instr_seq_len = instr_array_size(&as->instr_seq);
+    size_t *const addr_map = ow_malloc(sizeof(size_t) * (instr_seq_len + 1));
+    bool *const wide_jumps = ow_malloc(instr_seq_len + 1);
+    size_t code_seq_len = layout_instr_seq(as, addr_map, wide_jumps);
+
+#if OW_DEBUG_CODEGEN && OW_DEBUG_LOGGING
+    ow_debuglog_print(
+        "CodeGen", DBG,
+        "optimized in %zu round(s): %zu => %zu instructions, %zu => %zu bytes",
+        opt_rounds, orig_instr_seq_len, instr_seq_len,
+        orig_code_seq_len, code_seq_len
+    );
+#endif // OW_DEBUG_CODEGEN && OW_DEBUG_LOGGING
+
+    bool *const is_label_target = ow_malloc(instr_seq_len + 1);
+    memset(is_label_target, 0, instr_seq_len + 1);
+    for (size_t i = 0, n = ow_array_size(&as->labels); i < n; i++) {
+        const size_t lbl_instr_idx = (uintptr_t)ow_array_at(&as->labels, i);
+        if (lbl_instr_idx <= instr_seq_len)
+            is_label_target[lbl_instr_idx] = true;
     }
-    addr_map[instr_seq_len] = code_seq_len;
 
     uint8_t *const code_seq = ow_malloc(code_seq_len);
     uint8_t *code_seq_ptr = code_seq;
+    size_t fused_end = 0; // End of last fused sequence.
 
     for (size_t i = 0, n = instr_array_size(&as->instr_seq); i < n; i++) {
         struct instr_data instr = *instr_array_ref(&as->instr_seq, i);
 
+        if (i >= fused_end) {
+            const struct fusion_pattern *const pattern =
+                find_fusion_pattern(as, i, is_label_target, wide_jumps);
+            if (pattern) {
+                assert(ow_operand_type((enum ow_opcode)pattern->fused_opcode) ==
+                    ow_operand_type((enum ow_opcode)instr.opcode));
+                instr.opcode = pattern->fused_opcode;
+                fused_end = i + pattern->length;
+            }
+        }
+
         if (instr.operand_is_label) {
-            const size_t label_id = instr.operand.u16;
-            const size_t lbl_instr_idx =
-                (uintptr_t)ow_array_at(&as->labels, label_id);
-            assert(lbl_instr_idx > i);
-            const bool use_width_operand = (lbl_instr_idx - i) > (INT8_MAX / 3);
-            const size_t offset = addr_map[lbl_instr_idx] - addr_map[i];
-            if (use_width_operand)
+            const size_t lbl_instr_idx = label_instr_index(as, instr.operand.u16);
+            const ptrdiff_t offset =
+                (ptrdiff_t)addr_map[lbl_instr_idx] - (ptrdiff_t)addr_map[i];
+            if (wide_jumps[i]) {
+                if (offset < INT16_MIN || offset > INT16_MAX)
+                    abort(); // Too far.
+                instr.opcode = (uint8_t)_opcode_to_wide((enum ow_opcode)instr.opcode);
                 instr.operand.i16 = (int16_t)offset;
-            else
+            } else {
                 instr.operand.i8 = (int8_t)offset;
+            }
         }
 
         *code_seq_ptr++ = instr.opcode;
@@ -378,6 +685,8 @@ struct ow_func_obj *ow_assembler_output(
     );
 
     ow_free(code_seq);
+    ow_free(is_label_target);
+    ow_free(wide_jumps);
     ow_free(addr_map);
 
     return func;
@@ -47,6 +47,15 @@ ow_static_inline struct ow_ast_node *ow_ast_node_array_last(
     return ow_array_at(&arr->_data, ow_array_size(&arr->_data) - 1);
 }
 
+// Replace a node and return the old one without deleting it.
+ow_static_inline struct ow_ast_node *ow_ast_node_array_set(
+    struct ow_ast_node_array *arr, size_t index, struct ow_ast_node *node
+) {
+    struct ow_ast_node *const old_node = ow_array_at(&arr->_data, index);
+    ow_array_at(&arr->_data, index) = node;
+    return old_node;
+}
+
 // Append a node.
 ow_static_inline void ow_ast_node_array_append(
     struct ow_ast_node_array *arr, struct ow_ast_node *node
@@ -0,0 +1,801 @@
+#include "astopt.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ast.h"
+#include <utilities/attributes.h>
+#include <utilities/hashmap.h>
+#include <utilities/memalloc.h>
+#include <utilities/strings.h>
+
+#define BIN_OP_EXPR_CASES \
+    case OW_AST_NODE_AddExpr: case OW_AST_NODE_SubExpr: case OW_AST_NODE_MulExpr: \
+    case OW_AST_NODE_DivExpr: case OW_AST_NODE_RemExpr: case OW_AST_NODE_ShlExpr: \
+    case OW_AST_NODE_ShrExpr: case OW_AST_NODE_BitAndExpr: case OW_AST_NODE_BitOrExpr: \
+    case OW_AST_NODE_BitXorExpr: \
+    case OW_AST_NODE_EqExpr: case OW_AST_NODE_NeExpr: case OW_AST_NODE_LtExpr: \
+    case OW_AST_NODE_LeExpr: case OW_AST_NODE_GtExpr: case OW_AST_NODE_GeExpr \
+// ^^^ BIN_OP_EXPR_CASES ^^^
+
+#define ASSIGN_EXPR_CASES \
+    case OW_AST_NODE_EqlExpr: case OW_AST_NODE_AddEqlExpr: case OW_AST_NODE_SubEqlExpr: \
+    case OW_AST_NODE_MulEqlExpr: case OW_AST_NODE_DivEqlExpr: case OW_AST_NODE_RemEqlExpr: \
+    case OW_AST_NODE_ShlEqlExpr: case OW_AST_NODE_ShrEqlExpr: \
+    case OW_AST_NODE_BitAndEqlExpr: case OW_AST_NODE_BitOrEqlExpr: \
+    case OW_AST_NODE_BitXorEqlExpr \
+// ^^^ ASSIGN_EXPR_CASES ^^^
+
+#define UN_OP_EXPR_CASES \
+    case OW_AST_NODE_PosExpr: case OW_AST_NODE_NegExpr: \
+    case OW_AST_NODE_BitNotExpr: case OW_AST_NODE_NotExpr \
+// ^^^ UN_OP_EXPR_CASES ^^^
+
+#define ARRAY_LIKE_EXPR_CASES \
+    case OW_AST_NODE_TupleExpr: case OW_AST_NODE_ArrayExpr: case OW_AST_NODE_SetExpr \
+// ^^^ ARRAY_LIKE_EXPR_CASES ^^^
+
+#define CALL_LIKE_EXPR_CASES \
+    case OW_AST_NODE_CallExpr: case OW_AST_NODE_SubscriptExpr \
+// ^^^ CALL_LIKE_EXPR_CASES ^^^
+
+/// Check whether a node is a literal that can be copied freely.
+static bool node_is_literal(const struct ow_ast_node *node) {
+    switch (node->type) {
+    case OW_AST_NODE_NilLiteral:
+    case OW_AST_NODE_BoolLiteral:
+    case OW_AST_NODE_IntLiteral:
+    case OW_AST_NODE_FloatLiteral:
+    case OW_AST_NODE_SymbolLiteral:
+    case OW_AST_NODE_StringLiteral:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// Copy a literal node.
+static struct ow_ast_node *literal_clone(
+    const struct ow_ast_node *node, const struct ow_source_range *location
+) {
+    struct ow_ast_node *res;
+    switch (node->type) {
+    case OW_AST_NODE_NilLiteral:
+        res = (struct ow_ast_node *)ow_ast_NilLiteral_new();
+        break;
+    case OW_AST_NODE_BoolLiteral:
+        res = (struct ow_ast_node *)ow_ast_BoolLiteral_new();
+        ((struct ow_ast_BoolLiteral *)res)->value =
+            ((const struct ow_ast_BoolLiteral *)node)->value;
+        break;
+    case OW_AST_NODE_IntLiteral:
+        res = (struct ow_ast_node *)ow_ast_IntLiteral_new();
+        ((struct ow_ast_IntLiteral *)res)->value =
+            ((const struct ow_ast_IntLiteral *)node)->value;
+        break;
+    case OW_AST_NODE_FloatLiteral:
+        res = (struct ow_ast_node *)ow_ast_FloatLiteral_new();
+        ((struct ow_ast_FloatLiteral *)res)->value =
+            ((const struct ow_ast_FloatLiteral *)node)->value;
+        break;
+    case OW_AST_NODE_SymbolLiteral:
+        res = (struct ow_ast_node *)ow_ast_SymbolLiteral_new();
+        ((struct ow_ast_SymbolLiteral *)res)->value = ow_sharedstr_ref(
+            ((const struct ow_ast_SymbolLiteral *)node)->value);
+        break;
+    case OW_AST_NODE_StringLiteral:
+        res = (struct ow_ast_node *)ow_ast_StringLiteral_new();
+        ((struct ow_ast_StringLiteral *)res)->value = ow_sharedstr_ref(
+            ((const struct ow_ast_StringLiteral *)node)->value);
+        break;
+    default:
+        assert(!node_is_literal(node));
+        return NULL;
+    }
+    res->location = *location;
+    return res;
+}
+
+/// Make a Bool literal.
+static struct ow_ast_node *make_bool_literal(
+    bool value, const struct ow_source_range *location
+) {
+    struct ow_ast_BoolLiteral *const node = ow_ast_BoolLiteral_new();
+    node->location = *location;
+    node->value = value;
+    return (struct ow_ast_node *)node;
+}
+
+/// Make an Int literal.
+static struct ow_ast_node *make_int_literal(
+    int64_t value, const struct ow_source_range *location
+) {
+    struct ow_ast_IntLiteral *const node = ow_ast_IntLiteral_new();
+    node->location = *location;
+    node->value = value;
+    return (struct ow_ast_node *)node;
+}
+
+/// Make a Float literal. Return NULL if the value cannot be a literal (NaN or -0.0).
+static struct ow_ast_node *make_float_literal(
+    double value, const struct ow_source_range *location
+) {
+    if (isnan(value) || (value == 0.0 && signbit(value)))
+        return NULL;
+    struct ow_ast_FloatLiteral *const node = ow_ast_FloatLiteral_new();
+    node->location = *location;
+    node->value = value;
+    return (struct ow_ast_node *)node;
+}
+
+/// Evaluate a binary operator on two Int values, the same way as the interpreter.
+/// Return NULL if it cannot be folded.
+static struct ow_ast_node *fold_int_bin_op(
+    enum ow_ast_node_type op, int64_t lhs, int64_t rhs,
+    const struct ow_source_range *location
+) {
+    const uint64_t l = (uint64_t)lhs, r = (uint64_t)rhs;
+    int64_t res;
+    switch (op) {
+    case OW_AST_NODE_AddExpr: res = (int64_t)(l + r); break;
+    case OW_AST_NODE_SubExpr: res = (int64_t)(l - r); break;
+    case OW_AST_NODE_MulExpr: res = (int64_t)(l * r); break;
+    case OW_AST_NODE_DivExpr:
+    case OW_AST_NODE_RemExpr:
+        if (!rhs)
+            return NULL; // Division by zero shall be raised at runtime.
+        if (rhs == -1)
+            res = op == OW_AST_NODE_DivExpr ? (int64_t)(0 - l) : 0;
+        else
+            res = op == OW_AST_NODE_DivExpr ? lhs / rhs : lhs % rhs;
+        break;
+    case OW_AST_NODE_ShlExpr: res = (int64_t)(l << (r & 63)); break;
+    case OW_AST_NODE_ShrExpr: res = lhs >> (r & 63); break;
+    case OW_AST_NODE_BitAndExpr: res = (int64_t)(l & r); break;
+    case OW_AST_NODE_BitOrExpr: res = (int64_t)(l | r); break;
+    case OW_AST_NODE_BitXorExpr: res = (int64_t)(l ^ r); break;
+    case OW_AST_NODE_EqExpr: return make_bool_literal(lhs == rhs, location);
+    case OW_AST_NODE_NeExpr: return make_bool_literal(lhs != rhs, location);
+    case OW_AST_NODE_LtExpr: return make_bool_literal(lhs < rhs, location);
+    case OW_AST_NODE_LeExpr: return make_bool_literal(lhs <= rhs, location);
+    case OW_AST_NODE_GtExpr: return make_bool_literal(lhs > rhs, location);
+    case OW_AST_NODE_GeExpr: return make_bool_literal(lhs >= rhs, location);
+    default: return NULL;
+    }
+    return make_int_literal(res, location);
+}
+
+/// Evaluate a binary operator on two Float values, the same way as the interpreter.
+/// Return NULL if it cannot be folded.
+static struct ow_ast_node *fold_float_bin_op(
+    enum ow_ast_node_type op, double lhs, double rhs,
+    const struct ow_source_range *location
+) {
+    switch (op) {
+    case OW_AST_NODE_AddExpr: return make_float_literal(lhs + rhs, location);
+    case OW_AST_NODE_SubExpr: return make_float_literal(lhs - rhs, location);
+    case OW_AST_NODE_MulExpr: return make_float_literal(lhs * rhs, location);
+    case OW_AST_NODE_DivExpr: return make_float_literal(lhs / rhs, location);
+    case OW_AST_NODE_RemExpr: return make_float_literal(fmod(lhs, rhs), location);
+    default: break;
+    }
+    if (isnan(lhs) || isnan(rhs))
+        return NULL; // Unordered.
+    switch (op) {
+    case OW_AST_NODE_EqExpr: return make_bool_literal(lhs == rhs, location);
+    case OW_AST_NODE_NeExpr: return make_bool_literal(lhs != rhs, location);
+    case OW_AST_NODE_LtExpr: return make_bool_literal(lhs < rhs, location);
+    case OW_AST_NODE_LeExpr: return make_bool_literal(lhs <= rhs, location);
+    case OW_AST_NODE_GtExpr: return make_bool_literal(lhs > rhs, location);
+    case OW_AST_NODE_GeExpr: return make_bool_literal(lhs >= rhs, location);
+    default: return NULL;
+    }
+}
+
+/// Compare two String values, the same way as the interpreter.
+/// Return NULL if it cannot be folded.
+static struct ow_ast_node *fold_string_bin_op(
+    enum ow_ast_node_type op, struct ow_sharedstr *lhs, struct ow_sharedstr *rhs,
+    const struct ow_source_range *location
+) {
+    const size_t size1 = ow_sharedstr_size(lhs), size2 = ow_sharedstr_size(rhs);
+    int cmp = memcmp(
+        ow_sharedstr_data(lhs), ow_sharedstr_data(rhs), size1 < size2 ? size1 : size2);
+    if (!cmp)
+        cmp = size1 == size2 ? 0 : size1 < size2 ? -1 : 1;
+    switch (op) {
+    case OW_AST_NODE_EqExpr: return make_bool_literal(cmp == 0, location);
+    case OW_AST_NODE_NeExpr: return make_bool_literal(cmp != 0, location);
+    case OW_AST_NODE_LtExpr: return make_bool_literal(cmp < 0, location);
+    case OW_AST_NODE_LeExpr: return make_bool_literal(cmp <= 0, location);
+    case OW_AST_NODE_GtExpr: return make_bool_literal(cmp > 0, location);
+    case OW_AST_NODE_GeExpr: return make_bool_literal(cmp >= 0, location);
+    default: return NULL;
+    }
+}
+
+/// Try to evaluate a binary operator expression whose operands have been folded.
+/// Return the result node or NULL.
+static struct ow_ast_node *fold_bin_op(struct ow_ast_BinOpExpr *node) {
+    const enum ow_ast_node_type op = node->type;
+    const struct ow_ast_node *const lhs = (struct ow_ast_node *)node->lhs;
+    const struct ow_ast_node *const rhs = (struct ow_ast_node *)node->rhs;
+    const enum ow_ast_node_type lhs_type = lhs->type, rhs_type = rhs->type;
+
+    if (lhs_type == OW_AST_NODE_IntLiteral && rhs_type == OW_AST_NODE_IntLiteral) {
+        return fold_int_bin_op(
+            op, ((const struct ow_ast_IntLiteral *)lhs)->value,
+            ((const struct ow_ast_IntLiteral *)rhs)->value, &node->location);
+    }
+    if ((lhs_type == OW_AST_NODE_IntLiteral || lhs_type == OW_AST_NODE_FloatLiteral) &&
+            (rhs_type == OW_AST_NODE_IntLiteral || rhs_type == OW_AST_NODE_FloatLiteral)) {
+        const double l = lhs_type == OW_AST_NODE_FloatLiteral ?
+            ((const struct ow_ast_FloatLiteral *)lhs)->value :
+            (double)((const struct ow_ast_IntLiteral *)lhs)->value;
+        const double r = rhs_type == OW_AST_NODE_FloatLiteral ?
+            ((const struct ow_ast_FloatLiteral *)rhs)->value :
+            (double)((const struct ow_ast_IntLiteral *)rhs)->value;
+        return fold_float_bin_op(op, l, r, &node->location);
+    }
+    if (lhs_type == OW_AST_NODE_StringLiteral && rhs_type == OW_AST_NODE_StringLiteral) {
+        return fold_string_bin_op(
+            op, ((const struct ow_ast_StringLiteral *)lhs)->value,
+            ((const struct ow_ast_StringLiteral *)rhs)->value, &node->location);
+    }
+    return NULL;
+}
+
+/// Try to evaluate a unary operator expression whose operand has been folded.
+/// Return the result node or NULL.
+static struct ow_ast_node *fold_un_op(struct ow_ast_UnOpExpr *node) {
+    const struct ow_ast_node *const val = (struct ow_ast_node *)node->val;
+    switch (node->type) {
+    case OW_AST_NODE_NegExpr:
+        if (val->type == OW_AST_NODE_IntLiteral) {
+            const uint64_t v = (uint64_t)((const struct ow_ast_IntLiteral *)val)->value;
+            return make_int_literal((int64_t)(0 - v), &node->location);
+        }
+        if (val->type == OW_AST_NODE_FloatLiteral) {
+            const double v = ((const struct ow_ast_FloatLiteral *)val)->value;
+            return make_float_literal(-v, &node->location);
+        }
+        return NULL;
+    case OW_AST_NODE_BitNotExpr:
+        if (val->type == OW_AST_NODE_IntLiteral) {
+            const uint64_t v = (uint64_t)((const struct ow_ast_IntLiteral *)val)->value;
+            return make_int_literal((int64_t)~v, &node->location);
+        }
+        return NULL;
+    case OW_AST_NODE_NotExpr:
+        if (val->type == OW_AST_NODE_BoolLiteral) {
+            const bool v = ((const struct ow_ast_BoolLiteral *)val)->value;
+            return make_bool_literal(!v, &node->location);
+        }
+        return NULL;
+    default:
+        return NULL;
+    }
+}
+
+/// Information about a module-level variable, for constant propagation.
+struct global_var_info {
+    size_t assign_count; // Number of assignments to the name anywhere.
+    bool is_bound; // Also bound as a function, an argument, a module or a loop variable.
+    struct ow_ast_node *value; // The constant (a literal) once assigned; nullable.
+};
+
+/// Optimizer state.
+struct astopt {
+    int level;
+    bool in_module_scope; // Visiting statements directly in the module.
+    struct ow_hashmap global_vars; // {name, struct global_var_info *}
+};
+
+/// Find or create a variable info.
+static struct global_var_info *astopt_global_var(
+    struct astopt *opt, struct ow_sharedstr *name
+) {
+    struct global_var_info *info =
+        ow_hashmap_get(&opt->global_vars, &ow_sharedstr_hashmap_funcs, name);
+    if (!info) {
+        info = ow_malloc(sizeof(struct global_var_info));
+        info->assign_count = 0;
+        info->is_bound = false;
+        info->value = NULL;
+        ow_hashmap_set(
+            &opt->global_vars, &ow_sharedstr_hashmap_funcs,
+            ow_sharedstr_ref(name), info);
+    }
+    return info;
+}
+
+static int _astopt_global_vars_clear_walker(void *arg, const void *key, void *val) {
+    ow_unused_var(arg);
+    struct global_var_info *const info = val;
+    if (info->value)
+        ow_ast_node_del(info->value);
+    ow_free(info);
+    ow_sharedstr_unref((struct ow_sharedstr *)key);
+    return 0;
+}
+
+/// Mark an identifier as bound by something other than an assignment.
+static void astopt_bind_name(struct astopt *opt, const struct ow_ast_Identifier *name) {
+    if (name)
+        astopt_global_var(opt, name->value)->is_bound = true;
+}
+
+static void astopt_scan_node(struct astopt *opt, const struct ow_ast_node *node);
+
+/// Record names bound in a function.
+static void astopt_scan_func(struct astopt *opt, const struct ow_ast_FuncStmt *node) {
+    astopt_bind_name(opt, node->name);
+    const struct ow_ast_node_array *const args = &node->args->elems;
+    for (size_t i = 0, n = ow_ast_node_array_size(args); i < n; i++) {
+        const struct ow_ast_node *const arg = ow_ast_node_array_at(args, i);
+        if (arg->type == OW_AST_NODE_Identifier)
+            astopt_bind_name(opt, (const struct ow_ast_Identifier *)arg);
+    }
+    for (size_t i = 0, n = ow_ast_node_array_size(&node->stmts); i < n; i++)
+        astopt_scan_node(opt, ow_ast_node_array_at(&node->stmts, i));
+}
+
+/// Count assignments and bindings of names in a subtree.
+static void astopt_scan_node(struct astopt *opt, const struct ow_ast_node *node) {
+    if (!node)
+        return;
+
+    switch (node->type) {
+    ASSIGN_EXPR_CASES: {
+        const struct ow_ast_BinOpExpr *const n = (const struct ow_ast_BinOpExpr *)node;
+        if (((struct ow_ast_node *)n->lhs)->type == OW_AST_NODE_Identifier)
+            astopt_global_var(opt, ((struct ow_ast_Identifier *)n->lhs)->value)->assign_count++;
+        else
+            astopt_scan_node(opt, (struct ow_ast_node *)n->lhs);
+        astopt_scan_node(opt, (struct ow_ast_node *)n->rhs);
+        break;
+    }
+
+    BIN_OP_EXPR_CASES:
+    case OW_AST_NODE_AndExpr:
+    case OW_AST_NODE_OrExpr:
+    case OW_AST_NODE_AttrAccessExpr:
+    case OW_AST_NODE_MethodUseExpr: {
+        const struct ow_ast_BinOpExpr *const n = (const struct ow_ast_BinOpExpr *)node;
+        astopt_scan_node(opt, (struct ow_ast_node *)n->lhs);
+        astopt_scan_node(opt, (struct ow_ast_node *)n->rhs);
+        break;
+    }
+
+    UN_OP_EXPR_CASES:
+        astopt_scan_node(opt, (struct ow_ast_node *)((struct ow_ast_UnOpExpr *)node)->val);
+        break;
+
+    ARRAY_LIKE_EXPR_CASES: {
+        const struct ow_ast_node_array *const elems =
+            &((const struct ow_ast_ArrayLikeExpr *)node)->elems;
+        for (size_t i = 0, n = ow_ast_node_array_size(elems); i < n; i++)
+            astopt_scan_node(opt, ow_ast_node_array_at(elems, i));
+        break;
+    }
+
+    case OW_AST_NODE_MapExpr: {
+        const struct ow_ast_nodepair_array *const pairs =
+            &((const struct ow_ast_MapExpr *)node)->pairs;
+        for (size_t i = 0, n = ow_ast_nodepair_array_size(pairs); i < n; i++) {
+            const struct ow_ast_nodepair_array_elem pair = ow_ast_nodepair_array_at(pairs, i);
+            astopt_scan_node(opt, pair.first);
+            astopt_scan_node(opt, pair.second);
+        }
+        break;
+    }
+
+    CALL_LIKE_EXPR_CASES: {
+        const struct ow_ast_CallLikeExpr *const n = (const struct ow_ast_CallLikeExpr *)node;
+        astopt_scan_node(opt, (struct ow_ast_node *)n->obj);
+        for (size_t i = 0, n_args = ow_ast_node_array_size(&n->args); i < n_args; i++)
+            astopt_scan_node(opt, ow_ast_node_array_at(&n->args, i));
+        break;
+    }
+
+    case OW_AST_NODE_LambdaExpr:
+        astopt_scan_func(opt, ((const struct ow_ast_LambdaExpr *)node)->func);
+        break;
+
+    case OW_AST_NODE_ExprStmt:
+        astopt_scan_node(opt, (struct ow_ast_node *)((struct ow_ast_ExprStmt *)node)->expr);
+        break;
+
+    case OW_AST_NODE_ReturnStmt:
+    case OW_AST_NODE_MagicReturnStmt:
+        astopt_scan_node(opt, (struct ow_ast_node *)((struct ow_ast_ReturnStmt *)node)->ret_val);
+        break;
+
+    case OW_AST_NODE_ImportStmt:
+        astopt_bind_name(opt, ((const struct ow_ast_ImportStmt *)node)->mod_name);
+        break;
+
+    case OW_AST_NODE_IfElseStmt: {
+        const struct ow_ast_IfElseStmt *const n = (const struct ow_ast_IfElseStmt *)node;
+        for (size_t i = 0, n_br = ow_ast_nodepair_array_size(&n->branches); i < n_br; i++) {
+            const struct ow_ast_nodepair_array_elem branch =
+                ow_ast_nodepair_array_at(&n->branches, i);
+            astopt_scan_node(opt, branch.first);
+            astopt_scan_node(opt, branch.second);
+        }
+        astopt_scan_node(opt, (struct ow_ast_node *)n->else_branch);
+        break;
+    }
+
+    case OW_AST_NODE_ForStmt: {
+        const struct ow_ast_ForStmt *const n = (const struct ow_ast_ForStmt *)node;
+        astopt_bind_name(opt, n->var);
+        astopt_scan_node(opt, (struct ow_ast_node *)n->iter);
+        for (size_t i = 0, n_stmts = ow_ast_node_array_size(&n->stmts); i < n_stmts; i++)
+            astopt_scan_node(opt, ow_ast_node_array_at(&n->stmts, i));
+        break;
+    }
+
+    case OW_AST_NODE_WhileStmt:
+        astopt_scan_node(opt, (struct ow_ast_node *)((struct ow_ast_WhileStmt *)node)->cond);
+        // fallthrough
+    case OW_AST_NODE_BlockStmt: {
+        const struct ow_ast_node_array *const stmts =
+            &((const struct ow_ast_BlockStmt *)node)->stmts;
+        for (size_t i = 0, n = ow_ast_node_array_size(stmts); i < n; i++)
+            astopt_scan_node(opt, ow_ast_node_array_at(stmts, i));
+        break;
+    }
+
+    case OW_AST_NODE_FuncStmt:
+        astopt_scan_func(opt, (const struct ow_ast_FuncStmt *)node);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static struct ow_ast_node *astopt_fold_expr(struct astopt *opt, struct ow_ast_node *node);
+static void astopt_optimize_block(struct astopt *opt, struct ow_ast_node_array *stmts);
+
+/// Fold an expression field in place.
+#define FOLD_FIELD(OPT, FIELD) \
+    ((FIELD) = (void *)astopt_fold_expr((OPT), (struct ow_ast_node *)(FIELD)))
+
+/// Fold expressions in an array in place.
+static void astopt_fold_expr_array(struct astopt *opt, struct ow_ast_node_array *arr) {
+    for (size_t i = 0, n = ow_ast_node_array_size(arr); i < n; i++) {
+        struct ow_ast_node *const elem = ow_ast_node_array_at(arr, i);
+        struct ow_ast_node *const new_elem = astopt_fold_expr(opt, elem);
+        if (new_elem != elem)
+            ow_ast_node_array_set(arr, i, new_elem);
+    }
+}
+
+/// Fold sub-expressions of an assignment target, but not the target name itself.
+static void astopt_fold_assign_target(struct astopt *opt, struct ow_ast_node *target) {
+    switch (target->type) {
+    case OW_AST_NODE_AttrAccessExpr:
+        FOLD_FIELD(opt, ((struct ow_ast_AttrAccessExpr *)target)->lhs);
+        break;
+    case OW_AST_NODE_SubscriptExpr: {
+        struct ow_ast_SubscriptExpr *const n = (struct ow_ast_SubscriptExpr *)target;
+        FOLD_FIELD(opt, n->obj);
+        astopt_fold_expr_array(opt, &n->args);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/// Optimize statements in a nested block, such as a function or a loop body.
+static void astopt_optimize_nested_block(
+    struct astopt *opt, struct ow_ast_node_array *stmts
+) {
+    const bool in_module_scope = opt->in_module_scope;
+    opt->in_module_scope = false;
+    astopt_optimize_block(opt, stmts);
+    opt->in_module_scope = in_module_scope;
+}
+
+/// Fold an expression. Return the new expression, which may be the given one.
+/// If a new node is returned, the old one has been deleted.
+static struct ow_ast_node *astopt_fold_expr(struct astopt *opt, struct ow_ast_node *node) {
+    if (!node)
+        return NULL;
+
+    struct ow_ast_node *res = NULL;
+
+    switch (node->type) {
+    case OW_AST_NODE_Identifier:
+        if (opt->level >= 2) {
+            const struct global_var_info *const info = ow_hashmap_get(
+                &opt->global_vars, &ow_sharedstr_hashmap_funcs,
+                ((struct ow_ast_Identifier *)node)->value);
+            if (info && info->value)
+                res = literal_clone(info->value, &node->location);
+        }
+        break;
+
+    case OW_AST_NODE_AndExpr:
+    case OW_AST_NODE_OrExpr: {
+        struct ow_ast_BinOpExpr *const n = (struct ow_ast_BinOpExpr *)node;
+        FOLD_FIELD(opt, n->lhs);
+        FOLD_FIELD(opt, n->rhs);
+        const struct ow_ast_node *const lhs = (struct ow_ast_node *)n->lhs;
+        if (lhs->type == OW_AST_NODE_BoolLiteral) {
+            const bool lhs_val = ((const struct ow_ast_BoolLiteral *)lhs)->value;
+            // `true and x` => `x`; `false and x` => `false`;
+            // `true or x` => `true`; `false or x` => `x`.
+            if (lhs_val == (node->type == OW_AST_NODE_AndExpr)) {
+                res = (struct ow_ast_node *)n->rhs;
+                n->rhs = NULL;
+            } else {
+                res = (struct ow_ast_node *)n->lhs;
+                n->lhs = NULL;
+            }
+        }
+        break;
+    }
+
+    BIN_OP_EXPR_CASES: {
+        struct ow_ast_BinOpExpr *const n = (struct ow_ast_BinOpExpr *)node;
+        FOLD_FIELD(opt, n->lhs);
+        FOLD_FIELD(opt, n->rhs);
+        res = fold_bin_op(n);
+        break;
+    }
+
+    ASSIGN_EXPR_CASES: {
+        struct ow_ast_BinOpExpr *const n = (struct ow_ast_BinOpExpr *)node;
+        astopt_fold_assign_target(opt, (struct ow_ast_node *)n->lhs);
+        FOLD_FIELD(opt, n->rhs);
+        break;
+    }
+
+    case OW_AST_NODE_AttrAccessExpr:
+    case OW_AST_NODE_MethodUseExpr:
+        FOLD_FIELD(opt, ((struct ow_ast_BinOpExpr *)node)->lhs);
+        break;
+
+    UN_OP_EXPR_CASES: {
+        struct ow_ast_UnOpExpr *const n = (struct ow_ast_UnOpExpr *)node;
+        FOLD_FIELD(opt, n->val);
+        res = fold_un_op(n);
+        break;
+    }
+
+    ARRAY_LIKE_EXPR_CASES:
+        astopt_fold_expr_array(opt, &((struct ow_ast_ArrayLikeExpr *)node)->elems);
+        break;
+
+    case OW_AST_NODE_MapExpr: {
+        struct ow_ast_nodepair_array *const pairs = &((struct ow_ast_MapExpr *)node)->pairs;
+        for (size_t i = 0, n = ow_ast_nodepair_array_size(pairs); i < n; i++) {
+            struct ow_ast_nodepair_array_elem *const pair = &ow_xarray_at(
+                &pairs->_data, struct ow_ast_nodepair_array_elem, i);
+            pair->first = astopt_fold_expr(opt, pair->first);
+            pair->second = astopt_fold_expr(opt, pair->second);
+        }
+        break;
+    }
+
+    CALL_LIKE_EXPR_CASES: {
+        struct ow_ast_CallLikeExpr *const n = (struct ow_ast_CallLikeExpr *)node;
+        FOLD_FIELD(opt, n->obj);
+        astopt_fold_expr_array(opt, &n->args);
+        break;
+    }
+
+    case OW_AST_NODE_LambdaExpr:
+        astopt_optimize_nested_block(opt, &((struct ow_ast_LambdaExpr *)node)->func->stmts);
+        break;
+
+    default:
+        break;
+    }
+
+    if (!res)
+        return node;
+    ow_ast_node_del(node);
+    return res;
+}
+
+/// Check whether a node is a Bool literal with the given value.
+static bool node_is_bool(const struct ow_ast_node *node, bool value) {
+    return node->type == OW_AST_NODE_BoolLiteral &&
+        ((const struct ow_ast_BoolLiteral *)node)->value == value;
+}
+
+/// Move statements of a block to the end of an array and delete the block.
+static void splice_block(struct ow_ast_node_array *dst, struct ow_ast_BlockStmt *block) {
+    const size_t n = ow_ast_node_array_size(&block->stmts);
+    for (size_t i = 0; i < n; i++)
+        ow_ast_node_array_append(dst, ow_ast_node_array_at(&block->stmts, i));
+    for (size_t i = 0; i < n; i++)
+        ow_ast_node_array_drop(&block->stmts);
+    ow_ast_node_del((struct ow_ast_node *)block);
+}
+
+/// Remove dead branches of an if-else statement and optimize the rest.
+/// Statements to replace it with are appended to `out`.
+static void astopt_optimize_if_else(
+    struct astopt *opt, struct ow_ast_IfElseStmt *node, struct ow_ast_node_array *out
+) {
+    const size_t branch_count = ow_ast_nodepair_array_size(&node->branches);
+    struct ow_ast_nodepair_array_elem *const branches =
+        ow_malloc(sizeof(struct ow_ast_nodepair_array_elem) * (branch_count + 1));
+    for (size_t i = branch_count; i > 0; i--)
+        branches[i - 1] = ow_ast_nodepair_array_drop(&node->branches);
+
+    for (size_t i = 0; i < branch_count; i++) {
+        struct ow_ast_node *const cond = astopt_fold_expr(opt, branches[i].first);
+        struct ow_ast_BlockStmt *const body = (struct ow_ast_BlockStmt *)branches[i].second;
+        if (node_is_bool(cond, false)) {
+            ow_ast_node_del(cond);
+            ow_ast_node_del((struct ow_ast_node *)body);
+            continue;
+        }
+        if (node_is_bool(cond, true)) {
+            // This branch is always taken. Following branches are dead.
+            ow_ast_node_del(cond);
+            for (size_t j = i + 1; j < branch_count; j++) {
+                ow_ast_node_del(branches[j].first);
+                ow_ast_node_del(branches[j].second);
+            }
+            if (node->else_branch)
+                ow_ast_node_del((struct ow_ast_node *)node->else_branch);
+            node->else_branch = body;
+            break;
+        }
+        astopt_optimize_nested_block(opt, &body->stmts);
+        ow_ast_nodepair_array_append(
+            &node->branches,
+            (struct ow_ast_nodepair_array_elem){cond, (struct ow_ast_node *)body});
+    }
+    ow_free(branches);
+
+    if (node->else_branch)
+        astopt_optimize_nested_block(opt, &node->else_branch->stmts);
+
+    if (ow_ast_nodepair_array_size(&node->branches)) {
+        ow_ast_node_array_append(out, (struct ow_ast_node *)node);
+        return;
+    }
+    if (node->else_branch) {
+        splice_block(out, node->else_branch);
+        node->else_branch = NULL;
+    }
+    ow_ast_node_del((struct ow_ast_node *)node);
+}
+
+/// If the statement assigns a literal to a name that is a module-level constant,
+/// remember the value for propagation.
+static void astopt_record_constant(struct astopt *opt, const struct ow_ast_ExprStmt *stmt) {
+    const struct ow_ast_node *const expr = (struct ow_ast_node *)stmt->expr;
+    if (expr->type != OW_AST_NODE_EqlExpr)
+        return;
+    const struct ow_ast_EqlExpr *const assign = (const struct ow_ast_EqlExpr *)expr;
+    const struct ow_ast_node *const lhs = (struct ow_ast_node *)assign->lhs;
+    const struct ow_ast_node *const rhs = (struct ow_ast_node *)assign->rhs;
+    if (lhs->type != OW_AST_NODE_Identifier || !node_is_literal(rhs))
+        return;
+    struct global_var_info *const info = ow_hashmap_get(
+        &opt->global_vars, &ow_sharedstr_hashmap_funcs,
+        ((const struct ow_ast_Identifier *)lhs)->value);
+    assert(info);
+    if (info->assign_count != 1 || info->is_bound)
+        return;
+    assert(!info->value);
+    info->value = literal_clone(rhs, &rhs->location);
+}
+
+/// Optimize statements: fold expressions, remove dead branches and unreachable statements.
+static void astopt_optimize_block(struct astopt *opt, struct ow_ast_node_array *stmts) {
+    const size_t stmt_count = ow_ast_node_array_size(stmts);
+    struct ow_ast_node **const old_stmts =
+        ow_malloc(sizeof(struct ow_ast_node *) * (stmt_count + 1));
+    for (size_t i = stmt_count; i > 0; i--)
+        old_stmts[i - 1] = ow_ast_node_array_drop(stmts);
+
+    bool unreachable = false;
+    for (size_t i = 0; i < stmt_count; i++) {
+        struct ow_ast_node *const stmt = old_stmts[i];
+        if (unreachable) {
+            ow_ast_node_del(stmt);
+            continue;
+        }
+
+        switch (stmt->type) {
+        case OW_AST_NODE_ExprStmt: {
+            struct ow_ast_ExprStmt *const n = (struct ow_ast_ExprStmt *)stmt;
+            FOLD_FIELD(opt, n->expr);
+            if (node_is_literal((struct ow_ast_node *)n->expr)) {
+                ow_ast_node_del(stmt); // No effect.
+                continue;
+            }
+            if (opt->level >= 2 && opt->in_module_scope)
+                astopt_record_constant(opt, n);
+            break;
+        }
+
+        case OW_AST_NODE_ReturnStmt:
+        case OW_AST_NODE_MagicReturnStmt:
+            FOLD_FIELD(opt, ((struct ow_ast_ReturnStmt *)stmt)->ret_val);
+            unreachable = true;
+            break;
+
+        case OW_AST_NODE_IfElseStmt: {
+            const size_t n = ow_ast_node_array_size(stmts);
+            astopt_optimize_if_else(opt, (struct ow_ast_IfElseStmt *)stmt, stmts);
+            const size_t n1 = ow_ast_node_array_size(stmts);
+            if (n1 > n) {
+                const struct ow_ast_node *const last = ow_ast_node_array_last(stmts);
+                if (last->type == OW_AST_NODE_ReturnStmt ||
+                        last->type == OW_AST_NODE_MagicReturnStmt)
+                    unreachable = true;
+            }
+            continue;
+        }
+
+        case OW_AST_NODE_WhileStmt: {
+            struct ow_ast_WhileStmt *const n = (struct ow_ast_WhileStmt *)stmt;
+            FOLD_FIELD(opt, n->cond);
+            if (node_is_bool((struct ow_ast_node *)n->cond, false)) {
+                ow_ast_node_del(stmt);
+                continue;
+            }
+            astopt_optimize_nested_block(opt, &n->stmts);
+            // There is no `break`; an infinite loop can only be left by returning.
+            if (node_is_bool((struct ow_ast_node *)n->cond, true))
+                unreachable = true;
+            break;
+        }
+
+        case OW_AST_NODE_ForStmt: {
+            struct ow_ast_ForStmt *const n = (struct ow_ast_ForStmt *)stmt;
+            FOLD_FIELD(opt, n->iter);
+            astopt_optimize_nested_block(opt, &n->stmts);
+            break;
+        }
+
+        case OW_AST_NODE_BlockStmt:
+            astopt_optimize_nested_block(opt, &((struct ow_ast_BlockStmt *)stmt)->stmts);
+            break;
+
+        case OW_AST_NODE_FuncStmt:
+            astopt_optimize_nested_block(opt, &((struct ow_ast_FuncStmt *)stmt)->stmts);
+            break;
+
+        default:
+            break;
+        }
+
+        ow_ast_node_array_append(stmts, stmt);
+    }
+
+    ow_free(old_stmts);
+}
+
+void ow_ast_optimize(struct ow_ast *ast, int level) {
+    struct ow_ast_Module *const module = ow_ast_get_module(ast);
+    if (level <= 0 || !module || !module->code)
+        return;
+
+    struct astopt opt;
+    opt.level = level;
+    opt.in_module_scope = true;
+    ow_hashmap_init(&opt.global_vars, 0);
+
+    if (level >= 2)
+        astopt_scan_node(&opt, (struct ow_ast_node *)module->code);
+    astopt_optimize_block(&opt, &module->code->stmts);
+
+    ow_hashmap_foreach(&opt.global_vars, _astopt_global_vars_clear_walker, NULL);
+    ow_hashmap_fini(&opt.global_vars);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+struct ow_ast;
+
+/// Optimize an AST in place before code generation.
+/// Level 0 does nothing; level 1 folds constant expressions and removes dead
+/// branches and unreachable statements; level 2 also propagates module-level
+/// variables that are assigned a constant once and never reassigned.
+void ow_ast_optimize(struct ow_ast *ast, int level);
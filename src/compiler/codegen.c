@@ -1077,11 +1077,13 @@ static void ow_codegen_emit_MapExpr(
         codegen, action, &node->pairs, &node->location, OW_OPC_MkMap, OW_OPC_MkMapW);
 }
 
-static void ow_codegen_emit_CallExpr(
+/// Emit a call expression with instruction `Call` or `TailCall`.
+static void ow_codegen_emit_call(
     struct ow_codegen *codegen, enum codegen_action action,
-    const struct ow_ast_CallExpr *node
+    const struct ow_ast_CallExpr *node, enum ow_opcode opcode
 ) {
     assert(action == ACT_PUSH || action == ACT_EVAL);
+    assert(opcode == OW_OPC_Call || (opcode == OW_OPC_TailCall && action == ACT_PUSH));
     struct ow_assembler *const as = code_stack_top(&codegen->code_stack);
     size_t arg_cnt = ow_ast_node_array_size(&node->args);
     if (node->obj->type == OW_AST_NODE_MethodUseExpr) {
@@ -1100,7 +1102,14 @@ static void ow_codegen_emit_CallExpr(
     if (ow_unlikely(arg_cnt > (UINT8_MAX >> 1)))
         ow_codegen_error_throw(codegen, &node->location, "too many arguments");
     const uint8_t operand = (uint8_t)arg_cnt | (action == ACT_EVAL ? (1 << 7) : 0);
-    ow_assembler_append(as, OW_OPC_Call, (union ow_operand){.u8 = operand});
+    ow_assembler_append(as, opcode, (union ow_operand){.u8 = operand});
+}
+
+static void ow_codegen_emit_CallExpr(
+    struct ow_codegen *codegen, enum codegen_action action,
+    const struct ow_ast_CallExpr *node
+) {
+    ow_codegen_emit_call(codegen, action, node, OW_OPC_Call);
 }
 
 static void ow_codegen_emit_SubscriptExpr(
@@ -1202,7 +1211,15 @@ static void ow_codegen_emit_ReturnStmt(
             ow_assembler_append(as, OW_OPC_RetLoc, (union ow_operand){.u8 = (uint8_t)index});
             return;
         } while (0);
-        ow_codegen_emit_node(codegen, ACT_PUSH, (struct ow_ast_node *)node->ret_val);
+        if (node->ret_val->type == OW_AST_NODE_CallExpr &&
+                scope_stack_top(&codegen->scope_stack)->type == SCOPE_FUNC) {
+            // The `Ret` is reached only if the callee cannot replace current frame.
+            ow_codegen_emit_call(
+                codegen, ACT_PUSH, (const struct ow_ast_CallExpr *)node->ret_val,
+                OW_OPC_TailCall);
+        } else {
+            ow_codegen_emit_node(codegen, ACT_PUSH, (struct ow_ast_node *)node->ret_val);
+        }
         ow_assembler_append(as, OW_OPC_Ret, (union ow_operand){.u8 = 0});
     } else {
         ow_assembler_append(as, OW_OPC_RetNil, (union ow_operand){.u8 = 0});
@@ -1272,7 +1289,21 @@ static void ow_codegen_emit_ForStmt(
     const struct ow_ast_ForStmt *node
 ) {
     ow_unused_var(action);
-    ow_codegen_error_throw_not_implemented(codegen, &node->location);
+    assert(action == ACT_EVAL);
+    struct ow_assembler *const as = code_stack_top(&codegen->code_stack);
+
+    // The iterated object and the iteration position stay on stack during the loop.
+    ow_codegen_emit_node(
+        codegen, ACT_PUSH, (const struct ow_ast_node *)node->iter);
+    ow_assembler_append(as, OW_OPC_PrepIter, (union ow_operand){.u8 = 0});
+    const int lbl_begin = ow_assembler_place_label(as, -1);
+    const int lbl_end = ow_assembler_prepare_label(as);
+    ow_assembler_append_jump(as, OW_OPC_ForIter, lbl_end);
+    ow_codegen_emit_Identifier(codegen, ACT_RECV, node->var);
+    ow_codegen_emit_BlockStmt(
+        codegen, ACT_EVAL, (const struct ow_ast_BlockStmt *)node);
+    ow_assembler_append_jump(as, OW_OPC_Jmp, lbl_begin);
+    ow_assembler_place_label(as, lbl_end);
 }
 
 static void ow_codegen_emit_WhileStmt(
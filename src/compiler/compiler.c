@@ -1,6 +1,7 @@
 #include "compiler.h"
 
 #include "ast.h"
+#include "astopt.h"
 #include "codegen.h"
 #include "lexer.h"
 #include "parser.h"
@@ -83,6 +84,11 @@ bool ow_compiler_compile(
         if (ow_unlikely(flags & OW_COMPILE_RETLASTEXPR))
             modify_ast_return_last_expr(&ast);
 
+        int opt_level = OW_COMPILE_OPTLEVEL(flags);
+        if (ow_unlikely(flags & OW_COMPILE_RETLASTEXPR) && opt_level > 1)
+            opt_level = 1; // Globals may be reassigned by code compiled later.
+        ow_ast_optimize(&ast, opt_level);
+
         if (!ow_codegen_generate(compiler->codegen, &ast, 0, module)) {
             compiler->last_error_source = ERR_SRC_CODEGEN;
             break;
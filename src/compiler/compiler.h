@@ -16,6 +16,10 @@ struct ow_syntax_error;
 struct ow_compiler;
 
 #define OW_COMPILE_RETLASTEXPR    0x0001
+/// Optimization level (0 to 2) in compile flags. See `ow_ast_optimize()`.
+#define OW_COMPILE_OPTIMIZE(LEVEL)  (((LEVEL) & 0x3) << 4)
+/// Get optimization level from compile flags.
+#define OW_COMPILE_OPTLEVEL(FLAGS)  (((FLAGS) >> 4) & 0x3)
 
 /// Create a compiler.
 ow_nodiscard struct ow_compiler *ow_compiler_new(struct ow_machine *om);
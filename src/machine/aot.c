@@ -0,0 +1,844 @@
+#include "aot.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "symbols.h"
+#include <bytecode/opcode.h>
+#include <bytecode/operand.h>
+#include <objects/arrayobj.h>
+#include <objects/classes.h>
+#include <objects/exceptionobj.h>
+#include <objects/floatobj.h>
+#include <objects/intobj.h>
+#include <objects/objmem.h>
+#include <objects/stringobj.h>
+#include <objects/symbolobj.h>
+#include <utilities/filesystem.h>
+#include <utilities/memalloc.h>
+#include <utilities/platform.h>
+#include <utilities/process.h>
+#include <utilities/stream.h>
+
+#include <config/definitions.h>
+
+#if _IS_POSIX_
+#    include <errno.h>
+#    include <spawn.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+extern char **environ;
+#endif
+
+/*
+ * Each instruction is translated into a statement that works on the machine
+ * stack like the interpreter does. Simple instructions and the fast paths of
+ * operators on small values are written inline; the others call
+ * `ow_aot_rt_exec()`. Jumps become `goto` statements.
+ */
+
+struct aot_func {
+    struct ow_func_obj *func;
+    const char *name; // Name for messages, or NULL.
+    size_t pool_base; // Pool index of the first constant; symbols follow constants.
+    size_t constant_count;
+    size_t symbol_count;
+};
+
+struct aot_generator {
+    struct ow_machine *om;
+    struct ow_stream *out;
+    struct aot_func *funcs;
+    size_t func_count;
+    size_t func_capacity;
+    struct ow_symbol_obj **globals; // Globals of the source module, by index.
+    size_t global_count;
+    size_t pool_size;
+    const char *error; // Static string, or NULL.
+};
+
+static void gen_printf(struct aot_generator *g, const char *fmt, ...) {
+    char buffer[256];
+    va_list ap;
+    va_start(ap, fmt);
+    const int n = vsnprintf(buffer, sizeof buffer, fmt, ap);
+    va_end(ap);
+    assert(n >= 0 && (size_t)n < sizeof buffer);
+    ow_stream_write(g->out, buffer, (size_t)n);
+}
+
+/// Write a C string literal.
+static void gen_string(struct aot_generator *g, const char *s, size_t n) {
+    ow_stream_putc(g->out, '"');
+    for (size_t i = 0; i < n; i++) {
+        const unsigned char c = (unsigned char)s[i];
+        if (c == '"' || c == '\\' || c == '?') {
+            ow_stream_putc(g->out, '\\');
+            ow_stream_putc(g->out, c);
+        } else if (c >= 0x20 && c < 0x7f) {
+            ow_stream_putc(g->out, c);
+        } else {
+            gen_printf(g, "\\%03o", c);
+        }
+    }
+    ow_stream_putc(g->out, '"');
+}
+
+/// Find or add a function. Return its index.
+static size_t gen_add_func(struct aot_generator *g, struct ow_func_obj *func) {
+    for (size_t i = 0; i < g->func_count; i++) {
+        if (g->funcs[i].func == func)
+            return i;
+    }
+    if (g->func_count == g->func_capacity) {
+        g->func_capacity = g->func_capacity ? g->func_capacity * 2 : 8;
+        g->funcs = ow_realloc(g->funcs, g->func_capacity * sizeof g->funcs[0]);
+    }
+    struct aot_func *const f = &g->funcs[g->func_count];
+    f->func = func;
+    f->name = NULL;
+    f->constant_count = 0;
+    while (ow_func_obj_get_constant(func, f->constant_count))
+        f->constant_count++;
+    f->symbol_count = 0;
+    while (ow_func_obj_get_symbol(func, f->symbol_count))
+        f->symbol_count++;
+    f->pool_base = g->pool_size;
+    g->pool_size += f->constant_count + f->symbol_count;
+    return g->func_count++;
+}
+
+/// Find a global of the source module. Return its index or -1.
+static size_t gen_find_global(const struct aot_generator *g, const struct ow_symbol_obj *name) {
+    for (size_t i = 0; i < g->global_count; i++) {
+        if (g->globals[i] == name)
+            return i;
+    }
+    return (size_t)-1;
+}
+
+/// Add functions referred by constants of function `index`, naming them after
+/// the globals they are stored to.
+static void gen_collect_funcs(struct aot_generator *g, size_t index) {
+    struct ow_func_obj *const func = g->funcs[index].func;
+    struct ow_class_obj *const func_class = g->om->builtin_classes->func;
+    const unsigned char *const code = func->code;
+    for (size_t off = 0; off < func->code_size; ) {
+        const enum ow_opcode opcode = ow_opcode_generic((enum ow_opcode)code[off]);
+        const enum ow_operand_type operand_type = ow_operand_type(opcode);
+        const size_t next = off + 1 + ow_operand_type_width(operand_type);
+        if (opcode == OW_OPC_LdCnst || opcode == OW_OPC_LdCnstW) {
+            struct ow_object *const obj = ow_func_obj_get_constant(
+                func, (size_t)ow_operand_read(code + off + 1, operand_type));
+            if (obj && !ow_smallval_check(obj) && ow_object_class(obj) == func_class) {
+                const size_t i = gen_add_func(g, ow_object_cast(obj, struct ow_func_obj));
+                const enum ow_opcode next_opcode = next < func->code_size ?
+                    ow_opcode_generic((enum ow_opcode)code[next]) : OW_OPC_Nop;
+                if ((next_opcode == OW_OPC_StGlob || next_opcode == OW_OPC_StGlobW) &&
+                        !g->funcs[i].name) {
+                    const size_t global_index = (size_t)ow_operand_read(
+                        code + next + 1, ow_operand_type(next_opcode));
+                    if (global_index < g->global_count)
+                        g->funcs[i].name = ow_symbol_obj_data(g->globals[global_index]);
+                }
+            }
+        }
+        off = next;
+    }
+}
+
+static void gen_constants(struct aot_generator *g) {
+    struct ow_builtin_classes *const bic = g->om->builtin_classes;
+    gen_printf(g, "static const struct ow_aot_constant aot_constants[] = {\n");
+    for (size_t fi = 0; fi < g->func_count; fi++) {
+        const struct aot_func *const f = &g->funcs[fi];
+        for (size_t i = 0; i < f->constant_count; i++) {
+            struct ow_object *const obj = ow_func_obj_get_constant(f->func, i);
+            gen_printf(g, "    ");
+            if (ow_smallint_check(obj)) {
+                gen_printf(g, "{OW_AOT_CONST_INT, .i = INT64_C(%" PRId64 ")}",
+                    (int64_t)ow_smallint_from_ptr(obj));
+            } else if (ow_smallfloat_check(obj) || ow_object_class(obj) == bic->float_) {
+                const double v = ow_smallfloat_check(obj) ? ow_smallfloat_from_ptr(obj) :
+                    ow_float_obj_value(ow_object_cast(obj, struct ow_float_obj));
+                if (isnan(v))
+                    gen_printf(g, "{OW_AOT_CONST_FLT, .f = NAN}");
+                else if (isinf(v))
+                    gen_printf(g, "{OW_AOT_CONST_FLT, .f = %sHUGE_VAL}", v < 0 ? "-" : "");
+                else
+                    gen_printf(g, "{OW_AOT_CONST_FLT, .f = %a}", v);
+            } else if (ow_object_class(obj) == bic->int_) {
+                const int64_t v = ow_int_obj_value(ow_object_cast(obj, struct ow_int_obj));
+                if (v == INT64_MIN)
+                    gen_printf(g, "{OW_AOT_CONST_INT, .i = INT64_MIN}");
+                else
+                    gen_printf(g, "{OW_AOT_CONST_INT, .i = INT64_C(%" PRId64 ")}", v);
+            } else if (ow_object_class(obj) == bic->string) {
+                struct ow_string_obj *const str = ow_object_cast(obj, struct ow_string_obj);
+                size_t size;
+                const char *const data = ow_string_obj_flatten(g->om, str, &size);
+                gen_printf(g, "{OW_AOT_CONST_STR, .s = {");
+                gen_string(g, data, size);
+                gen_printf(g, ", %zu}}", size);
+            } else if (ow_object_class(obj) == bic->func) {
+                struct ow_func_obj *const func = ow_object_cast(obj, struct ow_func_obj);
+                const size_t index = gen_add_func(g, func);
+                const char *const name = g->funcs[index].name;
+                gen_printf(g, "{OW_AOT_CONST_FUNC, .func = {aot_func_%zu, ", index);
+                gen_string(g, name ? name : "<lambda>", strlen(name ? name : "<lambda>"));
+                gen_printf(g, ", %i}}", func->func_spec.arg_cnt);
+            } else {
+                g->error = "unsupported type of constant";
+                return;
+            }
+            gen_printf(g, ", // %zu\n", f->pool_base + i);
+        }
+        for (size_t i = 0; i < f->symbol_count; i++) {
+            struct ow_symbol_obj *const sym = ow_func_obj_get_symbol(f->func, i);
+            gen_printf(g, "    {OW_AOT_CONST_SYM, .s = {");
+            gen_string(g, ow_symbol_obj_data(sym), ow_symbol_obj_size(sym));
+            gen_printf(g, ", %zu}}, // %zu\n",
+                ow_symbol_obj_size(sym), f->pool_base + f->constant_count + i);
+        }
+    }
+    gen_printf(g, "    {OW_AOT_CONST_INT, .i = 0}, // unused\n};\n\n");
+
+    gen_printf(g, "static const char *const aot_globals[] = {\n");
+    for (size_t i = 0; i < g->global_count; i++) {
+        gen_printf(g, "    ");
+        gen_string(g, ow_symbol_obj_data(g->globals[i]), ow_symbol_obj_size(g->globals[i]));
+        gen_printf(g, ",\n");
+    }
+    gen_printf(g, "    NULL,\n};\n\n");
+}
+
+/// Get C operator of an arithmetic or comparison opcode. Return NULL if not one.
+static const char *gen_operator(enum ow_opcode opcode) {
+    switch (opcode) {
+    case OW_OPC_Add:   return "+";
+    case OW_OPC_Sub:   return "-";
+    case OW_OPC_Mul:   return "*";
+    case OW_OPC_Div:   return "/";
+    case OW_OPC_Rem:   return "%";
+    case OW_OPC_Shl:   return "<<";
+    case OW_OPC_Shr:   return ">>";
+    case OW_OPC_And:   return "&";
+    case OW_OPC_Or:    return "|";
+    case OW_OPC_Xor:   return "^";
+    case OW_OPC_Neg:   return "-";
+    case OW_OPC_Inv:   return "~";
+    case OW_OPC_CmpLt: return "<";
+    case OW_OPC_CmpLe: return "<=";
+    case OW_OPC_CmpGt: return ">";
+    case OW_OPC_CmpGe: return ">=";
+    case OW_OPC_CmpEq: return "==";
+    case OW_OPC_CmpNe: return "!=";
+    default:           return NULL;
+    }
+}
+
+/// Translate function `index`.
+static void gen_func(struct aot_generator *g, size_t index) {
+    const struct aot_func *const f = &g->funcs[index];
+    const unsigned char *const code = f->func->code;
+    const size_t code_size = f->func->code_size;
+
+    bool *const is_target = ow_malloc(code_size + 1);
+    memset(is_target, 0, code_size + 1);
+    for (size_t off = 0; off < code_size; ) {
+        const enum ow_opcode opcode = ow_opcode_generic((enum ow_opcode)code[off]);
+        const enum ow_operand_type operand_type = ow_operand_type(opcode);
+        if ((opcode >= OW_OPC_Jmp && opcode <= OW_OPC_JmpUnlsW) ||
+                opcode == OW_OPC_ForIter || opcode == OW_OPC_ForIterW) {
+            const ptrdiff_t target = (ptrdiff_t)off + ow_operand_read(code + off + 1, operand_type);
+            if (target < 0 || (size_t)target >= code_size) {
+                g->error = "jump target out of range";
+                ow_free(is_target);
+                return;
+            }
+            is_target[target] = true;
+        }
+        off += 1 + ow_operand_type_width(operand_type);
+    }
+
+    gen_printf(g, "static int aot_func_%zu(struct ow_machine *om) {\n", index);
+    gen_printf(g, "    OW_AOT_FUNC_BEGIN(%u)\n", f->func->func_spec.local_cnt);
+    if (index == 0) {
+        gen_printf(g, "    ow_aot_rt_init(om, aot_constants, %zu, aot_globals, %zu);\n",
+            g->pool_size, g->global_count);
+    }
+
+    bool uses_raise = false;
+    for (size_t off = 0; off < code_size; ) {
+        const enum ow_opcode opcode = ow_opcode_generic((enum ow_opcode)code[off]);
+        const enum ow_operand_type operand_type = ow_operand_type(opcode);
+        const int operand = ow_operand_read(code + off + 1, operand_type);
+        size_t next = off + 1 + ow_operand_type_width(operand_type);
+        const char *const op = gen_operator(opcode);
+
+        if (is_target[off])
+            gen_printf(g, "L%zu:;\n", off);
+        gen_printf(g, "    ");
+
+        switch (opcode) {
+        case OW_OPC_Nop:
+            gen_printf(g, ";");
+            break;
+
+        case OW_OPC_Swap:
+            gen_printf(g, "{ struct ow_object *const t = sp[0]; sp[0] = sp[-1]; sp[-1] = t; }");
+            break;
+
+        case OW_OPC_SwapN:
+            if (operand > 1) {
+                gen_printf(g, "{ struct ow_object *const t = sp[0]; "
+                    "for (int i = 0; i < %i; i++) sp[-i] = sp[-i - 1]; sp[%i] = t; }",
+                    operand - 1, 1 - operand);
+            } else {
+                gen_printf(g, ";");
+            }
+            break;
+
+        case OW_OPC_Drop:
+            gen_printf(g, "sp--;");
+            break;
+
+        case OW_OPC_DropN:
+            gen_printf(g, "sp -= %i;", operand);
+            break;
+
+        case OW_OPC_Dup:
+            gen_printf(g, "sp[1] = sp[0], sp++;");
+            break;
+
+        case OW_OPC_DupN:
+            gen_printf(g, "for (int i = 1; i <= %i; i++) sp[i] = sp[0]; sp += %i;",
+                operand, operand);
+            break;
+
+        case OW_OPC_LdNil:
+            gen_printf(g, "*++sp = om->globals->value_nil;");
+            break;
+
+        case OW_OPC_LdBool:
+            gen_printf(g, "*++sp = OW_AOT_BOOL(%i);", operand ? 1 : 0);
+            break;
+
+        case OW_OPC_LdInt:
+        case OW_OPC_LdIntW:
+            gen_printf(g, "*++sp = ow_smallint_to_ptr(%i);", operand);
+            break;
+
+        case OW_OPC_LdFlt:
+            gen_printf(g, "OW_AOT_PUSH_FLT(%i);", operand);
+            uses_raise = true;
+            break;
+
+        case OW_OPC_Add:
+        case OW_OPC_Sub:
+        case OW_OPC_Mul:
+        case OW_OPC_Div:
+            gen_printf(g, "OW_AOT_ARITH_OP(%s, %s);", ow_opcode_name(opcode), op);
+            uses_raise = true;
+            break;
+
+        case OW_OPC_Rem:
+        case OW_OPC_Shl:
+        case OW_OPC_Shr:
+        case OW_OPC_And:
+        case OW_OPC_Or:
+        case OW_OPC_Xor:
+            gen_printf(g, "OW_AOT_INT_OP(%s, %s);", ow_opcode_name(opcode), op);
+            uses_raise = true;
+            break;
+
+        case OW_OPC_Neg:
+        case OW_OPC_Inv:
+            gen_printf(g, "OW_AOT_UN_OP(%s, %s);", ow_opcode_name(opcode), op);
+            uses_raise = true;
+            break;
+
+        case OW_OPC_Is:
+            gen_printf(g, "sp--, *sp = OW_AOT_BOOL(sp[0] == sp[1]);");
+            break;
+
+        case OW_OPC_CmpLt:
+        case OW_OPC_CmpLe:
+        case OW_OPC_CmpGt:
+        case OW_OPC_CmpGe:
+        case OW_OPC_CmpEq:
+        case OW_OPC_CmpNe: {
+            const enum ow_opcode next_opcode = next < code_size ?
+                ow_opcode_generic((enum ow_opcode)code[next]) : OW_OPC_Nop;
+            if (!is_target[next] && next_opcode >= OW_OPC_JmpWhen &&
+                    next_opcode <= OW_OPC_JmpUnlsW) {
+                const enum ow_operand_type jmp_operand_type = ow_operand_type(next_opcode);
+                const size_t target =
+                    next + (size_t)ow_operand_read(code + next + 1, jmp_operand_type);
+                const bool when = next_opcode == OW_OPC_JmpWhen || next_opcode == OW_OPC_JmpWhenW;
+                gen_printf(g, "OW_AOT_CMP_JMP_IF(%s, %s, %i, L%zu);",
+                    ow_opcode_name(opcode), op, when ? 1 : 0, target);
+                next += 1 + ow_operand_type_width(jmp_operand_type);
+            } else {
+                gen_printf(g, "OW_AOT_CMP_OP(%s, %s);", ow_opcode_name(opcode), op);
+            }
+            uses_raise = true;
+            break;
+        }
+
+        case OW_OPC_LdCnst:
+        case OW_OPC_LdCnstW:
+        case OW_OPC_LdSym:
+        case OW_OPC_LdSymW: {
+            const bool is_sym = opcode == OW_OPC_LdSym || opcode == OW_OPC_LdSymW;
+            if ((size_t)operand >= (is_sym ? f->symbol_count : f->constant_count)) {
+                g->error = "illegal operand";
+                break;
+            }
+            gen_printf(g, "*++sp = OW_AOT_CONST(%zu);",
+                f->pool_base + (is_sym ? f->constant_count : 0) + (size_t)operand);
+            break;
+        }
+
+        case OW_OPC_LdArg:
+            gen_printf(g, "*++sp = args[%i];", operand);
+            break;
+
+        case OW_OPC_StArg:
+            gen_printf(g, "args[%i] = *sp--;", operand);
+            break;
+
+        case OW_OPC_LdLoc:
+        case OW_OPC_LdLocW:
+            gen_printf(g, "*++sp = fp[%i];", operand);
+            break;
+
+        case OW_OPC_StLoc:
+        case OW_OPC_StLocW:
+            gen_printf(g, "fp[%i] = *sp--;", operand);
+            break;
+
+        case OW_OPC_LdGlob:
+        case OW_OPC_LdGlobW:
+        case OW_OPC_StGlob:
+        case OW_OPC_StGlobW:
+            if ((size_t)operand >= g->global_count) {
+                g->error = "illegal operand";
+                break;
+            }
+            gen_printf(g,
+                opcode == OW_OPC_LdGlob || opcode == OW_OPC_LdGlobW ?
+                    "OW_AOT_LOAD_GLOBAL(%zu); // %s" : "OW_AOT_STORE_GLOBAL(%zu); // %s",
+                OW_AOT_GLOBAL_BASE + (size_t)operand,
+                ow_symbol_obj_data(g->globals[operand]));
+            uses_raise = true;
+            break;
+
+        case OW_OPC_LdGlobY:
+        case OW_OPC_LdGlobYW:
+        case OW_OPC_StGlobY:
+        case OW_OPC_StGlobYW: {
+            const bool is_load = opcode == OW_OPC_LdGlobY || opcode == OW_OPC_LdGlobYW;
+            if ((size_t)operand >= f->symbol_count) {
+                g->error = "illegal operand";
+                break;
+            }
+            struct ow_symbol_obj *const name = ow_func_obj_get_symbol(f->func, (size_t)operand);
+            const size_t name_index = f->pool_base + f->constant_count + (size_t)operand;
+            const size_t global_index = gen_find_global(g, name);
+            if (global_index != (size_t)-1) {
+                // Globals of the source module are declared first, so the index is known.
+                gen_printf(g, is_load ?
+                    "OW_AOT_LOAD_GLOBAL(%zu); // %s" : "OW_AOT_STORE_GLOBAL(%zu); // %s",
+                    OW_AOT_GLOBAL_BASE + global_index, ow_symbol_obj_data(name));
+                uses_raise = true;
+            } else if (is_load) {
+                gen_printf(g, "OW_AOT_LOAD_GLOBAL_Y(%zu, &aot_cells[%zu]); // %s",
+                    name_index, name_index, ow_symbol_obj_data(name));
+            } else {
+                gen_printf(g, "OW_AOT_EXEC(OW_OPC_StGlobY, 0, OW_AOT_SYMBOL(%zu)); // %s",
+                    name_index, ow_symbol_obj_data(name));
+                uses_raise = true;
+            }
+            break;
+        }
+
+        case OW_OPC_LdAttrY:
+        case OW_OPC_LdAttrYW:
+        case OW_OPC_StAttrY:
+        case OW_OPC_StAttrYW:
+        case OW_OPC_PrepMethY:
+        case OW_OPC_PrepMethYW:
+        case OW_OPC_LdMod: {
+            if ((size_t)operand >= f->symbol_count) {
+                g->error = "illegal operand";
+                break;
+            }
+            const enum ow_opcode base_opcode =
+                opcode == OW_OPC_LdMod ? opcode : (enum ow_opcode)(opcode & ~1);
+            gen_printf(g, "OW_AOT_EXEC(OW_OPC_%s, 0, OW_AOT_SYMBOL(%zu)); // %s",
+                ow_opcode_name(base_opcode),
+                f->pool_base + f->constant_count + (size_t)operand,
+                ow_symbol_obj_data(ow_func_obj_get_symbol(f->func, (size_t)operand)));
+            uses_raise = true;
+            break;
+        }
+
+        case OW_OPC_Jmp:
+        case OW_OPC_JmpW:
+            gen_printf(g, "goto L%zu;", (size_t)((ptrdiff_t)off + operand));
+            break;
+
+        case OW_OPC_JmpWhen:
+        case OW_OPC_JmpWhenW:
+        case OW_OPC_JmpUnls:
+        case OW_OPC_JmpUnlsW: {
+            const bool when = opcode == OW_OPC_JmpWhen || opcode == OW_OPC_JmpWhenW;
+            gen_printf(g, "OW_AOT_JMP_IF(%i, L%zu);",
+                when ? 1 : 0, (size_t)((ptrdiff_t)off + operand));
+            uses_raise = true;
+            break;
+        }
+
+        case OW_OPC_ForIter:
+        case OW_OPC_ForIterW:
+            gen_printf(g, "OW_AOT_FOR_ITER(L%zu);", (size_t)((ptrdiff_t)off + operand));
+            uses_raise = true;
+            break;
+
+        case OW_OPC_Ret:
+            gen_printf(g, "OW_AOT_RETURN(1);");
+            break;
+
+        case OW_OPC_RetNil:
+            gen_printf(g, "OW_AOT_RETURN(0);");
+            break;
+
+        case OW_OPC_RetLoc:
+            gen_printf(g, "*++sp = fp[%i]; OW_AOT_RETURN(1);", operand);
+            break;
+
+        case OW_OPC_MkArrW:
+        case OW_OPC_MkTupW:
+        case OW_OPC_MkSetW:
+        case OW_OPC_MkMapW:
+            gen_printf(g, "OW_AOT_EXEC(OW_OPC_%s, %i, NULL);",
+                ow_opcode_name((enum ow_opcode)(opcode & ~1)), operand);
+            uses_raise = true;
+            break;
+
+        default:
+            // Not, Cmp, LdElem, StElem, Call, MkArr, ... and unimplemented ones.
+            gen_printf(g, "OW_AOT_EXEC(OW_OPC_%s, %i, NULL);",
+                ow_opcode_name(opcode), operand);
+            uses_raise = true;
+            break;
+        }
+
+        gen_printf(g, "\n");
+        if (g->error)
+            break;
+        off = next;
+    }
+
+    gen_printf(g, "    OW_AOT_RETURN(0);\n");
+    if (uses_raise)
+        gen_printf(g, "raise_exc:\n    return -1;\n");
+    gen_printf(g, "}\n\n");
+    ow_free(is_target);
+}
+
+static int gen_global_walker(
+    void *arg, struct ow_symbol_obj *name, size_t index, struct ow_object *value
+) {
+    ow_unused_var(value);
+    struct aot_generator *const g = arg;
+    if (index < g->global_count)
+        g->globals[index] = name;
+    return 0;
+}
+
+struct ow_exception_obj *ow_aot_generate(
+    struct ow_machine *om, struct ow_module_obj *module,
+    const char *name, struct ow_stream *out
+) {
+    struct ow_symbol_obj *const sym_anon = om->common_symbols->anon;
+    const size_t anon_index = ow_module_obj_find_global(module, sym_anon);
+    struct ow_object *const init_func = anon_index == (size_t)-1 ? NULL :
+        ow_module_obj_get_global(module, anon_index);
+    if (!init_func || ow_smallval_check(init_func) ||
+            ow_object_class(init_func) != om->builtin_classes->func) {
+        return ow_exception_format(
+            om, NULL, "module `%s' has not been compiled from source code", name);
+    }
+    // The initializer is the last global; the others are those of the source.
+    assert(anon_index + 1 == ow_module_obj_global_count(module));
+
+    struct aot_generator g = {
+        .om = om,
+        .out = out,
+        .global_count = anon_index,
+    };
+    g.globals = ow_malloc((g.global_count + 1) * sizeof g.globals[0]);
+    ow_module_obj_foreach_global(module, gen_global_walker, &g);
+
+    // Objects must not move during generation.
+    ow_objmem_push_ngc(om);
+    gen_add_func(&g, ow_object_cast(init_func, struct ow_func_obj));
+    g.funcs[0].name = "<module>";
+    for (size_t i = 0; i < g.func_count; i++)
+        gen_collect_funcs(&g, i);
+
+    gen_printf(&g, "// Native module `%s', generated from compiled code by owiz.\n\n", name);
+    gen_printf(&g, "#include <math.h>\n#include <stdint.h>\n\n");
+    gen_printf(&g, "#include <machine/aot.h>\n#include <modules/modules_util.h>\n\n");
+    for (size_t i = 0; i < g.func_count; i++) {
+        const char *const func_name = g.funcs[i].name ? g.funcs[i].name : "<lambda>";
+        gen_printf(&g, "static int aot_func_%zu(struct ow_machine *); // ", i);
+        gen_string(&g, func_name, strlen(func_name));
+        gen_printf(&g, "\n");
+    }
+    gen_printf(&g, "\n");
+    gen_constants(&g);
+    // Cells are indexed like the constant pool, one for each symbol of each function.
+    gen_printf(&g, "static struct ow_func_obj_global_cell aot_cells[%zu];\n\n", g.pool_size + 1);
+    for (size_t i = 0; i < g.func_count && !g.error; i++)
+        gen_func(&g, i);
+
+    gen_printf(&g, "static const struct ow_native_func_def aot_functions[] = {\n");
+    gen_printf(&g, "    {\"\", aot_func_0, 0, 0},\n    {NULL, NULL, 0, 0},\n};\n\n");
+    gen_printf(&g, "OW_BIMOD_MODULE_DEF(%s) = {\n", name);
+    gen_printf(&g, "    .name = \"%s\",\n    .functions = aot_functions,\n", name);
+    gen_printf(&g, "    .finalizer = NULL,\n};\n");
+
+    ow_objmem_pop_ngc(om);
+    ow_free(g.funcs);
+    ow_free(g.globals);
+    if (g.error)
+        return ow_exception_format(om, NULL, "cannot compile module `%s': %s", name, g.error);
+    return NULL;
+}
+
+/// Check whether the string is a C identifier.
+static bool is_identifier(const char *s) {
+    if (!(*s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z')))
+        return false;
+    for (s++; *s; s++) {
+        if (!(*s == '_' || (*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') ||
+                (*s >= '0' && *s <= '9')))
+            return false;
+    }
+    return true;
+}
+
+#if _IS_POSIX_
+
+/// Append `prefix` followed by `n` (or all if -1) chars of `arg` to a C compiler
+/// argument list. Strings in the list are deallocated with `ow_free()`.
+static void aot_args_add(struct ow_array *args, const char *prefix, const char *arg, size_t n) {
+    const size_t prefix_len = strlen(prefix);
+    if (n == (size_t)-1)
+        n = strlen(arg);
+    char *const s = ow_malloc(prefix_len + n + 1);
+    memcpy(s, prefix, prefix_len);
+    memcpy(s + prefix_len, arg, n);
+    s[prefix_len + n] = '\0';
+    ow_array_append(args, s);
+}
+
+/// Append each non-empty part of `list` separated by `sep`, following `prefix`.
+static void aot_args_add_split(
+    struct ow_array *args, const char *prefix, const char *list, char sep
+) {
+    if (!list)
+        return;
+    for (const char *p = list; *p; ) {
+        const char *const end = strchr(p, sep);
+        const size_t n = end ? (size_t)(end - p) : strlen(p);
+        if (n)
+            aot_args_add(args, prefix, p, n);
+        p += n + (end ? 1 : 0);
+    }
+}
+
+/// Append `-I` options for the headers that generated code includes. They are
+/// taken from environment variable `OWIZ_AOT_INCLUDE` (directories separated by
+/// colons) if set, or the installation next to the executable if any, or else
+/// the source and build trees.
+static void aot_args_add_include_dirs(struct ow_array *args) {
+    const char *const env_dirs = getenv("OWIZ_AOT_INCLUDE");
+    if (env_dirs && *env_dirs) {
+        aot_args_add_split(args, "-I", env_dirs, ':');
+        return;
+    }
+
+    const ow_path_char_t *const exe_path = ow_current_exe_path();
+    if (exe_path) {
+        ow_path_char_t *const exe_dir = ow_path_dup(ow_path_parent(exe_path));
+        const bool installed = ow_fs_exists(ow_path_join(exe_dir, "../include/owiz"));
+        if (installed) {
+            aot_args_add(args, "-I", ow_path_join(exe_dir, "../include/owiz"), (size_t)-1);
+            aot_args_add(args, "-I", ow_path_join(exe_dir, "../include"), (size_t)-1);
+        }
+        ow_free(exe_dir);
+        if (installed)
+            return;
+    }
+
+    static const char *const build_dirs[] = {OW_AOT_INCLUDE_DIRS};
+    for (size_t i = 0; i < sizeof build_dirs / sizeof build_dirs[0]; i++)
+        aot_args_add(args, "-I", build_dirs[i], (size_t)-1);
+}
+
+#endif // _IS_POSIX_
+
+struct ow_exception_obj *ow_aot_compile(
+    struct ow_machine *om, struct ow_module_obj *module, const char *out_path
+) {
+    char name[128];
+    {
+        const ow_path_char_t *const stem = ow_path_stem(OW_PATH_FROM_STR(out_path));
+#if _IS_WINDOWS_
+        char *const stem_str = ow_winpath_to_str(stem);
+        snprintf(name, sizeof name, "%s", stem_str);
+        ow_free(stem_str);
+#else
+        snprintf(name, sizeof name, "%s", stem);
+#endif
+    }
+    if (!is_identifier(name)) {
+        return ow_exception_format(
+            om, NULL, "illegal module name `%s' (from file name `%s')", name, out_path);
+    }
+
+    const size_t out_path_len = strlen(out_path);
+    const bool source_only = out_path_len > 2 && !strcmp(out_path + out_path_len - 2, ".c");
+    char *const src_path = ow_malloc(out_path_len + 3);
+    memcpy(src_path, out_path, out_path_len);
+    strcpy(src_path + out_path_len, source_only ? "" : ".c");
+
+    struct ow_exception_obj *exc = NULL;
+    struct ow_stream *const out = ow_stream_open_file(
+        OW_PATH_FROM_STR(src_path), OW_STREAM_OPEN_WRITE | OW_STREAM_OPEN_CREATE);
+    if (!out) {
+        exc = ow_exception_format(om, NULL, "cannot open file `%s'", src_path);
+        goto end;
+    }
+    exc = ow_aot_generate(om, module, name, out);
+    ow_stream_close(out);
+    if (exc || source_only)
+        goto end;
+
+#if _IS_POSIX_
+    {
+        // Build the source with the same headers that the runtime was built with.
+        const char *cc = getenv("OWIZ_AOT_CC");
+        if (!cc || !*cc)
+            cc = OW_AOT_CC;
+        struct ow_array args;
+        ow_array_init(&args, 16);
+        aot_args_add(&args, "", cc, (size_t)-1);
+        aot_args_add(&args, "", "-O2", (size_t)-1);
+        aot_args_add(&args, "", "-fPIC", (size_t)-1);
+        aot_args_add(&args, "", "-shared", (size_t)-1);
+        aot_args_add(&args, "", "-DOW_EXPORT_MOD=1", (size_t)-1);
+        aot_args_add_include_dirs(&args);
+        aot_args_add_split(&args, "", getenv("OWIZ_AOT_CFLAGS"), ' ');
+        aot_args_add(&args, "", "-o", (size_t)-1);
+        aot_args_add(&args, "", out_path, (size_t)-1);
+        aot_args_add(&args, "", src_path, (size_t)-1);
+        ow_array_append(&args, NULL);
+
+        int status = 0;
+        pid_t pid;
+        const int err = posix_spawnp(
+            &pid, cc, NULL, NULL, (char **)ow_array_data(&args), environ);
+        if (!err) {
+            while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+                continue;
+        }
+        for (size_t i = 0, n = ow_array_size(&args); i < n; i++)
+            ow_free(ow_array_at(&args, i));
+        ow_array_fini(&args);
+        remove(src_path);
+        if (err || (WIFEXITED(status) && WEXITSTATUS(status) == 127)) {
+            // The command cannot be found or run.
+            exc = ow_exception_format(
+                om, NULL, "C compiler `%s' is not available", cc);
+        } else if (status != 0) {
+            exc = ow_exception_format(
+                om, NULL, "cannot build `%s' with C compiler `%s' (status %i)",
+                out_path, cc, status);
+        }
+    }
+#else
+    remove(src_path);
+    exc = ow_exception_format(
+        om, NULL, "building native modules is not supported on this platform");
+#endif
+
+end:
+    ow_free(src_path);
+    return exc;
+}
+
+void ow_aot_rt_init(
+    struct ow_machine *om, const struct ow_aot_constant *constants, size_t constant_count,
+    const char *const *global_names, size_t global_count
+) {
+    ow_objmem_push_ngc(om);
+
+    struct ow_module_obj *const module = ow_object_cast(
+        om->callstack.frame_info_list.current->arg_list[-1],
+        struct ow_cfunc_obj)->module;
+    struct ow_object **const pool = ow_malloc((constant_count + 1) * sizeof pool[0]);
+    for (size_t i = 0; i < constant_count; i++) {
+        const struct ow_aot_constant *const c = &constants[i];
+        struct ow_object *obj;
+        switch (c->type) {
+        case OW_AOT_CONST_INT:
+            obj = ow_int_obj_or_smallint(om, c->i);
+            break;
+        case OW_AOT_CONST_FLT:
+            obj = ow_float_obj_or_smallfloat(om, c->f);
+            break;
+        case OW_AOT_CONST_STR:
+            obj = ow_object_from(ow_string_obj_new(om, c->s.p, c->s.n));
+            break;
+        case OW_AOT_CONST_SYM:
+            obj = ow_object_from(ow_symbol_obj_new(om, c->s.p, c->s.n));
+            break;
+        case OW_AOT_CONST_FUNC:
+            obj = ow_object_from(ow_cfunc_obj_new(
+                om, module, c->func.name, c->func.code,
+                &(struct ow_func_spec){c->func.argc, 0, 0}));
+            break;
+        default:
+            obj = om->globals->value_nil;
+            break;
+        }
+        pool[i] = obj;
+    }
+    struct ow_array_obj *const pool_obj = ow_array_obj_new(om, pool, constant_count);
+    ow_free(pool);
+
+    size_t index = ow_module_obj_set_global_y(
+        module, ow_symbol_obj_new(om, OW_AOT_POOL_NAME, (size_t)-1),
+        ow_object_from(pool_obj));
+    ow_unused_var(index);
+    assert(index == OW_AOT_POOL_INDEX);
+    for (size_t i = 0; i < global_count; i++) {
+        index = ow_module_obj_set_global_y(
+            module, ow_symbol_obj_new(om, global_names[i], (size_t)-1),
+            om->globals->value_nil);
+        assert(index == OW_AOT_GLOBAL_BASE + i);
+    }
+
+    ow_objmem_pop_ngc(om);
+}
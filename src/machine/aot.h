@@ -0,0 +1,296 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "globals.h"
+#include "machine.h"
+#include <bytecode/opcode.h>
+#include <objects/arrayobj.h>
+#include <objects/cfuncobj.h>
+#include <objects/funcobj.h>
+#include <objects/moduleobj.h>
+#include <objects/natives.h>
+#include <objects/object.h>
+#include <objects/smallint.h>
+#include <utilities/array.h>
+#include <utilities/attributes.h>
+
+struct ow_exception_obj;
+struct ow_stream;
+struct ow_symbol_obj;
+
+/*
+ * Ahead-of-time compilation translates the functions of a compiled module into
+ * C functions of a native module (".owo"). Each function follows the calling
+ * convention of `ow_cfunc_obj` and keeps the frame layout of the interpreter,
+ * so values live on the machine stack where the GC can find them.
+ *
+ * Globals of an AOT-compiled module: the initializer (named by the anonymous
+ * symbol), the constant pool (an array), and then globals of the source module
+ * in their original order.
+ *
+ * Native modules are loaded as plugins of the runtime library, whose internal
+ * symbols are hidden. So the generated code only uses inline functions and the
+ * `ow_aot_rt_*()` functions, which are exported with `OW_AOT_RT_API`.
+ */
+
+#if (__GNUC__ + 0 >= 4) || defined(__clang__)
+#    define OW_AOT_RT_API __attribute__((used, visibility("default")))
+#else
+#    define OW_AOT_RT_API
+#endif
+
+/// Name of the module global that holds the constant pool.
+#define OW_AOT_POOL_NAME    ".aot"
+/// Index of the constant pool in module globals.
+#define OW_AOT_POOL_INDEX   1
+/// Index of the first global of the source module in module globals.
+#define OW_AOT_GLOBAL_BASE  2
+
+/// Description of an object in the constant pool.
+struct ow_aot_constant {
+    enum ow_aot_constant_type {
+        OW_AOT_CONST_INT,
+        OW_AOT_CONST_FLT,
+        OW_AOT_CONST_STR,
+        OW_AOT_CONST_SYM,
+        OW_AOT_CONST_FUNC,
+    } type;
+    union {
+        int64_t i;
+        double f;
+        struct { const char *p; size_t n; } s;
+        struct { ow_native_func_t code; const char *name; int argc; } func;
+    };
+};
+
+/// Translate the functions of a compiled module to C source of a native module
+/// named `name`. Return NULL on success, or an exception on failure.
+struct ow_exception_obj *ow_aot_generate(
+    struct ow_machine *om, struct ow_module_obj *module,
+    const char *name, struct ow_stream *out);
+/// Translate a compiled module and build it into a native module file at `out_path`
+/// with the C compiler. The module name is the file name without extension.
+/// If `out_path` ends with ".c", write the C source only. The compiler is run
+/// directly, not by a shell. Headers come from the directories in environment
+/// variable `OWIZ_AOT_INCLUDE`, the installation, or the source and build trees.
+/// Return NULL on success, or an exception on failure.
+struct ow_exception_obj *ow_aot_compile(
+    struct ow_machine *om, struct ow_module_obj *module, const char *out_path);
+
+/// Runtime function for AOT-compiled code. Create the constant pool and declare
+/// globals of the source module, in the module of the running function.
+OW_AOT_RT_API void ow_aot_rt_init(
+    struct ow_machine *om, const struct ow_aot_constant *constants, size_t constant_count,
+    const char *const *global_names, size_t global_count);
+/// Runtime function for AOT-compiled code, implemented by the interpreter. Execute
+/// an instruction; `name` is the symbol that its operand refers to, if any.
+/// The stack top shall have been stored to `om->callstack.regs.sp`, which is updated
+/// when it returns. Return `0` on success, `1` if it is a jump instruction and the
+/// jump shall be taken, or `-1` if an exception was raised (it is on the stack top).
+OW_AOT_RT_API int ow_aot_rt_exec(
+    struct ow_machine *om, enum ow_opcode opcode, size_t operand,
+    struct ow_symbol_obj *name);
+/// Runtime function for AOT-compiled code, implemented by the interpreter. Push
+/// a global variable that is not in the source module, binding `cell` to its slot.
+OW_AOT_RT_API void ow_aot_rt_load_global_y(
+    struct ow_machine *om, struct ow_symbol_obj *name,
+    struct ow_func_obj_global_cell *cell);
+
+/* ----- Building blocks of generated code ----------------------------------- */
+// They use the variables `om`, `args`, `fp` and `sp` and the label `raise_exc`.
+
+#define OW_AOT_FUNC_BEGIN(LOCAL_COUNT) \
+    struct ow_object **const args = om->callstack.frame_info_list.current->arg_list; \
+    struct ow_object **const fp = om->callstack.regs.fp; \
+    struct ow_object **sp = om->callstack.regs.sp; \
+    ow_unused_var(args), ow_unused_var(fp); \
+    for (size_t _i = 0; _i < (LOCAL_COUNT); _i++) \
+        *++sp = om->globals->value_nil; \
+// ^^^ OW_AOT_FUNC_BEGIN() ^^^
+
+#define OW_AOT_RETURN(HAS_VALUE) \
+    do { \
+        om->callstack.regs.sp = sp; \
+        return (HAS_VALUE); \
+    } while (0) \
+// ^^^ OW_AOT_RETURN() ^^^
+
+#define OW_AOT_MODULE() \
+    (ow_object_cast(args[-1], struct ow_cfunc_obj)->module)
+
+#define OW_AOT_CONST(INDEX) \
+    ow_array_at(ow_array_obj_data(ow_object_cast( \
+        ow_module_obj_get_global(OW_AOT_MODULE(), OW_AOT_POOL_INDEX), \
+        struct ow_array_obj)), (INDEX)) \
+// ^^^ OW_AOT_CONST() ^^^
+
+#define OW_AOT_SYMBOL(INDEX) \
+    ow_object_cast(OW_AOT_CONST(INDEX), struct ow_symbol_obj)
+
+#define OW_AOT_BOOL(VALUE) \
+    ((VALUE) ? om->globals->value_true : om->globals->value_false)
+
+#define OW_AOT_EXEC(OPCODE, OPERAND, NAME) \
+    do { \
+        om->callstack.regs.sp = sp; \
+        if (ow_unlikely(ow_aot_rt_exec(om, (OPCODE), (OPERAND), (NAME)))) \
+            goto raise_exc; \
+        sp = om->callstack.regs.sp; \
+    } while (0) \
+// ^^^ OW_AOT_EXEC() ^^^
+
+#define OW_AOT_LOAD_GLOBAL(INDEX) \
+    do { \
+        struct ow_object *const _v = \
+            ow_module_obj_get_global(OW_AOT_MODULE(), (INDEX)); \
+        *++sp = ow_likely(_v) ? _v : om->globals->value_nil; \
+    } while (0) \
+// ^^^ OW_AOT_LOAD_GLOBAL() ^^^
+
+#define OW_AOT_STORE_GLOBAL(INDEX) \
+    OW_AOT_EXEC(OW_OPC_StGlob, (INDEX), NULL)
+
+#define OW_AOT_LOAD_GLOBAL_Y(NAME_INDEX, CELL) \
+    do { \
+        om->callstack.regs.sp = sp; \
+        ow_aot_rt_load_global_y(om, OW_AOT_SYMBOL(NAME_INDEX), (CELL)); \
+        sp = om->callstack.regs.sp; \
+    } while (0) \
+// ^^^ OW_AOT_LOAD_GLOBAL_Y() ^^^
+
+#define OW_AOT_PUSH_FLT(VALUE) \
+    do { \
+        struct ow_object *const _v = ow_smallfloat_try_to_ptr((double)(VALUE)); \
+        if (ow_likely(_v)) \
+            *++sp = _v; \
+        else \
+            OW_AOT_EXEC(OW_OPC_LdFlt, (size_t)(ptrdiff_t)(VALUE), NULL); \
+    } while (0) \
+// ^^^ OW_AOT_PUSH_FLT() ^^^
+
+#define OW_AOT_RHS_OK(NAME, RHS) \
+    ((OW_OPC_##NAME != OW_OPC_Div && OW_OPC_##NAME != OW_OPC_Rem) || \
+        (RHS) != ow_smallint_to_ptr(0)) && \
+    ((OW_OPC_##NAME != OW_OPC_Shl && OW_OPC_##NAME != OW_OPC_Shr) || \
+        (uintptr_t)ow_smallint_from_ptr(RHS) < 64) \
+// ^^^ OW_AOT_RHS_OK() ^^^
+
+/// Binary operator with small int and small float fast paths.
+#define OW_AOT_ARITH_OP(NAME, OPERATOR) \
+    do { \
+        struct ow_object *const _lhs = sp[-1], *const _rhs = sp[0]; \
+        struct ow_object *_res; \
+        if (ow_smallint_check(_lhs) && ow_smallint_check(_rhs) && \
+            OW_AOT_RHS_OK(NAME, _rhs) && \
+            (_res = ow_smallint_try_to_ptr( \
+                ow_smallint_from_ptr(_lhs) OPERATOR ow_smallint_from_ptr(_rhs))) \
+        ) { \
+            *--sp = _res; \
+        } else if (ow_smallfloat_check(_lhs) && ow_smallfloat_check(_rhs) && \
+            (_res = ow_smallfloat_try_to_ptr( \
+                ow_smallfloat_from_ptr(_lhs) OPERATOR ow_smallfloat_from_ptr(_rhs))) \
+        ) { \
+            *--sp = _res; \
+        } else { \
+            OW_AOT_EXEC(OW_OPC_##NAME, 0, NULL); \
+        } \
+    } while (0) \
+// ^^^ OW_AOT_ARITH_OP() ^^^
+
+/// Binary operator with a small int fast path.
+#define OW_AOT_INT_OP(NAME, OPERATOR) \
+    do { \
+        struct ow_object *const _lhs = sp[-1], *const _rhs = sp[0]; \
+        struct ow_object *_res; \
+        if (ow_smallint_check(_lhs) && ow_smallint_check(_rhs) && \
+            OW_AOT_RHS_OK(NAME, _rhs) && \
+            (_res = ow_smallint_try_to_ptr( \
+                ow_smallint_from_ptr(_lhs) OPERATOR ow_smallint_from_ptr(_rhs))) \
+        ) { \
+            *--sp = _res; \
+        } else { \
+            OW_AOT_EXEC(OW_OPC_##NAME, 0, NULL); \
+        } \
+    } while (0) \
+// ^^^ OW_AOT_INT_OP() ^^^
+
+/// Unary operator with a small int fast path.
+#define OW_AOT_UN_OP(NAME, OPERATOR) \
+    do { \
+        struct ow_object *const _val = sp[0]; \
+        struct ow_object *_res; \
+        if (ow_smallint_check(_val) && \
+            (_res = ow_smallint_try_to_ptr(OPERATOR ow_smallint_from_ptr(_val))) \
+        ) { \
+            *sp = _res; \
+        } else { \
+            OW_AOT_EXEC(OW_OPC_##NAME, 0, NULL); \
+        } \
+    } while (0) \
+// ^^^ OW_AOT_UN_OP() ^^^
+
+/// Comparison operator with small int and small float fast paths.
+#define OW_AOT_CMP_OP(NAME, OPERATOR) \
+    do { \
+        struct ow_object *const _lhs = sp[-1], *const _rhs = sp[0]; \
+        if (ow_smallint_check(_lhs) && ow_smallint_check(_rhs)) { \
+            sp--; \
+            *sp = OW_AOT_BOOL( \
+                ow_smallint_from_ptr(_lhs) OPERATOR ow_smallint_from_ptr(_rhs)); \
+        } else if (ow_smallfloat_check(_lhs) && ow_smallfloat_check(_rhs)) { \
+            sp--; \
+            *sp = OW_AOT_BOOL( \
+                ow_smallfloat_from_ptr(_lhs) OPERATOR ow_smallfloat_from_ptr(_rhs)); \
+        } else { \
+            OW_AOT_EXEC(OW_OPC_##NAME, 0, NULL); \
+        } \
+    } while (0) \
+// ^^^ OW_AOT_CMP_OP() ^^^
+
+/// Jump to `LABEL` if the popped condition is `WHEN` (true or false).
+#define OW_AOT_JMP_IF(WHEN, LABEL) \
+    do { \
+        struct ow_object *const _cond = *sp--; \
+        if (_cond == om->globals->value_true) { \
+            if (WHEN) \
+                goto LABEL; \
+        } else if (ow_likely(_cond == om->globals->value_false)) { \
+            if (!(WHEN)) \
+                goto LABEL; \
+        } else { \
+            OW_AOT_EXEC(OW_OPC_JmpWhen, 0, NULL); \
+        } \
+    } while (0) \
+// ^^^ OW_AOT_JMP_IF() ^^^
+
+/// `ForIter`: push the next element, or drop the iterated object and the position
+/// and jump at the end.
+#define OW_AOT_FOR_ITER(LABEL) \
+    do { \
+        om->callstack.regs.sp = sp; \
+        const int _status = ow_aot_rt_exec(om, OW_OPC_ForIter, 0, NULL); \
+        sp = om->callstack.regs.sp; \
+        if (ow_unlikely(_status < 0)) \
+            goto raise_exc; \
+        if (_status) \
+            goto LABEL; \
+    } while (0) \
+// ^^^ OW_AOT_FOR_ITER() ^^^
+
+/// A comparison followed by a conditional jump, without making the boolean object
+/// when both operands are small ints.
+#define OW_AOT_CMP_JMP_IF(NAME, OPERATOR, WHEN, LABEL) \
+    do { \
+        struct ow_object *const _lhs = sp[-1], *const _rhs = sp[0]; \
+        if (ow_likely(ow_smallint_check(_lhs) && ow_smallint_check(_rhs))) { \
+            sp -= 2; \
+            if ((ow_smallint_from_ptr(_lhs) OPERATOR ow_smallint_from_ptr(_rhs)) == (WHEN)) \
+                goto LABEL; \
+        } else { \
+            OW_AOT_CMP_OP(NAME, OPERATOR); \
+            OW_AOT_JMP_IF(WHEN, LABEL); \
+        } \
+    } while (0) \
+// ^^^ OW_AOT_CMP_JMP_IF() ^^^
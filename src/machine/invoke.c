@@ -2,11 +2,18 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+#include "aot.h"
 #include "globals.h"
+#include "jit.h"
 #include "machine.h"
+#include "regvm.h"
 #include "symbols.h"
+#include "sysparam.h"
+#include "trace.h"
 #include <bytecode/opcode.h>
 #include <bytecode/operand.h>
 #include <machine/modmgr.h>
@@ -22,13 +29,89 @@
 #include <objects/objmem.h>
 #include <objects/moduleobj.h>
 #include <objects/object.h>
+#include <objects/rangeobj.h>
 #include <objects/setobj.h>
 #include <objects/smallint.h>
+#include <objects/stringobj.h>
 #include <objects/symbolobj.h>
 #include <objects/tupleobj.h>
+#include <utilities/array.h>
 #include <utilities/attributes.h>
+#include <utilities/debuglog.h>
 #include <utilities/unreachable.h>
 
+#include <config/options.h>
+
+/// Whether to use direct-threaded dispatching (labels as values) in `invoke_impl()`.
+#if OW_BUILD_THREADED_DISPATCH && defined __GNUC__
+#    define INVOKE_IMPL_THREADED 1
+#else
+#    define INVOKE_IMPL_THREADED 0
+#endif
+
+/// Whether to keep the top stack value in a local variable in `invoke_impl()`
+/// (stack caching). It needs a second dispatch table, so threaded dispatching.
+#if OW_BUILD_STACK_CACHING && INVOKE_IMPL_THREADED
+#    define INVOKE_IMPL_TOS_CACHE 1
+#else
+#    define INVOKE_IMPL_TOS_CACHE 0
+#endif
+
+/// Instructions that have an implementation for the cached state.
+#define INVOKE_IMPL_TOS_OP_LIST \
+    ELEM(Drop) ELEM(Dup) \
+    ELEM(LdNil) ELEM(LdBool) ELEM(LdInt) ELEM(LdIntW) \
+    ELEM(AddInt) ELEM(SubInt) ELEM(MulInt) \
+    ELEM(CmpLtInt) ELEM(CmpLeInt) ELEM(CmpGtInt) \
+    ELEM(CmpGeInt) ELEM(CmpEqInt) ELEM(CmpNeInt) \
+    ELEM(CmpLtJmp) ELEM(CmpLeJmp) ELEM(CmpGtJmp) \
+    ELEM(CmpGeJmp) ELEM(CmpEqJmp) ELEM(CmpNeJmp) \
+    ELEM(LdCnst) ELEM(LdCnstW) ELEM(LdArg) ELEM(StArg) \
+    ELEM(LdLoc) ELEM(LdLocW) ELEM(StLoc) ELEM(StLocW) ELEM(LdLoc2) \
+    ELEM(JmpWhen) ELEM(JmpWhenW) ELEM(JmpUnls) ELEM(JmpUnlsW) \
+// ^^^ INVOKE_IMPL_TOS_OP_LIST ^^^
+
+#if OW_DEBUG_OPSTAT
+
+/// Counters of executed opcode pairs (generic opcodes), for choosing superinstructions.
+static struct {
+    size_t counts[_OW_OPC_COUNT][_OW_OPC_COUNT];
+    size_t total; // Executed instructions.
+    const unsigned char *prev_ip;
+    unsigned char prev_opcode;
+} invoke_impl_opstat;
+
+/// Count the instruction at `ip` and the one before it if it falls through.
+ow_noinline static void invoke_impl_opstat_count(const unsigned char *ip) {
+    const enum ow_opcode opcode = ow_opcode_generic((enum ow_opcode)*ip);
+    const unsigned char prev_opcode = invoke_impl_opstat.prev_opcode;
+    if (invoke_impl_opstat.prev_ip && invoke_impl_opstat.prev_ip + 1 +
+            ow_operand_type_width(ow_operand_type((enum ow_opcode)prev_opcode)) == ip)
+        invoke_impl_opstat.counts[prev_opcode][opcode]++;
+    invoke_impl_opstat.total++;
+    invoke_impl_opstat.prev_ip = ip;
+    invoke_impl_opstat.prev_opcode = (unsigned char)opcode;
+}
+
+void ow_machine_opstat_dump(void) {
+    for (size_t i = 0; i < _OW_OPC_COUNT; i++) {
+        for (size_t j = 0; j < _OW_OPC_COUNT; j++) {
+            const size_t n = invoke_impl_opstat.counts[i][j];
+            if (!n)
+                continue;
+            ow_debuglog_print(
+                "OpStat", INFO, "%s %s %zu",
+                ow_opcode_name((enum ow_opcode)i), ow_opcode_name((enum ow_opcode)j), n);
+        }
+    }
+    ow_debuglog_print("OpStat", INFO, "total %zu", invoke_impl_opstat.total);
+}
+
+#    define OPSTAT_COUNT(IP)  invoke_impl_opstat_count(IP)
+#else // !OW_DEBUG_OPSTAT
+#    define OPSTAT_COUNT(IP)  ((void)0)
+#endif // OW_DEBUG_OPSTAT
+
 /// Adjust argc (push nils).
 ow_forceinline static void invoke_impl_argc_adjust(
     struct ow_machine *om, size_t orig_argc, size_t expected_argc
@@ -98,11 +181,8 @@ ow_nodiscard ow_noinline static bool invoke_impl_get_method_y(
     struct ow_machine *om, struct ow_object *obj,
     struct ow_symbol_obj *name, struct ow_object **result
 ) {
-    struct ow_class_obj *obj_class;
-    if (ow_unlikely(ow_smallint_check(obj)))
-        obj_class = om->builtin_classes->int_;
-    else
-        obj_class = ow_object_class(obj);
+    struct ow_class_obj *const obj_class =
+        ow_builtin_classes_class_of(om->builtin_classes, obj);
     const size_t index = ow_class_obj_find_method(obj_class, name);
     if (ow_likely(index != (size_t)-1)) {
         *result = ow_class_obj_get_method(obj_class, index);
@@ -111,6 +191,324 @@ ow_nodiscard ow_noinline static bool invoke_impl_get_method_y(
     return invoke_impl_do_find_method(om, obj, obj_class, name, result) == 0;
 }
 
+/// Check whether an object can be iterated by `ForIter` directly from its storage,
+/// without calling `__iter__()` and `__next__()`.
+ow_static_forceinline bool invoke_impl_iter_builtin(
+    const struct ow_builtin_classes *bic, struct ow_object *obj
+) {
+    if (ow_smallval_check(obj))
+        return false;
+    struct ow_class_obj *const obj_class = ow_object_class(obj);
+    return obj_class == bic->range || obj_class == bic->array ||
+        obj_class == bic->tuple || obj_class == bic->set || obj_class == bic->map;
+}
+
+/// Get the next element of an object accepted by `invoke_impl_iter_builtin()`.
+/// `*pos` is the iteration position, which starts from 0 and is advanced.
+/// Return NULL at the end.
+static struct ow_object *invoke_impl_iter_next(
+    const struct ow_builtin_classes *bic, struct ow_object *obj, size_t *pos
+) {
+    struct ow_class_obj *const obj_class = ow_object_class(obj);
+    if (obj_class == bic->range) {
+        struct ow_object *const elem =
+            ow_range_obj_get(ow_object_cast(obj, struct ow_range_obj), *pos);
+        if (elem)
+            ++*pos;
+        return elem;
+    }
+    if (obj_class == bic->array) {
+        struct ow_array *const data =
+            ow_array_obj_data(ow_object_cast(obj, struct ow_array_obj));
+        if (*pos >= ow_array_size(data))
+            return NULL;
+        return ow_array_at(data, (*pos)++);
+    }
+    if (obj_class == bic->tuple) {
+        struct ow_object *const elem =
+            ow_tuple_obj_get(ow_object_cast(obj, struct ow_tuple_obj), *pos);
+        if (elem)
+            ++*pos;
+        return elem;
+    }
+    if (obj_class == bic->set)
+        return ow_set_obj_next(ow_object_cast(obj, struct ow_set_obj), pos);
+    assert(obj_class == bic->map);
+    return ow_map_obj_next(ow_object_cast(obj, struct ow_map_obj), pos, NULL);
+}
+
+/// Value of an Int or a Float.
+struct invoke_impl_num {
+    bool is_float;
+    union {
+        int64_t i;
+        double f;
+    };
+};
+
+/// Get value from a small int, a small float, an Int object or a Float object.
+/// If it is not a number, return false.
+ow_static_forceinline bool invoke_impl_get_num(
+    const struct ow_builtin_classes *bic, struct ow_object *obj,
+    struct invoke_impl_num *num
+) {
+    if (ow_smallint_check(obj)) {
+        num->is_float = false, num->i = ow_smallint_from_ptr(obj);
+        return true;
+    }
+    if (ow_smallfloat_check(obj)) {
+        num->is_float = true, num->f = ow_smallfloat_from_ptr(obj);
+        return true;
+    }
+    struct ow_class_obj *const obj_class = ow_object_class(obj);
+    if (obj_class == bic->int_) {
+        num->is_float = false;
+        num->i = ow_int_obj_value(ow_object_cast(obj, struct ow_int_obj));
+        return true;
+    }
+    if (obj_class == bic->float_) {
+        num->is_float = true;
+        num->f = ow_float_obj_value(ow_object_cast(obj, struct ow_float_obj));
+        return true;
+    }
+    return false;
+}
+
+/// Evaluate a binary operator on Int and Float values without calling methods.
+/// Return 0 and store result on success; return 1 if the operands or the
+/// operator are not supported; return -1 and store exception on failure.
+ow_nodiscard ow_noinline static int invoke_impl_builtin_bin_op(
+    struct ow_machine *om, enum ow_opcode opcode,
+    struct ow_object *lhs, struct ow_object *rhs, struct ow_object **result
+) {
+    struct invoke_impl_num lhs_v, rhs_v;
+    if (!invoke_impl_get_num(om->builtin_classes, lhs, &lhs_v) ||
+            !invoke_impl_get_num(om->builtin_classes, rhs, &rhs_v))
+        return 1;
+
+    if (!lhs_v.is_float && !rhs_v.is_float) {
+        // Compute in 64 bits, wrapping around on 64-bit overflow. Results out of
+        // the small int range are boxed, so small int overflow promotes to Int.
+        const uint64_t l = (uint64_t)lhs_v.i, r = (uint64_t)rhs_v.i;
+        int64_t res;
+        switch (opcode) {
+        case OW_OPC_Add: res = (int64_t)(l + r); break;
+        case OW_OPC_Sub: res = (int64_t)(l - r); break;
+        case OW_OPC_Mul: res = (int64_t)(l * r); break;
+        case OW_OPC_Div:
+        case OW_OPC_Rem:
+            if (ow_unlikely(!rhs_v.i)) {
+                *result = ow_object_from(ow_exception_format(
+                    om, NULL, "division by zero"));
+                return -1;
+            }
+            if (ow_unlikely(rhs_v.i == -1))
+                res = opcode == OW_OPC_Div ? (int64_t)(0 - l) : 0;
+            else
+                res = opcode == OW_OPC_Div ? lhs_v.i / rhs_v.i : lhs_v.i % rhs_v.i;
+            break;
+        case OW_OPC_Shl: res = (int64_t)(l << (r & 63)); break;
+        case OW_OPC_Shr: res = lhs_v.i >> (r & 63); break;
+        case OW_OPC_And: res = (int64_t)(l & r); break;
+        case OW_OPC_Or : res = (int64_t)(l | r); break;
+        case OW_OPC_Xor: res = (int64_t)(l ^ r); break;
+        default: return 1;
+        }
+        *result = ow_int_obj_or_smallint(om, res);
+        return 0;
+    }
+
+    const double l = lhs_v.is_float ? lhs_v.f : (double)lhs_v.i;
+    const double r = rhs_v.is_float ? rhs_v.f : (double)rhs_v.i;
+    double res;
+    switch (opcode) {
+    case OW_OPC_Add: res = l + r; break;
+    case OW_OPC_Sub: res = l - r; break;
+    case OW_OPC_Mul: res = l * r; break;
+    case OW_OPC_Div: res = l / r; break;
+    case OW_OPC_Rem: res = fmod(l, r); break;
+    default: return 1;
+    }
+    *result = ow_float_obj_or_smallfloat(om, res);
+    return 0;
+}
+
+/// Evaluate a unary operator on an Int or a Float value without calling methods.
+/// Return 0 and store result on success; return 1 if not supported.
+ow_nodiscard ow_noinline static int invoke_impl_builtin_un_op(
+    struct ow_machine *om, enum ow_opcode opcode,
+    struct ow_object *val, struct ow_object **result
+) {
+    struct invoke_impl_num val_v;
+    if (!invoke_impl_get_num(om->builtin_classes, val, &val_v))
+        return 1;
+    if (!val_v.is_float) {
+        const uint64_t v = (uint64_t)val_v.i;
+        if (opcode == OW_OPC_Neg)
+            *result = ow_int_obj_or_smallint(om, (int64_t)(0 - v));
+        else if (opcode == OW_OPC_Inv)
+            *result = ow_int_obj_or_smallint(om, (int64_t)~v);
+        else
+            return 1;
+        return 0;
+    }
+    if (opcode == OW_OPC_Neg) {
+        *result = ow_float_obj_or_smallfloat(om, -val_v.f);
+        return 0;
+    }
+    return 1;
+}
+
+/// Compare Int, Float or String values without calling methods.
+/// Return 0 and store `-1`, `0` or `1` on success; return 1 if the operands
+/// are not supported; return 2 if the operands are unordered (NaN).
+ow_nodiscard ow_noinline static int invoke_impl_builtin_cmp(
+    struct ow_machine *om, struct ow_object *lhs, struct ow_object *rhs, int *result
+) {
+    struct invoke_impl_num lhs_v, rhs_v;
+    if (invoke_impl_get_num(om->builtin_classes, lhs, &lhs_v)) {
+        if (!invoke_impl_get_num(om->builtin_classes, rhs, &rhs_v))
+            return 1;
+        if (!lhs_v.is_float && !rhs_v.is_float) {
+            *result = lhs_v.i == rhs_v.i ? 0 : lhs_v.i < rhs_v.i ? -1 : 1;
+            return 0;
+        }
+        const double l = lhs_v.is_float ? lhs_v.f : (double)lhs_v.i;
+        const double r = rhs_v.is_float ? rhs_v.f : (double)rhs_v.i;
+        if (l < r)
+            *result = -1;
+        else if (l > r)
+            *result = 1;
+        else if (l == r)
+            *result = 0;
+        else
+            return 2;
+        return 0;
+    }
+
+    struct ow_class_obj *const string_class = om->builtin_classes->string;
+    if (ow_object_class(lhs) == string_class && !ow_smallval_check(rhs) &&
+            ow_object_class(rhs) == string_class) {
+        const int res = ow_string_obj_compare(
+            om, ow_object_cast(lhs, struct ow_string_obj),
+            ow_object_cast(rhs, struct ow_string_obj));
+        *result = res == 0 ? 0 : res < 0 ? -1 : 1;
+        return 0;
+    }
+
+    return 1;
+}
+
+/// Load a global variable for instruction `LdGlobY` that ends at `next_ip`,
+/// binding the instruction to the global slot. Return NULL if the operand is illegal.
+ow_static_forceinline struct ow_object *invoke_impl_load_global_y(
+    struct ow_machine *om, struct ow_func_obj *func,
+    const unsigned char *next_ip, size_t name_index
+) {
+    struct ow_module_obj *const module = func->module;
+    struct ow_func_obj_global_cell *const cell = ow_func_obj_global_cell(func, next_ip);
+    if (ow_likely(cell && cell->index)) {
+        if (ow_likely(!cell->base_guard))
+            return ow_module_obj_get_global(module, cell->index - 1);
+        if (ow_likely(cell->base_guard == ow_module_obj_global_count(module) + 1))
+            return ow_module_obj_get_global(om->globals->module_base, cell->index - 1);
+        // A new global in current module may shadow it.
+    }
+    struct ow_symbol_obj *const name = ow_func_obj_get_symbol(func, name_index);
+    if (ow_unlikely(!name))
+        return NULL;
+    size_t index = ow_module_obj_find_global(module, name);
+    if (index != (size_t)-1) {
+        if (ow_likely(cell))
+            *cell = (struct ow_func_obj_global_cell){index + 1, 0};
+        return ow_module_obj_get_global(module, index);
+    }
+    struct ow_module_obj *const base = om->globals->module_base;
+    index = ow_module_obj_find_global(base, name);
+    if (index != (size_t)-1) {
+        if (ow_likely(cell)) {
+            *cell = (struct ow_func_obj_global_cell){
+                index + 1, ow_module_obj_global_count(module) + 1};
+        }
+        return ow_module_obj_get_global(base, index);
+    }
+    return om->globals->value_nil;
+}
+
+/// Store a global variable for instruction `StGlobY` that ends at `next_ip`,
+/// binding the instruction to the global slot. Return false if the operand is illegal.
+ow_static_forceinline bool invoke_impl_store_global_y(
+    struct ow_func_obj *func, const unsigned char *next_ip,
+    size_t name_index, struct ow_object *obj
+) {
+    struct ow_module_obj *const module = func->module;
+    struct ow_func_obj_global_cell *const cell = ow_func_obj_global_cell(func, next_ip);
+    if (ow_likely(cell && cell->index && !cell->base_guard)) {
+        ow_module_obj_set_global(module, cell->index - 1, obj);
+        return true;
+    }
+    struct ow_symbol_obj *const name = ow_func_obj_get_symbol(func, name_index);
+    if (ow_unlikely(!name))
+        return false;
+    const size_t index = ow_module_obj_set_global_y(module, name, obj);
+    if (ow_likely(cell))
+        *cell = (struct ow_func_obj_global_cell){index + 1, 0};
+    return true;
+}
+
+#if OW_JIT_AVAILABLE
+
+/// Compile a function that has become hot. Return the native entry for `ip` or NULL.
+ow_noinline static const void *invoke_impl_jit_compile(
+    struct ow_func_obj *func, const unsigned char *ip
+) {
+    assert(!func->jit_code);
+    func->jit_counter = 0;
+    struct ow_jit_code *const code = ow_jit_compile(func);
+    if (ow_unlikely(!code))
+        return NULL; // Try again later.
+    func->jit_code = code;
+    return ow_jit_code_entry(code, (size_t)(ip - func->code));
+}
+
+/// Count a call or a loop iteration and compile the function if it is hot.
+/// Return the native entry for `ip`, or NULL if not to run native code.
+ow_static_forceinline const void *invoke_impl_jit_entry(
+    struct ow_func_obj *func, const unsigned char *ip, size_t threshold
+) {
+    const struct ow_jit_code *const code = func->jit_code;
+    if (ow_likely(code))
+        return ow_jit_code_entry(code, (size_t)(ip - func->code));
+    if (ow_likely(++func->jit_counter < threshold))
+        return NULL;
+    return invoke_impl_jit_compile(func, ip);
+}
+
+#endif // OW_JIT_AVAILABLE
+
+#if OW_BUILD_REGISTER_VM
+
+/// Translate a function to register code on its first call.
+ow_noinline static const struct ow_regvm_code *invoke_impl_regvm_compile(
+    struct ow_func_obj *func
+) {
+    assert(!func->regvm_code);
+    func->regvm_code = ow_regvm_compile(func);
+    return func->regvm_code;
+}
+
+/// Get the register code entry for `ip`, or NULL if not to run register code.
+ow_static_forceinline const uint32_t *invoke_impl_regvm_entry(
+    struct ow_func_obj *func, const unsigned char *ip
+) {
+    const struct ow_regvm_code *code = func->regvm_code;
+    if (ow_unlikely(!code))
+        code = invoke_impl_regvm_compile(func);
+    return ow_regvm_code_entry(code, (size_t)(ip - func->code));
+}
+
+#endif // OW_BUILD_REGISTER_VM
+
 #ifdef __GNUC__
 __attribute__((hot))
 #endif // __GNUC__
@@ -122,25 +520,79 @@ static int invoke_impl(
     struct ow_func_obj *current_func_obj;
     struct ow_callstack_frame_info *current_frame;
     struct ow_module_obj *current_module;
+    unsigned char call_ret_hook; // Return hook of the next frame to enter.
     struct ow_machine_globals *const machine_globals = machine->globals;
     struct ow_builtin_classes *const builtin_classes = machine->builtin_classes;
     struct ow_common_symbols *const common_symbols = machine->common_symbols;
+#if OW_JIT_AVAILABLE
+    const void *jit_entry;
+    const size_t jit_threshold =
+        ow_sysparam.jit_threshold ? ow_sysparam.jit_threshold : (size_t)-1;
+    const size_t trace_threshold = ow_sysparam.trace_threshold;
+#endif // OW_JIT_AVAILABLE
+#if OW_BUILD_REGISTER_VM
+    const uint32_t *regvm_entry;
+#endif // OW_BUILD_REGISTER_VM
+#if INVOKE_IMPL_TOS_CACHE
+    struct ow_object *tos; // Top value of the stack in the cached state.
+#endif // INVOKE_IMPL_TOS_CACHE
 
 #define STACK_COMMIT()     (machine->callstack.regs = stack)
 #define STACK_UPDATE()     (stack = machine->callstack.regs)
 #define STACK_ASSERT_NC()  \
     assert(stack.sp == machine->callstack.regs.sp && stack.fp == machine->callstack.regs.fp)
 
+#if INVOKE_IMPL_THREADED
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wpedantic"
+    static const void *const dispatch_table[UINT8_MAX + 1] = {
+#    define ELEM(NAME, CODE, OPERAND_SIZE) [OW_OPC_##NAME] = &&op_##NAME ,
+        OW_OPCODE_LIST
+#    undef ELEM
+        [_OW_OPC_COUNT ... UINT8_MAX] = &&op__illegal,
+    };
+#    define DISPATCH()     goto *dispatch_table[(OPSTAT_COUNT(ip), *ip++)]
+#    if INVOKE_IMPL_TOS_CACHE
+#        pragma GCC diagnostic ignored "-Woverride-init"
+    // Dispatch table of the cached state, where the top value is in `tos` rather
+    // than in memory and `stack.sp` points to the value below it. Others flush it first.
+    static const void *const dispatch_table_tos[UINT8_MAX + 1] = {
+#        define ELEM(NAME, CODE, OPERAND_SIZE) [OW_OPC_##NAME] = &&tos_flush_##NAME ,
+        OW_OPCODE_LIST
+#        undef ELEM
+        [_OW_OPC_COUNT ... UINT8_MAX] = &&tos_flush__illegal,
+#        define ELEM(NAME) [OW_OPC_##NAME] = &&tos_op_##NAME ,
+        INVOKE_IMPL_TOS_OP_LIST
+#        undef ELEM
+    };
+#        define DISPATCH_TOS() goto *dispatch_table_tos[(OPSTAT_COUNT(ip), *ip++)]
+#    endif // INVOKE_IMPL_TOS_CACHE
+#endif // INVOKE_IMPL_THREADED
+
+#if INVOKE_IMPL_TOS_CACHE
+/// Push a value by keeping it in `tos`, then dispatch in the cached state.
+#    define TOS_PUSH(VAL)  do { tos = (VAL); DISPATCH_TOS(); } while (0)
+/// Leave the cached state and run the usual implementation of the instruction.
+/// It must be used before `ip` is moved past the opcode.
+#    define TOS_FLUSH_AND_RUN(NAME)  do { *++stack.sp = tos; goto op_##NAME; } while (0)
+#else // !INVOKE_IMPL_TOS_CACHE
+#    define TOS_PUSH(VAL)  ((void)(*++stack.sp = (VAL)))
+#endif // INVOKE_IMPL_TOS_CACHE
+
     ip = NULL;
     STACK_UPDATE();
     current_func_obj = NULL;
     current_module = NULL;
+    call_ret_hook = 0;
     current_frame = machine->callstack.frame_info_list.current;
+#if INVOKE_IMPL_TOS_CACHE
+    tos = NULL;
+#endif // INVOKE_IMPL_TOS_CACHE
 
     goto start;
 
     while (1) {
-        switch ((enum ow_opcode)*ip++) {
+        switch ((enum ow_opcode)(OPSTAT_COUNT(ip), *ip++)) {
             typedef int8_t   _operand_type_i8;
             typedef uint8_t  _operand_type_u8;
             typedef int16_t  _operand_type_i16;
@@ -157,14 +609,70 @@ static int invoke_impl(
                 void         *pointer;
             } operand;
 
-#define OP_BEGIN(NAME)     case OW_OPC_##NAME : {
-#define OP_END             } continue;
+#if INVOKE_IMPL_THREADED
+#    define OP_BEGIN(NAME)  case OW_OPC_##NAME : op_##NAME : {
+#    define OP_END          } DISPATCH();
+#    define OP_NEXT()       DISPATCH()
+#    define OP_RESERVED(NAME) op_##NAME :
+#else // !INVOKE_IMPL_THREADED
+#    define OP_BEGIN(NAME)  case OW_OPC_##NAME : {
+#    define OP_END          } continue;
+#    define OP_NEXT()       continue
+#    define OP_RESERVED(NAME)
+#endif // INVOKE_IMPL_THREADED
 #define OPERAND_(TYPE, TO) { (TO) = *(_operand_type_##TYPE *)ip; }
 #define OPERAND(TYPE, TO)  { OPERAND_(TYPE, TO); ip += sizeof(_operand_type_##TYPE); }
 #define NO_OPERAND()       { }
 
 #define DO_CALL(ARGC)      do { operand.u8 = (uint8_t)(ARGC); goto op_Call_1; } while (0)
 
+/// Rewrite opcode of current instruction, whose operand has been read.
+#define QUICKEN(NAME, OPERAND_SIZE) \
+    (((unsigned char *)ip)[-1 - (OPERAND_SIZE)] = (unsigned char)OW_OPC_##NAME)
+
+#if OW_JIT_AVAILABLE
+/// Count and enter native code at `ip` if possible (function entry or loop head).
+#    define JIT_TRY_ENTER() \
+    do { \
+        jit_entry = invoke_impl_jit_entry(current_func_obj, ip, jit_threshold); \
+        if (ow_unlikely(jit_entry)) \
+            goto jit_enter; \
+    } while (0)
+/// Enter native code at `ip` if the function has been compiled (return address).
+#    define JIT_TRY_RESUME() \
+    do { \
+        if (ow_likely(!current_func_obj->jit_code)) \
+            break; \
+        jit_entry = ow_jit_code_entry( \
+            current_func_obj->jit_code, (size_t)(ip - current_func_obj->code)); \
+        if (jit_entry) \
+            goto jit_enter; \
+    } while (0)
+/// Run the trace of the loop whose head is `ip`, or count and enter native code.
+#    define JIT_TRY_LOOP() \
+    do { \
+        if (trace_threshold) \
+            goto trace_enter; \
+        JIT_TRY_ENTER(); \
+    } while (0)
+#else // !OW_JIT_AVAILABLE
+#    define JIT_TRY_ENTER()  ((void)0)
+#    define JIT_TRY_RESUME() ((void)0)
+#    define JIT_TRY_LOOP()   ((void)0)
+#endif // OW_JIT_AVAILABLE
+
+#if OW_BUILD_REGISTER_VM
+/// Enter register code at `ip` if possible (function entry, loop head, or return address).
+#    define REGVM_TRY_ENTER() \
+    do { \
+        regvm_entry = invoke_impl_regvm_entry(current_func_obj, ip); \
+        if (regvm_entry) \
+            goto regvm_enter; \
+    } while (0)
+#else // !OW_BUILD_REGISTER_VM
+#    define REGVM_TRY_ENTER() ((void)0)
+#endif // OW_BUILD_REGISTER_VM
+
         start:
             assert(_argc < (UINT8_MAX >> 1));
             DO_CALL(_argc);
@@ -187,13 +695,13 @@ static int invoke_impl(
 
         OP_BEGIN(SwapN)
             OPERAND(u8, operand.count)
-            if (ow_unlikely(!operand.count))
-                break;
-            struct ow_object *const top = stack.sp[0];
-            struct ow_object **const p_end = stack.sp - operand.count + 1;
-            for (struct ow_object **p = stack.sp; p > p_end; p--)
-                p[0] = p[-1];
-            *p_end = top;
+            if (ow_likely(operand.count)) {
+                struct ow_object *const top = stack.sp[0];
+                struct ow_object **const p_end = stack.sp - operand.count + 1;
+                for (struct ow_object **p = stack.sp; p > p_end; p--)
+                    p[0] = p[-1];
+                *p_end = top;
+            }
         OP_END
 
         OP_BEGIN(Drop)
@@ -209,7 +717,7 @@ static int invoke_impl(
         OP_BEGIN(Dup)
             NO_OPERAND()
             struct ow_object *const top = stack.sp[0];
-            *++stack.sp = top;
+            TOS_PUSH(top);
         OP_END
 
         OP_BEGIN(DupN)
@@ -221,38 +729,79 @@ static int invoke_impl(
 
         OP_BEGIN(LdNil)
             NO_OPERAND()
-            *++stack.sp = machine_globals->value_nil;
+            TOS_PUSH(machine_globals->value_nil);
         OP_END
 
         OP_BEGIN(LdBool)
             OPERAND(u8, operand.u8)
-            *++stack.sp = operand.u8 ?
-                machine_globals->value_true : machine_globals->value_false;
+            TOS_PUSH(operand.u8 ?
+                machine_globals->value_true : machine_globals->value_false);
         OP_END
 
         OP_BEGIN(LdInt)
             OPERAND(i8, operand.i8)
-            *++stack.sp = ow_smallint_to_ptr(operand.i8);
+            TOS_PUSH(ow_smallint_to_ptr(operand.i8));
         OP_END
 
         OP_BEGIN(LdIntW)
             OPERAND(i16, operand.i16)
-            *++stack.sp = ow_smallint_to_ptr(operand.i16);
+            TOS_PUSH(ow_smallint_to_ptr(operand.i16));
         OP_END
 
+#if INVOKE_IMPL_TOS_CACHE
+        // Instructions in the cached state. Pushing ones spill `tos` first.
+
+#define ELEM(NAME, CODE, OPERAND_SIZE) \
+        tos_flush_##NAME: \
+            *++stack.sp = tos; \
+            goto op_##NAME;
+        OW_OPCODE_LIST
+#undef ELEM
+        tos_flush__illegal:
+            *++stack.sp = tos;
+            goto op__illegal;
+
+        tos_op_Drop:
+            DISPATCH();
+
+        tos_op_Dup:
+            *++stack.sp = tos;
+            DISPATCH_TOS();
+
+        tos_op_LdNil:
+            TOS_FLUSH_AND_RUN(LdNil);
+
+        tos_op_LdBool:
+            TOS_FLUSH_AND_RUN(LdBool);
+
+        tos_op_LdInt:
+            TOS_FLUSH_AND_RUN(LdInt);
+
+        tos_op_LdIntW:
+            TOS_FLUSH_AND_RUN(LdIntW);
+#endif // INVOKE_IMPL_TOS_CACHE
+
         OP_BEGIN(LdFlt)
             OPERAND(i8, operand.i8)
-            *++stack.sp =
-                ow_object_from(ow_float_obj_new(machine, (double)operand.i8));
-        OP_END
-
-#define IMPL_BIN_OP(OPERATOR, METH_NAME) \
-    struct ow_object *const lhs = stack.sp[-1]; \
-    struct ow_object *const rhs = stack.sp[0]; \
-    if (ow_smallint_check(lhs) && ow_smallint_check(rhs)) { \
-        const ow_smallint_t res = \
-            ow_smallint_from_ptr(lhs) OPERATOR ow_smallint_from_ptr(rhs); \
-        *--stack.sp = ow_int_obj_or_smallint(machine, res); \
+            *++stack.sp = ow_float_obj_or_smallfloat(machine, (double)operand.i8);
+        OP_END
+
+#define IMPL_BIN_OP_RHS_OK(NAME, RHS) \
+    ((OW_OPC_##NAME != OW_OPC_Div && OW_OPC_##NAME != OW_OPC_Rem) || \
+        (RHS) != ow_smallint_to_ptr(0)) && \
+    ((OW_OPC_##NAME != OW_OPC_Shl && OW_OPC_##NAME != OW_OPC_Shr) || \
+        (uintptr_t)ow_smallint_from_ptr(RHS) < 64) \
+// ^^^ IMPL_BIN_OP_RHS_OK() ^^^
+
+#define IMPL_BIN_OP_SLOW(NAME, METH_NAME) \
+    STACK_COMMIT(); \
+    const int status = invoke_impl_builtin_bin_op( \
+        machine, OW_OPC_##NAME, lhs, rhs, &res_o); \
+    if (ow_likely(!status)) { \
+        *--stack.sp = res_o; \
+    } else if (status < 0) { \
+        *--stack.sp = res_o; \
+        goto raise_exc; \
     } else { \
         *stack.sp = lhs; \
         *++stack.sp = rhs; \
@@ -266,66 +815,214 @@ static int invoke_impl(
         } \
         DO_CALL(2); \
     } \
+// ^^^ IMPL_BIN_OP_SLOW() ^^^
+
+#define IMPL_BIN_OP(NAME, OPERATOR, METH_NAME) \
+    struct ow_object *const lhs = stack.sp[-1]; \
+    struct ow_object *const rhs = stack.sp[0]; \
+    struct ow_object *res_o; \
+    if (ow_smallint_check(lhs) && ow_smallint_check(rhs) && \
+        IMPL_BIN_OP_RHS_OK(NAME, rhs) && \
+        (res_o = ow_smallint_try_to_ptr( \
+            ow_smallint_from_ptr(lhs) OPERATOR ow_smallint_from_ptr(rhs))) \
+    ) { \
+        *--stack.sp = res_o; \
+    } else { \
+        IMPL_BIN_OP_SLOW(NAME, METH_NAME) \
+    } \
 // ^^^ IMPL_BIN_OP() ^^^
 
+#define IMPL_ARITH_OP(NAME, OPERATOR, METH_NAME) \
+    op_##NAME##_1:; \
+    struct ow_object *const lhs = stack.sp[-1]; \
+    struct ow_object *const rhs = stack.sp[0]; \
+    struct ow_object *res_o; \
+    if (ow_smallint_check(lhs) && ow_smallint_check(rhs) && \
+        IMPL_BIN_OP_RHS_OK(NAME, rhs) && \
+        (res_o = ow_smallint_try_to_ptr( \
+            ow_smallint_from_ptr(lhs) OPERATOR ow_smallint_from_ptr(rhs))) \
+    ) { \
+        *--stack.sp = res_o; \
+        QUICKEN(NAME##Int, 0); \
+    } else if (ow_smallfloat_check(lhs) && ow_smallfloat_check(rhs) && \
+        (res_o = ow_smallfloat_try_to_ptr( \
+            ow_smallfloat_from_ptr(lhs) OPERATOR ow_smallfloat_from_ptr(rhs))) \
+    ) { \
+        *--stack.sp = res_o; \
+        QUICKEN(NAME##Flt, 0); \
+    } else { \
+        IMPL_BIN_OP_SLOW(NAME, METH_NAME) \
+    } \
+// ^^^ IMPL_ARITH_OP() ^^^
+
+#define IMPL_ARITH_OP_INT(NAME, OPERATOR) \
+    struct ow_object *const lhs = stack.sp[-1]; \
+    struct ow_object *const rhs = stack.sp[0]; \
+    struct ow_object *res_o; \
+    if (ow_likely(ow_smallint_check(lhs) && ow_smallint_check(rhs) && \
+        IMPL_BIN_OP_RHS_OK(NAME, rhs) && \
+        (res_o = ow_smallint_try_to_ptr( \
+            ow_smallint_from_ptr(lhs) OPERATOR ow_smallint_from_ptr(rhs)))) \
+    ) { \
+        *--stack.sp = res_o; \
+    } else { \
+        QUICKEN(NAME, 0); \
+        goto op_##NAME##_1; \
+    } \
+// ^^^ IMPL_ARITH_OP_INT() ^^^
+
+#define IMPL_ARITH_OP_FLT(NAME, OPERATOR) \
+    struct ow_object *const lhs = stack.sp[-1]; \
+    struct ow_object *const rhs = stack.sp[0]; \
+    struct ow_object *res_o; \
+    if (ow_likely(ow_smallfloat_check(lhs) && ow_smallfloat_check(rhs) && \
+        (res_o = ow_smallfloat_try_to_ptr( \
+            ow_smallfloat_from_ptr(lhs) OPERATOR ow_smallfloat_from_ptr(rhs)))) \
+    ) { \
+        *--stack.sp = res_o; \
+    } else { \
+        QUICKEN(NAME, 0); \
+        goto op_##NAME##_1; \
+    } \
+// ^^^ IMPL_ARITH_OP_FLT() ^^^
+
         OP_BEGIN(Add)
             NO_OPERAND()
-            IMPL_BIN_OP(+, add)
+            IMPL_ARITH_OP(Add, +, add)
         OP_END
 
         OP_BEGIN(Sub)
             NO_OPERAND()
-            IMPL_BIN_OP(-, sub)
+            IMPL_ARITH_OP(Sub, -, sub)
         OP_END
 
         OP_BEGIN(Mul)
             NO_OPERAND()
-            IMPL_BIN_OP(*, mul)
+            IMPL_ARITH_OP(Mul, *, mul)
         OP_END
 
         OP_BEGIN(Div)
             NO_OPERAND()
-            IMPL_BIN_OP(/, div)
+            IMPL_ARITH_OP(Div, /, div)
         OP_END
 
         OP_BEGIN(Rem)
             NO_OPERAND()
-            IMPL_BIN_OP(%, rem)
+            IMPL_BIN_OP(Rem, %, rem)
         OP_END
 
         OP_BEGIN(Shl)
             NO_OPERAND()
-            IMPL_BIN_OP(<<, shl)
+            IMPL_BIN_OP(Shl, <<, shl)
         OP_END
 
         OP_BEGIN(Shr)
             NO_OPERAND()
-            IMPL_BIN_OP(>>, shr)
+            IMPL_BIN_OP(Shr, >>, shr)
         OP_END
 
         OP_BEGIN(And)
             NO_OPERAND()
-            IMPL_BIN_OP(&, and_)
+            IMPL_BIN_OP(And, &, and_)
         OP_END
 
         OP_BEGIN(Or)
             NO_OPERAND()
-            IMPL_BIN_OP(|, or_)
+            IMPL_BIN_OP(Or, |, or_)
         OP_END
 
         OP_BEGIN(Xor)
             NO_OPERAND()
-            IMPL_BIN_OP(^, xor_)
+            IMPL_BIN_OP(Xor, ^, xor_)
+        OP_END
+
+        OP_BEGIN(AddInt)
+            NO_OPERAND()
+            IMPL_ARITH_OP_INT(Add, +)
+        OP_END
+
+        OP_BEGIN(SubInt)
+            NO_OPERAND()
+            IMPL_ARITH_OP_INT(Sub, -)
+        OP_END
+
+        OP_BEGIN(MulInt)
+            NO_OPERAND()
+            IMPL_ARITH_OP_INT(Mul, *)
+        OP_END
+
+        OP_BEGIN(DivInt)
+            NO_OPERAND()
+            IMPL_ARITH_OP_INT(Div, /)
+        OP_END
+
+#if INVOKE_IMPL_TOS_CACHE
+
+#define IMPL_TOS_ARITH_OP_INT(NAME, OPERATOR) \
+    tos_op_##NAME##Int: { \
+        struct ow_object *const lhs = stack.sp[0]; \
+        struct ow_object *res_o; \
+        if (ow_likely(ow_smallint_check(lhs) && ow_smallint_check(tos) && \
+            (res_o = ow_smallint_try_to_ptr( \
+                ow_smallint_from_ptr(lhs) OPERATOR ow_smallint_from_ptr(tos)))) \
+        ) { \
+            stack.sp--; \
+            tos = res_o; \
+            DISPATCH_TOS(); \
+        } \
+        TOS_FLUSH_AND_RUN(NAME##Int); \
+    } \
+// ^^^ IMPL_TOS_ARITH_OP_INT() ^^^
+
+        IMPL_TOS_ARITH_OP_INT(Add, +)
+        IMPL_TOS_ARITH_OP_INT(Sub, -)
+        IMPL_TOS_ARITH_OP_INT(Mul, *)
+
+#undef IMPL_TOS_ARITH_OP_INT
+
+#endif // INVOKE_IMPL_TOS_CACHE
+
+        OP_BEGIN(AddFlt)
+            NO_OPERAND()
+            IMPL_ARITH_OP_FLT(Add, +)
+        OP_END
+
+        OP_BEGIN(SubFlt)
+            NO_OPERAND()
+            IMPL_ARITH_OP_FLT(Sub, -)
+        OP_END
+
+        OP_BEGIN(MulFlt)
+            NO_OPERAND()
+            IMPL_ARITH_OP_FLT(Mul, *)
         OP_END
 
+        OP_BEGIN(DivFlt)
+            NO_OPERAND()
+            IMPL_ARITH_OP_FLT(Div, /)
+        OP_END
+
+#undef IMPL_BIN_OP_RHS_OK
+#undef IMPL_BIN_OP_SLOW
 #undef IMPL_BIN_OP
+#undef IMPL_ARITH_OP
+#undef IMPL_ARITH_OP_INT
+#undef IMPL_ARITH_OP_FLT
 
-#define IMPL_UN_OP(OPERATOR, METH_NAME) \
+#define IMPL_UN_OP(NAME, OPERATOR, METH_NAME) \
     struct ow_object *const val = stack.sp[0]; \
-    if (ow_smallint_check(val)) { \
-        const ow_smallint_t res = OPERATOR ow_smallint_from_ptr(val); \
-        *stack.sp = ow_int_obj_or_smallint(machine, res); \
+    struct ow_object *res_o; \
+    if (ow_smallint_check(val) && \
+        (res_o = ow_smallint_try_to_ptr(OPERATOR ow_smallint_from_ptr(val))) \
+    ) { \
+        *stack.sp = res_o; \
     } else { \
+        STACK_COMMIT(); \
+        if (ow_likely(!invoke_impl_builtin_un_op( \
+                machine, OW_OPC_##NAME, val, &res_o))) { \
+            *stack.sp = res_o; \
+            OP_NEXT(); \
+        } \
         *++stack.sp = val; \
         STACK_COMMIT(); \
         const bool ok = invoke_impl_get_method_y( \
@@ -341,14 +1038,16 @@ static int invoke_impl(
 
         OP_BEGIN(Neg)
             NO_OPERAND()
-            IMPL_UN_OP(-, neg)
+            IMPL_UN_OP(Neg, -, neg)
         OP_END
 
         OP_BEGIN(Inv)
             NO_OPERAND()
-            IMPL_UN_OP(~, inv)
+            IMPL_UN_OP(Inv, ~, inv)
         OP_END
 
+#undef IMPL_UN_OP
+
         OP_BEGIN(Not)
             NO_OPERAND()
             struct ow_object *obj= *stack.sp;
@@ -382,7 +1081,20 @@ static int invoke_impl(
                 const ow_smallint_t rhs_v = ow_smallint_from_ptr(rhs);
                 const ow_smallint_t res = lhs_v == rhs_v ? 0 : lhs_v < rhs_v ? -1 : 1;
                 *--stack.sp = ow_smallint_to_ptr(res);
+            } else if (ow_smallfloat_check(lhs) && ow_smallfloat_check(rhs)) {
+                const double lhs_v = ow_smallfloat_from_ptr(lhs);
+                const double rhs_v = ow_smallfloat_from_ptr(rhs);
+                const ow_smallint_t res = lhs_v == rhs_v ? 0 : lhs_v < rhs_v ? -1 : 1;
+                *--stack.sp = ow_smallint_to_ptr(res);
             } else {
+                int cmp_res;
+                STACK_COMMIT();
+                const int cmp_status = invoke_impl_builtin_cmp(machine, lhs, rhs, &cmp_res);
+                if (ow_likely(cmp_status != 1)) {
+                    *--stack.sp = cmp_status == 0 ?
+                        ow_smallint_to_ptr(cmp_res) : machine_globals->value_nil;
+                    OP_NEXT();
+                }
                 *stack.sp = lhs;
                 *++stack.sp = rhs;
                 STACK_COMMIT();
@@ -397,7 +1109,8 @@ static int invoke_impl(
             }
         OP_END
 
-#define IMPL_CMP_OP(OPERATOR) \
+#define IMPL_CMP_OP(NAME, OPERATOR) \
+    op_##NAME##_1:; \
     struct ow_object *const lhs = stack.sp[-1]; \
     struct ow_object *const rhs = stack.sp[0]; \
     if (ow_smallint_check(lhs) && ow_smallint_check(rhs)) { \
@@ -405,7 +1118,23 @@ static int invoke_impl(
         const ow_smallint_t rhs_v = ow_smallint_from_ptr(rhs); \
         *--stack.sp = lhs_v OPERATOR rhs_v ? \
             machine_globals->value_true : machine_globals->value_false; \
+        QUICKEN(NAME##Int, 0); \
+    } else if (ow_smallfloat_check(lhs) && ow_smallfloat_check(rhs)) { \
+        const double lhs_v = ow_smallfloat_from_ptr(lhs); \
+        const double rhs_v = ow_smallfloat_from_ptr(rhs); \
+        *--stack.sp = lhs_v OPERATOR rhs_v ? \
+            machine_globals->value_true : machine_globals->value_false; \
     } else { \
+        int cmp_res; \
+        STACK_COMMIT(); \
+        const int cmp_status = invoke_impl_builtin_cmp(machine, lhs, rhs, &cmp_res); \
+        if (ow_likely(cmp_status != 1)) { \
+            const bool res = cmp_status == 0 ? \
+                cmp_res OPERATOR 0 : /* unordered */ (0 OPERATOR 1) && (1 OPERATOR 0); \
+            *--stack.sp = res ? \
+                machine_globals->value_true : machine_globals->value_false; \
+            OP_NEXT(); \
+        } \
         *stack.sp = lhs; \
         *++stack.sp = rhs; \
         STACK_COMMIT(); \
@@ -416,52 +1145,186 @@ static int invoke_impl(
             stack.sp -= 2; \
             goto raise_exc; \
         } \
-        const int status = ow_machine_invoke(machine, 2, stack.sp - 2); \
-        stack.sp -= 2; \
-        if (ow_unlikely(status)) \
-            goto raise_exc; \
-        struct ow_object *const cmp_res_o = *stack.sp; \
-        if (ow_unlikely(!ow_smallint_check(cmp_res_o))) { \
-            *stack.sp = ow_object_from(ow_exception_format( \
-                machine, NULL, "wrong type of comparison result")); \
-            goto raise_exc; \
-        } \
-        *stack.sp = (ow_smallint_from_ptr(cmp_res_o) OPERATOR 0) ? \
-            machine_globals->value_true : machine_globals->value_false; \
+        call_ret_hook = (unsigned char)OW_OPC_##NAME; \
+        DO_CALL(2); \
     } \
 // ^^^ IMPL_CMP_OP^^^
 
+#define IMPL_CMP_OP_INT(NAME, OPERATOR) \
+    struct ow_object *const lhs = stack.sp[-1]; \
+    struct ow_object *const rhs = stack.sp[0]; \
+    if (ow_likely(ow_smallint_check(lhs) && ow_smallint_check(rhs))) { \
+        *--stack.sp = ow_smallint_from_ptr(lhs) OPERATOR ow_smallint_from_ptr(rhs) ? \
+            machine_globals->value_true : machine_globals->value_false; \
+    } else { \
+        QUICKEN(NAME, 0); \
+        goto op_##NAME##_1; \
+    } \
+// ^^^ IMPL_CMP_OP_INT() ^^^
+
         OP_BEGIN(CmpLt)
             NO_OPERAND()
-            IMPL_CMP_OP(<)
+            IMPL_CMP_OP(CmpLt, <)
         OP_END
 
         OP_BEGIN(CmpLe)
             NO_OPERAND()
-            IMPL_CMP_OP(<=)
+            IMPL_CMP_OP(CmpLe, <=)
         OP_END
 
         OP_BEGIN(CmpGt)
             NO_OPERAND()
-            IMPL_CMP_OP(>)
+            IMPL_CMP_OP(CmpGt, >)
         OP_END
 
         OP_BEGIN(CmpGe)
             NO_OPERAND()
-            IMPL_CMP_OP(>=)
+            IMPL_CMP_OP(CmpGe, >=)
         OP_END
 
         OP_BEGIN(CmpEq)
             NO_OPERAND()
-            IMPL_CMP_OP(==)
+            IMPL_CMP_OP(CmpEq, ==)
         OP_END
 
         OP_BEGIN(CmpNe)
             NO_OPERAND()
-            IMPL_CMP_OP(!=)
+            IMPL_CMP_OP(CmpNe, !=)
+        OP_END
+
+        OP_BEGIN(CmpLtInt)
+            NO_OPERAND()
+            IMPL_CMP_OP_INT(CmpLt, <)
+        OP_END
+
+        OP_BEGIN(CmpLeInt)
+            NO_OPERAND()
+            IMPL_CMP_OP_INT(CmpLe, <=)
+        OP_END
+
+        OP_BEGIN(CmpGtInt)
+            NO_OPERAND()
+            IMPL_CMP_OP_INT(CmpGt, >)
+        OP_END
+
+        OP_BEGIN(CmpGeInt)
+            NO_OPERAND()
+            IMPL_CMP_OP_INT(CmpGe, >=)
+        OP_END
+
+        OP_BEGIN(CmpEqInt)
+            NO_OPERAND()
+            IMPL_CMP_OP_INT(CmpEq, ==)
+        OP_END
+
+        OP_BEGIN(CmpNeInt)
+            NO_OPERAND()
+            IMPL_CMP_OP_INT(CmpNe, !=)
+        OP_END
+
+#if INVOKE_IMPL_TOS_CACHE
+
+#define IMPL_TOS_CMP_OP_INT(NAME, OPERATOR) \
+    tos_op_##NAME##Int: { \
+        struct ow_object *const lhs = stack.sp[0]; \
+        if (ow_likely(ow_smallint_check(lhs) && ow_smallint_check(tos))) { \
+            stack.sp--; \
+            tos = ow_smallint_from_ptr(lhs) OPERATOR ow_smallint_from_ptr(tos) ? \
+                machine_globals->value_true : machine_globals->value_false; \
+            DISPATCH_TOS(); \
+        } \
+        TOS_FLUSH_AND_RUN(NAME##Int); \
+    } \
+// ^^^ IMPL_TOS_CMP_OP_INT() ^^^
+
+        IMPL_TOS_CMP_OP_INT(CmpLt, <)
+        IMPL_TOS_CMP_OP_INT(CmpLe, <=)
+        IMPL_TOS_CMP_OP_INT(CmpGt, >)
+        IMPL_TOS_CMP_OP_INT(CmpGe, >=)
+        IMPL_TOS_CMP_OP_INT(CmpEq, ==)
+        IMPL_TOS_CMP_OP_INT(CmpNe, !=)
+
+#undef IMPL_TOS_CMP_OP_INT
+
+#endif // INVOKE_IMPL_TOS_CACHE
+
+/// `CmpXx; JmpUnls off`, with `ip` at the `JmpUnls`.
+#define IMPL_CMP_JMP_OP(NAME, OPERATOR) \
+    struct ow_object *const lhs = stack.sp[-1]; \
+    struct ow_object *const rhs = stack.sp[0]; \
+    if (ow_likely(ow_smallint_check(lhs) && ow_smallint_check(rhs))) { \
+        stack.sp -= 2; \
+        if (ow_smallint_from_ptr(lhs) OPERATOR ow_smallint_from_ptr(rhs)) \
+            ip += 2; \
+        else \
+            ip += (int8_t)ip[1]; \
+    } else { \
+        goto op_##NAME##_1; \
+    } \
+// ^^^ IMPL_CMP_JMP_OP() ^^^
+
+        OP_BEGIN(CmpLtJmp)
+            NO_OPERAND()
+            IMPL_CMP_JMP_OP(CmpLt, <)
+        OP_END
+
+        OP_BEGIN(CmpLeJmp)
+            NO_OPERAND()
+            IMPL_CMP_JMP_OP(CmpLe, <=)
+        OP_END
+
+        OP_BEGIN(CmpGtJmp)
+            NO_OPERAND()
+            IMPL_CMP_JMP_OP(CmpGt, >)
+        OP_END
+
+        OP_BEGIN(CmpGeJmp)
+            NO_OPERAND()
+            IMPL_CMP_JMP_OP(CmpGe, >=)
         OP_END
 
+        OP_BEGIN(CmpEqJmp)
+            NO_OPERAND()
+            IMPL_CMP_JMP_OP(CmpEq, ==)
+        OP_END
+
+        OP_BEGIN(CmpNeJmp)
+            NO_OPERAND()
+            IMPL_CMP_JMP_OP(CmpNe, !=)
+        OP_END
+
+#if INVOKE_IMPL_TOS_CACHE
+
+#define IMPL_TOS_CMP_JMP_OP(NAME, OPERATOR) \
+    tos_op_##NAME##Jmp: { \
+        struct ow_object *const lhs = stack.sp[0]; \
+        if (ow_likely(ow_smallint_check(lhs) && ow_smallint_check(tos))) { \
+            stack.sp--; \
+            if (ow_smallint_from_ptr(lhs) OPERATOR ow_smallint_from_ptr(tos)) \
+                ip += 2; \
+            else \
+                ip += (int8_t)ip[1]; \
+            DISPATCH(); \
+        } \
+        *++stack.sp = tos; \
+        goto op_##NAME##_1; \
+    } \
+// ^^^ IMPL_TOS_CMP_JMP_OP() ^^^
+
+        IMPL_TOS_CMP_JMP_OP(CmpLt, <)
+        IMPL_TOS_CMP_JMP_OP(CmpLe, <=)
+        IMPL_TOS_CMP_JMP_OP(CmpGt, >)
+        IMPL_TOS_CMP_JMP_OP(CmpGe, >=)
+        IMPL_TOS_CMP_JMP_OP(CmpEq, ==)
+        IMPL_TOS_CMP_JMP_OP(CmpNe, !=)
+
+#undef IMPL_TOS_CMP_JMP_OP
+
+#endif // INVOKE_IMPL_TOS_CACHE
+
 #undef IMPL_CMP_OP
+#undef IMPL_CMP_OP_INT
+#undef IMPL_CMP_JMP_OP
 
         OP_BEGIN(LdCnst)
             OPERAND(u8, operand.index)
@@ -470,7 +1333,7 @@ static int invoke_impl(
                 ow_func_obj_get_constant(current_func_obj, operand.index);
             if (ow_unlikely(!obj))
                 goto err_bad_operand;
-            *++stack.sp = obj;
+            TOS_PUSH(obj);
         OP_END
 
         OP_BEGIN(LdCnstW)
@@ -478,6 +1341,14 @@ static int invoke_impl(
             goto op_LdCnst_1;
         OP_END
 
+#if INVOKE_IMPL_TOS_CACHE
+        tos_op_LdCnst:
+            TOS_FLUSH_AND_RUN(LdCnst);
+
+        tos_op_LdCnstW:
+            TOS_FLUSH_AND_RUN(LdCnstW);
+#endif // INVOKE_IMPL_TOS_CACHE
+
         OP_BEGIN(LdSym)
             OPERAND(u8, operand.index)
         op_LdSym_1:;
@@ -498,7 +1369,7 @@ static int invoke_impl(
             struct ow_object **const p = current_frame->arg_list + operand.index;
             if (ow_unlikely(p >= stack.fp))
                 goto err_bad_operand;
-            *++stack.sp = *p;
+            TOS_PUSH(*p);
         OP_END
 
         OP_BEGIN(StArg)
@@ -512,23 +1383,23 @@ static int invoke_impl(
         OP_BEGIN(LdLoc)
             OPERAND(u8, operand.index)
             struct ow_object **const p = stack.fp + operand.index;
-            if (ow_unlikely(p <= stack.sp))
+            if (ow_unlikely(p > stack.sp))
                 goto err_bad_operand;
-            *++stack.sp = *p;
+            TOS_PUSH(*p);
         OP_END
 
         OP_BEGIN(LdLocW)
             OPERAND(u16, operand.index)
             struct ow_object **const p = stack.fp + operand.index;
-            if (ow_unlikely(p <= stack.sp))
+            if (ow_unlikely(p > stack.sp))
                 goto err_bad_operand;
-            *++stack.sp = *p;
+            TOS_PUSH(*p);
         OP_END
 
         OP_BEGIN(StLoc)
             OPERAND(u8, operand.index)
             struct ow_object **const p = stack.fp + operand.index;
-            if (ow_unlikely(p < stack.sp))
+            if (ow_unlikely(p >= stack.sp))
                 goto err_bad_operand;
             *p = *stack.sp--;
         OP_END
@@ -536,11 +1407,92 @@ static int invoke_impl(
         OP_BEGIN(StLocW)
             OPERAND(u16, operand.index)
             struct ow_object **const p = stack.fp + operand.index;
-            if (ow_unlikely(p < stack.sp))
+            if (ow_unlikely(p >= stack.sp))
                 goto err_bad_operand;
             *p = *stack.sp--;
         OP_END
 
+        OP_BEGIN(LdLoc2)
+            // LdLoc a; LdLoc b
+            OPERAND(u8, operand.index)
+            struct ow_object **const p = stack.fp + operand.index;
+            if (ow_unlikely(p > stack.sp))
+                goto err_bad_operand;
+            *++stack.sp = *p;
+            struct ow_object **const p2 = stack.fp + ip[1];
+            if (ow_likely(p2 <= stack.sp)) {
+                ip += 2;
+                TOS_PUSH(*p2);
+            }
+        OP_END
+
+#if INVOKE_IMPL_TOS_CACHE
+
+        tos_op_LdArg:
+            TOS_FLUSH_AND_RUN(LdArg);
+
+        tos_op_StArg: {
+            OPERAND_(u8, operand.index)
+            struct ow_object **const p = current_frame->arg_list + operand.index;
+            if (ow_unlikely(p >= stack.fp))
+                TOS_FLUSH_AND_RUN(StArg);
+            ip += 1;
+            *p = tos;
+            DISPATCH();
+        }
+
+        tos_op_LdLoc:
+            TOS_FLUSH_AND_RUN(LdLoc);
+
+        tos_op_LdLocW:
+            TOS_FLUSH_AND_RUN(LdLocW);
+
+        tos_op_LdLoc2:
+            TOS_FLUSH_AND_RUN(LdLoc2);
+
+        // The stored value is not in memory, so the slot must not be above `stack.sp`.
+
+        tos_op_StLoc: {
+            OPERAND_(u8, operand.index)
+            struct ow_object **const p = stack.fp + operand.index;
+            if (ow_unlikely(p > stack.sp))
+                TOS_FLUSH_AND_RUN(StLoc);
+            ip += 1;
+            *p = tos;
+            DISPATCH();
+        }
+
+        tos_op_StLocW: {
+            OPERAND_(u16, operand.index)
+            struct ow_object **const p = stack.fp + operand.index;
+            if (ow_unlikely(p > stack.sp))
+                TOS_FLUSH_AND_RUN(StLocW);
+            ip += 2;
+            *p = tos;
+            DISPATCH();
+        }
+
+#endif // INVOKE_IMPL_TOS_CACHE
+
+        OP_BEGIN(IncLoc)
+            // LdLoc a; LdInt k; Add; StLoc b
+            OPERAND(u8, operand.index)
+            struct ow_object **const p = stack.fp + operand.index;
+            if (ow_unlikely(p > stack.sp))
+                goto err_bad_operand;
+            struct ow_object *const val = *p;
+            struct ow_object **const p2 = stack.fp + ip[4];
+            struct ow_object *res_o;
+            if (ow_likely(ow_smallint_check(val) && p2 <= stack.sp &&
+                (res_o = ow_smallint_try_to_ptr(ow_smallint_from_ptr(val) + (int8_t)ip[1])))
+            ) {
+                *p2 = res_o;
+                ip += 5;
+            } else {
+                TOS_PUSH(val);
+            }
+        OP_END
+
         OP_BEGIN(LdGlob)
             OPERAND(u8, operand.index)
         op_LdGlob_1:;
@@ -571,17 +1523,11 @@ static int invoke_impl(
         OP_BEGIN(LdGlobY)
             OPERAND(u8, operand.index)
         op_LdGlobY_1:;
-            struct ow_symbol_obj *name =
-                ow_func_obj_get_symbol(current_func_obj, operand.index);
-            if (ow_unlikely(!name))
+            assert(current_module == current_func_obj->module);
+            struct ow_object *const obj = invoke_impl_load_global_y(
+                machine, current_func_obj, ip, operand.index);
+            if (ow_unlikely(!obj))
                 goto err_bad_operand;
-            struct ow_object *obj =
-                ow_module_obj_get_global_y(current_module, name);
-            if (!obj) {
-                obj = ow_module_obj_get_global_y(machine_globals->module_base, name);
-                if (ow_unlikely(!obj))
-                    obj = machine_globals->value_nil;
-            }
             *++stack.sp = obj;
         OP_END
 
@@ -593,12 +1539,11 @@ static int invoke_impl(
         OP_BEGIN(StGlobY)
             OPERAND(u8, operand.index)
         op_StGlobY_1:;
-            struct ow_symbol_obj *name =
-                ow_func_obj_get_symbol(current_func_obj, operand.index);
-            if (ow_unlikely(!name))
-                goto err_bad_operand;
+            assert(current_module == current_func_obj->module);
             struct ow_object *const obj = *stack.sp--;
-            ow_module_obj_set_global_y(current_module, name, obj);
+            if (ow_unlikely(!invoke_impl_store_global_y(
+                    current_func_obj, ip, operand.index, obj)))
+                goto err_bad_operand;
         OP_END
 
         OP_BEGIN(StGlobYW)
@@ -609,16 +1554,23 @@ static int invoke_impl(
         OP_BEGIN(LdAttrY)
             OPERAND(u8, operand.index)
         op_LdAttrY_1:;
+            struct ow_object *const obj = *stack.sp;
+            struct ow_class_obj *const obj_class =
+                ow_builtin_classes_class_of(builtin_classes, obj);
+            struct ow_func_obj_inline_cache *const cache =
+                ow_func_obj_inline_cache(current_func_obj, ip);
+            if (ow_likely(cache)) {
+                const size_t field_index =
+                    ow_func_obj_inline_cache_find(cache, obj_class);
+                if (ow_likely(field_index != (size_t)-1)) {
+                    *stack.sp = ow_object_get_field(obj, field_index);
+                    OP_NEXT();
+                }
+            }
             struct ow_symbol_obj *name =
                 ow_func_obj_get_symbol(current_func_obj, operand.index);
             if (ow_unlikely(!name))
                 goto err_bad_operand;
-            struct ow_object *const obj = *stack.sp;
-            struct ow_class_obj *obj_class;
-            if (ow_unlikely(ow_smallint_check(obj)))
-                obj_class = builtin_classes->int_;
-            else
-                obj_class = ow_object_class(obj);
             struct ow_object *attr;
             if (obj_class == builtin_classes->module) {
                 attr = ow_module_obj_get_global_y(
@@ -628,6 +1580,8 @@ static int invoke_impl(
             } else {
                 operand.index = ow_class_obj_find_attribute(obj_class, name);
                 if (ow_likely(operand.index != (size_t)-1)) {
+                    if (ow_likely(cache))
+                        ow_func_obj_inline_cache_record(cache, obj_class, operand.index);
                     attr = ow_object_get_field(obj, operand.index);
                 } else {
                     STACK_COMMIT();
@@ -657,11 +1611,8 @@ static int invoke_impl(
                 goto err_bad_operand;
             struct ow_object *const obj = *stack.sp--;
             struct ow_object *const attr = *stack.sp;
-            struct ow_class_obj *obj_class;
-            if (ow_unlikely(ow_smallint_check(obj)))
-                obj_class = builtin_classes->int_;
-            else
-                obj_class = ow_object_class(obj);
+            struct ow_class_obj *const obj_class =
+                ow_builtin_classes_class_of(builtin_classes, obj);
             if (obj_class == builtin_classes->module) {
                 ow_module_obj_set_global_y(
                     ow_object_cast(obj, struct ow_module_obj), name, attr);
@@ -711,11 +1662,19 @@ static int invoke_impl(
         OP_BEGIN(Jmp)
             OPERAND_(i8, operand.ptrdiff)
             ip = ip - 1 + operand.ptrdiff;
+            if (operand.ptrdiff < 0) {
+                JIT_TRY_LOOP();
+                REGVM_TRY_ENTER();
+            }
         OP_END
 
         OP_BEGIN(JmpW)
             OPERAND_(i16, operand.ptrdiff)
             ip = ip - 1 + operand.ptrdiff;
+            if (operand.ptrdiff < 0) {
+                JIT_TRY_LOOP();
+                REGVM_TRY_ENTER();
+            }
         OP_END
 
         OP_BEGIN(JmpWhen)
@@ -762,6 +1721,30 @@ static int invoke_impl(
                 goto err_cond_is_not_bool;
         OP_END
 
+#if INVOKE_IMPL_TOS_CACHE
+
+#define IMPL_TOS_JMP_OP(NAME, OPERAND_TYPE, JMP_VAL, NEXT_VAL) \
+    tos_op_##NAME: { \
+        OPERAND_(OPERAND_TYPE, operand.ptrdiff) \
+        if (tos == machine_globals->JMP_VAL) \
+            ip = ip - 1 + operand.ptrdiff; \
+        else if (ow_likely(tos == machine_globals->NEXT_VAL)) \
+            ip += sizeof(_operand_type_##OPERAND_TYPE); \
+        else \
+            TOS_FLUSH_AND_RUN(NAME); \
+        DISPATCH(); \
+    } \
+// ^^^ IMPL_TOS_JMP_OP() ^^^
+
+        IMPL_TOS_JMP_OP(JmpWhen , i8 , value_true , value_false)
+        IMPL_TOS_JMP_OP(JmpWhenW, i16, value_true , value_false)
+        IMPL_TOS_JMP_OP(JmpUnls , i8 , value_false, value_true )
+        IMPL_TOS_JMP_OP(JmpUnlsW, i16, value_false, value_true )
+
+#undef IMPL_TOS_JMP_OP
+
+#endif // INVOKE_IMPL_TOS_CACHE
+
         OP_BEGIN(LdMod)
             OPERAND(u16, operand.index)
             struct ow_symbol_obj *sym =
@@ -777,8 +1760,10 @@ static int invoke_impl(
                 goto raise_exc;
             }
             *++stack.sp = ow_object_from(mod_o);
+            STACK_COMMIT();
             const int status = ow_machine_run(
                 machine, mod_o, false, (struct ow_object **)&exc_o);
+            STACK_UPDATE();
             if (ow_unlikely(status == -1)) {
                 *++stack.sp = ow_object_from(exc_o);
                 goto raise_exc;
@@ -791,6 +1776,7 @@ static int invoke_impl(
             operand.pointer = *stack.sp;
             // Return value is stored in `operand.pointer`.
         op_Ret_2:;
+            const unsigned char ret_hook = current_frame->ret_hook;
             ip = current_frame->prev_ip;
             stack.fp = current_frame->prev_fp;
             if (current_frame->not_ret_val || ow_unlikely(!ip)) {
@@ -816,6 +1802,12 @@ static int invoke_impl(
             current_func_obj = ow_object_cast(
                 (*(current_frame->arg_list - 1)), struct ow_func_obj);
             current_module = current_func_obj->module;
+            if (ow_unlikely(ret_hook)) {
+                operand.u8 = ret_hook;
+                goto finish_ret_hook;
+            }
+            JIT_TRY_RESUME();
+            REGVM_TRY_ENTER();
         OP_END
 
         OP_BEGIN(RetNil)
@@ -834,15 +1826,28 @@ static int invoke_impl(
 
         OP_BEGIN(Call)
             OPERAND(u8, operand.u8)
+            {
+                const size_t arg_count = operand.u8 & 0x7f;
+                struct ow_object *const callable_obj = *(stack.sp - arg_count);
+                if (!ow_smallval_check(callable_obj) &&
+                        ow_object_class(callable_obj) == builtin_classes->func &&
+                        ow_object_cast(callable_obj, struct ow_func_obj)
+                            ->func_spec.arg_cnt == (int)arg_count)
+                    QUICKEN(CallFunc, 1);
+            }
         op_Call_1:;
             size_t arg_count = operand.u8 & 0x7f;
             const bool no_ret_val  = operand.u8 & 0x80;
+            if (ow_unlikely(!ow_callstack_frame_room(machine->callstack, stack.sp)))
+                goto err_stack_overflow;
 
             struct ow_callstack_frame_info_list *const frame_info_list =
                 &machine->callstack.frame_info_list;
             ow_callstack_frame_info_list_enter(frame_info_list);
             current_frame = frame_info_list->current;
             current_frame->not_ret_val = no_ret_val;
+            current_frame->ret_hook = call_ret_hook;
+            call_ret_hook = 0;
             current_frame->arg_list = stack.sp - arg_count + 1;
             current_frame->prev_fp = stack.fp;
             current_frame->prev_ip = ip;
@@ -883,8 +1888,9 @@ static int invoke_impl(
 
             struct ow_object *const callable_obj = *(stack.sp - arg_count);
             struct ow_class_obj *callable_obj_class;
-            if (ow_unlikely(ow_smallint_check(callable_obj))) {
-                callable_obj_class = builtin_classes->int_;
+            if (ow_unlikely(ow_smallval_check(callable_obj))) {
+                callable_obj_class =
+                    ow_builtin_classes_class_of(builtin_classes, callable_obj);
                 goto other_func_obj_type;
             }
             callable_obj_class = ow_object_class(callable_obj);
@@ -892,9 +1898,13 @@ static int invoke_impl(
                 struct ow_func_obj *const func_obj =
                     ow_object_cast(callable_obj, struct ow_func_obj);
                 OP_CALL_CHECK_ARGC(&func_obj->func_spec, arg_count);
+                for (size_t i = func_obj->func_spec.local_cnt; i; i--)
+                    *++stack.sp = machine_globals->value_nil;
                 ip = func_obj->code;
                 current_func_obj = func_obj;
                 current_module = func_obj->module;
+                JIT_TRY_ENTER();
+                REGVM_TRY_ENTER();
             } else if (callable_obj_class == builtin_classes->cfunc) {
                 struct ow_cfunc_obj *const cfunc_obj =
                     ow_object_cast(callable_obj, struct ow_cfunc_obj);
@@ -902,6 +1912,7 @@ static int invoke_impl(
                 STACK_COMMIT();
                 const int status = cfunc_obj->code(machine);
                 STACK_UPDATE();
+                const unsigned char ret_hook = current_frame->ret_hook;
                 struct ow_object *const ret_val =
                     status ? *stack.sp : machine_globals->value_nil;
                 assert(current_frame->prev_ip == ip);
@@ -923,6 +1934,12 @@ static int invoke_impl(
                     *++stack.sp = ret_val; // Exception.
                     goto raise_exc;
                 }
+                if (ow_unlikely(ret_hook)) {
+                    operand.u8 = ret_hook;
+                    goto finish_ret_hook;
+                }
+                JIT_TRY_RESUME();
+                REGVM_TRY_ENTER();
             } else {
             other_func_obj_type:;
                 STACK_COMMIT();
@@ -933,6 +1950,7 @@ static int invoke_impl(
                     stack.sp -= arg_count;
                     goto raise_exc;
                 }
+                call_ret_hook = current_frame->ret_hook;
                 goto op_Call_1;
             }
 
@@ -940,27 +1958,108 @@ static int invoke_impl(
 
         OP_END
 
+        OP_BEGIN(CallFunc)
+            OPERAND(u8, operand.u8)
+            const size_t arg_count = operand.u8 & 0x7f;
+            struct ow_object *const callable_obj = *(stack.sp - arg_count);
+            if (ow_unlikely(ow_smallval_check(callable_obj) ||
+                    ow_object_class(callable_obj) != builtin_classes->func)) {
+                QUICKEN(Call, 1);
+                goto op_Call_1;
+            }
+            struct ow_func_obj *const func_obj =
+                ow_object_cast(callable_obj, struct ow_func_obj);
+            if (ow_unlikely(func_obj->func_spec.arg_cnt != (int)arg_count)) {
+                QUICKEN(Call, 1);
+                goto op_Call_1;
+            }
+            if (ow_unlikely(!ow_callstack_frame_room(machine->callstack, stack.sp)))
+                goto err_stack_overflow;
+
+            struct ow_callstack_frame_info_list *const frame_info_list =
+                &machine->callstack.frame_info_list;
+            ow_callstack_frame_info_list_enter(frame_info_list);
+            current_frame = frame_info_list->current;
+            current_frame->not_ret_val = operand.u8 & 0x80;
+            current_frame->ret_hook = 0;
+            current_frame->arg_list = stack.sp - arg_count + 1;
+            current_frame->prev_fp = stack.fp;
+            current_frame->prev_ip = ip;
+            stack.fp = stack.sp + 1;
+
+            for (size_t i = func_obj->func_spec.local_cnt; i; i--)
+                *++stack.sp = machine_globals->value_nil;
+            ip = func_obj->code;
+            current_func_obj = func_obj;
+            current_module = func_obj->module;
+            JIT_TRY_ENTER();
+            REGVM_TRY_ENTER();
+        OP_END
+
+        OP_BEGIN(TailCall)
+            OPERAND(u8, operand.u8)
+            const size_t arg_count = operand.u8 & 0x7f;
+            assert(!(operand.u8 & 0x80));
+            struct ow_object **const callee_slot = stack.sp - arg_count;
+            struct ow_object *const callable_obj = *callee_slot;
+            if (ow_unlikely(ow_smallval_check(callable_obj) ||
+                    ow_object_class(callable_obj) != builtin_classes->func))
+                goto op_Call_1; // The next instruction returns the result.
+            struct ow_func_obj *const func_obj =
+                ow_object_cast(callable_obj, struct ow_func_obj);
+            if (ow_unlikely(func_obj->func_spec.arg_cnt != (int)arg_count))
+                goto op_Call_1;
+
+            // Replace the callee and arguments of current frame, then reuse the frame.
+            struct ow_object **const frame_slot = current_frame->arg_list - 1;
+            if (ow_unlikely(!ow_callstack_frame_room(machine->callstack, frame_slot)))
+                goto err_stack_overflow;
+            for (size_t i = 0; i <= arg_count; i++)
+                frame_slot[i] = callee_slot[i];
+            stack.sp = frame_slot + arg_count;
+            stack.fp = stack.sp + 1;
+            current_frame->tail_calls++;
+
+            for (size_t i = func_obj->func_spec.local_cnt; i; i--)
+                *++stack.sp = machine_globals->value_nil;
+            ip = func_obj->code;
+            current_func_obj = func_obj;
+            current_module = func_obj->module;
+            JIT_TRY_ENTER();
+            REGVM_TRY_ENTER();
+        OP_END
+
         OP_BEGIN(PrepMethY)
             OPERAND(u8, operand.index)
         op_PrepMethY_1:;
+            struct ow_object *const obj = *stack.sp;
+            struct ow_class_obj *const obj_class =
+                ow_builtin_classes_class_of(builtin_classes, obj);
+            struct ow_func_obj_inline_cache *const cache =
+                ow_func_obj_inline_cache(current_func_obj, ip);
+            if (ow_likely(cache)) {
+                const size_t method_index =
+                    ow_func_obj_inline_cache_find(cache, obj_class);
+                if (ow_likely(method_index != (size_t)-1)) {
+                    *stack.sp = ow_class_obj_get_method(obj_class, method_index);
+                    *++stack.sp = obj;
+                    OP_NEXT();
+                }
+            }
             struct ow_symbol_obj *name =
                 ow_func_obj_get_symbol(current_func_obj, operand.index);
             if (ow_unlikely(!name))
                 goto err_bad_operand;
-            struct ow_object *const obj = *stack.sp;
-            struct ow_class_obj *obj_class;
-            if (ow_unlikely(ow_smallint_check(obj)))
-                obj_class = builtin_classes->int_;
-            else
-                obj_class = ow_object_class(obj);
             operand.index = ow_class_obj_find_method(obj_class, name);
             if (ow_likely(operand.index != (size_t)-1)) {
+                if (ow_likely(cache))
+                    ow_func_obj_inline_cache_record(cache, obj_class, operand.index);
                 *stack.sp = ow_class_obj_get_method(obj_class, operand.index);
                 *++stack.sp = obj;
             } else {
                 *++stack.sp = obj;
                 STACK_COMMIT();
-                const bool ok = invoke_impl_do_find_method(
+                const bool ok = !invoke_impl_do_find_method(
                     machine, obj, obj_class, name, stack.sp - 1);
                 STACK_ASSERT_NC();
                 if (ow_unlikely(!ok)) {
@@ -975,6 +2074,90 @@ static int invoke_impl(
             goto op_PrepMethY_1;
         OP_END
 
+        OP_BEGIN(CallMethY)
+            // PrepMethY name; Call argc
+            OPERAND(u8, operand.index)
+            struct ow_object *const obj = *stack.sp;
+            struct ow_func_obj_inline_cache *const cache =
+                ow_func_obj_inline_cache(current_func_obj, ip);
+            if (ow_unlikely(!cache))
+                goto op_PrepMethY_1;
+            struct ow_class_obj *const obj_class =
+                ow_builtin_classes_class_of(builtin_classes, obj);
+            const size_t method_index = ow_func_obj_inline_cache_find(cache, obj_class);
+            if (ow_unlikely(method_index == (size_t)-1))
+                goto op_PrepMethY_1;
+            *stack.sp = ow_class_obj_get_method(obj_class, method_index);
+            *++stack.sp = obj;
+            ip += 2;
+            DO_CALL(ip[-1]);
+        OP_END
+
+        OP_BEGIN(PrepIter)
+            NO_OPERAND()
+            struct ow_object *const obj = *stack.sp;
+            if (ow_likely(invoke_impl_iter_builtin(builtin_classes, obj))) {
+                *++stack.sp = ow_smallint_to_ptr(0);
+                OP_NEXT();
+            }
+            *++stack.sp = obj;
+            STACK_COMMIT();
+            const bool ok = invoke_impl_get_method_y(
+                machine, obj, common_symbols->iter, stack.sp - 1);
+            STACK_ASSERT_NC();
+            if (ow_unlikely(!ok)) {
+                stack.sp--;
+                goto raise_exc;
+            }
+            call_ret_hook = (unsigned char)OW_OPC_PrepIter;
+            DO_CALL(1);
+        OP_END
+
+#define IMPL_FOR_ITER(NAME, OPERAND_SIZE) \
+    struct ow_object *const pos_o = *stack.sp; \
+    if (ow_likely(ow_smallint_check(pos_o))) { \
+        size_t pos = (size_t)ow_smallint_from_ptr(pos_o); \
+        struct ow_object *const elem = \
+            invoke_impl_iter_next(builtin_classes, stack.sp[-1], &pos); \
+        if (ow_likely(elem)) { \
+            *stack.sp = ow_smallint_to_ptr((ow_smallint_t)pos); \
+            *++stack.sp = elem; \
+            ip += OPERAND_SIZE; \
+            REGVM_TRY_ENTER(); \
+        } else { \
+            stack.sp -= 2; \
+            ip = ip - 1 + operand.ptrdiff; \
+        } \
+    } else { \
+        struct ow_object *const iter = stack.sp[-1]; \
+        stack.sp += 2; \
+        *stack.sp = iter; \
+        ip += OPERAND_SIZE; \
+        STACK_COMMIT(); \
+        const bool ok = invoke_impl_get_method_y( \
+            machine, iter, common_symbols->next, stack.sp - 1); \
+        STACK_ASSERT_NC(); \
+        if (ow_unlikely(!ok)) { \
+            stack.sp--; \
+            goto raise_exc; \
+        } \
+        call_ret_hook = (unsigned char)OW_OPC_##NAME; \
+        DO_CALL(1); \
+    } \
+// ^^^ IMPL_FOR_ITER() ^^^
+
+        OP_BEGIN(ForIter)
+            OPERAND_(i8, operand.ptrdiff)
+            IMPL_FOR_ITER(ForIter, 1)
+        OP_END
+
+        OP_BEGIN(ForIterW)
+            OPERAND_(i16, operand.ptrdiff)
+            IMPL_FOR_ITER(ForIterW, 2)
+        OP_END
+
+#undef IMPL_FOR_ITER
+
         OP_BEGIN(MkArr)
             OPERAND(u8, operand.count)
         op_MkArr_1:;
@@ -1048,7 +2231,7 @@ static int invoke_impl(
             STACK_ASSERT_NC();
             *stack.sp = ow_object_from(obj);
             for (size_t i = 0; i < operand.index; i++)
-                ow_map_obj_set(machine, obj, data[i], data[i + 1]);
+                ow_map_obj_set(machine, obj, data[i * 2], data[i * 2 + 1]);
             STACK_ASSERT_NC();
             *data = ow_object_from(obj);
             stack.sp = data;
@@ -1061,9 +2244,19 @@ static int invoke_impl(
 
 #undef OP_BEGIN
 #undef OP_END
+#undef OP_NEXT
 #undef OPERAND
 #undef NO_OPERAND
 
+        OP_RESERVED(_4d)
+        OP_RESERVED(_illegal)
+
+#undef OP_RESERVED
+#undef JIT_TRY_ENTER
+#undef JIT_TRY_RESUME
+#undef JIT_TRY_LOOP
+#undef REGVM_TRY_ENTER
+
         default:
             ip--;
             *++stack.sp = ow_object_from(ow_exception_format(
@@ -1091,15 +2284,164 @@ static int invoke_impl(
             ));
             goto raise_exc;
 
+        err_stack_overflow:
+            // Raised before entering the new frame. Operand is that of `Call`.
+            stack.sp -= (operand.u8 & 0x7f) + 1; // Drop the callable and the arguments.
+            call_ret_hook = 0;
+            STACK_COMMIT();
+            operand.pointer = ow_object_from(ow_exception_format(
+                machine, NULL, "stack overflow"));
+            if (ow_unlikely(!ip)) {
+                *_res_out = operand.pointer;
+                return -1;
+            }
+            *++stack.sp = operand.pointer;
+            goto raise_exc;
+
         err_cond_is_not_bool:
             ip--;
             *++stack.sp = ow_object_from(ow_exception_format(
                 machine, NULL, "condition value is not a boolean object"));
             goto raise_exc;
 
+        finish_ret_hook:
+            // Post-process the value returned from a frame that has a return hook.
+            // The hook (an opcode) is in `operand.u8`; the value is at `*stack.sp`.
+            if (operand.u8 == OW_OPC_PrepIter) {
+                // The iterator from `__iter__()`. Iterate it with `__next__()`.
+                *++stack.sp = machine_globals->value_nil;
+                goto finish_ret_hook_done;
+            }
+            if (operand.u8 == OW_OPC_ForIter || operand.u8 == OW_OPC_ForIterW) {
+                // The element from `__next__()`. Nil means the end.
+                if (*stack.sp == machine_globals->value_nil) {
+                    stack.sp -= 3;
+                    if (operand.u8 == OW_OPC_ForIter)
+                        ip = ip - 2 + *(const int8_t *)(ip - 1);
+                    else
+                        ip = ip - 3 + *(const int16_t *)(ip - 2);
+                }
+                goto finish_ret_hook_done;
+            }
+            if (ow_unlikely(!ow_smallint_check(*stack.sp))) {
+                *stack.sp = ow_object_from(ow_exception_format(
+                    machine, NULL, "wrong type of comparison result"));
+                goto raise_exc;
+            }
+            {
+                const ow_smallint_t cmp_res = ow_smallint_from_ptr(*stack.sp);
+                bool res;
+                switch ((enum ow_opcode)operand.u8) {
+                case OW_OPC_CmpLt: res = cmp_res <  0; break;
+                case OW_OPC_CmpLe: res = cmp_res <= 0; break;
+                case OW_OPC_CmpGt: res = cmp_res >  0; break;
+                case OW_OPC_CmpGe: res = cmp_res >= 0; break;
+                case OW_OPC_CmpEq: res = cmp_res == 0; break;
+                case OW_OPC_CmpNe: res = cmp_res != 0; break;
+                default: ow_unreachable();
+                }
+                *stack.sp = res ?
+                    machine_globals->value_true : machine_globals->value_false;
+            }
+        finish_ret_hook_done:
+#if INVOKE_IMPL_THREADED
+            DISPATCH();
+#else // !INVOKE_IMPL_THREADED
+            continue;
+#endif // INVOKE_IMPL_THREADED
+
+#if OW_JIT_AVAILABLE
+        jit_enter:
+            // Run native code of current function from `jit_entry`.
+            {
+                struct ow_jit_context jit_ctx = {
+                    .sp = stack.sp,
+                    .fp = stack.fp,
+                    .arg_list = current_frame->arg_list,
+                    .globals = machine_globals,
+                    .machine = machine,
+                    .ip_offset = 0,
+                };
+                STACK_COMMIT();
+                const int status =
+                    ow_jit_code_run(current_func_obj->jit_code, &jit_ctx, jit_entry);
+                stack.sp = jit_ctx.sp;
+                STACK_COMMIT();
+                // Objects may have been moved by GC.
+                current_func_obj = ow_object_cast(
+                    (*(current_frame->arg_list - 1)), struct ow_func_obj);
+                current_module = current_func_obj->module;
+                ip = current_func_obj->code + jit_ctx.ip_offset;
+                if (ow_unlikely(status < 0))
+                    goto raise_exc;
+            }
+#    if INVOKE_IMPL_THREADED
+            DISPATCH();
+#    else // !INVOKE_IMPL_THREADED
+            continue;
+#    endif // INVOKE_IMPL_THREADED
+
+        trace_enter:
+            // Run the trace of the loop at `ip`. If not run, try native code of the function.
+            {
+                struct ow_jit_context jit_ctx = {
+                    .sp = stack.sp,
+                    .fp = stack.fp,
+                    .arg_list = current_frame->arg_list,
+                    .globals = machine_globals,
+                    .machine = machine,
+                    .ip_offset = 0,
+                };
+                STACK_COMMIT();
+                if (ow_trace_run(
+                        &jit_ctx, (size_t)(ip - current_func_obj->code), trace_threshold)) {
+                    stack.sp = jit_ctx.sp;
+                    STACK_COMMIT();
+                    // Objects may have been moved by GC.
+                    current_func_obj = ow_object_cast(
+                        (*(current_frame->arg_list - 1)), struct ow_func_obj);
+                    current_module = current_func_obj->module;
+                    ip = current_func_obj->code + jit_ctx.ip_offset;
+                } else {
+                    jit_entry = invoke_impl_jit_entry(current_func_obj, ip, jit_threshold);
+                    if (ow_unlikely(jit_entry))
+                        goto jit_enter;
+                }
+            }
+#    if INVOKE_IMPL_THREADED
+            DISPATCH();
+#    else // !INVOKE_IMPL_THREADED
+            continue;
+#    endif // INVOKE_IMPL_THREADED
+#endif // OW_JIT_AVAILABLE
+
+#if OW_BUILD_REGISTER_VM
+        regvm_enter:
+            // Run register code of current function from `regvm_entry`.
+            // It neither allocates nor calls, so objects stay where they are.
+            {
+                struct ow_jit_context regvm_ctx = {
+                    .sp = stack.sp,
+                    .fp = stack.fp,
+                    .arg_list = current_frame->arg_list,
+                    .globals = machine_globals,
+                    .machine = machine,
+                    .ip_offset = 0,
+                };
+                ow_regvm_code_run(current_func_obj->regvm_code, &regvm_ctx, regvm_entry);
+                stack.sp = regvm_ctx.sp;
+                ip = current_func_obj->code + regvm_ctx.ip_offset;
+            }
+#    if INVOKE_IMPL_THREADED
+            DISPATCH();
+#    else // !INVOKE_IMPL_THREADED
+            continue;
+#    endif // INVOKE_IMPL_THREADED
+#endif // OW_BUILD_REGISTER_VM
+
         raise_exc:
             operand.pointer = *stack.sp; // The exception to raise.
-            if (ow_unlikely(ow_smallint_check(operand.pointer) ||
+            if (ow_unlikely(ow_smallval_check(operand.pointer) ||
                     !ow_class_obj_is_base(builtin_classes->exception,
                         ow_object_class(operand.pointer)))) {
                 operand.pointer = ow_object_from(ow_exception_format(
@@ -1112,6 +2454,7 @@ static int invoke_impl(
                     &(const struct ow_exception_obj_frame_info){
                         .ip = ip,
                         .function = ow_object_from(current_func_obj),
+                        .tail_calls = current_frame->tail_calls,
                     }
                 );
 
@@ -1139,15 +2482,614 @@ static int invoke_impl(
         ow_unreachable();
     }
 
+#if INVOKE_IMPL_THREADED
+#    undef DISPATCH
+#    pragma GCC diagnostic pop
+#endif // INVOKE_IMPL_THREADED
+
 #undef STACK_COMMIT
 #undef STACK_UPDATE
 #undef STACK_ASSERT_NC
 }
 
+#if OW_JIT_AVAILABLE
+
+int ow_jit_rt_exec(struct ow_jit_context *ctx, size_t offset) {
+    struct ow_machine *const machine = ctx->machine;
+    struct ow_machine_globals *const machine_globals = ctx->globals;
+    struct ow_func_obj *const func_obj =
+        ow_object_cast(ctx->arg_list[-1], struct ow_func_obj);
+    const unsigned char *const ip = func_obj->code + offset;
+    const enum ow_opcode opcode = ow_opcode_generic((enum ow_opcode)*ip);
+    const enum ow_operand_type operand_type = ow_operand_type(opcode);
+    const unsigned char *const next_ip = ip + 1 + ow_operand_type_width(operand_type);
+    size_t index;
+    if (operand_type == OW_OPERAND_u8)
+        index = ip[1];
+    else if (operand_type == OW_OPERAND_u16)
+        index = *(const uint16_t *)(ip + 1);
+    else
+        index = 0;
+
+    struct ow_object **sp = ctx->sp;
+    machine->callstack.regs.sp = sp;
+    machine->callstack.regs.fp = ctx->fp;
+
+    switch (opcode) {
+        struct ow_object *res_o;
+        int status;
+
+    case OW_OPC_LdFlt:
+        *++sp = ow_float_obj_or_smallfloat(machine, (double)(int8_t)ip[1]);
+        break;
+
+    case OW_OPC_Add:
+    case OW_OPC_Sub:
+    case OW_OPC_Mul:
+    case OW_OPC_Div:
+    case OW_OPC_Rem:
+    case OW_OPC_Shl:
+    case OW_OPC_Shr:
+    case OW_OPC_And:
+    case OW_OPC_Or:
+    case OW_OPC_Xor:
+        status = invoke_impl_builtin_bin_op(machine, opcode, sp[-1], sp[0], &res_o);
+        if (ow_unlikely(status > 0))
+            goto defer;
+        *--sp = res_o;
+        if (ow_unlikely(status < 0))
+            goto raise_exc;
+        break;
+
+    case OW_OPC_Neg:
+    case OW_OPC_Inv:
+        if (ow_unlikely(invoke_impl_builtin_un_op(machine, opcode, sp[0], &res_o)))
+            goto defer;
+        *sp = res_o;
+        break;
+
+    case OW_OPC_Cmp:
+    case OW_OPC_CmpLt:
+    case OW_OPC_CmpLe:
+    case OW_OPC_CmpGt:
+    case OW_OPC_CmpGe:
+    case OW_OPC_CmpEq:
+    case OW_OPC_CmpNe: {
+        int cmp_res;
+        status = invoke_impl_builtin_cmp(machine, sp[-1], sp[0], &cmp_res);
+        if (ow_unlikely(status == 1))
+            goto defer;
+        bool res;
+        switch (opcode) {
+        case OW_OPC_Cmp:
+            *--sp = status == 0 ? ow_smallint_to_ptr(cmp_res) : machine_globals->value_nil;
+            goto done;
+        case OW_OPC_CmpLt: res = status == 0 && cmp_res <  0; break;
+        case OW_OPC_CmpLe: res = status == 0 && cmp_res <= 0; break;
+        case OW_OPC_CmpGt: res = status == 0 && cmp_res >  0; break;
+        case OW_OPC_CmpGe: res = status == 0 && cmp_res >= 0; break;
+        case OW_OPC_CmpEq: res = status == 0 && cmp_res == 0; break;
+        case OW_OPC_CmpNe: res = status != 0 || cmp_res != 0; break;
+        default: ow_unreachable();
+        }
+        *--sp = res ? machine_globals->value_true : machine_globals->value_false;
+        break;
+    }
+
+    case OW_OPC_LdCnst:
+    case OW_OPC_LdCnstW:
+        res_o = ow_func_obj_get_constant(func_obj, index);
+        if (ow_unlikely(!res_o))
+            goto defer;
+        *++sp = res_o;
+        break;
+
+    case OW_OPC_LdSym:
+    case OW_OPC_LdSymW: {
+        struct ow_symbol_obj *const sym = ow_func_obj_get_symbol(func_obj, index);
+        if (ow_unlikely(!sym))
+            goto defer;
+        *++sp = ow_object_from(sym);
+        break;
+    }
+
+    case OW_OPC_LdGlob:
+    case OW_OPC_LdGlobW:
+        res_o = ow_module_obj_get_global(func_obj->module, index);
+        *++sp = ow_likely(res_o) ? res_o : machine_globals->value_nil;
+        break;
+
+    case OW_OPC_StGlob:
+    case OW_OPC_StGlobW:
+        ow_module_obj_set_global(func_obj->module, index, *sp--);
+        break;
+
+    case OW_OPC_LdGlobY:
+    case OW_OPC_LdGlobYW:
+        res_o = invoke_impl_load_global_y(machine, func_obj, next_ip, index);
+        if (ow_unlikely(!res_o))
+            goto defer;
+        *++sp = res_o;
+        break;
+
+    case OW_OPC_StGlobY:
+    case OW_OPC_StGlobYW:
+        if (ow_unlikely(!invoke_impl_store_global_y(func_obj, next_ip, index, sp[0])))
+            goto defer;
+        sp--;
+        break;
+
+    case OW_OPC_PrepIter:
+        if (ow_unlikely(!invoke_impl_iter_builtin(machine->builtin_classes, sp[0])))
+            goto defer;
+        *++sp = ow_smallint_to_ptr(0);
+        break;
+
+    case OW_OPC_ForIter:
+    case OW_OPC_ForIterW: {
+        if (ow_unlikely(!ow_smallint_check(sp[0])))
+            goto defer;
+        size_t pos = (size_t)ow_smallint_from_ptr(sp[0]);
+        res_o = invoke_impl_iter_next(machine->builtin_classes, sp[-1], &pos);
+        if (!res_o) {
+            ctx->sp = sp - 2;
+            return 2;
+        }
+        *sp = ow_smallint_to_ptr((ow_smallint_t)pos);
+        *++sp = res_o;
+        break;
+    }
+
+    default:
+        goto defer;
+    }
+
+done:
+    ctx->sp = sp;
+    return 0;
+
+defer:
+    ctx->ip_offset = offset;
+    return 1;
+
+raise_exc:
+    ctx->sp = sp;
+    ctx->ip_offset = (size_t)(next_ip - func_obj->code);
+    return -1;
+}
+
+#endif // OW_JIT_AVAILABLE
+
+/// Call method `name` for an AOT-compiled instruction. The stack top holds a slot
+/// for the method followed by `argc` arguments, the first one being the receiver.
+/// They are popped. Return 0 or -1 like `ow_machine_invoke()`.
+static int invoke_impl_aot_call_method(
+    struct ow_machine *om, struct ow_symbol_obj *name,
+    size_t argc, struct ow_object **res_out
+) {
+    struct ow_object **const slot = om->callstack.regs.sp - argc;
+    if (ow_unlikely(!invoke_impl_get_method_y(om, slot[1], name, slot))) {
+        *res_out = *slot;
+        om->callstack.regs.sp = slot - 1;
+        return -1;
+    }
+    return ow_machine_invoke(om, (int)argc, res_out);
+}
+
+/// Like `invoke_impl_aot_call_method()`, but the `argc` arguments on stack top
+/// have no slot for the method under them.
+static int invoke_impl_aot_call_method_ns(
+    struct ow_machine *om, struct ow_symbol_obj *name,
+    size_t argc, struct ow_object **res_out
+) {
+    struct ow_object **const sp = om->callstack.regs.sp;
+    for (size_t i = 0; i < argc; i++)
+        sp[1 - i] = sp[-i];
+    sp[1 - argc] = om->globals->value_nil;
+    om->callstack.regs.sp = sp + 1;
+    return invoke_impl_aot_call_method(om, name, argc, res_out);
+}
+
+/// Method name of a binary or unary operator.
+static struct ow_symbol_obj *invoke_impl_aot_op_method(
+    const struct ow_common_symbols *cs, enum ow_opcode opcode
+) {
+    switch (opcode) {
+    case OW_OPC_Add: return cs->add;
+    case OW_OPC_Sub: return cs->sub;
+    case OW_OPC_Mul: return cs->mul;
+    case OW_OPC_Div: return cs->div;
+    case OW_OPC_Rem: return cs->rem;
+    case OW_OPC_Shl: return cs->shl;
+    case OW_OPC_Shr: return cs->shr;
+    case OW_OPC_And: return cs->and_;
+    case OW_OPC_Or : return cs->or_;
+    case OW_OPC_Xor: return cs->xor_;
+    case OW_OPC_Neg: return cs->neg;
+    case OW_OPC_Inv: return cs->inv;
+    default: ow_unreachable();
+    }
+}
+
+int ow_aot_rt_exec(
+    struct ow_machine *om, enum ow_opcode opcode, size_t operand,
+    struct ow_symbol_obj *name
+) {
+    struct ow_machine_globals *const machine_globals = om->globals;
+    struct ow_builtin_classes *const builtin_classes = om->builtin_classes;
+    struct ow_common_symbols *const common_symbols = om->common_symbols;
+    struct ow_callstack_frame_info *const current_frame =
+        om->callstack.frame_info_list.current;
+    struct ow_module_obj *const current_module =
+        ow_object_cast(current_frame->arg_list[-1], struct ow_cfunc_obj)->module;
+    struct ow_object **sp = om->callstack.regs.sp;
+    struct ow_object *res_o;
+    int status;
+
+    switch (opcode) {
+    case OW_OPC_Add:
+    case OW_OPC_Sub:
+    case OW_OPC_Mul:
+    case OW_OPC_Div:
+    case OW_OPC_Rem:
+    case OW_OPC_Shl:
+    case OW_OPC_Shr:
+    case OW_OPC_And:
+    case OW_OPC_Or:
+    case OW_OPC_Xor:
+        status = invoke_impl_builtin_bin_op(om, opcode, sp[-1], sp[0], &res_o);
+        if (ow_likely(status <= 0)) {
+            *--sp = res_o;
+            if (ow_unlikely(status < 0))
+                goto raise_exc;
+            break;
+        }
+        status = invoke_impl_aot_call_method_ns(
+            om, invoke_impl_aot_op_method(common_symbols, opcode), 2, &res_o);
+        goto push_result;
+
+    case OW_OPC_Neg:
+    case OW_OPC_Inv:
+        if (ow_likely(!invoke_impl_builtin_un_op(om, opcode, sp[0], &res_o))) {
+            *sp = res_o;
+            break;
+        }
+        status = invoke_impl_aot_call_method_ns(
+            om, invoke_impl_aot_op_method(common_symbols, opcode), 1, &res_o);
+        goto push_result;
+
+    case OW_OPC_Not:
+        if (*sp == machine_globals->value_true)
+            *sp = machine_globals->value_false;
+        else if (*sp != machine_globals->value_false)
+            *sp = machine_globals->value_true;
+        else
+            goto err_cond_is_not_bool;
+        break;
+
+    case OW_OPC_Cmp:
+    case OW_OPC_CmpLt:
+    case OW_OPC_CmpLe:
+    case OW_OPC_CmpGt:
+    case OW_OPC_CmpGe:
+    case OW_OPC_CmpEq:
+    case OW_OPC_CmpNe: {
+        int cmp_res;
+        status = invoke_impl_builtin_cmp(om, sp[-1], sp[0], &cmp_res);
+        if (ow_unlikely(status == 1)) {
+            status = invoke_impl_aot_call_method_ns(om, common_symbols->cmp, 2, &res_o);
+            if (ow_unlikely(status) || opcode == OW_OPC_Cmp)
+                goto push_result;
+            sp = om->callstack.regs.sp + 1;
+            if (ow_unlikely(!ow_smallint_check(res_o))) {
+                *sp = ow_object_from(ow_exception_format(
+                    om, NULL, "wrong type of comparison result"));
+                goto raise_exc;
+            }
+            cmp_res = ow_smallint_from_ptr(res_o) < 0 ? -1 : ow_smallint_from_ptr(res_o) > 0;
+        } else {
+            sp--;
+            if (opcode == OW_OPC_Cmp) {
+                *sp = status == 0 ? ow_smallint_to_ptr(cmp_res) : machine_globals->value_nil;
+                break;
+            }
+        }
+        bool res;
+        switch (opcode) {
+        case OW_OPC_CmpLt: res = status == 0 && cmp_res <  0; break;
+        case OW_OPC_CmpLe: res = status == 0 && cmp_res <= 0; break;
+        case OW_OPC_CmpGt: res = status == 0 && cmp_res >  0; break;
+        case OW_OPC_CmpGe: res = status == 0 && cmp_res >= 0; break;
+        case OW_OPC_CmpEq: res = status == 0 && cmp_res == 0; break;
+        case OW_OPC_CmpNe: res = status != 0 || cmp_res != 0; break;
+        default: ow_unreachable();
+        }
+        *sp = res ? machine_globals->value_true : machine_globals->value_false;
+        break;
+    }
+
+    case OW_OPC_LdFlt:
+        res_o = ow_float_obj_or_smallfloat(om, (double)(ptrdiff_t)operand);
+        *++sp = res_o;
+        break;
+
+    case OW_OPC_StGlob:
+        ow_module_obj_set_global(current_module, operand, *sp--);
+        break;
+
+    case OW_OPC_StGlobY:
+        ow_module_obj_set_global_y(current_module, name, *sp--);
+        break;
+
+    case OW_OPC_LdAttrY: {
+        struct ow_object *const obj = *sp;
+        struct ow_class_obj *const obj_class =
+            ow_builtin_classes_class_of(builtin_classes, obj);
+        if (obj_class == builtin_classes->module) {
+            res_o = ow_module_obj_get_global_y(
+                ow_object_cast(obj, struct ow_module_obj), name);
+            *sp = ow_likely(res_o) ? res_o : machine_globals->value_nil;
+            break;
+        }
+        const size_t index = ow_class_obj_find_attribute(obj_class, name);
+        if (ow_likely(index != (size_t)-1)) {
+            *sp = ow_object_get_field(obj, index);
+            break;
+        }
+        status = invoke_impl_do_find_attribute(om, obj, obj_class, name, &res_o);
+        *sp = res_o;
+        if (ow_unlikely(status))
+            goto raise_exc;
+        break;
+    }
+
+    case OW_OPC_StAttrY: {
+        struct ow_object *const obj = *sp--;
+        if (ow_builtin_classes_class_of(builtin_classes, obj) != builtin_classes->module) {
+            *++sp = ow_object_from(ow_exception_format(
+                om, NULL, "instruction `%s' has not been implemented",
+                ow_opcode_name(opcode)));
+            goto raise_exc;
+        }
+        ow_module_obj_set_global_y(ow_object_cast(obj, struct ow_module_obj), name, *sp);
+        break;
+    }
+
+    case OW_OPC_PrepMethY: {
+        struct ow_object *const obj = *sp;
+        struct ow_class_obj *const obj_class =
+            ow_builtin_classes_class_of(builtin_classes, obj);
+        const size_t index = ow_class_obj_find_method(obj_class, name);
+        *++sp = obj;
+        if (ow_likely(index != (size_t)-1)) {
+            sp[-1] = ow_class_obj_get_method(obj_class, index);
+            break;
+        }
+        om->callstack.regs.sp = sp;
+        if (ow_unlikely(invoke_impl_do_find_method(om, obj, obj_class, name, sp - 1))) {
+            sp--;
+            goto raise_exc;
+        }
+        break;
+    }
+
+    case OW_OPC_LdElem:
+        status = invoke_impl_aot_call_method_ns(om, common_symbols->get_elem, 2, &res_o);
+        goto push_result;
+
+    case OW_OPC_StElem:
+        sp[1] = sp[-2];
+        om->callstack.regs.sp = sp + 1;
+        status = invoke_impl_aot_call_method(om, common_symbols->set_elem, 3, &res_o);
+        goto push_result;
+
+    case OW_OPC_LdMod: {
+        struct ow_exception_obj *exc_o;
+        struct ow_module_obj *const mod_o = ow_module_manager_load(
+            om->module_manager, ow_symbol_obj_data(name), 0, &exc_o);
+        if (ow_unlikely(!mod_o)) {
+            *++sp = ow_object_from(exc_o);
+            goto raise_exc;
+        }
+        *++sp = ow_object_from(mod_o);
+        om->callstack.regs.sp = sp;
+        if (ow_unlikely(ow_machine_run(om, mod_o, false, &res_o))) {
+            *++sp = res_o;
+            goto raise_exc;
+        }
+        break;
+    }
+
+    case OW_OPC_Call:
+    case OW_OPC_TailCall: {
+        // Native code cannot reuse its frame. The following `Ret` returns the result.
+        const size_t arg_count = operand & 0x7f;
+        struct ow_object *const callable_obj = sp[-(ptrdiff_t)arg_count];
+        struct ow_cfunc_obj *cfunc_obj;
+        if (!ow_smallval_check(callable_obj) &&
+                ow_object_class(callable_obj) == builtin_classes->cfunc &&
+                (cfunc_obj = ow_object_cast(callable_obj, struct ow_cfunc_obj),
+                    cfunc_obj->func_spec.arg_cnt == (int)arg_count)) {
+            // Call a native function (maybe another AOT-compiled one) directly.
+            if (ow_unlikely(!ow_callstack_frame_room(om->callstack, sp) ||
+                    om->callstack.native_depth >= OW_CALLSTACK_NATIVE_DEPTH_MAX)) {
+                om->callstack.regs.sp = sp - arg_count - 1;
+                res_o = ow_object_from(ow_exception_format(om, NULL, "stack overflow"));
+                status = -1;
+                goto push_result;
+            }
+            struct ow_callstack_frame_info_list *const frame_info_list =
+                &om->callstack.frame_info_list;
+            ow_callstack_frame_info_list_enter(frame_info_list);
+            struct ow_callstack_frame_info *const frame = frame_info_list->current;
+            frame->not_ret_val = false;
+            frame->ret_hook = 0;
+            frame->arg_list = sp - arg_count + 1;
+            frame->prev_fp = om->callstack.regs.fp;
+            frame->prev_ip = NULL;
+            om->callstack.regs.fp = sp + 1;
+            om->callstack.regs.sp = sp;
+            om->callstack.native_depth++;
+            status = cfunc_obj->code(om);
+            om->callstack.native_depth--;
+            res_o = status ? *om->callstack.regs.sp : machine_globals->value_nil;
+            om->callstack.regs.fp = frame->prev_fp;
+            om->callstack.regs.sp = frame->arg_list - 2;
+            ow_callstack_frame_info_list_leave(frame_info_list);
+        } else {
+            status = ow_machine_invoke(om, (int)arg_count, &res_o);
+        }
+        if (ow_unlikely(status < 0) || !(operand & 0x80))
+            goto push_result;
+        sp = om->callstack.regs.sp;
+        break;
+    }
+
+    case OW_OPC_MkArr:
+    case OW_OPC_MkTup: {
+        struct ow_object **const data = sp - operand + 1;
+        res_o = opcode == OW_OPC_MkArr ?
+            ow_object_from(ow_array_obj_new(om, data, operand)) :
+            ow_object_from(ow_tuple_obj_new(om, data, operand));
+        *data = res_o;
+        sp = data;
+        break;
+    }
+
+    case OW_OPC_MkSet:
+    case OW_OPC_MkMap: {
+        struct ow_object **const data =
+            sp - (opcode == OW_OPC_MkMap ? operand * 2 : operand) + 1;
+        *++sp = machine_globals->value_nil;
+        om->callstack.regs.sp = sp;
+        if (opcode == OW_OPC_MkSet) {
+            struct ow_set_obj *const obj = ow_set_obj_new(om);
+            *sp = ow_object_from(obj);
+            for (size_t i = 0; i < operand; i++)
+                ow_set_obj_insert(om, obj, data[i]);
+        } else {
+            struct ow_map_obj *const obj = ow_map_obj_new(om);
+            *sp = ow_object_from(obj);
+            for (size_t i = 0; i < operand; i++)
+                ow_map_obj_set(om, obj, data[i * 2], data[i * 2 + 1]);
+        }
+        *data = *sp;
+        sp = data;
+        break;
+    }
+
+    case OW_OPC_JmpWhen:
+    case OW_OPC_JmpUnls:
+        goto err_cond_is_not_bool;
+
+    case OW_OPC_PrepIter:
+        if (ow_likely(invoke_impl_iter_builtin(builtin_classes, *sp))) {
+            *++sp = ow_smallint_to_ptr(0);
+            break;
+        }
+        status = invoke_impl_aot_call_method_ns(om, common_symbols->iter, 1, &res_o);
+        sp = om->callstack.regs.sp;
+        *++sp = res_o;
+        if (ow_unlikely(status < 0))
+            goto raise_exc;
+        *++sp = machine_globals->value_nil;
+        break;
+
+    case OW_OPC_ForIter:
+        if (ow_likely(ow_smallint_check(*sp))) {
+            size_t pos = (size_t)ow_smallint_from_ptr(*sp);
+            res_o = invoke_impl_iter_next(builtin_classes, sp[-1], &pos);
+            if (!res_o)
+                goto for_iter_end;
+            *sp = ow_smallint_to_ptr((ow_smallint_t)pos);
+            *++sp = res_o;
+            break;
+        }
+        sp[1] = sp[-1];
+        om->callstack.regs.sp = sp + 1;
+        status = invoke_impl_aot_call_method_ns(om, common_symbols->next, 1, &res_o);
+        sp = om->callstack.regs.sp;
+        if (ow_unlikely(status < 0)) {
+            *++sp = res_o;
+            goto raise_exc;
+        }
+        if (res_o == machine_globals->value_nil)
+            goto for_iter_end;
+        *++sp = res_o;
+        break;
+
+    default:
+        *++sp = ow_object_from(ow_exception_format(
+            om, NULL, "instruction `%s' has not been implemented",
+            ow_opcode_name(opcode)));
+        goto raise_exc;
+    }
+
+    om->callstack.regs.sp = sp;
+    return 0;
+
+push_result:
+    // Push the result of a call (or the exception if `status` is negative).
+    sp = om->callstack.regs.sp;
+    *++sp = res_o;
+    if (ow_unlikely(status < 0))
+        goto raise_exc;
+    om->callstack.regs.sp = sp;
+    return 0;
+
+for_iter_end:
+    // Drop the iterator and the position, and take the jump.
+    om->callstack.regs.sp = sp - 2;
+    return 1;
+
+err_cond_is_not_bool:
+    *++sp = ow_object_from(ow_exception_format(
+        om, NULL, "condition value is not a boolean object"));
+    goto raise_exc;
+
+raise_exc:
+    om->callstack.regs.sp = sp;
+    return -1;
+}
+
+void ow_aot_rt_load_global_y(
+    struct ow_machine *om, struct ow_symbol_obj *name,
+    struct ow_func_obj_global_cell *cell
+) {
+    struct ow_module_obj *const module = ow_object_cast(
+        om->callstack.frame_info_list.current->arg_list[-1],
+        struct ow_cfunc_obj)->module;
+    struct ow_module_obj *const base = om->globals->module_base;
+    struct ow_object *value;
+    size_t index;
+    if (ow_likely(cell->index &&
+            cell->base_guard == ow_module_obj_global_count(module) + 1)) {
+        // A new global in current module may shadow it, which changes the count.
+        value = ow_module_obj_get_global(base, cell->index - 1);
+    } else if ((index = ow_module_obj_find_global(module, name)) != (size_t)-1) {
+        value = ow_module_obj_get_global(module, index);
+    } else if ((index = ow_module_obj_find_global(base, name)) != (size_t)-1) {
+        *cell = (struct ow_func_obj_global_cell){
+            index + 1, ow_module_obj_global_count(module) + 1};
+        value = ow_module_obj_get_global(base, index);
+    } else {
+        value = NULL;
+    }
+    *++om->callstack.regs.sp = ow_likely(value) ? value : om->globals->value_nil;
+}
+
 int ow_machine_invoke(
     struct ow_machine *om, int argc, struct ow_object **res_out
 ) {
-    return invoke_impl(om, argc, res_out);
+    if (ow_unlikely(om->callstack.native_depth >= OW_CALLSTACK_NATIVE_DEPTH_MAX)) {
+        om->callstack.regs.sp -= argc + 1; // Drop the callable and the arguments.
+        *res_out = ow_object_from(ow_exception_format(om, NULL, "stack overflow"));
+        return -1;
+    }
+    om->callstack.native_depth++;
+    const int status = invoke_impl(om, argc, res_out);
+    om->callstack.native_depth--;
+    return status;
 }
 
 int ow_machine_call(
@@ -1168,15 +3110,14 @@ int ow_machine_call_method(
     assert(argv || om->callstack.regs.sp > om->callstack.regs.fp);
     struct ow_object *const obj = argv ? argv[0] : om->callstack.regs.sp[1 - argc];
     struct ow_class_obj *const obj_class =
-        ow_unlikely(ow_smallint_check(obj)) ?
-            om->builtin_classes->int_ : ow_object_class(obj);
+        ow_builtin_classes_class_of(om->builtin_classes, obj);
     const size_t index = ow_class_obj_find_method(obj_class, method_name);
     struct ow_object *method;
     if (ow_likely(index != (size_t)-1)) {
         method = ow_class_obj_get_method(obj_class, index);
     } else {
         ow_objmem_push_ngc(om);
-        const bool ok = invoke_impl_do_find_method(
+        const bool ok = !invoke_impl_do_find_method(
             om, obj, obj_class, method_name, &method);
         ow_objmem_pop_ngc(om);
         if (ow_unlikely(!ok)) {
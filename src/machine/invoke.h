@@ -2,6 +2,8 @@
 
 #include <stdbool.h>
 
+#include <config/options.h>
+
 struct ow_machine;
 struct ow_module_obj;
 struct ow_object;
@@ -36,3 +38,11 @@ int ow_machine_call_native(
 /// Run a module. Call the initializer and main function (optional).
 int ow_machine_run(struct ow_machine *om,
     struct ow_module_obj *module, bool call_main, struct ow_object **res_out);
+
+#if OW_DEBUG_OPSTAT
+
+/// Print counts of executed opcode pairs and the total number of executed
+/// instructions with debug logging.
+void ow_machine_opstat_dump(void);
+
+#endif // OW_DEBUG_OPSTAT
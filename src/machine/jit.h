@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utilities/attributes.h>
+
+#include <config/options.h>
+
+struct ow_func_obj;
+struct ow_machine;
+struct ow_machine_globals;
+struct ow_object;
+
+/// Whether the baseline JIT compiler is available (x86-64 Linux only).
+#if OW_BUILD_JIT && (defined __x86_64__) && (defined __linux__)
+#    define OW_JIT_AVAILABLE 1
+#else
+#    define OW_JIT_AVAILABLE 0
+#endif
+
+/// State of an interpreter frame shared with native code.
+/// The value stack layout is the same as what the interpreter uses.
+struct ow_jit_context {
+    struct ow_object **sp; ///< Stack top. Updated when native code returns.
+    struct ow_object **fp; ///< Frame base.
+    struct ow_object **arg_list; ///< Arguments of the frame; `arg_list[-1]` is the function.
+    struct ow_machine_globals *globals;
+    struct ow_machine *machine;
+    size_t ip_offset; ///< Bytecode offset to continue from when native code returns.
+};
+
+/// Native code of a function.
+struct ow_jit_code {
+    void *memory; // Executable memory.
+    size_t memory_size;
+    size_t entry_count; // Number of elements in `entries`, i.e., bytecode size + 1.
+    uint32_t entries[]; // { bytecode offset => (native offset + 1) or 0 }
+};
+
+#if OW_JIT_AVAILABLE
+
+/// Compile a function to native code. Return NULL on failure.
+struct ow_jit_code *ow_jit_compile(struct ow_func_obj *func);
+/// Delete native code.
+void ow_jit_code_del(struct ow_jit_code *code);
+/// Get the native entry for a bytecode offset. Return NULL if it cannot be entered there.
+ow_static_forceinline const void *ow_jit_code_entry(
+    const struct ow_jit_code *code, size_t offset);
+/// Run native code from an entry. Return `-1` if an exception was raised (it is
+/// at `*ctx->sp` and `ctx->ip_offset` is the offset after the faulting instruction),
+/// otherwise the interpreter shall continue from `ctx->ip_offset`.
+int ow_jit_code_run(
+    const struct ow_jit_code *code, struct ow_jit_context *ctx, const void *entry);
+
+/// Runtime function for native code, implemented by the interpreter. Execute the
+/// instruction at `offset` of the running function. Return `0` on success, `1` if
+/// it shall be executed by the interpreter (`ctx->ip_offset` is set to `offset`),
+/// `2` if it is a jump instruction and the jump shall be taken,
+/// or `-1` if an exception was raised.
+int ow_jit_rt_exec(struct ow_jit_context *ctx, size_t offset);
+
+ow_static_forceinline const void *ow_jit_code_entry(
+    const struct ow_jit_code *code, size_t offset
+) {
+    if (ow_unlikely(offset >= code->entry_count))
+        return NULL;
+    const uint32_t n = code->entries[offset];
+    return ow_likely(n) ? (const unsigned char *)code->memory + (n - 1) : NULL;
+}
+
+#endif // OW_JIT_AVAILABLE
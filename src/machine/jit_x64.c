@@ -0,0 +1,668 @@
+#include "jit.h"
+
+#if OW_JIT_AVAILABLE
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sys/mman.h> // munmap()
+
+#include "globals.h"
+#include "jit_x64_asm.h"
+#include <bytecode/opcode.h>
+#include <bytecode/operand.h>
+#include <objects/funcobj.h>
+#include <objects/smallint.h>
+#include <utilities/attributes.h>
+#include <utilities/debuglog.h>
+#include <utilities/memalloc.h>
+#include <utilities/unreachable.h>
+
+/*
+ * Native code of a function is made by stitching a template for each instruction.
+ *
+ * Registers used by templates: rbx = sp, r12 = fp, r13 = context, r14 = globals,
+ * r15 = arg_list. They are callee-saved, so calls to runtime functions keep them.
+ * Before calling a runtime function, sp is written back to the context.
+ *
+ * An instruction that has no template is not compiled; instead, native code
+ * stops before it and returns to the interpreter, which may enter native code
+ * again at a loop head, a function entry, or a return address.
+ */
+
+#define REG_SP    RBX
+#define REG_FP    R12
+#define REG_CTX   R13
+#define REG_GLOB  R14
+#define REG_ARGS  R15
+
+#define CTX_OFFSET(FIELD)  ((int32_t)offsetof(struct ow_jit_context, FIELD))
+#define GLOB_OFFSET(FIELD) ((int32_t)offsetof(struct ow_machine_globals, FIELD))
+
+/// Minimum number of compiled instructions in a row to make an entry worthwhile.
+#define JIT_ENTRY_MIN_RUN 6
+
+struct jit_fixup {
+    size_t pos; // Position of the rel32 field.
+    size_t target; // Bytecode offset.
+};
+
+struct jit_compiler {
+    struct jit_asm as;
+    struct ow_func_obj *func;
+    const unsigned char *code;
+    size_t code_size;
+    const struct ow_func_spec *func_spec;
+    size_t *native_at; // { bytecode offset => native offset or -1 }
+    struct jit_fixup *fixups;
+    size_t fixup_count;
+    size_t exit_pos; // Native offset of the common exit.
+};
+
+/* ----- Templates ---------------------------------------------------------- */
+
+/// Return to the interpreter, which shall continue from `offset`.
+static void gen_exit(struct jit_compiler *c, size_t offset) {
+    emit_store_imm(&c->as, REG_CTX, CTX_OFFSET(ip_offset), (int32_t)offset);
+    emit_u8(&c->as, 0x31), emit_u8(&c->as, 0xc0); // xor eax, eax
+    patch_rel32(&c->as, emit_jmp(&c->as), c->exit_pos);
+}
+
+/// Call `ow_jit_rt_exec()` for the instruction. The result is in `eax`.
+static void gen_call_rt_exec(struct jit_compiler *c, size_t offset) {
+    emit_store(&c->as, REG_CTX, CTX_OFFSET(sp), REG_SP);
+    emit_alu(&c->as, ALU_MOV, RDI, REG_CTX);
+    emit_u8(&c->as, 0xbe), emit_u32(&c->as, (uint32_t)offset); // mov esi, offset
+    emit_mov_imm64(&c->as, RAX, (uint64_t)(uintptr_t)ow_jit_rt_exec);
+    emit_u8(&c->as, 0xff), emit_u8(&c->as, 0xd0); // call rax
+    emit_load(&c->as, REG_SP, REG_CTX, CTX_OFFSET(sp));
+}
+
+/// Execute the instruction with `ow_jit_rt_exec()`.
+static void gen_call_rt(struct jit_compiler *c, size_t offset) {
+    gen_call_rt_exec(c, offset);
+    emit_u8(&c->as, 0x85), emit_u8(&c->as, 0xc0); // test eax, eax
+    patch_rel32(&c->as, emit_jcc(&c->as, CC_NE), c->exit_pos);
+}
+
+/// Execute the jump instruction with `ow_jit_rt_exec()`, going to `target` if taken.
+static void gen_call_rt_jmp(struct jit_compiler *c, size_t offset, size_t target) {
+    gen_call_rt_exec(c, offset);
+    emit_u8(&c->as, 0x83), emit_u8(&c->as, 0xf8), emit_u8(&c->as, 2); // cmp eax, 2
+    const size_t jump = emit_jcc(&c->as, CC_E);
+    c->fixups[c->fixup_count++] = (struct jit_fixup){jump, target};
+    emit_u8(&c->as, 0x85), emit_u8(&c->as, 0xc0); // test eax, eax
+    patch_rel32(&c->as, emit_jcc(&c->as, CC_NE), c->exit_pos);
+}
+
+/// Push `rax`.
+static void gen_push_rax(struct jit_compiler *c) {
+    emit_store(&c->as, REG_SP, 8, RAX);
+    emit_add_imm(&c->as, REG_SP, 8);
+}
+
+/// Load two operands into `rax` and `rcx`, and jump if they are not both small ints.
+/// Return position of the rel32 field of the jump.
+static size_t gen_load_smallint_pair(struct jit_compiler *c) {
+    emit_load(&c->as, RAX, REG_SP, -8);
+    emit_load(&c->as, RCX, REG_SP, 0);
+    emit_u8(&c->as, 0x89), emit_u8(&c->as, 0xc2); // mov edx, eax
+    emit_u8(&c->as, 0x21), emit_u8(&c->as, 0xca); // and edx, ecx
+    emit_u8(&c->as, 0xf7), emit_u8(&c->as, 0xc2), emit_u32(&c->as, 1); // test edx, 1
+    return emit_jcc(&c->as, CC_E);
+}
+
+/// Convert small float in `reg` (`rax` or `rcx`) to a double in `xmm<xmm>`,
+/// using `rdx` and `rsi`. Jump if it is zero. Return position of the rel32 field.
+static size_t gen_smallfloat_decode(struct jit_compiler *c, int reg, int xmm) {
+    emit_mov_imm64(&c->as, RSI, (uint64_t)_OW_SMALLFLOAT_ZERO);
+    emit_alu(&c->as, ALU_CMP, reg, RSI);
+    const size_t zero_jump = emit_jcc(&c->as, CC_E);
+    // bits = rotate_right((v & ~3) | (2 - (v >> 63)), 3)
+    emit_alu(&c->as, ALU_MOV, RDX, reg);
+    emit_u8(&c->as, 0x48), emit_u8(&c->as, 0xc1), emit_u8(&c->as, 0xea), emit_u8(&c->as, 63); // shr rdx, 63
+    emit_u8(&c->as, 0x48), emit_u8(&c->as, 0xf7), emit_u8(&c->as, 0xda); // neg rdx
+    emit_add_imm(&c->as, RDX, 2);
+    emit_rex_w(&c->as, 0, reg), emit_u8(&c->as, 0x83), emit_u8(&c->as, 0xe0 | (unsigned int)reg), emit_u8(&c->as, 0xfc); // and reg, -4
+    emit_alu(&c->as, ALU_OR, reg, RDX);
+    emit_rex_w(&c->as, 0, reg), emit_u8(&c->as, 0xc1), emit_u8(&c->as, 0xc8 | (unsigned int)reg), emit_u8(&c->as, 3); // ror reg, 3
+    // movq xmm, reg
+    emit_u8(&c->as, 0x66), emit_rex_w(&c->as, xmm, reg), emit_u8(&c->as, 0x0f), emit_u8(&c->as, 0x6e);
+    emit_u8(&c->as, (unsigned int)(0xc0 | (xmm & 7) << 3 | (reg & 7)));
+    return zero_jump;
+}
+
+/// Convert the double in `xmm0` to a small float in `rax`, using `rdx`. Jump if
+/// it cannot be a small float. Return position of the rel32 field.
+static size_t gen_smallfloat_encode(struct jit_compiler *c) {
+    emit_u8(&c->as, 0x66), emit_u8(&c->as, 0x48), emit_u8(&c->as, 0x0f), emit_u8(&c->as, 0x7e), emit_u8(&c->as, 0xc0); // movq rax, xmm0
+    // Bits 62..60 must be `011` or `100`, and it must not be the bit pattern for zero.
+    emit_alu(&c->as, ALU_MOV, RDX, RAX);
+    emit_u8(&c->as, 0x48), emit_u8(&c->as, 0xc1), emit_u8(&c->as, 0xea), emit_u8(&c->as, 60); // shr rdx, 60
+    emit_u8(&c->as, 0x83), emit_u8(&c->as, 0xe2), emit_u8(&c->as, 7); // and edx, 7
+    emit_u8(&c->as, 0x83), emit_u8(&c->as, 0xea), emit_u8(&c->as, 3); // sub edx, 3
+    emit_u8(&c->as, 0x83), emit_u8(&c->as, 0xfa), emit_u8(&c->as, 1); // cmp edx, 1
+    const size_t range_jump = emit_jcc(&c->as, CC_A);
+    emit_mov_imm64(&c->as, RDX, UINT64_C(0x3000000000000000));
+    emit_alu(&c->as, ALU_CMP, RAX, RDX);
+    const size_t zero_jump = emit_jcc(&c->as, CC_E);
+    // v = (rotate_left(bits, 3) & ~3) | 2
+    emit_u8(&c->as, 0x48), emit_u8(&c->as, 0xc1), emit_u8(&c->as, 0xc0), emit_u8(&c->as, 3); // rol rax, 3
+    emit_u8(&c->as, 0x48), emit_u8(&c->as, 0x83), emit_u8(&c->as, 0xe0), emit_u8(&c->as, 0xfc); // and rax, -4
+    emit_u8(&c->as, 0x48), emit_u8(&c->as, 0x83), emit_u8(&c->as, 0xc8), emit_u8(&c->as, 2); // or rax, 2
+    const size_t done_jump = emit_jmp(&c->as);
+    patch_rel32_here(&c->as, range_jump);
+    patch_rel32_here(&c->as, zero_jump);
+    const size_t fail_jump = emit_jmp(&c->as);
+    patch_rel32_here(&c->as, done_jump);
+    return fail_jump;
+}
+
+/// Binary operation with a small int fast path and a slow path using runtime function.
+static void gen_bin_op(struct jit_compiler *c, enum ow_opcode opcode, size_t offset) {
+    size_t slow_jumps[8];
+    size_t slow_jump_count = 0;
+    const size_t not_int_jump = gen_load_smallint_pair(c);
+    int res_reg = RDX;
+    emit_alu(&c->as, ALU_MOV, RDX, RAX);
+    switch (opcode) {
+    case OW_OPC_Add:
+        emit_add_imm(&c->as, RDX, -1);
+        emit_alu(&c->as, ALU_ADD, RDX, RCX);
+        slow_jumps[slow_jump_count++] = emit_jcc(&c->as, CC_O);
+        break;
+    case OW_OPC_Sub:
+        emit_alu(&c->as, ALU_SUB, RDX, RCX);
+        slow_jumps[slow_jump_count++] = emit_jcc(&c->as, CC_O);
+        emit_or_1(&c->as, RDX);
+        break;
+    case OW_OPC_Mul:
+        emit_sar_1(&c->as, RDX);
+        emit_alu(&c->as, ALU_MOV, RSI, RCX);
+        emit_add_imm(&c->as, RSI, -1);
+        emit_imul(&c->as, RDX, RSI);
+        slow_jumps[slow_jump_count++] = emit_jcc(&c->as, CC_O);
+        emit_or_1(&c->as, RDX);
+        break;
+    case OW_OPC_Div:
+    case OW_OPC_Rem:
+        // Division by 0 raises an exception; division by -1 may overflow.
+        emit_cmp_imm(&c->as, RCX, 1);
+        slow_jumps[slow_jump_count++] = emit_jcc(&c->as, CC_E);
+        emit_cmp_imm(&c->as, RCX, -1);
+        slow_jumps[slow_jump_count++] = emit_jcc(&c->as, CC_E);
+        emit_sar_1(&c->as, RAX);
+        emit_sar_1(&c->as, RCX);
+        emit_u8(&c->as, 0x48), emit_u8(&c->as, 0x99); // cqo
+        emit_u8(&c->as, 0x48), emit_u8(&c->as, 0xf7), emit_u8(&c->as, 0xf9); // idiv rcx
+        res_reg = opcode == OW_OPC_Div ? RAX : RDX;
+        emit_alu(&c->as, ALU_ADD, res_reg, res_reg);
+        emit_or_1(&c->as, res_reg);
+        break;
+    case OW_OPC_And:
+        emit_alu(&c->as, ALU_AND, RDX, RCX);
+        break;
+    case OW_OPC_Or:
+        emit_alu(&c->as, ALU_OR, RDX, RCX);
+        break;
+    case OW_OPC_Xor:
+        emit_alu(&c->as, ALU_XOR, RDX, RCX);
+        emit_or_1(&c->as, RDX);
+        break;
+    default:
+        ow_unreachable();
+    }
+    emit_add_imm(&c->as, REG_SP, -8);
+    emit_store(&c->as, REG_SP, 0, res_reg);
+    const size_t int_done_jump = emit_jmp(&c->as);
+    patch_rel32_here(&c->as, not_int_jump);
+
+    size_t flt_done_jump = (size_t)-1;
+    if (opcode == OW_OPC_Add || opcode == OW_OPC_Sub ||
+            opcode == OW_OPC_Mul || opcode == OW_OPC_Div) {
+        // Both small floats: bit 1 set in both and bit 0 clear in both.
+        emit_alu(&c->as, ALU_MOV, RDX, RAX);
+        emit_alu(&c->as, ALU_AND, RDX, RCX);
+        emit_u8(&c->as, 0xf7), emit_u8(&c->as, 0xc2), emit_u32(&c->as, 2); // test edx, 2
+        slow_jumps[slow_jump_count++] = emit_jcc(&c->as, CC_E);
+        emit_alu(&c->as, ALU_MOV, RDX, RAX);
+        emit_alu(&c->as, ALU_OR, RDX, RCX);
+        emit_u8(&c->as, 0xf7), emit_u8(&c->as, 0xc2), emit_u32(&c->as, 1); // test edx, 1
+        slow_jumps[slow_jump_count++] = emit_jcc(&c->as, CC_NE);
+        slow_jumps[slow_jump_count++] = gen_smallfloat_decode(c, RAX, 0);
+        slow_jumps[slow_jump_count++] = gen_smallfloat_decode(c, RCX, 1);
+        static const unsigned char sse_ops[] = {
+            [OW_OPC_Add] = 0x58, [OW_OPC_Sub] = 0x5c, [OW_OPC_Mul] = 0x59, [OW_OPC_Div] = 0x5e,
+        };
+        emit_u8(&c->as, 0xf2), emit_u8(&c->as, 0x0f), emit_u8(&c->as, sse_ops[opcode]), emit_u8(&c->as, 0xc1);
+        slow_jumps[slow_jump_count++] = gen_smallfloat_encode(c);
+        emit_add_imm(&c->as, REG_SP, -8);
+        emit_store(&c->as, REG_SP, 0, RAX);
+        flt_done_jump = emit_jmp(&c->as);
+    }
+
+    for (size_t i = 0; i < slow_jump_count; i++)
+        patch_rel32_here(&c->as, slow_jumps[i]);
+    gen_call_rt(c, offset);
+    patch_rel32_here(&c->as, int_done_jump);
+    if (flt_done_jump != (size_t)-1)
+        patch_rel32_here(&c->as, flt_done_jump);
+}
+
+/// Comparison with a small int fast path and a slow path using runtime function.
+static void gen_cmp_op(struct jit_compiler *c, enum jit_cond cc, size_t offset) {
+    const size_t slow_jump = gen_load_smallint_pair(c);
+    emit_alu(&c->as, ALU_CMP, RAX, RCX);
+    emit_load(&c->as, RAX, REG_GLOB, GLOB_OFFSET(value_false));
+    emit_cmov_mem(&c->as, cc, RAX, REG_GLOB, GLOB_OFFSET(value_true));
+    emit_add_imm(&c->as, REG_SP, -8);
+    emit_store(&c->as, REG_SP, 0, RAX);
+    const size_t done_jump = emit_jmp(&c->as);
+    patch_rel32_here(&c->as, slow_jump);
+    gen_call_rt(c, offset);
+    patch_rel32_here(&c->as, done_jump);
+}
+
+/// Conditional jump. Jump if the value is `jump_val`; exit if not a bool.
+static void gen_cond_jmp(
+    struct jit_compiler *c, bool jump_when_true, size_t offset, size_t target
+) {
+    const int32_t jump_val_off = jump_when_true ?
+        GLOB_OFFSET(value_true) : GLOB_OFFSET(value_false);
+    const int32_t other_val_off = jump_when_true ?
+        GLOB_OFFSET(value_false) : GLOB_OFFSET(value_true);
+    emit_load(&c->as, RAX, REG_SP, 0);
+    emit_add_imm(&c->as, REG_SP, -8);
+    emit_cmp_mem(&c->as, RAX, REG_GLOB, jump_val_off);
+    const size_t jump = emit_jcc(&c->as, CC_E);
+    c->fixups[c->fixup_count++] = (struct jit_fixup){jump, target};
+    emit_cmp_mem(&c->as, RAX, REG_GLOB, other_val_off);
+    const size_t next_jump = emit_jcc(&c->as, CC_E);
+    emit_add_imm(&c->as, REG_SP, 8);
+    gen_exit(c, offset);
+    patch_rel32_here(&c->as, next_jump);
+}
+
+/// Whether an instruction is compiled (with a template or a runtime function call).
+static bool opcode_compiled(enum ow_opcode opcode) {
+    switch (opcode) {
+    case OW_OPC_Nop:
+    case OW_OPC_Swap:
+    case OW_OPC_Drop:
+    case OW_OPC_DropN:
+    case OW_OPC_Dup:
+    case OW_OPC_LdNil:
+    case OW_OPC_LdBool:
+    case OW_OPC_LdInt:
+    case OW_OPC_LdIntW:
+    case OW_OPC_LdFlt:
+    case OW_OPC_Add:
+    case OW_OPC_Sub:
+    case OW_OPC_Mul:
+    case OW_OPC_Div:
+    case OW_OPC_Rem:
+    case OW_OPC_Shl:
+    case OW_OPC_Shr:
+    case OW_OPC_And:
+    case OW_OPC_Or:
+    case OW_OPC_Xor:
+    case OW_OPC_Neg:
+    case OW_OPC_Inv:
+    case OW_OPC_Is:
+    case OW_OPC_Cmp:
+    case OW_OPC_CmpLt:
+    case OW_OPC_CmpLe:
+    case OW_OPC_CmpGt:
+    case OW_OPC_CmpGe:
+    case OW_OPC_CmpEq:
+    case OW_OPC_CmpNe:
+    case OW_OPC_LdCnst:
+    case OW_OPC_LdCnstW:
+    case OW_OPC_LdSym:
+    case OW_OPC_LdSymW:
+    case OW_OPC_LdArg:
+    case OW_OPC_StArg:
+    case OW_OPC_LdLoc:
+    case OW_OPC_LdLocW:
+    case OW_OPC_StLoc:
+    case OW_OPC_StLocW:
+    case OW_OPC_LdGlob:
+    case OW_OPC_LdGlobW:
+    case OW_OPC_StGlob:
+    case OW_OPC_StGlobW:
+    case OW_OPC_LdGlobY:
+    case OW_OPC_LdGlobYW:
+    case OW_OPC_StGlobY:
+    case OW_OPC_StGlobYW:
+    case OW_OPC_Jmp:
+    case OW_OPC_JmpW:
+    case OW_OPC_JmpWhen:
+    case OW_OPC_JmpWhenW:
+    case OW_OPC_JmpUnls:
+    case OW_OPC_JmpUnlsW:
+    case OW_OPC_PrepIter:
+    case OW_OPC_ForIter:
+    case OW_OPC_ForIterW:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// Check whether `offset` is a valid jump target.
+static bool jump_target_valid(struct jit_compiler *c, ptrdiff_t target) {
+    return target >= 0 && (size_t)target < c->code_size &&
+        c->native_at[target] != (size_t)-2 /* not an instruction */;
+}
+
+/// Compile an instruction at `offset`.
+static void gen_instruction(
+    struct jit_compiler *c, enum ow_opcode opcode, int operand,
+    size_t offset
+) {
+    const size_t local_count = c->func_spec->local_cnt;
+    const int arg_count = c->func_spec->arg_cnt;
+
+    switch (opcode) {
+    case OW_OPC_Nop:
+        break;
+
+    case OW_OPC_Swap:
+        emit_load(&c->as, RAX, REG_SP, 0);
+        emit_load(&c->as, RCX, REG_SP, -8);
+        emit_store(&c->as, REG_SP, 0, RCX);
+        emit_store(&c->as, REG_SP, -8, RAX);
+        break;
+
+    case OW_OPC_Drop:
+        emit_add_imm(&c->as, REG_SP, -8);
+        break;
+
+    case OW_OPC_DropN:
+        if (operand)
+            emit_add_imm(&c->as, REG_SP, -8 * operand);
+        break;
+
+    case OW_OPC_Dup:
+        emit_load(&c->as, RAX, REG_SP, 0);
+        gen_push_rax(c);
+        break;
+
+    case OW_OPC_LdNil:
+        emit_load(&c->as, RAX, REG_GLOB, GLOB_OFFSET(value_nil));
+        gen_push_rax(c);
+        break;
+
+    case OW_OPC_LdBool:
+        emit_load(&c->as, RAX, REG_GLOB,
+            operand ? GLOB_OFFSET(value_true) : GLOB_OFFSET(value_false));
+        gen_push_rax(c);
+        break;
+
+    case OW_OPC_LdInt:
+    case OW_OPC_LdIntW:
+        emit_mov_imm64(&c->as, RAX, (uint64_t)(((int64_t)operand << 1) | 1));
+        gen_push_rax(c);
+        break;
+
+    case OW_OPC_Add:
+    case OW_OPC_Sub:
+    case OW_OPC_Mul:
+    case OW_OPC_Div:
+    case OW_OPC_Rem:
+    case OW_OPC_And:
+    case OW_OPC_Or:
+    case OW_OPC_Xor:
+        gen_bin_op(c, opcode, offset);
+        break;
+
+    case OW_OPC_Is:
+        emit_load(&c->as, RAX, REG_SP, 0);
+        emit_add_imm(&c->as, REG_SP, -8);
+        emit_cmp_mem(&c->as, RAX, REG_SP, 0);
+        emit_load(&c->as, RAX, REG_GLOB, GLOB_OFFSET(value_false));
+        emit_cmov_mem(&c->as, CC_E, RAX, REG_GLOB, GLOB_OFFSET(value_true));
+        emit_store(&c->as, REG_SP, 0, RAX);
+        break;
+
+    case OW_OPC_CmpLt: gen_cmp_op(c, CC_L , offset); break;
+    case OW_OPC_CmpLe: gen_cmp_op(c, CC_LE, offset); break;
+    case OW_OPC_CmpGt: gen_cmp_op(c, CC_G , offset); break;
+    case OW_OPC_CmpGe: gen_cmp_op(c, CC_GE, offset); break;
+    case OW_OPC_CmpEq: gen_cmp_op(c, CC_E , offset); break;
+    case OW_OPC_CmpNe: gen_cmp_op(c, CC_NE, offset); break;
+
+    case OW_OPC_LdFlt: {
+        struct ow_object *const obj = ow_smallfloat_try_to_ptr((double)operand);
+        if (!obj) {
+            gen_call_rt(c, offset);
+            break;
+        }
+        emit_mov_imm64(&c->as, RAX, (uint64_t)(uintptr_t)obj);
+        gen_push_rax(c);
+        break;
+    }
+
+    case OW_OPC_LdCnst:
+    case OW_OPC_LdCnstW: {
+        // A small int or a small float can be embedded.
+        struct ow_object *const obj = ow_func_obj_get_constant(c->func, (size_t)operand);
+        if (!obj || !ow_smallval_check(obj)) {
+            gen_call_rt(c, offset);
+            break;
+        }
+        emit_mov_imm64(&c->as, RAX, (uint64_t)(uintptr_t)obj);
+        gen_push_rax(c);
+        break;
+    }
+
+    case OW_OPC_LdArg:
+    case OW_OPC_StArg:
+        if (arg_count < 0 || operand >= arg_count) {
+            gen_exit(c, offset);
+            break;
+        }
+        if (opcode == OW_OPC_LdArg) {
+            emit_load(&c->as, RAX, REG_ARGS, 8 * operand);
+            gen_push_rax(c);
+        } else {
+            emit_load(&c->as, RAX, REG_SP, 0);
+            emit_add_imm(&c->as, REG_SP, -8);
+            emit_store(&c->as, REG_ARGS, 8 * operand, RAX);
+        }
+        break;
+
+    case OW_OPC_LdLoc:
+    case OW_OPC_LdLocW:
+        if ((size_t)operand >= local_count) {
+            gen_exit(c, offset);
+            break;
+        }
+        emit_load(&c->as, RAX, REG_FP, 8 * operand);
+        gen_push_rax(c);
+        break;
+
+    case OW_OPC_StLoc:
+    case OW_OPC_StLocW:
+        if ((size_t)operand >= local_count) {
+            gen_exit(c, offset);
+            break;
+        }
+        emit_load(&c->as, RAX, REG_SP, 0);
+        emit_add_imm(&c->as, REG_SP, -8);
+        emit_store(&c->as, REG_FP, 8 * operand, RAX);
+        break;
+
+    case OW_OPC_Jmp:
+    case OW_OPC_JmpW:
+    case OW_OPC_JmpWhen:
+    case OW_OPC_JmpWhenW:
+    case OW_OPC_JmpUnls:
+    case OW_OPC_JmpUnlsW: {
+        const ptrdiff_t target = (ptrdiff_t)offset + operand;
+        if (!jump_target_valid(c, target)) {
+            gen_exit(c, offset);
+            break;
+        }
+        if (opcode == OW_OPC_Jmp || opcode == OW_OPC_JmpW) {
+            const size_t jump = emit_jmp(&c->as);
+            c->fixups[c->fixup_count++] = (struct jit_fixup){jump, (size_t)target};
+        } else {
+            const bool when = opcode == OW_OPC_JmpWhen || opcode == OW_OPC_JmpWhenW;
+            gen_cond_jmp(c, when, offset, (size_t)target);
+        }
+        break;
+    }
+
+    case OW_OPC_ForIter:
+    case OW_OPC_ForIterW: {
+        const ptrdiff_t target = (ptrdiff_t)offset + operand;
+        if (!jump_target_valid(c, target)) {
+            gen_exit(c, offset);
+            break;
+        }
+        gen_call_rt_jmp(c, offset, (size_t)target);
+        break;
+    }
+
+    default:
+        if (opcode_compiled(opcode))
+            gen_call_rt(c, offset);
+        else
+            gen_exit(c, offset);
+        break;
+    }
+
+}
+
+/* ----- Compiler ----------------------------------------------------------- */
+
+/// Prologue: `int (*)(struct ow_jit_context *ctx, const void *entry)`. And the common exit.
+static void gen_prologue_and_exit(struct jit_compiler *c) {
+    emit_u8(&c->as, 0x53); // push rbx
+    emit_u8(&c->as, 0x41), emit_u8(&c->as, 0x54); // push r12
+    emit_u8(&c->as, 0x41), emit_u8(&c->as, 0x55); // push r13
+    emit_u8(&c->as, 0x41), emit_u8(&c->as, 0x56); // push r14
+    emit_u8(&c->as, 0x41), emit_u8(&c->as, 0x57); // push r15
+    emit_alu(&c->as, ALU_MOV, REG_CTX, RDI);
+    emit_load(&c->as, REG_SP, REG_CTX, CTX_OFFSET(sp));
+    emit_load(&c->as, REG_FP, REG_CTX, CTX_OFFSET(fp));
+    emit_load(&c->as, REG_ARGS, REG_CTX, CTX_OFFSET(arg_list));
+    emit_load(&c->as, REG_GLOB, REG_CTX, CTX_OFFSET(globals));
+    emit_u8(&c->as, 0xff), emit_u8(&c->as, 0xe6); // jmp rsi
+
+    c->exit_pos = c->as.buf_size;
+    emit_store(&c->as, REG_CTX, CTX_OFFSET(sp), REG_SP);
+    emit_u8(&c->as, 0x41), emit_u8(&c->as, 0x5f); // pop r15
+    emit_u8(&c->as, 0x41), emit_u8(&c->as, 0x5e); // pop r14
+    emit_u8(&c->as, 0x41), emit_u8(&c->as, 0x5d); // pop r13
+    emit_u8(&c->as, 0x41), emit_u8(&c->as, 0x5c); // pop r12
+    emit_u8(&c->as, 0x5b); // pop rbx
+    emit_u8(&c->as, 0xc3); // ret
+}
+
+struct ow_jit_code *ow_jit_compile(struct ow_func_obj *func) {
+    struct jit_compiler c = {
+        .as = {NULL, 0, 0},
+        .func = func,
+        .code = func->code,
+        .code_size = func->code_size,
+        .func_spec = &func->func_spec,
+    };
+    c.native_at = ow_malloc((c.code_size + 1) * sizeof(size_t));
+    for (size_t i = 0; i <= c.code_size; i++)
+        c.native_at[i] = (size_t)-2;
+    size_t instruction_count = 0;
+
+    // Find instructions.
+    for (size_t off = 0; off < c.code_size; ) {
+        const enum ow_opcode opcode = (enum ow_opcode)c.code[off];
+        if (!ow_opcode_name(opcode))
+            break;
+        const size_t next = off + 1 + ow_operand_type_width(ow_operand_type(opcode));
+        if (next > c.code_size)
+            break;
+        c.native_at[off] = (size_t)-1;
+        instruction_count++;
+        off = next;
+    }
+    c.fixups = ow_malloc((instruction_count + 1) * sizeof(struct jit_fixup)); // At most one for each.
+    c.fixup_count = 0;
+
+    // Generate code.
+    gen_prologue_and_exit(&c);
+    size_t off = 0;
+    while (off < c.code_size && c.native_at[off] == (size_t)-1) {
+        const enum ow_opcode opcode = ow_opcode_generic((enum ow_opcode)c.code[off]);
+        const enum ow_operand_type operand_type = ow_operand_type(opcode);
+        const int operand = ow_operand_read(c.code + off + 1, operand_type);
+        const size_t next = off + 1 + ow_operand_type_width(operand_type);
+        c.native_at[off] = c.as.buf_size;
+        gen_instruction(&c, opcode, operand, off);
+        off = next;
+    }
+    c.native_at[off] = c.as.buf_size;
+    gen_exit(&c, off);
+    for (size_t i = 0; i < c.fixup_count; i++) {
+        const struct jit_fixup *const f = &c.fixups[i];
+        patch_rel32(&c.as, f->pos, c.native_at[f->target]);
+    }
+
+    // Choose entries: instructions followed by enough compiled instructions.
+    struct ow_jit_code *const code = ow_malloc(
+        sizeof(struct ow_jit_code) + (c.code_size + 1) * sizeof(uint32_t));
+    code->entry_count = c.code_size + 1;
+    memset(code->entries, 0, code->entry_count * sizeof(uint32_t));
+    size_t run = 0;
+    for (size_t i = c.code_size; i-- > 0; ) {
+        if (c.native_at[i] == (size_t)-2)
+            continue;
+        const enum ow_opcode opcode = ow_opcode_generic((enum ow_opcode)c.code[i]);
+        if (!opcode_compiled(opcode)) {
+            run = 0;
+            continue;
+        }
+        if (opcode == OW_OPC_Jmp || opcode == OW_OPC_JmpW) {
+            const int operand = ow_operand_read(c.code + i + 1, ow_operand_type(opcode));
+            run = operand < 0 ? JIT_ENTRY_MIN_RUN : 1; // A loop stays in native code.
+        } else {
+            run++;
+        }
+        if (run >= JIT_ENTRY_MIN_RUN)
+            code->entries[i] = (uint32_t)c.native_at[i] + 1;
+    }
+
+    // Copy to executable memory.
+    code->memory = jit_asm_install(&c.as, &code->memory_size);
+    if (ow_unlikely(!code->memory)) {
+        ow_free(code);
+        ow_free(c.as.buf), ow_free(c.native_at), ow_free(c.fixups);
+        return NULL;
+    }
+
+    ow_debuglog_print(
+        "jit", DBG, "compiled function %p: %zu bytes of bytecode => %zu bytes of native code",
+        (void *)func, c.code_size, c.as.buf_size);
+
+    ow_free(c.as.buf), ow_free(c.native_at), ow_free(c.fixups);
+    return code;
+}
+
+void ow_jit_code_del(struct ow_jit_code *code) {
+    munmap(code->memory, code->memory_size);
+    ow_free(code);
+}
+
+int ow_jit_code_run(
+    const struct ow_jit_code *code, struct ow_jit_context *ctx, const void *entry
+) {
+    int (*fn)(struct ow_jit_context *, const void *);
+    static_assert(sizeof fn == sizeof code->memory, "");
+    memcpy(&fn, &code->memory, sizeof fn);
+    return fn(ctx, entry);
+}
+
+#endif // OW_JIT_AVAILABLE
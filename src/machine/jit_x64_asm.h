@@ -0,0 +1,278 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sys/mman.h>
+
+#include <utilities/attributes.h>
+#include <utilities/memalloc.h>
+
+/*
+ * x86-64 machine code encoding, shared by the JIT compilers.
+ */
+
+enum jit_reg {
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R12 = 12, R13 = 13, R14 = 14, R15 = 15,
+};
+
+enum jit_cond {
+    CC_O = 0x0, CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7,
+    CC_P = 0xa, CC_NP = 0xb,
+    CC_L = 0xc, CC_GE = 0xd, CC_LE = 0xe, CC_G = 0xf,
+};
+
+enum jit_alu_op {
+    ALU_ADD = 0x01, ALU_OR  = 0x09, ALU_AND = 0x21, ALU_SUB = 0x29,
+    ALU_XOR = 0x31, ALU_CMP = 0x39, ALU_MOV = 0x89,
+};
+
+/// Code buffer.
+struct jit_asm {
+    unsigned char *buf;
+    size_t buf_size;
+    size_t buf_capacity;
+};
+
+ow_static_inline void emit_bytes(struct jit_asm *a, const void *data, size_t size) {
+    if (ow_unlikely(a->buf_size + size > a->buf_capacity)) {
+        a->buf_capacity = a->buf_capacity ? a->buf_capacity * 2 : 256;
+        if (a->buf_capacity < a->buf_size + size)
+            a->buf_capacity = a->buf_size + size;
+        a->buf = ow_realloc(a->buf, a->buf_capacity);
+    }
+    memcpy(a->buf + a->buf_size, data, size);
+    a->buf_size += size;
+}
+
+ow_static_inline void emit_u8(struct jit_asm *a, unsigned int x) {
+    const unsigned char b = (unsigned char)x;
+    emit_bytes(a, &b, 1);
+}
+
+ow_static_inline void emit_u32(struct jit_asm *a, uint32_t x) {
+    emit_bytes(a, &x, 4);
+}
+
+ow_static_inline void emit_u64(struct jit_asm *a, uint64_t x) {
+    emit_bytes(a, &x, 8);
+}
+
+ow_static_inline void emit_rex_w(struct jit_asm *a, int reg, int base) {
+    emit_u8(a, 0x48 | ((reg >> 3) & 1) << 2 | ((base >> 3) & 1));
+}
+
+/// ModRM (and SIB, displacement) for operand `[base + disp]`.
+ow_static_inline void emit_modrm_mem(struct jit_asm *a, int reg, int base, int32_t disp) {
+    int mod;
+    if (disp == 0 && (base & 7) != RBP)
+        mod = 0;
+    else if (disp >= INT8_MIN && disp <= INT8_MAX)
+        mod = 1;
+    else
+        mod = 2;
+    emit_u8(a, (unsigned int)(mod << 6 | (reg & 7) << 3 | (base & 7)));
+    if ((base & 7) == RSP)
+        emit_u8(a, 0x24);
+    if (mod == 1)
+        emit_u8(a, (unsigned int)(uint8_t)(int8_t)disp);
+    else if (mod == 2)
+        emit_u32(a, (uint32_t)disp);
+}
+
+/// `mov reg, [base + disp]`
+ow_static_inline void emit_load(struct jit_asm *a, int reg, int base, int32_t disp) {
+    emit_rex_w(a, reg, base);
+    emit_u8(a, 0x8b);
+    emit_modrm_mem(a, reg, base, disp);
+}
+
+/// `mov [base + disp], reg`
+ow_static_inline void emit_store(struct jit_asm *a, int base, int32_t disp, int reg) {
+    emit_rex_w(a, reg, base);
+    emit_u8(a, 0x89);
+    emit_modrm_mem(a, reg, base, disp);
+}
+
+/// `OP reg, [base + disp]` (64-bit)
+ow_static_inline void emit_alu_mem(
+    struct jit_asm *a, enum jit_alu_op op, int reg, int base, int32_t disp
+) {
+    emit_rex_w(a, reg, base);
+    emit_u8(a, (unsigned int)op | 2); // Direction bit: load from memory.
+    emit_modrm_mem(a, reg, base, disp);
+}
+
+/// `cmp reg, [base + disp]`
+ow_static_inline void emit_cmp_mem(struct jit_asm *a, int reg, int base, int32_t disp) {
+    emit_rex_w(a, reg, base);
+    emit_u8(a, 0x3b);
+    emit_modrm_mem(a, reg, base, disp);
+}
+
+/// `cmovCC reg, [base + disp]`
+ow_static_inline void emit_cmov_mem(
+    struct jit_asm *a, enum jit_cond cc, int reg, int base, int32_t disp
+) {
+    emit_rex_w(a, reg, base);
+    emit_u8(a, 0x0f);
+    emit_u8(a, 0x40 | (unsigned int)cc);
+    emit_modrm_mem(a, reg, base, disp);
+}
+
+/// `mov qword [base + disp], imm32` (sign-extended)
+ow_static_inline void emit_store_imm(struct jit_asm *a, int base, int32_t disp, int32_t imm) {
+    emit_rex_w(a, 0, base);
+    emit_u8(a, 0xc7);
+    emit_modrm_mem(a, 0, base, disp);
+    emit_u32(a, (uint32_t)imm);
+}
+
+/// `OP dst, src` (64-bit)
+ow_static_inline void emit_alu(struct jit_asm *a, enum jit_alu_op op, int dst, int src) {
+    emit_rex_w(a, src, dst);
+    emit_u8(a, (unsigned int)op);
+    emit_u8(a, (unsigned int)(0xc0 | (src & 7) << 3 | (dst & 7)));
+}
+
+/// `add dst, imm` or `sub dst, -imm` (64-bit)
+ow_static_inline void emit_add_imm(struct jit_asm *a, int dst, int32_t imm) {
+    const unsigned int digit = imm >= 0 ? 0 : 5;
+    const int32_t abs_imm = imm >= 0 ? imm : -imm;
+    emit_rex_w(a, 0, dst);
+    if (abs_imm <= INT8_MAX) {
+        emit_u8(a, 0x83);
+        emit_u8(a, 0xc0 | digit << 3 | (unsigned int)(dst & 7));
+        emit_u8(a, (unsigned int)abs_imm);
+    } else {
+        emit_u8(a, 0x81);
+        emit_u8(a, 0xc0 | digit << 3 | (unsigned int)(dst & 7));
+        emit_u32(a, (uint32_t)abs_imm);
+    }
+}
+
+/// `cmp reg, imm8` (64-bit, sign-extended)
+ow_static_inline void emit_cmp_imm(struct jit_asm *a, int reg, int8_t imm) {
+    emit_rex_w(a, 0, reg);
+    emit_u8(a, 0x83);
+    emit_u8(a, 0xf8 | (unsigned int)(reg & 7));
+    emit_u8(a, (unsigned int)(uint8_t)imm);
+}
+
+/// `or dst, 1` (64-bit)
+ow_static_inline void emit_or_1(struct jit_asm *a, int dst) {
+    emit_rex_w(a, 0, dst);
+    emit_u8(a, 0x83);
+    emit_u8(a, 0xc8 | (unsigned int)(dst & 7));
+    emit_u8(a, 1);
+}
+
+/// `sar dst, 1` (64-bit)
+ow_static_inline void emit_sar_1(struct jit_asm *a, int dst) {
+    emit_rex_w(a, 0, dst);
+    emit_u8(a, 0xd1);
+    emit_u8(a, 0xf8 | (unsigned int)(dst & 7));
+}
+
+/// `imul dst, src` (64-bit)
+ow_static_inline void emit_imul(struct jit_asm *a, int dst, int src) {
+    emit_rex_w(a, dst, src);
+    emit_u8(a, 0x0f);
+    emit_u8(a, 0xaf);
+    emit_u8(a, (unsigned int)(0xc0 | (dst & 7) << 3 | (src & 7)));
+}
+
+/// `mov reg, imm64`
+ow_static_inline void emit_mov_imm64(struct jit_asm *a, int reg, uint64_t imm) {
+    emit_rex_w(a, 0, reg);
+    emit_u8(a, 0xb8 | (unsigned int)(reg & 7));
+    emit_u64(a, imm);
+}
+
+/// `jmp rel32`. Return position of the rel32 field.
+ow_static_inline size_t emit_jmp(struct jit_asm *a) {
+    emit_u8(a, 0xe9);
+    emit_u32(a, 0);
+    return a->buf_size - 4;
+}
+
+/// `jCC rel32`. Return position of the rel32 field.
+ow_static_inline size_t emit_jcc(struct jit_asm *a, enum jit_cond cc) {
+    emit_u8(a, 0x0f);
+    emit_u8(a, 0x80 | (unsigned int)cc);
+    emit_u32(a, 0);
+    return a->buf_size - 4;
+}
+
+/// Set the rel32 field at `pos` to jump to native offset `to`.
+ow_static_inline void patch_rel32(struct jit_asm *a, size_t pos, size_t to) {
+    const int32_t rel = (int32_t)((ptrdiff_t)to - (ptrdiff_t)(pos + 4));
+    memcpy(a->buf + pos, &rel, 4);
+}
+
+/// Set the rel32 field at `pos` to jump to current position.
+ow_static_inline void patch_rel32_here(struct jit_asm *a, size_t pos) {
+    patch_rel32(a, pos, a->buf_size);
+}
+
+/// SSE instruction with operand `[base + disp]`: `PREFIX [REX] 0F OPCODE /reg`.
+ow_static_inline void emit_sse_mem(
+    struct jit_asm *a, unsigned int prefix, bool rex_w, unsigned int opcode,
+    int reg, int base, int32_t disp
+) {
+    emit_u8(a, prefix);
+    const unsigned int rex =
+        0x40 | (unsigned int)rex_w << 3 | (unsigned int)((reg >> 3) & 1) << 2 |
+        (unsigned int)((base >> 3) & 1);
+    if (rex != 0x40)
+        emit_u8(a, rex);
+    emit_u8(a, 0x0f);
+    emit_u8(a, opcode);
+    emit_modrm_mem(a, reg, base, disp);
+}
+
+/// SSE instruction with register operands: `PREFIX [REX] 0F OPCODE /reg`.
+ow_static_inline void emit_sse_reg(
+    struct jit_asm *a, unsigned int prefix, bool rex_w, unsigned int opcode,
+    int reg, int rm
+) {
+    emit_u8(a, prefix);
+    const unsigned int rex =
+        0x40 | (unsigned int)rex_w << 3 | (unsigned int)((reg >> 3) & 1) << 2 |
+        (unsigned int)((rm >> 3) & 1);
+    if (rex != 0x40)
+        emit_u8(a, rex);
+    emit_u8(a, 0x0f);
+    emit_u8(a, opcode);
+    emit_u8(a, (unsigned int)(0xc0 | (reg & 7) << 3 | (rm & 7)));
+}
+
+/// `setCC reg8; movzx reg, reg8` (`reg` must be one of `rax`, `rcx`, `rdx` and `rbx`)
+ow_static_inline void emit_setcc(struct jit_asm *a, enum jit_cond cc, int reg) {
+    emit_u8(a, 0x0f);
+    emit_u8(a, 0x90 | (unsigned int)cc);
+    emit_u8(a, 0xc0 | (unsigned int)(reg & 7));
+    emit_u8(a, 0x0f);
+    emit_u8(a, 0xb6);
+    emit_u8(a, (unsigned int)(0xc0 | (reg & 7) << 3 | (reg & 7)));
+}
+
+/// Copy code to newly mapped executable memory. Return NULL on failure.
+ow_static_inline void *jit_asm_install(const struct jit_asm *a, size_t *memory_size) {
+    const size_t page_size = ow_mem_get_pagesize();
+    const size_t size = (a->buf_size + page_size - 1) / page_size * page_size;
+    void *const memory = mmap(
+        NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ow_unlikely(memory == MAP_FAILED))
+        return NULL;
+    memcpy(memory, a->buf, a->buf_size);
+    if (ow_unlikely(mprotect(memory, size, PROT_READ | PROT_EXEC))) {
+        munmap(memory, size);
+        return NULL;
+    }
+    *memory_size = size;
+    return memory;
+}
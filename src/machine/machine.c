@@ -53,6 +53,10 @@ struct ow_machine *ow_machine_new(void) {
 void ow_machine_del(struct ow_machine *om) {
     assert(!ow_objmem_test_ngc(om));
 
+#if OW_DEBUG_OPSTAT
+    ow_machine_opstat_dump();
+#endif // OW_DEBUG_OPSTAT
+
     ow_callstack_fini(om, &om->callstack);
     ow_machine_globals_del(om, om->globals);
     ow_common_symbols_del(om, om->common_symbols);
@@ -79,21 +83,12 @@ bool ow_machine_longjmp(struct ow_machine *om, struct ow_machine_jmpbuf *jb) {
     )) {
         return false;
     }
-    for (struct ow_callstack_frame_info *fi =
-            om->callstack.frame_info_list.current; ; fi = fi->_next
-    ) {
-        if (!fi)
-            return false;
-        if (fi == jb->fi)
-            break;
-    }
+    if (!ow_callstack_frame_info_list_contains(&om->callstack.frame_info_list, jb->fi))
+        return false;
 
     om->callstack.regs.sp = jb->sp;
     om->callstack.regs.fp = jb->fp;
-    while (om->callstack.frame_info_list.current != jb->fi) {
-        assert(om->callstack.frame_info_list.current);
-        ow_callstack_frame_info_list_leave(&om->callstack.frame_info_list);
-    }
+    om->callstack.frame_info_list.current = jb->fi;
 
     return true;
 }
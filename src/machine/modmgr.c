@@ -1,5 +1,6 @@
 #include "modmgr.h"
 
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -125,7 +126,7 @@ bool ow_module_manager_add_path(
         struct ow_array *const paths = ow_array_obj_data(mm->path_array);
         for (size_t i = 0, n = ow_array_size(paths); i < n; i++) {
             struct ow_object *const path_o = ow_array_at(paths, i);
-            if (ow_smallint_check(path_o) ||
+            if (ow_smallval_check(path_o) ||
                     ow_object_class(path_o) != mm->machine->builtin_classes->string)
                 continue;
             const char *const str = ow_string_obj_flatten(
@@ -150,7 +151,7 @@ bool ow_module_manager_add_path(
     return ok;
 }
 
-#define ELEM(NAME) extern OW_BIMOD_MODULE_DEF(NAME) ;
+#define ELEM(NAME) extern const struct ow_native_module_def OW_BIMOD_MODULE_DEF_NAME(NAME) ;
 OW_EMBEDDED_MODULE_LIST
 #undef ELEM
 
@@ -183,7 +184,7 @@ struct ow_module_manager_locator ow_module_manager_search(
     struct ow_array *const paths = ow_array_obj_data(mm->path_array);
     for (size_t i = 0, n = ow_array_size(paths); i < n; i++) {
         struct ow_object *const path_o = ow_array_at(paths, i);
-        if (ow_smallint_check(path_o) ||
+        if (ow_smallval_check(path_o) ||
                 ow_object_class(path_o) != mm->machine->builtin_classes->string)
             continue;
         const char *const str = ow_string_obj_flatten(
@@ -242,6 +243,11 @@ static bool _load_module_from_dynlib(
     const size_t sym_prefix_len  = sizeof(OW_BIMOD_MODULE_DEF_NAME_PREFIX_STR) - 1;
     const char *const sym_suffix = OW_BIMOD_MODULE_DEF_NAME_SUFFIX_STR;
     const size_t sym_suffix_len  = sizeof(OW_BIMOD_MODULE_DEF_NAME_SUFFIX_STR) - 1;
+    const char *const abi_suffix = OW_BIMOD_MODULE_ABI_NAME_SUFFIX_STR;
+    static_assert(
+        sizeof(OW_BIMOD_MODULE_ABI_NAME_SUFFIX_STR) ==
+            sizeof(OW_BIMOD_MODULE_DEF_NAME_SUFFIX_STR),
+        "the suffixes must be of the same length");
     const size_t name_len        = strlen(name);
     if (sym_prefix_len + name_len + sym_suffix_len >= sizeof sym_buf) {
         if (exc) {
@@ -255,7 +261,8 @@ static bool _load_module_from_dynlib(
     p += sym_prefix_len;
     memcpy(p, name, name_len);
     p += name_len;
-    memcpy(p, sym_suffix, sym_suffix_len);
+    char *const sym_suffix_p = p;
+    memcpy(p, abi_suffix, sym_suffix_len);
     p += sym_suffix_len;
     *p = '\0';
     assert(p < sym_buf + sizeof sym_buf);
@@ -269,7 +276,25 @@ static bool _load_module_from_dynlib(
         }
         return false;
     }
-    const struct ow_native_module_def *const def = ow_dynlib_symbol(lib, sym_buf);
+    // Reject modules built for another version or configuration of the runtime.
+    static const struct ow_native_module_abi runtime_abi = OW_BIMOD_MODULE_ABI_INIT;
+    const struct ow_native_module_abi *const abi = ow_dynlib_symbol(lib, sym_buf);
+    if (abi && (
+        memcmp(abi->build, runtime_abi.build, sizeof runtime_abi.build) ||
+        memcmp(abi->layout, runtime_abi.layout, sizeof runtime_abi.layout)
+    )) {
+        ow_dynlib_close(lib);
+        if (exc) {
+            *exc = ow_exception_format(
+                mm->machine, NULL,
+                "module file `%" OW_PATH_STR_PRI "' was built for a different runtime",
+                file_path);
+        }
+        return false;
+    }
+    memcpy(sym_suffix_p, sym_suffix, sym_suffix_len);
+    const struct ow_native_module_def *const def =
+        abi ? ow_dynlib_symbol(lib, sym_buf) : NULL;
     if (!def) {
         ow_dynlib_close(lib);
         if (exc) {
@@ -313,7 +338,8 @@ static bool _load_module_from_source(
 #endif
 
     const bool ok = ow_compiler_compile(
-        compiler, file_stream, file_name_ss, 0, mm->temp_module);
+        compiler, file_stream, file_name_ss,
+        OW_COMPILE_OPTIMIZE(ow_sysparam.opt_level), mm->temp_module);
     if (ow_unlikely(!ok)) {
         struct ow_syntax_error *const err = ow_compiler_error(compiler);
         if (exc) {
@@ -0,0 +1,1277 @@
+#include "regvm.h"
+
+#if OW_BUILD_REGISTER_VM
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "globals.h"
+#include "machine.h"
+#include <bytecode/opcode.h>
+#include <bytecode/operand.h>
+#include <objects/classes.h>
+#include <objects/funcobj.h>
+#include <objects/moduleobj.h>
+#include <objects/object.h>
+#include <objects/smallint.h>
+#include <objects/stringobj.h>
+#include <utilities/attributes.h>
+#include <utilities/debuglog.h>
+#include <utilities/memalloc.h>
+#include <utilities/unreachable.h>
+
+/*
+ * Register code is translated from the stack bytecode of a function. A register
+ * is a slot of the frame: local variable `i` is register `i`, and the value at
+ * depth `d` of the stack (counted from the first value above local variables)
+ * is register `local_count + d`. Loads of local variables, arguments and small
+ * constants are folded into the operands of the instructions that use them, so
+ * an expression like `a = b + c * 3` becomes two instructions instead of six.
+ *
+ * Whenever an instruction cannot go on (an operand is not a small int, or the
+ * bytecode instruction has no register form), register code stops at a resume
+ * point: a bytecode offset before which every stack value is in its register.
+ * Instructions between the resume point and the stop only write registers above
+ * the resume depth, so the interpreter can run them again from there. A store
+ * to a variable always starts with every stack value in its register, which
+ * moves the resume point past it.
+ */
+
+/// Register instructions that are not made of an operator.
+#define REGVM_OPCODE_LIST \
+    /*   NAME   , OPERANDS : SEMANTICS */ \
+    ELEM(Exit   ) /*         : stop at the resume point          */ \
+    ELEM(Move   ) /* A B     : R[A] = R[B]                       */ \
+    ELEM(LdNil  ) /* A       : R[A] = nil                        */ \
+    ELEM(LdBool ) /* A B     : R[A] = B != 0                     */ \
+    ELEM(LdInt  ) /* A sBx   : R[A] = sBx                        */ \
+    ELEM(LdCnst ) /* A Bx    : R[A] = constant Bx                */ \
+    ELEM(LdVal  ) /* A Bx    : R[A] = small value Bx of the code */ \
+    ELEM(LdArg  ) /* A B     : R[A] = argument B                 */ \
+    ELEM(StArg  ) /* A B     : argument A = R[B]                 */ \
+    ELEM(LdGlob ) /* A Bx    : R[A] = global Bx or nil           */ \
+    ELEM(LdGlobY) /* A Bx    : R[A] = global bound to bytecode instruction ending at Bx */ \
+    ELEM(Jmp    ) /* ; J     : goto J                            */ \
+    ELEM(JmpWhen) /* A ; J   : if R[A] is true, goto J           */ \
+    ELEM(JmpUnls) /* A ; J   : if R[A] is false, goto J          */ \
+// ^^^ REGVM_OPCODE_LIST ^^^
+
+/// Operators on small ints and small floats. Each has forms `NAME` (A B C:
+/// R[A] = R[B] op R[C]) and `NAME##I` (A B sC: R[A] = R[B] op sC).
+#define REGVM_NUM_OP_LIST \
+    /*   NAME, OPERATOR, RHS_OK */ \
+    ELEM(Add , +       , 1      ) \
+    ELEM(Sub , -       , 1      ) \
+    ELEM(Mul , *       , 1      ) \
+    ELEM(Div , /       , rv != 0) \
+// ^^^ REGVM_NUM_OP_LIST ^^^
+
+/// Operators on small ints, in the same forms as `REGVM_NUM_OP_LIST`.
+#define REGVM_INT_OP_LIST \
+    /*   NAME, OPERATOR, RHS_OK */ \
+    ELEM(Rem , %       , rv != 0) \
+    ELEM(Shl , <<      , (uint64_t)rv < 64) \
+    ELEM(Shr , >>      , (uint64_t)rv < 64) \
+    ELEM(And , &       , 1      ) \
+    ELEM(Or  , |       , 1      ) \
+    ELEM(Xor , ^       , 1      ) \
+// ^^^ REGVM_INT_OP_LIST ^^^
+
+/// Comparisons. Each has forms `Cmp##NAME` (A B C: R[A] = R[B] op R[C]),
+/// `Cmp##NAME##I` (A B sC), `Cmp##NAME##Jmp` (A B ; J: unless R[A] op R[B], goto J),
+/// and `Cmp##NAME##JmpI` (A sB ; J).
+#define REGVM_CMP_LIST \
+    /*   NAME, OPERATOR */ \
+    ELEM(Lt  , <       ) \
+    ELEM(Le  , <=      ) \
+    ELEM(Gt  , >       ) \
+    ELEM(Ge  , >=      ) \
+    ELEM(Eq  , ==      ) \
+    ELEM(Ne  , !=      ) \
+// ^^^ REGVM_CMP_LIST ^^^
+
+/// Register opcodes.
+enum regvm_opcode {
+#define ELEM(NAME) REGVM_##NAME ,
+    REGVM_OPCODE_LIST
+#undef ELEM
+#define ELEM(NAME, OPERATOR, RHS_OK) REGVM_##NAME , REGVM_##NAME##I ,
+    REGVM_NUM_OP_LIST
+    REGVM_INT_OP_LIST
+#undef ELEM
+#define ELEM(NAME, OPERATOR) \
+    REGVM_Cmp##NAME , REGVM_Cmp##NAME##I , REGVM_Cmp##NAME##Jmp , REGVM_Cmp##NAME##JmpI ,
+    REGVM_CMP_LIST
+#undef ELEM
+    _REGVM_OPC_COUNT
+};
+
+static_assert((size_t)_REGVM_OPC_COUNT <= 256, "too many register opcodes");
+
+/*
+ * An instruction is a 32-bit word: opcode in bits 0..7, A in bits 8..15, and
+ * B and C in bits 16..23 and 24..31, or Bx in bits 16..31. An instruction
+ * marked with "; J" is followed by a second word, the word index to jump to.
+ */
+
+#define REGVM_INSN(OPCODE, A, B, C) \
+    ((uint32_t)(OPCODE) | (uint32_t)(A) << 8 | \
+        (uint32_t)(uint8_t)(B) << 16 | (uint32_t)(uint8_t)(C) << 24)
+#define REGVM_INSN_BX(OPCODE, A, BX) \
+    ((uint32_t)(OPCODE) | (uint32_t)(A) << 8 | (uint32_t)(uint16_t)(BX) << 16)
+
+/// Max number of registers, i.e., local variables plus max stack depth.
+#define REGVM_MAX_REGS 256
+
+/// Min number of instructions run from an entry before stopping. Entering and
+/// leaving register code costs more than a few instructions save.
+#define REGVM_ENTRY_MIN_RUN 4
+
+/* ----- Translator --------------------------------------------------------- */
+
+/// Control flow of a bytecode instruction.
+enum regvm_flow {
+    FLOW_NEXT, // Go on to the next instruction.
+    FLOW_JUMP, // Jump to the target.
+    FLOW_BRANCH, // Next or target.
+    FLOW_FOR_ITER, // Next with one more value, or target with two values fewer.
+    FLOW_END, // Leave the function.
+    FLOW_UNKNOWN, // Stack effect unknown; nothing after it is translated.
+};
+
+/// Get control flow and stack depth change of a bytecode instruction (generic opcode).
+static enum regvm_flow regvm_insn_flow(enum ow_opcode opcode, int operand, int *delta) {
+    *delta = 0;
+    switch (opcode) {
+    case OW_OPC_Nop:
+    case OW_OPC_Swap:
+    case OW_OPC_SwapN:
+    case OW_OPC_Neg:
+    case OW_OPC_Inv:
+    case OW_OPC_Not:
+    case OW_OPC_LdAttrY:
+    case OW_OPC_LdAttrYW:
+        return FLOW_NEXT;
+
+    case OW_OPC_Dup:
+    case OW_OPC_LdNil:
+    case OW_OPC_LdBool:
+    case OW_OPC_LdInt:
+    case OW_OPC_LdIntW:
+    case OW_OPC_LdFlt:
+    case OW_OPC_LdCnst:
+    case OW_OPC_LdCnstW:
+    case OW_OPC_LdSym:
+    case OW_OPC_LdSymW:
+    case OW_OPC_LdArg:
+    case OW_OPC_LdLoc:
+    case OW_OPC_LdLocW:
+    case OW_OPC_LdGlob:
+    case OW_OPC_LdGlobW:
+    case OW_OPC_LdGlobY:
+    case OW_OPC_LdGlobYW:
+    case OW_OPC_LdMod:
+    case OW_OPC_PrepMethY:
+    case OW_OPC_PrepMethYW:
+    case OW_OPC_PrepIter:
+        *delta = 1;
+        return FLOW_NEXT;
+
+    case OW_OPC_Drop:
+    case OW_OPC_Add:
+    case OW_OPC_Sub:
+    case OW_OPC_Mul:
+    case OW_OPC_Div:
+    case OW_OPC_Rem:
+    case OW_OPC_Shl:
+    case OW_OPC_Shr:
+    case OW_OPC_And:
+    case OW_OPC_Or:
+    case OW_OPC_Xor:
+    case OW_OPC_Is:
+    case OW_OPC_Cmp:
+    case OW_OPC_CmpLt:
+    case OW_OPC_CmpLe:
+    case OW_OPC_CmpGt:
+    case OW_OPC_CmpGe:
+    case OW_OPC_CmpEq:
+    case OW_OPC_CmpNe:
+    case OW_OPC_StArg:
+    case OW_OPC_StLoc:
+    case OW_OPC_StLocW:
+    case OW_OPC_StGlob:
+    case OW_OPC_StGlobW:
+    case OW_OPC_StGlobY:
+    case OW_OPC_StGlobYW:
+    case OW_OPC_StAttrY:
+    case OW_OPC_StAttrYW:
+    case OW_OPC_LdElem:
+        *delta = -1;
+        return FLOW_NEXT;
+
+    case OW_OPC_DupN:
+        *delta = operand;
+        return FLOW_NEXT;
+
+    case OW_OPC_DropN:
+        *delta = -operand;
+        return FLOW_NEXT;
+
+    case OW_OPC_MkArr:
+    case OW_OPC_MkArrW:
+    case OW_OPC_MkTup:
+    case OW_OPC_MkTupW:
+    case OW_OPC_MkSet:
+    case OW_OPC_MkSetW:
+        *delta = 1 - operand;
+        return FLOW_NEXT;
+
+    case OW_OPC_MkMap:
+    case OW_OPC_MkMapW:
+        *delta = 1 - operand * 2;
+        return FLOW_NEXT;
+
+    case OW_OPC_Call:
+    case OW_OPC_TailCall:
+        *delta = -((operand & 0x7f) + 1) + !(operand & 0x80);
+        return FLOW_NEXT;
+
+    case OW_OPC_Jmp:
+    case OW_OPC_JmpW:
+        return FLOW_JUMP;
+
+    case OW_OPC_JmpWhen:
+    case OW_OPC_JmpWhenW:
+    case OW_OPC_JmpUnls:
+    case OW_OPC_JmpUnlsW:
+        *delta = -1;
+        return FLOW_BRANCH;
+
+    case OW_OPC_ForIter:
+    case OW_OPC_ForIterW:
+        *delta = 1;
+        return FLOW_FOR_ITER;
+
+    case OW_OPC_Ret:
+    case OW_OPC_RetNil:
+    case OW_OPC_RetLoc:
+        return FLOW_END;
+
+    default:
+        return FLOW_UNKNOWN;
+    }
+}
+
+/// Kinds of values on the stack while translating.
+enum regvm_val_kind {
+    VAL_SLOT, // In its own register.
+    VAL_REG, // The same as register `x`, which is not written before the value is used.
+    VAL_INT, // Small int `x`.
+    VAL_NIL,
+    VAL_BOOL, // `x != 0`
+    VAL_CNST, // Constant `x`, an object.
+    VAL_VAL, // Small value `x` of the code, which is a small int or a small float.
+    VAL_ARG, // Argument `x`.
+};
+
+struct regvm_val {
+    enum regvm_val_kind kind;
+    int x;
+};
+
+struct regvm_fixup {
+    size_t pos; // Word index of the jump target.
+    size_t target; // Bytecode offset.
+};
+
+struct regvm_compiler {
+    struct ow_func_obj *func;
+    const unsigned char *code;
+    size_t code_size;
+    size_t local_count;
+    int *depth; // { bytecode offset => stack depth before the instruction, or -1 if not reached }
+    bool *is_label; // { bytecode offset => whether it is a jump target }
+    size_t *reg_at; // { bytecode offset => word index where translation started afresh, or -1 }
+    uint32_t *buf;
+    struct ow_regvm_resume *resume;
+    size_t buf_size, buf_capacity;
+    struct regvm_fixup *fixups;
+    size_t fixup_count, fixup_capacity;
+    struct ow_object **values;
+    size_t value_count, value_capacity;
+    bool live; // Whether the previous instruction may go on to the current one.
+    struct ow_regvm_resume resume_at; // Resume point of instructions being emitted.
+    size_t last_def; // Word index of last instruction if it writes `last_def_reg`, or -1.
+    size_t last_def_reg;
+    size_t stack_size;
+    struct regvm_val stack[REGVM_MAX_REGS];
+};
+
+/// Find instructions and compute stack depth before each. Return false if the
+/// stack depth cannot be determined consistently or is too large.
+static bool regvm_analyze(struct regvm_compiler *c) {
+    const size_t n = c->code_size + 1;
+    for (size_t i = 0; i < n; i++) {
+        c->depth[i] = -2; // Not an instruction.
+        c->is_label[i] = false;
+    }
+    for (size_t off = 0; off < c->code_size; ) {
+        const enum ow_opcode opcode = (enum ow_opcode)c->code[off];
+        if (!ow_opcode_name(opcode))
+            break;
+        const size_t next = off + 1 + ow_operand_type_width(ow_operand_type(opcode));
+        if (next > c->code_size)
+            break;
+        c->depth[off] = -1;
+        off = next;
+    }
+    c->depth[c->code_size] = -1;
+
+    size_t *const work_list = ow_malloc(n * sizeof(size_t));
+    size_t work_count = 0;
+    bool ok = true;
+    c->depth[0] = 0;
+    work_list[work_count++] = 0;
+
+#define SUCC(OFFSET, DEPTH) \
+    do { \
+        const ptrdiff_t _off = (OFFSET); \
+        const int _depth = (DEPTH); \
+        if (_off < 0 || (size_t)_off > c->code_size || c->depth[_off] == -2 || \
+                _depth < 0 || c->local_count + (size_t)_depth > REGVM_MAX_REGS) { \
+            ok = false; \
+            goto end; \
+        } \
+        if (c->depth[_off] == -1) { \
+            c->depth[_off] = _depth; \
+            work_list[work_count++] = (size_t)_off; \
+        } else if (c->depth[_off] != _depth) { \
+            ok = false; \
+            goto end; \
+        } \
+    } while (0)
+
+    while (work_count) {
+        const size_t off = work_list[--work_count];
+        if (off == c->code_size)
+            continue;
+        const enum ow_opcode opcode = ow_opcode_generic((enum ow_opcode)c->code[off]);
+        const enum ow_operand_type operand_type = ow_operand_type(opcode);
+        const int operand = ow_operand_read(c->code + off + 1, operand_type);
+        const size_t next = off + 1 + ow_operand_type_width(operand_type);
+        const int depth = c->depth[off];
+        int delta;
+        switch (regvm_insn_flow(opcode, operand, &delta)) {
+        case FLOW_NEXT:
+            SUCC(next, depth + delta);
+            break;
+        case FLOW_JUMP:
+            SUCC((ptrdiff_t)off + operand, depth);
+            c->is_label[off + operand] = true;
+            break;
+        case FLOW_BRANCH:
+            SUCC(next, depth + delta);
+            SUCC((ptrdiff_t)off + operand, depth + delta);
+            c->is_label[off + operand] = true;
+            break;
+        case FLOW_FOR_ITER:
+            SUCC(next, depth + 1);
+            SUCC((ptrdiff_t)off + operand, depth - 2);
+            c->is_label[off + operand] = true;
+            break;
+        case FLOW_END:
+        case FLOW_UNKNOWN:
+            break;
+        }
+    }
+
+#undef SUCC
+
+end:
+    ow_free(work_list);
+    return ok;
+}
+
+/// Append a word.
+static size_t regvm_emit_word(struct regvm_compiler *c, uint32_t word) {
+    if (ow_unlikely(c->buf_size == c->buf_capacity)) {
+        c->buf_capacity = c->buf_capacity ? c->buf_capacity * 2 : 64;
+        c->buf = ow_realloc(c->buf, c->buf_capacity * sizeof c->buf[0]);
+        c->resume = ow_realloc(c->resume, c->buf_capacity * sizeof c->resume[0]);
+    }
+    const size_t pos = c->buf_size++;
+    c->buf[pos] = word;
+    c->resume[pos] = c->resume_at;
+    return pos;
+}
+
+/// Append an instruction.
+static size_t regvm_emit(struct regvm_compiler *c, uint32_t insn) {
+    c->last_def = (size_t)-1;
+    return regvm_emit_word(c, insn);
+}
+
+/// Append an instruction that writes register `reg`.
+static void regvm_emit_def(struct regvm_compiler *c, uint32_t insn, size_t reg) {
+    const size_t pos = regvm_emit(c, insn);
+    c->last_def = pos;
+    c->last_def_reg = reg;
+}
+
+/// Append a jump instruction and its target.
+static void regvm_emit_jump(struct regvm_compiler *c, uint32_t insn, size_t target) {
+    regvm_emit(c, insn);
+    if (ow_unlikely(c->fixup_count == c->fixup_capacity)) {
+        c->fixup_capacity = c->fixup_capacity ? c->fixup_capacity * 2 : 16;
+        c->fixups = ow_realloc(c->fixups, c->fixup_capacity * sizeof c->fixups[0]);
+    }
+    c->fixups[c->fixup_count++] = (struct regvm_fixup){regvm_emit_word(c, 0), target};
+}
+
+/// Add a small value to the code if it is not there. Return its index.
+static size_t regvm_add_value(struct regvm_compiler *c, struct ow_object *obj) {
+    for (size_t i = 0; i < c->value_count; i++) {
+        if (c->values[i] == obj)
+            return i;
+    }
+    if (ow_unlikely(c->value_count == c->value_capacity)) {
+        c->value_capacity = c->value_capacity ? c->value_capacity * 2 : 8;
+        c->values = ow_realloc(c->values, c->value_capacity * sizeof c->values[0]);
+    }
+    c->values[c->value_count] = obj;
+    return c->value_count++;
+}
+
+/// Get the register that holds the stack value at `pos`, or -1.
+static int regvm_val_reg(const struct regvm_compiler *c, size_t pos) {
+    const struct regvm_val *const v = &c->stack[pos];
+    if (v->kind == VAL_SLOT)
+        return (int)(c->local_count + pos);
+    if (v->kind == VAL_REG)
+        return v->x;
+    return -1;
+}
+
+/// Copy the stack value at `pos` to register `reg`.
+static void regvm_gen_move(struct regvm_compiler *c, size_t pos, size_t reg) {
+    const struct regvm_val *const v = &c->stack[pos];
+    const int src = regvm_val_reg(c, pos);
+    if (src >= 0) {
+        if ((size_t)src != reg)
+            regvm_emit_def(c, REGVM_INSN(REGVM_Move, reg, src, 0), reg);
+        return;
+    }
+    switch (v->kind) {
+    case VAL_INT:
+        regvm_emit_def(c, REGVM_INSN_BX(REGVM_LdInt, reg, v->x), reg);
+        break;
+    case VAL_NIL:
+        regvm_emit_def(c, REGVM_INSN(REGVM_LdNil, reg, 0, 0), reg);
+        break;
+    case VAL_BOOL:
+        regvm_emit_def(c, REGVM_INSN(REGVM_LdBool, reg, v->x, 0), reg);
+        break;
+    case VAL_CNST:
+        regvm_emit_def(c, REGVM_INSN_BX(REGVM_LdCnst, reg, v->x), reg);
+        break;
+    case VAL_VAL:
+        regvm_emit_def(c, REGVM_INSN_BX(REGVM_LdVal, reg, v->x), reg);
+        break;
+    case VAL_ARG:
+        regvm_emit_def(c, REGVM_INSN(REGVM_LdArg, reg, v->x, 0), reg);
+        break;
+    default:
+        ow_unreachable();
+    }
+}
+
+/// Put the stack value at `pos` in its own register.
+static void regvm_gen_materialize(struct regvm_compiler *c, size_t pos) {
+    if (c->stack[pos].kind == VAL_SLOT)
+        return;
+    regvm_gen_move(c, pos, c->local_count + pos);
+    c->stack[pos].kind = VAL_SLOT;
+}
+
+/// Put stack values below `end` in their own registers.
+static void regvm_gen_flush(struct regvm_compiler *c, size_t end) {
+    for (size_t pos = 0; pos < end; pos++)
+        regvm_gen_materialize(c, pos);
+}
+
+/// Get a register holding the stack value at `pos`.
+static size_t regvm_operand_reg(struct regvm_compiler *c, size_t pos) {
+    const int reg = regvm_val_reg(c, pos);
+    if (reg >= 0)
+        return (size_t)reg;
+    regvm_gen_materialize(c, pos);
+    return c->local_count + pos;
+}
+
+/// Check whether the stack value at `pos` can be an 8-bit immediate operand.
+static bool regvm_val_is_imm(const struct regvm_compiler *c, size_t pos) {
+    const struct regvm_val *const v = &c->stack[pos];
+    return v->kind == VAL_INT && v->x >= INT8_MIN && v->x <= INT8_MAX;
+}
+
+/// Push a value.
+static void regvm_push(struct regvm_compiler *c, enum regvm_val_kind kind, int x) {
+    assert(c->local_count + c->stack_size < REGVM_MAX_REGS);
+    c->stack[c->stack_size++] = (struct regvm_val){kind, x};
+}
+
+/// Stop for the interpreter to run the instruction at `offset`.
+static void regvm_gen_exit(struct regvm_compiler *c, size_t offset) {
+    regvm_gen_flush(c, c->stack_size);
+    c->resume_at = (struct ow_regvm_resume){(uint32_t)offset, (uint32_t)c->stack_size};
+    regvm_emit(c, REGVM_INSN(REGVM_Exit, 0, 0, 0));
+    c->live = false;
+}
+
+/// Check whether a jump target has been given a stack depth.
+static bool regvm_jump_target_valid(const struct regvm_compiler *c, ptrdiff_t target) {
+    return target >= 0 && (size_t)target < c->code_size && c->depth[target] >= 0;
+}
+
+/// Get the register comparison opcode (plain form) of a bytecode comparison.
+static enum regvm_opcode regvm_cmp_opcode(enum ow_opcode opcode) {
+    switch (opcode) {
+    case OW_OPC_CmpLt: return REGVM_CmpLt;
+    case OW_OPC_CmpLe: return REGVM_CmpLe;
+    case OW_OPC_CmpGt: return REGVM_CmpGt;
+    case OW_OPC_CmpGe: return REGVM_CmpGe;
+    case OW_OPC_CmpEq: return REGVM_CmpEq;
+    case OW_OPC_CmpNe: return REGVM_CmpNe;
+    default: ow_unreachable();
+    }
+}
+
+/// Translate `CmpXx`, fused with a following `JmpUnls`. Return offset of the
+/// next bytecode instruction to translate.
+static size_t regvm_gen_cmp(
+    struct regvm_compiler *c, enum ow_opcode opcode, size_t next
+) {
+    const enum regvm_opcode cmp = regvm_cmp_opcode(opcode);
+    const size_t lhs = c->stack_size - 2, rhs = c->stack_size - 1;
+    const bool imm = regvm_val_is_imm(c, rhs);
+
+    if (next < c->code_size && !c->is_label[next]) {
+        const enum ow_opcode next_opcode = (enum ow_opcode)c->code[next];
+        if (next_opcode == OW_OPC_JmpUnls || next_opcode == OW_OPC_JmpUnlsW) {
+            const enum ow_operand_type operand_type = ow_operand_type(next_opcode);
+            const ptrdiff_t target =
+                (ptrdiff_t)next + ow_operand_read(c->code + next + 1, operand_type);
+            if (regvm_jump_target_valid(c, target)) {
+                regvm_gen_flush(c, lhs);
+                const size_t a = regvm_operand_reg(c, lhs);
+                const uint32_t insn = imm ?
+                    REGVM_INSN(cmp + 3, a, c->stack[rhs].x, 0) :
+                    REGVM_INSN(cmp + 2, a, regvm_operand_reg(c, rhs), 0);
+                regvm_emit_jump(c, insn, (size_t)target);
+                c->stack_size -= 2;
+                return next + 1 + ow_operand_type_width(operand_type);
+            }
+        }
+    }
+
+    const size_t b = regvm_operand_reg(c, lhs);
+    const size_t dst = c->local_count + lhs;
+    const uint32_t insn = imm ?
+        REGVM_INSN(cmp + 1, dst, b, c->stack[rhs].x) :
+        REGVM_INSN(cmp, dst, b, regvm_operand_reg(c, rhs));
+    c->stack_size--;
+    c->stack[lhs].kind = VAL_SLOT;
+    regvm_emit_def(c, insn, dst);
+    return next;
+}
+
+/// Translate a binary operator.
+static void regvm_gen_bin_op(struct regvm_compiler *c, enum regvm_opcode opcode) {
+    const size_t lhs = c->stack_size - 2, rhs = c->stack_size - 1;
+    const size_t b = regvm_operand_reg(c, lhs);
+    const size_t dst = c->local_count + lhs;
+    const uint32_t insn = regvm_val_is_imm(c, rhs) ?
+        REGVM_INSN(opcode + 1, dst, b, c->stack[rhs].x) :
+        REGVM_INSN(opcode, dst, b, regvm_operand_reg(c, rhs));
+    c->stack_size--;
+    c->stack[lhs].kind = VAL_SLOT;
+    regvm_emit_def(c, insn, dst);
+}
+
+/// Translate `StLoc`.
+static void regvm_gen_store_local(struct regvm_compiler *c, size_t index) {
+    const size_t top = c->stack_size - 1;
+    if (index < c->local_count) {
+        bool below_in_slots = true;
+        for (size_t pos = 0; pos < top; pos++) {
+            if (c->stack[pos].kind != VAL_SLOT) {
+                below_in_slots = false;
+                break;
+            }
+        }
+        if (below_in_slots && c->stack[top].kind == VAL_SLOT &&
+                c->last_def == c->buf_size - 1 &&
+                c->last_def_reg == c->local_count + top) {
+            // Let the instruction that made the value write the variable.
+            c->buf[c->last_def] = (c->buf[c->last_def] & ~(uint32_t)0xff00) |
+                (uint32_t)index << 8;
+            c->last_def = (size_t)-1;
+        } else {
+            regvm_gen_flush(c, top);
+            regvm_gen_move(c, top, index);
+        }
+    } else {
+        regvm_gen_flush(c, c->stack_size);
+        regvm_emit(c, REGVM_INSN(REGVM_Move, index, c->local_count + top, 0));
+    }
+    c->stack_size--;
+}
+
+/// Translate an instruction. Return offset of the next bytecode instruction to translate.
+static size_t regvm_gen_instruction(
+    struct regvm_compiler *c, enum ow_opcode opcode, int operand, size_t offset, size_t next
+) {
+    const int arg_count = c->func->func_spec.arg_cnt;
+
+    switch (opcode) {
+    case OW_OPC_Nop:
+        break;
+
+    case OW_OPC_Drop:
+        c->stack_size--;
+        break;
+
+    case OW_OPC_Dup: {
+        const size_t top = c->stack_size - 1;
+        if (c->stack[top].kind == VAL_SLOT)
+            regvm_push(c, VAL_REG, (int)(c->local_count + top));
+        else
+            regvm_push(c, c->stack[top].kind, c->stack[top].x);
+        break;
+    }
+
+    case OW_OPC_LdNil:
+        regvm_push(c, VAL_NIL, 0);
+        break;
+
+    case OW_OPC_LdBool:
+        regvm_push(c, VAL_BOOL, operand != 0);
+        break;
+
+    case OW_OPC_LdInt:
+    case OW_OPC_LdIntW:
+        regvm_push(c, VAL_INT, operand);
+        break;
+
+    case OW_OPC_LdFlt: {
+        struct ow_object *const obj = ow_smallfloat_try_to_ptr((double)operand);
+        const size_t index = obj ? regvm_add_value(c, obj) : (size_t)-1;
+        if (index > UINT16_MAX) {
+            regvm_gen_exit(c, offset);
+            break;
+        }
+        regvm_push(c, VAL_VAL, (int)index);
+        break;
+    }
+
+    case OW_OPC_LdCnst:
+    case OW_OPC_LdCnstW: {
+        struct ow_object *const obj = ow_func_obj_get_constant(c->func, (size_t)operand);
+        if (!obj) {
+            regvm_gen_exit(c, offset);
+            break;
+        }
+        if (ow_smallint_check(obj) && ow_smallint_from_ptr(obj) >= INT16_MIN &&
+                ow_smallint_from_ptr(obj) <= INT16_MAX) {
+            regvm_push(c, VAL_INT, (int)ow_smallint_from_ptr(obj));
+            break;
+        }
+        if (ow_smallint_check(obj) || ow_smallfloat_check(obj)) {
+            const size_t index = regvm_add_value(c, obj);
+            if (index <= UINT16_MAX) {
+                regvm_push(c, VAL_VAL, (int)index);
+                break;
+            }
+        }
+        regvm_push(c, VAL_CNST, operand);
+        break;
+    }
+
+    case OW_OPC_LdArg:
+        if (arg_count < 0 || operand >= arg_count) {
+            regvm_gen_exit(c, offset);
+            break;
+        }
+        regvm_push(c, VAL_ARG, operand);
+        break;
+
+    case OW_OPC_StArg: {
+        if (arg_count < 0 || operand >= arg_count) {
+            regvm_gen_exit(c, offset);
+            break;
+        }
+        const size_t top = c->stack_size - 1;
+        regvm_gen_flush(c, top);
+        regvm_emit(c, REGVM_INSN(REGVM_StArg, operand, regvm_operand_reg(c, top), 0));
+        c->stack_size--;
+        break;
+    }
+
+    case OW_OPC_LdLoc:
+    case OW_OPC_LdLocW:
+        if ((size_t)operand < c->local_count) {
+            regvm_push(c, VAL_REG, operand);
+        } else if ((size_t)operand < c->local_count + c->stack_size) {
+            regvm_gen_flush(c, c->stack_size);
+            regvm_push(c, VAL_REG, operand);
+        } else {
+            regvm_gen_exit(c, offset);
+        }
+        break;
+
+    case OW_OPC_StLoc:
+    case OW_OPC_StLocW:
+        if ((size_t)operand + 1 >= c->local_count + c->stack_size) {
+            regvm_gen_exit(c, offset);
+            break;
+        }
+        regvm_gen_store_local(c, (size_t)operand);
+        break;
+
+    case OW_OPC_LdGlob:
+    case OW_OPC_LdGlobW: {
+        const size_t dst = c->local_count + c->stack_size;
+        regvm_push(c, VAL_SLOT, 0);
+        regvm_emit_def(c, REGVM_INSN_BX(REGVM_LdGlob, dst, operand), dst);
+        break;
+    }
+
+    case OW_OPC_LdGlobY:
+    case OW_OPC_LdGlobYW: {
+        if (next > UINT16_MAX || !ow_func_obj_global_cell(c->func, c->func->code + next)) {
+            regvm_gen_exit(c, offset);
+            break;
+        }
+        const size_t dst = c->local_count + c->stack_size;
+        regvm_push(c, VAL_SLOT, 0);
+        regvm_emit_def(c, REGVM_INSN_BX(REGVM_LdGlobY, dst, next), dst);
+        break;
+    }
+
+    case OW_OPC_Add: regvm_gen_bin_op(c, REGVM_Add); break;
+    case OW_OPC_Sub: regvm_gen_bin_op(c, REGVM_Sub); break;
+    case OW_OPC_Mul: regvm_gen_bin_op(c, REGVM_Mul); break;
+    case OW_OPC_Div: regvm_gen_bin_op(c, REGVM_Div); break;
+    case OW_OPC_Rem: regvm_gen_bin_op(c, REGVM_Rem); break;
+    case OW_OPC_Shl: regvm_gen_bin_op(c, REGVM_Shl); break;
+    case OW_OPC_Shr: regvm_gen_bin_op(c, REGVM_Shr); break;
+    case OW_OPC_And: regvm_gen_bin_op(c, REGVM_And); break;
+    case OW_OPC_Or : regvm_gen_bin_op(c, REGVM_Or ); break;
+    case OW_OPC_Xor: regvm_gen_bin_op(c, REGVM_Xor); break;
+
+    case OW_OPC_CmpLt:
+    case OW_OPC_CmpLe:
+    case OW_OPC_CmpGt:
+    case OW_OPC_CmpGe:
+    case OW_OPC_CmpEq:
+    case OW_OPC_CmpNe:
+        return regvm_gen_cmp(c, opcode, next);
+
+    case OW_OPC_Jmp:
+    case OW_OPC_JmpW: {
+        const ptrdiff_t target = (ptrdiff_t)offset + operand;
+        if (!regvm_jump_target_valid(c, target)) {
+            regvm_gen_exit(c, offset);
+            break;
+        }
+        regvm_gen_flush(c, c->stack_size);
+        regvm_emit_jump(c, REGVM_INSN(REGVM_Jmp, 0, 0, 0), (size_t)target);
+        c->live = false;
+        break;
+    }
+
+    case OW_OPC_JmpWhen:
+    case OW_OPC_JmpWhenW:
+    case OW_OPC_JmpUnls:
+    case OW_OPC_JmpUnlsW: {
+        const ptrdiff_t target = (ptrdiff_t)offset + operand;
+        if (!regvm_jump_target_valid(c, target)) {
+            regvm_gen_exit(c, offset);
+            break;
+        }
+        const size_t top = c->stack_size - 1;
+        regvm_gen_flush(c, top);
+        const bool when = opcode == OW_OPC_JmpWhen || opcode == OW_OPC_JmpWhenW;
+        const uint32_t insn = REGVM_INSN(
+            when ? REGVM_JmpWhen : REGVM_JmpUnls, regvm_operand_reg(c, top), 0, 0);
+        regvm_emit_jump(c, insn, (size_t)target);
+        c->stack_size--;
+        break;
+    }
+
+    default:
+        regvm_gen_exit(c, offset);
+        break;
+    }
+
+    return next;
+}
+
+/// Translate all reachable instructions.
+static void regvm_gen_function(struct regvm_compiler *c) {
+    size_t off = 0;
+    while (off < c->code_size) {
+        const enum ow_opcode opcode = (enum ow_opcode)c->code[off];
+        if (c->depth[off] == -2)
+            break; // Invalid instruction.
+        const enum ow_opcode generic = ow_opcode_generic(opcode);
+        const enum ow_operand_type operand_type = ow_operand_type(generic);
+        const int operand = ow_operand_read(c->code + off + 1, operand_type);
+        const size_t next = off + 1 + ow_operand_type_width(operand_type);
+        const int depth = c->depth[off];
+        if (depth < 0) {
+            assert(!c->live);
+            off = next;
+            continue;
+        }
+
+        if (c->is_label[off] || !c->live) {
+            if (c->live)
+                regvm_gen_flush(c, c->stack_size);
+            c->stack_size = (size_t)depth;
+            for (size_t pos = 0; pos < c->stack_size; pos++)
+                c->stack[pos] = (struct regvm_val){VAL_SLOT, 0};
+            c->live = true;
+            c->last_def = (size_t)-1;
+            c->reg_at[off] = c->buf_size;
+        }
+        assert(c->stack_size == (size_t)depth);
+        bool in_slots = true;
+        for (size_t pos = 0; pos < c->stack_size; pos++) {
+            if (c->stack[pos].kind != VAL_SLOT) {
+                in_slots = false;
+                break;
+            }
+        }
+        if (in_slots)
+            c->resume_at = (struct ow_regvm_resume){(uint32_t)off, (uint32_t)depth};
+
+        off = regvm_gen_instruction(c, generic, operand, off, next);
+    }
+    if (c->live)
+        regvm_gen_exit(c, off);
+}
+
+/// Check whether an instruction is followed by a jump target word.
+static bool regvm_insn_is_jump(uint32_t insn) {
+    const enum regvm_opcode opcode = (enum regvm_opcode)(insn & 0xff);
+    if (opcode == REGVM_Jmp || opcode == REGVM_JmpWhen || opcode == REGVM_JmpUnls)
+        return true;
+    switch (opcode) {
+#define ELEM(NAME, OPERATOR) case REGVM_Cmp##NAME##Jmp: case REGVM_Cmp##NAME##JmpI:
+    REGVM_CMP_LIST
+#undef ELEM
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// Check whether running from word `pos` is worth entering: it goes through at
+/// least `REGVM_ENTRY_MIN_RUN` instructions or jumps back before the first Exit.
+static bool regvm_entry_worthwhile(const struct regvm_compiler *c, size_t pos) {
+    for (size_t n = 0; n < REGVM_ENTRY_MIN_RUN; n++) {
+        assert(pos < c->buf_size);
+        const uint32_t insn = c->buf[pos];
+        if ((insn & 0xff) == REGVM_Exit)
+            return false;
+        if (!regvm_insn_is_jump(insn)) {
+            pos++;
+            continue;
+        }
+        const size_t target = c->buf[pos + 1];
+        if (target <= pos)
+            return true; // A loop.
+        pos = (insn & 0xff) == REGVM_Jmp ? target : pos + 2;
+    }
+    return true;
+}
+
+struct ow_regvm_code *ow_regvm_compile(struct ow_func_obj *func) {
+    struct regvm_compiler *const c = ow_malloc(sizeof(struct regvm_compiler));
+    c->func = func;
+    c->code = func->code;
+    c->code_size = func->code_size;
+    c->local_count = func->func_spec.local_cnt;
+    c->depth = ow_malloc((c->code_size + 1) * sizeof(int));
+    c->is_label = ow_malloc((c->code_size + 1) * sizeof(bool));
+    c->reg_at = ow_malloc((c->code_size + 1) * sizeof(size_t));
+    for (size_t i = 0; i <= c->code_size; i++)
+        c->reg_at[i] = (size_t)-1;
+    c->buf = NULL, c->resume = NULL;
+    c->buf_size = 0, c->buf_capacity = 0;
+    c->fixups = NULL;
+    c->fixup_count = 0, c->fixup_capacity = 0;
+    c->values = NULL;
+    c->value_count = 0, c->value_capacity = 0;
+    c->live = false;
+    c->resume_at = (struct ow_regvm_resume){0, 0};
+    c->last_def = (size_t)-1;
+    c->stack_size = 0;
+
+    const bool translatable =
+        c->code_size <= UINT32_MAX && c->local_count <= REGVM_MAX_REGS && regvm_analyze(c);
+    if (translatable)
+        regvm_gen_function(c);
+    for (size_t i = 0; i < c->fixup_count; i++) {
+        const struct regvm_fixup *const f = &c->fixups[i];
+        assert(c->reg_at[f->target] != (size_t)-1);
+        c->buf[f->pos] = (uint32_t)c->reg_at[f->target];
+    }
+
+    // Entries: where translation started afresh, unless it stops soon.
+    const size_t entry_count = translatable ? c->code_size + 1 : 0;
+    struct ow_regvm_code *const code = ow_malloc(
+        sizeof(struct ow_regvm_code) + entry_count * sizeof(uint32_t));
+    code->code = c->buf;
+    code->code_size = c->buf_size;
+    code->resume = c->resume;
+    code->values = c->values;
+    code->local_count = c->local_count;
+    code->entry_count = entry_count;
+    for (size_t i = 0; i < entry_count; i++) {
+        const size_t pos = c->reg_at[i];
+        code->entries[i] = pos != (size_t)-1 && regvm_entry_worthwhile(c, pos) ?
+            (uint32_t)pos + 1 : 0;
+    }
+
+    ow_debuglog_print(
+        "regvm", DBG, "compiled function %p: %zu bytes of bytecode => %zu words of register code",
+        (void *)func, c->code_size, c->buf_size);
+
+    ow_free(c->depth), ow_free(c->is_label), ow_free(c->reg_at), ow_free(c->fixups);
+    ow_free(c);
+    return code;
+}
+
+void ow_regvm_code_del(struct ow_regvm_code *code) {
+    if (code->code)
+        ow_free(code->code);
+    if (code->resume)
+        ow_free(code->resume);
+    if (code->values)
+        ow_free(code->values);
+    ow_free(code);
+}
+
+/* ----- Interpreter -------------------------------------------------------- */
+
+/// Get value of a small int or a small float as a float.
+ow_static_forceinline double regvm_smallval_to_double(const struct ow_object *obj) {
+    return ow_smallint_check(obj) ?
+        (double)ow_smallint_from_ptr(obj) : ow_smallfloat_from_ptr(obj);
+}
+
+/// Compare two strings. Return false if they are not both strings.
+ow_noinline static bool regvm_string_cmp(
+    struct ow_machine *om, struct ow_object *lhs, struct ow_object *rhs, int *result
+) {
+    struct ow_class_obj *const string_class = om->builtin_classes->string;
+    if (ow_smallval_check(lhs) || ow_object_class(lhs) != string_class ||
+            ow_smallval_check(rhs) || ow_object_class(rhs) != string_class)
+        return false;
+    *result = ow_string_obj_compare(
+        om, ow_object_cast(lhs, struct ow_string_obj),
+        ow_object_cast(rhs, struct ow_string_obj));
+    return true;
+}
+
+/// Whether to use direct-threaded instruction dispatching in `ow_regvm_code_run()`.
+#if OW_BUILD_THREADED_DISPATCH && defined __GNUC__
+#    define REGVM_THREADED 1
+#else
+#    define REGVM_THREADED 0
+#endif
+
+void ow_regvm_code_run(
+    const struct ow_regvm_code *code, struct ow_jit_context *ctx, const uint32_t *entry
+) {
+    struct ow_object **const r = ctx->fp;
+    struct ow_object **const args = ctx->arg_list;
+    struct ow_func_obj *const func = ow_object_cast(args[-1], struct ow_func_obj);
+    struct ow_machine_globals *const globals = ctx->globals;
+    struct ow_machine *const machine = ctx->machine;
+    register const uint32_t *pc = entry;
+
+#define A    ((size_t)(pc[0] >> 8 & 0xff))
+#define B    ((size_t)(pc[0] >> 16 & 0xff))
+#define C    ((size_t)(pc[0] >> 24))
+#define SB   ((int8_t)(uint8_t)(pc[0] >> 16))
+#define SC   ((int8_t)(uint8_t)(pc[0] >> 24))
+#define BX   ((size_t)(pc[0] >> 16))
+#define SBX  ((int16_t)(uint16_t)(pc[0] >> 16))
+#define JUMP() (pc = code->code + pc[1])
+
+#if REGVM_THREADED
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wpedantic"
+    static const void *const dispatch_table[] = {
+#    define ELEM(NAME) [REGVM_##NAME] = &&op_##NAME ,
+        REGVM_OPCODE_LIST
+#    undef ELEM
+#    define ELEM(NAME, OPERATOR, RHS_OK) \
+        [REGVM_##NAME] = &&op_##NAME , [REGVM_##NAME##I] = &&op_##NAME##I ,
+        REGVM_NUM_OP_LIST
+        REGVM_INT_OP_LIST
+#    undef ELEM
+#    define ELEM(NAME, OPERATOR) \
+        [REGVM_Cmp##NAME] = &&op_Cmp##NAME , [REGVM_Cmp##NAME##I] = &&op_Cmp##NAME##I , \
+        [REGVM_Cmp##NAME##Jmp] = &&op_Cmp##NAME##Jmp , \
+        [REGVM_Cmp##NAME##JmpI] = &&op_Cmp##NAME##JmpI ,
+        REGVM_CMP_LIST
+#    undef ELEM
+    };
+#    define OP(NAME)  op_##NAME :
+#    define NEXT(N)   do { pc += (N); goto *dispatch_table[*pc & 0xff]; } while (0)
+    NEXT(0);
+#else // !REGVM_THREADED
+#    define OP(NAME)  case REGVM_##NAME :
+#    define NEXT(N)   do { pc += (N); goto dispatch; } while (0)
+dispatch:
+    switch ((enum regvm_opcode)(*pc & 0xff)) {
+#endif // REGVM_THREADED
+
+    OP(Exit)
+        goto exit;
+
+    OP(Move)
+        r[A] = r[B];
+        NEXT(1);
+
+    OP(LdNil)
+        r[A] = globals->value_nil;
+        NEXT(1);
+
+    OP(LdBool)
+        r[A] = B ? globals->value_true : globals->value_false;
+        NEXT(1);
+
+    OP(LdInt)
+        r[A] = ow_smallint_to_ptr(SBX);
+        NEXT(1);
+
+    OP(LdCnst)
+        r[A] = ow_func_obj_get_constant(func, BX);
+        NEXT(1);
+
+    OP(LdVal)
+        r[A] = code->values[BX];
+        NEXT(1);
+
+    OP(LdArg)
+        r[A] = args[B];
+        NEXT(1);
+
+    OP(StArg)
+        args[A] = r[B];
+        NEXT(1);
+
+    OP(LdGlob) {
+        struct ow_object *const obj = ow_module_obj_get_global(func->module, BX);
+        r[A] = ow_likely(obj) ? obj : globals->value_nil;
+        NEXT(1);
+    }
+
+    OP(LdGlobY) {
+        const struct ow_func_obj_global_cell *const cell =
+            ow_func_obj_global_cell(func, func->code + BX);
+        if (ow_likely(cell->index)) {
+            struct ow_module_obj *const module = func->module;
+            if (ow_likely(!cell->base_guard)) {
+                r[A] = ow_module_obj_get_global(module, cell->index - 1);
+                NEXT(1);
+            }
+            if (ow_likely(cell->base_guard == ow_module_obj_global_count(module) + 1)) {
+                r[A] = ow_module_obj_get_global(globals->module_base, cell->index - 1);
+                NEXT(1);
+            }
+        }
+        goto exit;
+    }
+
+    OP(Jmp)
+        JUMP();
+        NEXT(0);
+
+    OP(JmpWhen) {
+        struct ow_object *const cond = r[A];
+        if (cond == globals->value_true) {
+            JUMP();
+            NEXT(0);
+        }
+        if (ow_likely(cond == globals->value_false))
+            NEXT(2);
+        goto exit;
+    }
+
+    OP(JmpUnls) {
+        struct ow_object *const cond = r[A];
+        if (cond == globals->value_false) {
+            JUMP();
+            NEXT(0);
+        }
+        if (ow_likely(cond == globals->value_true))
+            NEXT(2);
+        goto exit;
+    }
+
+/// Operator with an 8-bit immediate right operand: small ints only.
+#define IMPL_OP_I(NAME, OPERATOR, RHS_OK) \
+    OP(NAME##I) { \
+        struct ow_object *const lhs = r[B]; \
+        struct ow_object *res; \
+        const ow_smallint_t rv = SC; \
+        if (ow_likely(ow_smallint_check(lhs) && (RHS_OK) && (res = ow_smallint_try_to_ptr( \
+                ow_smallint_from_ptr(lhs) OPERATOR rv)))) { \
+            r[A] = res; \
+            NEXT(1); \
+        } \
+        goto exit; \
+    } \
+// ^^^ IMPL_OP_I() ^^^
+
+#define IMPL_NUM_OP(NAME, OPERATOR, RHS_OK) \
+    OP(NAME) { \
+        struct ow_object *const lhs = r[B], *const rhs = r[C]; \
+        struct ow_object *res; \
+        if (ow_likely(ow_smallint_check(lhs) && ow_smallint_check(rhs))) { \
+            const ow_smallint_t rv = ow_smallint_from_ptr(rhs); \
+            if (ow_likely((RHS_OK) && (res = ow_smallint_try_to_ptr( \
+                    ow_smallint_from_ptr(lhs) OPERATOR rv)))) { \
+                r[A] = res; \
+                NEXT(1); \
+            } \
+        } else if (ow_smallfloat_check(lhs) && ow_smallfloat_check(rhs) && \
+                (res = ow_smallfloat_try_to_ptr( \
+                    ow_smallfloat_from_ptr(lhs) OPERATOR ow_smallfloat_from_ptr(rhs)))) { \
+            r[A] = res; \
+            NEXT(1); \
+        } \
+        goto exit; \
+    } \
+    IMPL_OP_I(NAME, OPERATOR, RHS_OK) \
+// ^^^ IMPL_NUM_OP() ^^^
+
+#define IMPL_INT_OP(NAME, OPERATOR, RHS_OK) \
+    OP(NAME) { \
+        struct ow_object *const lhs = r[B], *const rhs = r[C]; \
+        struct ow_object *res; \
+        if (ow_likely(ow_smallint_check(lhs) && ow_smallint_check(rhs))) { \
+            const ow_smallint_t rv = ow_smallint_from_ptr(rhs); \
+            if (ow_likely((RHS_OK) && (res = ow_smallint_try_to_ptr( \
+                    ow_smallint_from_ptr(lhs) OPERATOR rv)))) { \
+                r[A] = res; \
+                NEXT(1); \
+            } \
+        } \
+        goto exit; \
+    } \
+    IMPL_OP_I(NAME, OPERATOR, RHS_OK) \
+// ^^^ IMPL_INT_OP() ^^^
+
+/// Compare two values into `bool res`, or stop if they are not both numbers or
+/// both strings. An int and a float are compared as floats.
+#define IMPL_CMP(OPERATOR, LHS, RHS) \
+    if (ow_likely(ow_smallint_check(LHS) && ow_smallint_check(RHS))) \
+        res = ow_smallint_from_ptr(LHS) OPERATOR ow_smallint_from_ptr(RHS); \
+    else if (ow_smallval_check(LHS) && ow_smallval_check(RHS)) \
+        res = regvm_smallval_to_double(LHS) OPERATOR regvm_smallval_to_double(RHS); \
+    else if (regvm_string_cmp(machine, LHS, RHS, &cmp_res)) \
+        res = cmp_res OPERATOR 0; \
+    else \
+        goto exit; \
+// ^^^ IMPL_CMP() ^^^
+
+#define IMPL_CMP_OP(NAME, OPERATOR) \
+    OP(Cmp##NAME) { \
+        struct ow_object *const lhs = r[B], *const rhs = r[C]; \
+        bool res; int cmp_res; \
+        IMPL_CMP(OPERATOR, lhs, rhs) \
+        r[A] = res ? globals->value_true : globals->value_false; \
+        NEXT(1); \
+    } \
+    OP(Cmp##NAME##I) { \
+        struct ow_object *const lhs = r[B]; \
+        if (ow_unlikely(!ow_smallint_check(lhs))) \
+            goto exit; \
+        r[A] = ow_smallint_from_ptr(lhs) OPERATOR (ow_smallint_t)SC ? \
+            globals->value_true : globals->value_false; \
+        NEXT(1); \
+    } \
+    OP(Cmp##NAME##Jmp) { \
+        struct ow_object *const lhs = r[A], *const rhs = r[B]; \
+        bool res; int cmp_res; \
+        IMPL_CMP(OPERATOR, lhs, rhs) \
+        if (res) \
+            NEXT(2); \
+        JUMP(); \
+        NEXT(0); \
+    } \
+    OP(Cmp##NAME##JmpI) { \
+        struct ow_object *const lhs = r[A]; \
+        if (ow_unlikely(!ow_smallint_check(lhs))) \
+            goto exit; \
+        if (ow_smallint_from_ptr(lhs) OPERATOR (ow_smallint_t)SB) \
+            NEXT(2); \
+        JUMP(); \
+        NEXT(0); \
+    } \
+// ^^^ IMPL_CMP_OP() ^^^
+
+#define ELEM(NAME, OPERATOR, RHS_OK) IMPL_NUM_OP(NAME, OPERATOR, RHS_OK)
+    REGVM_NUM_OP_LIST
+#undef ELEM
+#define ELEM(NAME, OPERATOR, RHS_OK) IMPL_INT_OP(NAME, OPERATOR, RHS_OK)
+    REGVM_INT_OP_LIST
+#undef ELEM
+#define ELEM(NAME, OPERATOR) IMPL_CMP_OP(NAME, OPERATOR)
+    REGVM_CMP_LIST
+#undef ELEM
+
+#undef IMPL_OP_I
+#undef IMPL_NUM_OP
+#undef IMPL_INT_OP
+#undef IMPL_CMP
+#undef IMPL_CMP_OP
+
+#if REGVM_THREADED
+#    pragma GCC diagnostic pop
+#else // !REGVM_THREADED
+    default:
+        ow_unreachable();
+    }
+#endif // REGVM_THREADED
+
+#undef A
+#undef B
+#undef C
+#undef SB
+#undef SC
+#undef BX
+#undef SBX
+#undef JUMP
+#undef OP
+#undef NEXT
+
+exit:
+    {
+        const struct ow_regvm_resume *const resume = &code->resume[pc - code->code];
+        ctx->ip_offset = resume->offset;
+        ctx->sp = r + code->local_count + resume->depth - 1;
+    }
+}
+
+#endif // OW_BUILD_REGISTER_VM
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jit.h" // struct ow_jit_context
+#include <utilities/attributes.h>
+
+#include <config/options.h>
+
+struct ow_func_obj;
+
+/// Where the interpreter continues when register code cannot go on.
+struct ow_regvm_resume {
+    uint32_t offset; // Bytecode offset.
+    uint32_t depth; // Number of values on the stack above local variables.
+};
+
+/// Register code of a function. See "doc/bytecode.md" for the instruction set.
+struct ow_regvm_code {
+    uint32_t *code;
+    size_t code_size; // Number of words in `code`.
+    struct ow_regvm_resume *resume; // { word index of an instruction => resume point }
+    struct ow_object **values; // Small ints and small floats loaded by the code.
+    size_t local_count;
+    size_t entry_count; // Number of elements in `entries`, i.e., bytecode size + 1, or 0.
+    uint32_t entries[]; // { bytecode offset => (word index + 1) or 0 }
+};
+
+#if OW_BUILD_REGISTER_VM
+
+/// Translate the bytecode of a function to register code. A function that
+/// cannot be translated gets code without entries.
+struct ow_regvm_code *ow_regvm_compile(struct ow_func_obj *func);
+/// Delete register code.
+void ow_regvm_code_del(struct ow_regvm_code *code);
+/// Get the entry for a bytecode offset. Return NULL if it cannot be entered there.
+ow_static_forceinline const uint32_t *ow_regvm_code_entry(
+    const struct ow_regvm_code *code, size_t offset);
+/// Run register code from an entry. Then the interpreter shall continue
+/// from `ctx->ip_offset` with stack top `ctx->sp`.
+void ow_regvm_code_run(
+    const struct ow_regvm_code *code, struct ow_jit_context *ctx, const uint32_t *entry);
+
+ow_static_forceinline const uint32_t *ow_regvm_code_entry(
+    const struct ow_regvm_code *code, size_t offset
+) {
+    if (ow_unlikely(offset >= code->entry_count))
+        return NULL;
+    const uint32_t n = code->entries[offset];
+    return ow_likely(n) ? code->code + (n - 1) : NULL;
+}
+
+#endif // OW_BUILD_REGISTER_VM
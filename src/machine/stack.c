@@ -8,53 +8,53 @@
 
 #define CALLSTACK_MIN 64
 
-static void ow_callstack_frame_info_list_init(
-    struct ow_callstack_frame_info_list *list
-) {
-    list->current = NULL;
-    list->_free_list = NULL;
+/// Number of object slots committed when a call stack is created.
+#define CALLSTACK_INIT_COMMIT 1024
+
+/// Round up a size to a multiple of the page size.
+static size_t callstack_page_align(size_t size) {
+    const size_t page_size = ow_mem_get_pagesize();
+    return (size + page_size - 1) / page_size * page_size;
 }
 
-static void ow_callstack_frame_info_list_fini(
-    struct ow_callstack_frame_info_list *list
+/// Commit the first `size` bytes of a reserved region of `reserved_size` bytes.
+static bool callstack_commit(void *base, size_t size, size_t reserved_size) {
+    size = callstack_page_align(size);
+    return ow_mem_commit_virtual(base, size < reserved_size ? size : reserved_size);
+}
+
+static void ow_callstack_frame_info_list_init(
+    struct ow_callstack_frame_info_list *list, size_t n
 ) {
-    struct ow_callstack_frame_info *const lists[2] = {list->current, list->_free_list};
-    for (size_t i = 0; i < 2; i++) {
-        for (struct ow_callstack_frame_info *fi = lists[i]; fi; ) {
-            struct ow_callstack_frame_info *const next_fi = fi->_next;
-            ow_free(fi);
-            fi = next_fi;
-        }
-    }
+    // Each frame occupies at least one stack slot below the limit (the callable
+    // object), so `n` records are enough for a stack of `n` slots and never move.
+    const size_t size = callstack_page_align(sizeof(struct ow_callstack_frame_info) * n);
+    list->current = NULL;
+    list->_base = ow_mem_reserve_virtual(size);
+    assert(list->_base);
+    list->_end = list->_base + n;
 }
 
-void ow_callstack_frame_info_list_enter(
-    struct ow_callstack_frame_info_list *list
+/// Commit the records for a stack of `n` slots.
+static bool ow_callstack_frame_info_list_commit(
+    struct ow_callstack_frame_info_list *list, size_t n
 ) {
-    struct ow_callstack_frame_info *fi;
-    if (ow_likely(list->_free_list)) {
-        fi = list->_free_list;
-        list->_free_list = fi->_next;
-    } else {
-        fi = ow_malloc(sizeof(struct ow_callstack_frame_info));
-    }
-    fi->_next = list->current;
-    list->current = fi;
+    const size_t elem_size = sizeof(struct ow_callstack_frame_info);
+    return callstack_commit(
+        list->_base, elem_size * n, elem_size * (size_t)(list->_end - list->_base));
 }
 
-void ow_callstack_frame_info_list_leave(
+static void ow_callstack_frame_info_list_fini(
     struct ow_callstack_frame_info_list *list
 ) {
-    assert(list->current);
-    struct ow_callstack_frame_info *const fi = list->current;
-    list->current = fi->_next;
-    fi->_next = list->_free_list;
-    list->_free_list = fi;
+    const size_t size = callstack_page_align(
+        sizeof(struct ow_callstack_frame_info) * (size_t)(list->_end - list->_base));
+    ow_mem_deallocate_virtual(list->_base, size);
 }
 
 static void ow_callstack_gc_visitor(void *_ptr, int op) {
     struct ow_callstack *const stack = _ptr;
-    assert(stack->regs.sp < stack->data_end);
+    assert(stack->regs.sp < stack->data_end + OW_CALLSTACK_SLACK);
     for (struct ow_object **p = stack->_data, **const p_end = stack->regs.sp;
         p <= p_end; p++
     ) {
@@ -65,18 +65,48 @@ static void ow_callstack_gc_visitor(void *_ptr, int op) {
 void ow_callstack_init(struct ow_machine *om, struct ow_callstack *stack, size_t n) {
     if (n < CALLSTACK_MIN)
         n = CALLSTACK_MIN;
-    stack->_data = ow_malloc(sizeof(struct ow_object *) * n);
+    // The whole stack is reserved, and pages are committed as the stack grows
+    // (see `ow_callstack_grow()`), so the stack costs as much memory as it has
+    // ever been used. The slack beyond `data_end` is always committed.
+    stack->_size = callstack_page_align(
+        sizeof(struct ow_object *) * (n + OW_CALLSTACK_SLACK));
+    stack->_data = ow_mem_reserve_virtual(stack->_size);
+    assert(stack->_data);
     stack->regs.sp = stack->_data - 1;
     stack->regs.fp = stack->_data;
-    stack->data_end = stack->_data + n;
-    ow_callstack_frame_info_list_init(&stack->frame_info_list);
+    stack->data_end = stack->_data;
+    stack->_data_end_max = stack->_data + n;
+    stack->native_depth = 0;
+    ow_callstack_frame_info_list_init(&stack->frame_info_list, n);
+    const bool ok = ow_callstack_grow(
+        stack, stack->_data + (n < CALLSTACK_INIT_COMMIT ? n : CALLSTACK_INIT_COMMIT) - 1);
+    assert(ok);
+    ow_unused_var(ok);
     ow_objmem_add_gc_root(om, stack, ow_callstack_gc_visitor);
 }
 
+bool ow_callstack_grow(struct ow_callstack *stack, struct ow_object **sp) {
+    if (sp >= stack->_data_end_max)
+        return false;
+    const size_t n_max = (size_t)(stack->_data_end_max - stack->_data);
+    const size_t n_min = (size_t)(sp - stack->_data) + 1;
+    size_t n = (size_t)(stack->data_end - stack->_data) * 2;
+    if (n < n_min)
+        n = n_min;
+    if (n > n_max)
+        n = n_max;
+    if (!callstack_commit(
+            stack->_data, sizeof(struct ow_object *) * (n + OW_CALLSTACK_SLACK), stack->_size)
+            || !ow_callstack_frame_info_list_commit(&stack->frame_info_list, n))
+        return false;
+    stack->data_end = stack->_data + n;
+    return true;
+}
+
 void ow_callstack_fini(struct ow_machine *om, struct ow_callstack *stack) {
     ow_objmem_remove_gc_root(om, stack);
     ow_callstack_frame_info_list_fini(&stack->frame_info_list);
-    ow_free(stack->_data);
+    ow_mem_deallocate_virtual(stack->_data, stack->_size);
 }
 
 void ow_callstack_clear(struct ow_callstack *stack) {
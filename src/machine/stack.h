@@ -1,30 +1,59 @@
 #pragma once
 
+#include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
 
+#include <utilities/attributes.h>
+
 struct ow_machine;
 struct ow_object;
 
 /// Information of a call stack frame.
 struct ow_callstack_frame_info {
     bool not_ret_val;
+    unsigned char ret_hook; ///< Opcode to finish after the frame returns, or `0` if none.
     struct ow_object **arg_list;
     struct ow_object **prev_fp;
     const unsigned char *prev_ip;
-    struct ow_callstack_frame_info *_next;
+    size_t tail_calls; ///< Number of frames that have been replaced by tail calls.
 };
 
-/// A linked list of frame info.
+/// Frame info records, stored contiguously and indexed by call depth.
 struct ow_callstack_frame_info_list {
-    struct ow_callstack_frame_info *current;
-    struct ow_callstack_frame_info *_free_list;
+    struct ow_callstack_frame_info *current; ///< Innermost frame, or NULL if none.
+    struct ow_callstack_frame_info *_base;
+    struct ow_callstack_frame_info *_end;
 };
 
-/// Enter a new frame. All members of `list->current` must be filled after returns.
-void ow_callstack_frame_info_list_enter(struct ow_callstack_frame_info_list *list);
+/// Enter a new frame. All members of `list->current` except `tail_calls`, which
+/// is reset to 0, must be filled after returns.
+ow_static_forceinline void ow_callstack_frame_info_list_enter(
+    struct ow_callstack_frame_info_list *list
+) {
+    struct ow_callstack_frame_info *const fi =
+        ow_likely(list->current) ? list->current + 1 : list->_base;
+    assert(fi < list->_end);
+    fi->tail_calls = 0;
+    list->current = fi;
+}
+
 /// Leave current frame.
-void ow_callstack_frame_info_list_leave(struct ow_callstack_frame_info_list *list);
+ow_static_forceinline void ow_callstack_frame_info_list_leave(
+    struct ow_callstack_frame_info_list *list
+) {
+    assert(list->current);
+    list->current =
+        ow_likely(list->current != list->_base) ? list->current - 1 : NULL;
+}
+
+/// Check whether a frame info record is current frame or one of its callers.
+ow_static_forceinline bool ow_callstack_frame_info_list_contains(
+    const struct ow_callstack_frame_info_list *list,
+    const struct ow_callstack_frame_info *fi
+) {
+    return list->current && fi >= list->_base && fi <= list->current;
+}
 
 /// Registers used in call stack.
 struct ow_callstack_regs {
@@ -32,20 +61,38 @@ struct ow_callstack_regs {
     struct ow_object **fp; ///< Frame base.
 };
 
+/// Number of stack slots beyond `data_end`, which take the values pushed
+/// within a frame (locals and temporaries) without checking.
+#define OW_CALLSTACK_SLACK  ((size_t)1 << 17)
+
+/// Max nesting level of native calls that run code of the machine, which use
+/// the native (C) stack. See `ow_callstack::native_depth`.
+#define OW_CALLSTACK_NATIVE_DEPTH_MAX  10000
+
 /// The runtime call stack.
 struct ow_callstack {
     struct ow_callstack_regs regs;
     struct ow_callstack_frame_info_list frame_info_list;
-    struct ow_object **data_end;
+    struct ow_object **data_end; ///< Limit of stack top for entering a new frame.
+    size_t native_depth; ///< Nesting level of native calls, like `ow_machine_invoke()`.
     struct ow_object **_data;
+    struct ow_object **_data_end_max; ///< Max value of `data_end`, i.e., the stack size.
+    size_t _size; ///< Size of the reserved region in bytes.
 };
-/// Create a call stack.
 
+/// Create a call stack of `n` object slots.
 void ow_callstack_init(struct ow_machine *om, struct ow_callstack *stack, size_t n);
 /// Destroy a call stack.
 void ow_callstack_fini(struct ow_machine *om, struct ow_callstack *stack);
 /// Clear stack.
 void ow_callstack_clear(struct ow_callstack *stack);
+/// Commit more memory so that a new frame can be entered with stack top `sp`.
+/// Return false if the stack is full. Called by `ow_callstack_frame_room()`.
+bool ow_callstack_grow(struct ow_callstack *stack, struct ow_object **sp);
+/// Check whether a new frame can be entered with stack top `sp`. Otherwise,
+/// a stack overflow exception shall be raised.
+#define ow_callstack_frame_room(stack, sp) \
+    ((sp) < (stack).data_end || ow_callstack_grow(&(stack), (sp)))
 /// Push object to stack.
 #define ow_callstack_push(stack, object)  (*++(stack).regs.sp = (object))
 /// Pop top object on stack.
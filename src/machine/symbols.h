@@ -25,6 +25,8 @@ struct ow_symbol_obj;
     ELEM(hash, "__hash__") \
     ELEM(find_attr, "__find_attr__") \
     ELEM(find_meth, "__find_meth__") \
+    ELEM(iter, "__iter__") \
+    ELEM(next, "__next__") \
 // ^^^ OW_COMSYM_LIST ^^^
 
 /// Commonly used symbols.
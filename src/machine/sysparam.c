@@ -3,10 +3,17 @@
 #include <assert.h>
 #include <string.h>
 
+#include "jit.h"
 #include <utilities/memalloc.h>
 
 volatile struct ow_sysparam ow_sysparam = {
-    .stack_size       = 4000 / sizeof(void *),
+    .stack_size       = (size_t)1 << 20,
+    .jit_threshold    = 0,
+    .trace_threshold  = 0,
+    .opt_level        = 1,
+    .gc_slice_budget  = 0,
+    .gc_concurrent    = false,
+    .gc_threads       = 1,
     .default_paths    = NULL,
 };
 
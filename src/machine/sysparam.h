@@ -5,7 +5,13 @@
 
 /// Global parameters.
 struct ow_sysparam {
-    size_t stack_size; // Number of objects.
+    size_t stack_size; // Max number of objects. Memory is used on demand.
+    size_t jit_threshold; // Call and loop count before a function is compiled to native code; 0 to disable.
+    size_t trace_threshold; // Iterations before a loop is traced and compiled to native code; 0 to disable.
+    int opt_level; // Compiler optimization level.
+    size_t gc_slice_budget; // Objects marked in an incremental GC slice; 0 to mark in one pause.
+    bool gc_concurrent; // Mark old objects on a helper thread during incremental marking.
+    size_t gc_threads; // Threads that run a full GC, including the mutator thread.
     char *default_paths; // Default module paths.
 };
 
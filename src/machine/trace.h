@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "jit.h"
+
+/// Traces of hot loops in a function, keyed by loop head.
+struct ow_trace_table;
+
+#if OW_JIT_AVAILABLE
+
+/// Count an iteration of the loop whose head is at bytecode offset `head` of the
+/// running function (`ctx->arg_list[-1]`). Record and compile a trace of the loop
+/// once it has run `threshold` times. If a trace is available and the frame matches
+/// the types it was recorded with, run it and return true; then the interpreter
+/// shall continue from `ctx->ip_offset` with stack top `ctx->sp`.
+bool ow_trace_run(struct ow_jit_context *ctx, size_t head, size_t threshold);
+/// Delete a trace table.
+void ow_trace_table_del(struct ow_trace_table *table);
+
+#endif // OW_JIT_AVAILABLE
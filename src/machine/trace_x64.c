@@ -0,0 +1,1206 @@
+#include "trace.h"
+
+#if OW_JIT_AVAILABLE
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <sys/mman.h> // munmap()
+
+#include "globals.h"
+#include "jit_x64_asm.h"
+#include "machine.h"
+#include <bytecode/opcode.h>
+#include <bytecode/operand.h>
+#include <objects/classes.h>
+#include <objects/floatobj.h>
+#include <objects/funcobj.h>
+#include <objects/object.h>
+#include <objects/smallint.h>
+#include <utilities/attributes.h>
+#include <utilities/debuglog.h>
+#include <utilities/memalloc.h>
+#include <utilities/unreachable.h>
+
+/*
+ * A trace is the path that one iteration of a hot loop takes. It is recorded by
+ * running the iteration on a shadow of the frame, starting at the loop head;
+ * nothing is written to the real frame. Only Int, Float and Bool operations on
+ * constants, local variables and arguments are recorded. Anything else (calls,
+ * globals, objects, inner loops, ...) aborts recording, and the loop is left to
+ * the interpreter and the baseline JIT compiler.
+ *
+ * The recorded instructions become a linear IR, where each instruction defines
+ * a value and constant operations are folded. Values are unboxed: an Int is
+ * stored doubled (a small int without the tag), a Float as a double, and a Bool
+ * as 0 or 1. Each value has an 8-byte slot in a spill area (base in rbx).
+ *
+ * Guards check what the recorded iteration depends on: branch directions, no
+ * integer overflow and no division by zero or -1. A failing guard leaves native
+ * code through an exit, whose snapshot tells how to rebuild the frame (boxing the
+ * values) and where the interpreter shall continue. Types of variables are
+ * checked before entering native code. If no variable changes its type in an
+ * iteration, native code loops by itself; otherwise it exits at loop head.
+ */
+
+#define TRACE_MAX_LENGTH 500 ///< Max number of instructions to record.
+#define TRACE_MAX_VALUES 500
+#define TRACE_MAX_VARS   32
+#define TRACE_MAX_STACK  32
+#define TRACE_MAX_EXITS  64
+#define TRACE_MAX_ABORTS 3 ///< Times that recording may fail before giving up a loop.
+#define TRACE_TABLE_INIT_SIZE 4 ///< Initial number of buckets in a trace table.
+
+#define TRACE_NO_REF UINT32_MAX
+
+#define SLOT(REF) ((int32_t)(REF) * 8)
+
+enum trace_type {
+    TRACE_INT,
+    TRACE_FLT,
+    TRACE_BOOL,
+};
+
+enum trace_op {
+    IR_CONST, // Constant.
+    IR_HOME, // Value of a variable at loop head.
+    IR_ADD, IR_SUB, IR_MUL, IR_DIV, IR_REM, IR_AND, IR_OR, IR_XOR,
+    IR_FADD, IR_FSUB, IR_FMUL, IR_FDIV,
+    IR_I2F, // Int to Float.
+    IR_CMP, IR_FCMP, // Comparison of Ints or Floats.
+    IR_GUARD, // Exit if value `a` is not the expected one.
+};
+
+/// IR instruction. Its index is the reference to the value it defines.
+struct trace_ins {
+    uint8_t op; // enum trace_op
+    uint8_t type; // enum trace_type
+    uint8_t cmp; // Opcode for IR_CMP and IR_FCMP; expected value for IR_GUARD.
+    uint32_t a, b; // Operands.
+    uint32_t exit; // Exit for guards and checked operations, or TRACE_NO_REF.
+};
+
+/// Unboxed value during recording.
+union trace_value {
+    int64_t i; // Int or Bool
+    double f; // Float
+};
+
+/// A local variable or argument used in the trace.
+struct trace_var {
+    int32_t offset; // Slot `fp[offset]`.
+    bool live_in; // Read before written; loaded when entering the trace.
+    uint32_t home; // IR_HOME value, or TRACE_NO_REF.
+    uint32_t current; // Current value while recording; value at loop end after recording.
+};
+
+/// Snapshot of the frame for an exit.
+struct trace_exit {
+    size_t resume; // Bytecode offset to continue from.
+    uint32_t stack_begin, stack_count; // Values pushed since loop head, in `stack_refs`.
+    uint32_t var_begin, var_count; // Variables assigned in the iteration, in `var_refs`.
+};
+
+struct trace_var_ref {
+    uint32_t var; // Index of variable.
+    uint32_t ref; // Value.
+};
+
+/// Compiled trace.
+struct trace {
+    void *memory; // Executable memory.
+    size_t memory_size;
+    ptrdiff_t args_offset; // `arg_list - fp`
+    size_t stack_depth; // `sp - fp + 1` at loop head.
+    size_t misses; // Times that the frame does not match when entering.
+    int64_t *slots; // Spill area: values, temporaries, and the loop flag.
+    size_t loop_flag; // Index of the slot that is set after native code has looped.
+    struct trace_ins *ins;
+    struct trace_var *vars;
+    size_t var_count;
+    struct trace_exit *exits;
+    uint32_t *stack_refs;
+    struct trace_var_ref *var_refs;
+};
+
+/// Hash table of loops, keyed by loop head, with linear probing.
+struct ow_trace_table {
+    size_t count; // Number of loops.
+    size_t mask; // Number of buckets minus 1. The number of buckets is a power of 2.
+    struct ow_trace_table_entry {
+        size_t head; // Bytecode offset of loop head, or SIZE_MAX if the bucket is empty.
+        size_t counter; // Iterations since last recording, or SIZE_MAX if given up.
+        unsigned int aborts;
+        struct trace *trace; // Optional.
+    } entries[];
+};
+
+/* ----- Recorder ----------------------------------------------------------- */
+
+struct trace_recorder {
+    struct ow_machine *machine;
+    struct ow_func_obj *func;
+    struct ow_object **fp;
+    ptrdiff_t args_offset;
+    size_t stack_depth;
+    size_t head;
+    size_t pc; // Offset of current instruction.
+    bool failed;
+    bool closed; // Whether the loop has jumped back to its head.
+    size_t ins_count;
+    struct trace_ins ins[TRACE_MAX_VALUES];
+    union trace_value values[TRACE_MAX_VALUES]; // Values in the recorded iteration.
+    size_t var_count;
+    struct trace_var vars[TRACE_MAX_VARS];
+    size_t stack_size;
+    uint32_t stack[TRACE_MAX_STACK]; // Values pushed since loop head.
+    size_t exit_count;
+    struct trace_exit exits[TRACE_MAX_EXITS];
+    size_t stack_ref_count;
+    uint32_t stack_refs[TRACE_MAX_EXITS * TRACE_MAX_STACK];
+    size_t var_ref_count;
+    struct trace_var_ref var_refs[TRACE_MAX_EXITS * TRACE_MAX_VARS];
+};
+
+/// Get type and unboxed value of an object. Return false if it is not supported.
+static bool trace_unbox(
+    struct ow_machine *om, struct ow_object *obj,
+    enum trace_type *type, union trace_value *value
+) {
+    if (ow_smallint_check(obj)) {
+        *type = TRACE_INT, value->i = ow_smallint_from_ptr(obj);
+        return true;
+    }
+    if (ow_smallfloat_check(obj)) {
+        *type = TRACE_FLT, value->f = ow_smallfloat_from_ptr(obj);
+        return true;
+    }
+    if (obj == om->globals->value_true || obj == om->globals->value_false) {
+        *type = TRACE_BOOL, value->i = obj == om->globals->value_true;
+        return true;
+    }
+    if (ow_object_class(obj) == om->builtin_classes->float_) {
+        *type = TRACE_FLT;
+        value->f = ow_float_obj_value(ow_object_cast(obj, struct ow_float_obj));
+        return true;
+    }
+    return false;
+}
+
+/// Convert an unboxed value to slot content.
+static int64_t trace_slot_bits(enum trace_type type, union trace_value value) {
+    if (type == TRACE_FLT) {
+        int64_t bits;
+        memcpy(&bits, &value.f, sizeof bits);
+        return bits;
+    }
+    return type == TRACE_INT ? value.i * 2 : value.i;
+}
+
+static uint32_t rec_emit(
+    struct trace_recorder *r, enum trace_op op, enum trace_type type,
+    uint32_t a, uint32_t b, union trace_value value
+) {
+    if (ow_unlikely(r->ins_count >= TRACE_MAX_VALUES)) {
+        r->failed = true;
+        return 0;
+    }
+    const uint32_t ref = (uint32_t)r->ins_count++;
+    r->ins[ref] = (struct trace_ins){
+        .op = (uint8_t)op, .type = (uint8_t)type, .cmp = 0,
+        .a = a, .b = b, .exit = TRACE_NO_REF,
+    };
+    r->values[ref] = value;
+    return ref;
+}
+
+static uint32_t rec_const_int(struct trace_recorder *r, int64_t v) {
+    return rec_emit(r, IR_CONST, TRACE_INT, 0, 0, (union trace_value){.i = v});
+}
+
+static uint32_t rec_const_flt(struct trace_recorder *r, double v) {
+    return rec_emit(r, IR_CONST, TRACE_FLT, 0, 0, (union trace_value){.f = v});
+}
+
+static uint32_t rec_const_bool(struct trace_recorder *r, bool v) {
+    return rec_emit(r, IR_CONST, TRACE_BOOL, 0, 0, (union trace_value){.i = v});
+}
+
+static bool rec_is_const(const struct trace_recorder *r, uint32_t ref) {
+    return r->ins[ref].op == IR_CONST;
+}
+
+static void rec_push(struct trace_recorder *r, uint32_t ref) {
+    if (ow_unlikely(r->stack_size >= TRACE_MAX_STACK)) {
+        r->failed = true;
+        return;
+    }
+    r->stack[r->stack_size++] = ref;
+}
+
+/// Get the n-th value from stack top (0 for the top). Fail if it was there before loop head.
+static uint32_t rec_peek(struct trace_recorder *r, size_t n) {
+    if (ow_unlikely(n >= r->stack_size)) {
+        r->failed = true;
+        return 0;
+    }
+    return r->stack[r->stack_size - 1 - n];
+}
+
+static uint32_t rec_pop(struct trace_recorder *r) {
+    const uint32_t ref = rec_peek(r, 0);
+    if (ow_likely(!r->failed))
+        r->stack_size--;
+    return ref;
+}
+
+/// Take a snapshot for an exit that continues at `resume`. Return the exit index.
+static uint32_t rec_exit(struct trace_recorder *r, size_t resume) {
+    if (ow_unlikely(r->exit_count >= TRACE_MAX_EXITS)) {
+        r->failed = true;
+        return 0;
+    }
+    struct trace_exit *const e = &r->exits[r->exit_count];
+    e->resume = resume;
+    e->stack_begin = (uint32_t)r->stack_ref_count;
+    e->stack_count = (uint32_t)r->stack_size;
+    memcpy(r->stack_refs + r->stack_ref_count, r->stack, r->stack_size * sizeof(uint32_t));
+    r->stack_ref_count += r->stack_size;
+    e->var_begin = (uint32_t)r->var_ref_count;
+    for (size_t i = 0; i < r->var_count; i++) {
+        const struct trace_var *const v = &r->vars[i];
+        if (v->current == TRACE_NO_REF || v->current == v->home)
+            continue;
+        r->var_refs[r->var_ref_count++] = (struct trace_var_ref){(uint32_t)i, v->current};
+    }
+    e->var_count = (uint32_t)(r->var_ref_count - e->var_begin);
+    return (uint32_t)r->exit_count++;
+}
+
+static struct trace_var *rec_var(struct trace_recorder *r, int32_t offset) {
+    for (size_t i = 0; i < r->var_count; i++) {
+        if (r->vars[i].offset == offset)
+            return &r->vars[i];
+    }
+    if (ow_unlikely(r->var_count >= TRACE_MAX_VARS)) {
+        r->failed = true;
+        return NULL;
+    }
+    struct trace_var *const v = &r->vars[r->var_count++];
+    *v = (struct trace_var){offset, false, TRACE_NO_REF, TRACE_NO_REF};
+    return v;
+}
+
+static uint32_t rec_load_var(struct trace_recorder *r, int32_t offset) {
+    struct trace_var *const v = rec_var(r, offset);
+    if (ow_unlikely(!v))
+        return 0;
+    if (v->current == TRACE_NO_REF) {
+        // Not assigned in the iteration: take the value from the frame.
+        enum trace_type type;
+        union trace_value value;
+        if (!trace_unbox(r->machine, r->fp[offset], &type, &value)) {
+            r->failed = true;
+            return 0;
+        }
+        v->live_in = true;
+        v->home = rec_emit(r, IR_HOME, type, 0, 0, value);
+        v->current = v->home;
+    }
+    return v->current;
+}
+
+static void rec_store_var(struct trace_recorder *r, int32_t offset, uint32_t ref) {
+    struct trace_var *const v = rec_var(r, offset);
+    if (ow_likely(v))
+        v->current = ref;
+}
+
+/// Convert a value to Float.
+static uint32_t rec_to_float(struct trace_recorder *r, uint32_t ref) {
+    if (r->ins[ref].type == TRACE_FLT)
+        return ref;
+    assert(r->ins[ref].type == TRACE_INT);
+    const double v = (double)r->values[ref].i;
+    if (rec_is_const(r, ref))
+        return rec_const_flt(r, v);
+    return rec_emit(r, IR_I2F, TRACE_FLT, ref, 0, (union trace_value){.f = v});
+}
+
+/// Record a binary operator. The operands shall still be on the stack, so that an
+/// exit can continue from the current instruction.
+static uint32_t rec_bin_op(
+    struct trace_recorder *r, enum ow_opcode opcode, uint32_t a, uint32_t b
+) {
+    const enum trace_type a_type = r->ins[a].type, b_type = r->ins[b].type;
+    if (a_type == TRACE_BOOL || b_type == TRACE_BOOL) {
+        r->failed = true;
+        return 0;
+    }
+
+    if (a_type == TRACE_INT && b_type == TRACE_INT) {
+        const int64_t x = r->values[a].i, y = r->values[b].i;
+        int64_t res;
+        enum trace_op op;
+        bool overflow = false, checked = true;
+        switch (opcode) {
+        case OW_OPC_Add: op = IR_ADD, overflow = __builtin_add_overflow(x, y, &res); break;
+        case OW_OPC_Sub: op = IR_SUB, overflow = __builtin_sub_overflow(x, y, &res); break;
+        case OW_OPC_Mul: op = IR_MUL, overflow = __builtin_mul_overflow(x, y, &res); break;
+        case OW_OPC_Div:
+        case OW_OPC_Rem:
+            if (y == 0 || y == -1) {
+                r->failed = true;
+                return 0;
+            }
+            op = opcode == OW_OPC_Div ? IR_DIV : IR_REM;
+            res = opcode == OW_OPC_Div ? x / y : x % y;
+            break;
+        case OW_OPC_And: op = IR_AND, checked = false, res = x & y; break;
+        case OW_OPC_Or : op = IR_OR , checked = false, res = x | y; break;
+        case OW_OPC_Xor: op = IR_XOR, checked = false, res = x ^ y; break;
+        default:
+            r->failed = true;
+            return 0;
+        }
+        // A result that is not a small int makes an Int object; not supported.
+        if (overflow || res < OW_SMALLINT_MIN || res > OW_SMALLINT_MAX) {
+            r->failed = true;
+            return 0;
+        }
+        if (rec_is_const(r, a) && rec_is_const(r, b))
+            return rec_const_int(r, res);
+        const uint32_t exit = checked ? rec_exit(r, r->pc) : TRACE_NO_REF;
+        const uint32_t ref = rec_emit(r, op, TRACE_INT, a, b, (union trace_value){.i = res});
+        r->ins[ref].exit = exit;
+        return ref;
+    }
+
+    const uint32_t fa = rec_to_float(r, a), fb = rec_to_float(r, b);
+    const double x = r->values[fa].f, y = r->values[fb].f;
+    double res;
+    enum trace_op op;
+    switch (opcode) {
+    case OW_OPC_Add: op = IR_FADD, res = x + y; break;
+    case OW_OPC_Sub: op = IR_FSUB, res = x - y; break;
+    case OW_OPC_Mul: op = IR_FMUL, res = x * y; break;
+    case OW_OPC_Div: op = IR_FDIV, res = x / y; break;
+    default:
+        r->failed = true;
+        return 0;
+    }
+    if (rec_is_const(r, fa) && rec_is_const(r, fb))
+        return rec_const_flt(r, res);
+    return rec_emit(r, op, TRACE_FLT, fa, fb, (union trace_value){.f = res});
+}
+
+/// Record a comparison operator.
+static uint32_t rec_cmp_op(
+    struct trace_recorder *r, enum ow_opcode opcode, uint32_t a, uint32_t b
+) {
+    const enum trace_type a_type = r->ins[a].type, b_type = r->ins[b].type;
+    if (a_type == TRACE_BOOL || b_type == TRACE_BOOL) {
+        r->failed = true;
+        return 0;
+    }
+    enum trace_op op;
+    int res;
+    if (a_type == TRACE_INT && b_type == TRACE_INT) {
+        op = IR_CMP;
+        const int64_t x = r->values[a].i, y = r->values[b].i;
+        res = x == y ? 0 : x < y ? -1 : 1;
+    } else {
+        op = IR_FCMP;
+        a = rec_to_float(r, a), b = rec_to_float(r, b);
+        const double x = r->values[a].f, y = r->values[b].f;
+        res = x < y ? -1 : x > y ? 1 : x == y ? 0 : 2 /* unordered */;
+    }
+    bool v;
+    switch (opcode) {
+    case OW_OPC_CmpLt: v = res == -1; break;
+    case OW_OPC_CmpLe: v = res == -1 || res == 0; break;
+    case OW_OPC_CmpGt: v = res == 1; break;
+    case OW_OPC_CmpGe: v = res == 1 || res == 0; break;
+    case OW_OPC_CmpEq: v = res == 0; break;
+    case OW_OPC_CmpNe: v = res != 0; break;
+    default: ow_unreachable();
+    }
+    if (rec_is_const(r, a) && rec_is_const(r, b))
+        return rec_const_bool(r, v);
+    const uint32_t ref = rec_emit(r, op, TRACE_BOOL, a, b, (union trace_value){.i = v});
+    r->ins[ref].cmp = (uint8_t)opcode;
+    return ref;
+}
+
+/// Record a conditional jump. Return offset of the next instruction to record.
+static size_t rec_cond_jmp(
+    struct trace_recorder *r, bool jump_when, ptrdiff_t offset, size_t next
+) {
+    const uint32_t cond = rec_pop(r);
+    if (r->failed || r->ins[cond].type != TRACE_BOOL) {
+        r->failed = true;
+        return next;
+    }
+    const size_t target = (size_t)((ptrdiff_t)r->pc + offset);
+    const bool value = r->values[cond].i != 0;
+    const bool taken = value == jump_when;
+    if (!rec_is_const(r, cond)) {
+        const uint32_t exit = rec_exit(r, taken ? next : target);
+        const uint32_t guard = rec_emit(r, IR_GUARD, TRACE_BOOL, cond, 0, r->values[cond]);
+        r->ins[guard].cmp = value;
+        r->ins[guard].exit = exit;
+    }
+    if (!taken)
+        return next;
+    if (offset < 0) {
+        if (target == r->head)
+            r->closed = true;
+        else
+            r->failed = true; // An inner loop has its own trace.
+    }
+    return target;
+}
+
+/// Record an instruction. Return offset of the next instruction to record.
+static size_t rec_instruction(
+    struct trace_recorder *r, enum ow_opcode opcode, int operand, size_t next
+) {
+    uint32_t a, b;
+
+    switch (opcode) {
+    case OW_OPC_Nop:
+        break;
+
+    case OW_OPC_Swap:
+        a = rec_pop(r), b = rec_pop(r);
+        rec_push(r, a), rec_push(r, b);
+        break;
+
+    case OW_OPC_Drop:
+        rec_pop(r);
+        break;
+
+    case OW_OPC_DropN:
+        for (int i = 0; i < operand; i++)
+            rec_pop(r);
+        break;
+
+    case OW_OPC_Dup:
+        rec_push(r, rec_peek(r, 0));
+        break;
+
+    case OW_OPC_LdBool:
+        rec_push(r, rec_const_bool(r, operand != 0));
+        break;
+
+    case OW_OPC_LdInt:
+    case OW_OPC_LdIntW:
+        rec_push(r, rec_const_int(r, operand));
+        break;
+
+    case OW_OPC_LdFlt:
+        rec_push(r, rec_const_flt(r, (double)operand));
+        break;
+
+    case OW_OPC_LdCnst:
+    case OW_OPC_LdCnstW: {
+        struct ow_object *const obj = ow_func_obj_get_constant(r->func, (size_t)operand);
+        enum trace_type type;
+        union trace_value value;
+        if (!obj || !trace_unbox(r->machine, obj, &type, &value)) {
+            r->failed = true;
+            break;
+        }
+        rec_push(r, rec_emit(r, IR_CONST, type, 0, 0, value));
+        break;
+    }
+
+    case OW_OPC_LdArg:
+    case OW_OPC_StArg:
+        if (operand >= -r->args_offset) {
+            r->failed = true;
+            break;
+        }
+        if (opcode == OW_OPC_LdArg)
+            rec_push(r, rec_load_var(r, (int32_t)(r->args_offset + operand)));
+        else
+            rec_store_var(r, (int32_t)(r->args_offset + operand), rec_pop(r));
+        break;
+
+    case OW_OPC_LdLoc:
+    case OW_OPC_LdLocW:
+    case OW_OPC_StLoc:
+    case OW_OPC_StLocW:
+        // Slots above loop head stack top are not variables.
+        if ((size_t)operand >= r->stack_depth) {
+            r->failed = true;
+            break;
+        }
+        if (opcode == OW_OPC_LdLoc || opcode == OW_OPC_LdLocW)
+            rec_push(r, rec_load_var(r, operand));
+        else
+            rec_store_var(r, operand, rec_pop(r));
+        break;
+
+    case OW_OPC_Add:
+    case OW_OPC_Sub:
+    case OW_OPC_Mul:
+    case OW_OPC_Div:
+    case OW_OPC_Rem:
+    case OW_OPC_And:
+    case OW_OPC_Or:
+    case OW_OPC_Xor:
+        a = rec_peek(r, 1), b = rec_peek(r, 0);
+        if (r->failed)
+            break;
+        a = rec_bin_op(r, opcode, a, b);
+        r->stack_size -= 2;
+        rec_push(r, a);
+        break;
+
+    case OW_OPC_Neg:
+        a = rec_peek(r, 0);
+        if (r->failed)
+            break;
+        if (r->ins[a].type == TRACE_INT)
+            a = rec_bin_op(r, OW_OPC_Sub, rec_const_int(r, 0), a);
+        else
+            a = rec_bin_op(r, OW_OPC_Mul, a, rec_const_flt(r, -1.0));
+        r->stack_size -= 1;
+        rec_push(r, a);
+        break;
+
+    case OW_OPC_CmpLt:
+    case OW_OPC_CmpLe:
+    case OW_OPC_CmpGt:
+    case OW_OPC_CmpGe:
+    case OW_OPC_CmpEq:
+    case OW_OPC_CmpNe:
+        b = rec_pop(r), a = rec_pop(r);
+        if (r->failed)
+            break;
+        rec_push(r, rec_cmp_op(r, opcode, a, b));
+        break;
+
+    case OW_OPC_Jmp:
+    case OW_OPC_JmpW:
+        if (operand >= 0)
+            return (size_t)((ptrdiff_t)r->pc + operand);
+        if ((size_t)((ptrdiff_t)r->pc + operand) == r->head)
+            r->closed = true;
+        else
+            r->failed = true; // An inner loop has its own trace.
+        break;
+
+    case OW_OPC_JmpWhen:
+    case OW_OPC_JmpWhenW:
+        return rec_cond_jmp(r, true, operand, next);
+
+    case OW_OPC_JmpUnls:
+    case OW_OPC_JmpUnlsW:
+        return rec_cond_jmp(r, false, operand, next);
+
+    default:
+        r->failed = true;
+        break;
+    }
+
+    return next;
+}
+
+/// Record an iteration from loop head. Return false if not supported.
+static bool rec_iteration(struct trace_recorder *r) {
+    const unsigned char *const code = r->func->code;
+    const size_t code_size = r->func->code_size;
+    size_t pc = r->head;
+    for (size_t n = 0; !r->failed && !r->closed; n++) {
+        if (n >= TRACE_MAX_LENGTH || pc >= code_size)
+            return false;
+        const enum ow_opcode opcode = ow_opcode_generic((enum ow_opcode)code[pc]);
+        if (!ow_opcode_name(opcode))
+            return false;
+        const enum ow_operand_type operand_type = ow_operand_type(opcode);
+        const size_t next = pc + 1 + ow_operand_type_width(operand_type);
+        if (next > code_size)
+            return false;
+        r->pc = pc;
+        pc = rec_instruction(r, opcode, ow_operand_read(code + pc + 1, operand_type), next);
+    }
+    if (r->failed)
+        return false;
+
+    // Back at loop head. The stack shall be as it was.
+    if (r->stack_size)
+        return false;
+    for (size_t i = 0; i < r->var_count; i++) {
+        struct trace_var *const v = &r->vars[i];
+        if (v->live_in)
+            continue;
+        // Value of an assigned variable at loop head is the one at loop end.
+        v->home = rec_emit(r, IR_HOME, r->ins[v->current].type, 0, 0, r->values[v->current]);
+    }
+    return !r->failed;
+}
+
+/// Whether native code can loop by itself: variable types at loop end are the
+/// same as at loop head.
+static bool rec_type_stable(const struct trace_recorder *r) {
+    for (size_t i = 0; i < r->var_count; i++) {
+        const struct trace_var *const v = &r->vars[i];
+        if (r->ins[v->current].type != r->ins[v->home].type)
+            return false;
+    }
+    return true;
+}
+
+/* ----- Compiler ----------------------------------------------------------- */
+
+struct trace_compiler {
+    struct jit_asm as;
+    const struct trace_recorder *r;
+    size_t temp_base; // Slot of the first temporary.
+    size_t loop_flag; // Slot of the loop flag.
+    uint32_t flags_ref; // Value whose comparison is in CPU flags, or TRACE_NO_REF.
+    enum jit_cond flags_cc; // Condition that the value is true.
+    size_t jump_count;
+    struct trace_exit_jump {
+        size_t pos; // Position of the rel32 field.
+        uint32_t exit;
+    } *jumps;
+};
+
+static void gen_exit_jcc(struct trace_compiler *c, enum jit_cond cc, uint32_t exit) {
+    const size_t pos = emit_jcc(&c->as, cc);
+    c->jumps[c->jump_count++] = (struct trace_exit_jump){pos, exit};
+}
+
+static void gen_exit_jmp(struct trace_compiler *c, uint32_t exit) {
+    const size_t pos = emit_jmp(&c->as);
+    c->jumps[c->jump_count++] = (struct trace_exit_jump){pos, exit};
+}
+
+/// `movsd xmm, [rbx + slot]`
+static void gen_load_xmm(struct trace_compiler *c, int xmm, uint32_t ref) {
+    emit_sse_mem(&c->as, 0xf2, false, 0x10, xmm, RBX, SLOT(ref));
+}
+
+/// `movsd [rbx + slot], xmm`
+static void gen_store_xmm(struct trace_compiler *c, uint32_t ref, int xmm) {
+    emit_sse_mem(&c->as, 0xf2, false, 0x11, xmm, RBX, SLOT(ref));
+}
+
+static void gen_int_div(struct trace_compiler *c, const struct trace_ins *ins, uint32_t ref) {
+    emit_load(&c->as, RCX, RBX, SLOT(ins->b));
+    emit_alu(&c->as, ALU_OR, RCX, RCX);
+    gen_exit_jcc(c, CC_E, ins->exit);
+    emit_cmp_imm(&c->as, RCX, -2); // -1 doubled
+    gen_exit_jcc(c, CC_E, ins->exit);
+    emit_load(&c->as, RAX, RBX, SLOT(ins->a));
+    emit_sar_1(&c->as, RAX);
+    emit_sar_1(&c->as, RCX);
+    emit_u8(&c->as, 0x48), emit_u8(&c->as, 0x99); // cqo
+    emit_u8(&c->as, 0x48), emit_u8(&c->as, 0xf7), emit_u8(&c->as, 0xf9); // idiv rcx
+    const int res = ins->op == IR_DIV ? RAX : RDX;
+    emit_alu(&c->as, ALU_ADD, res, res);
+    emit_store(&c->as, RBX, SLOT(ref), res);
+}
+
+static enum jit_cond cmp_cond(enum ow_opcode opcode) {
+    switch (opcode) {
+    case OW_OPC_CmpLt: return CC_L;
+    case OW_OPC_CmpLe: return CC_LE;
+    case OW_OPC_CmpGt: return CC_G;
+    case OW_OPC_CmpGe: return CC_GE;
+    case OW_OPC_CmpEq: return CC_E;
+    case OW_OPC_CmpNe: return CC_NE;
+    default: ow_unreachable();
+    }
+}
+
+static void gen_float_cmp(struct trace_compiler *c, const struct trace_ins *ins, uint32_t ref) {
+    const enum ow_opcode opcode = (enum ow_opcode)ins->cmp;
+    gen_load_xmm(c, 0, ins->a);
+    gen_load_xmm(c, 1, ins->b);
+    // Unordered operands set ZF, PF and CF, which makes `a` and `ae` false.
+    if (opcode == OW_OPC_CmpLt || opcode == OW_OPC_CmpLe)
+        emit_sse_reg(&c->as, 0x66, false, 0x2e, 1, 0); // ucomisd xmm1, xmm0
+    else
+        emit_sse_reg(&c->as, 0x66, false, 0x2e, 0, 1); // ucomisd xmm0, xmm1
+    switch (opcode) {
+    case OW_OPC_CmpLt:
+    case OW_OPC_CmpGt:
+        c->flags_cc = CC_A;
+        break;
+    case OW_OPC_CmpLe:
+    case OW_OPC_CmpGe:
+        c->flags_cc = CC_AE;
+        break;
+    case OW_OPC_CmpEq:
+        emit_setcc(&c->as, CC_E, RAX);
+        emit_setcc(&c->as, CC_NP, RCX);
+        emit_alu(&c->as, ALU_AND, RAX, RCX);
+        emit_store(&c->as, RBX, SLOT(ref), RAX);
+        return;
+    case OW_OPC_CmpNe:
+        emit_setcc(&c->as, CC_NE, RAX);
+        emit_setcc(&c->as, CC_P, RCX);
+        emit_alu(&c->as, ALU_OR, RAX, RCX);
+        emit_store(&c->as, RBX, SLOT(ref), RAX);
+        return;
+    default:
+        ow_unreachable();
+    }
+    emit_setcc(&c->as, c->flags_cc, RAX);
+    emit_store(&c->as, RBX, SLOT(ref), RAX);
+    c->flags_ref = ref;
+}
+
+static void gen_ins(struct trace_compiler *c, uint32_t ref) {
+    const struct trace_ins *const ins = &c->r->ins[ref];
+    const uint32_t flags_ref = c->flags_ref;
+    if (ins->op != IR_CONST && ins->op != IR_HOME)
+        c->flags_ref = TRACE_NO_REF;
+
+    switch ((enum trace_op)ins->op) {
+    case IR_CONST:
+    case IR_HOME:
+        break;
+
+    case IR_ADD:
+    case IR_SUB:
+        emit_load(&c->as, RAX, RBX, SLOT(ins->a));
+        emit_alu_mem(&c->as, ins->op == IR_ADD ? ALU_ADD : ALU_SUB, RAX, RBX, SLOT(ins->b));
+        gen_exit_jcc(c, CC_O, ins->exit);
+        emit_store(&c->as, RBX, SLOT(ref), RAX);
+        break;
+
+    case IR_MUL:
+        emit_load(&c->as, RAX, RBX, SLOT(ins->a));
+        emit_load(&c->as, RCX, RBX, SLOT(ins->b));
+        emit_sar_1(&c->as, RCX);
+        emit_imul(&c->as, RAX, RCX);
+        gen_exit_jcc(c, CC_O, ins->exit);
+        emit_store(&c->as, RBX, SLOT(ref), RAX);
+        break;
+
+    case IR_DIV:
+    case IR_REM:
+        gen_int_div(c, ins, ref);
+        break;
+
+    case IR_AND:
+    case IR_OR:
+    case IR_XOR:
+        emit_load(&c->as, RAX, RBX, SLOT(ins->a));
+        emit_alu_mem(
+            &c->as, ins->op == IR_AND ? ALU_AND : ins->op == IR_OR ? ALU_OR : ALU_XOR,
+            RAX, RBX, SLOT(ins->b));
+        emit_store(&c->as, RBX, SLOT(ref), RAX);
+        break;
+
+    case IR_FADD:
+    case IR_FSUB:
+    case IR_FMUL:
+    case IR_FDIV: {
+        static const unsigned char sse_opcodes[] = {0x58, 0x5c, 0x59, 0x5e};
+        gen_load_xmm(c, 0, ins->a);
+        emit_sse_mem(
+            &c->as, 0xf2, false, sse_opcodes[ins->op - IR_FADD], 0, RBX, SLOT(ins->b));
+        gen_store_xmm(c, ref, 0);
+        break;
+    }
+
+    case IR_I2F:
+        emit_load(&c->as, RAX, RBX, SLOT(ins->a));
+        emit_sar_1(&c->as, RAX);
+        emit_sse_reg(&c->as, 0xf2, true, 0x2a, 0, RAX); // cvtsi2sd xmm0, rax
+        gen_store_xmm(c, ref, 0);
+        break;
+
+    case IR_CMP:
+        emit_load(&c->as, RAX, RBX, SLOT(ins->a));
+        emit_cmp_mem(&c->as, RAX, RBX, SLOT(ins->b));
+        c->flags_cc = cmp_cond((enum ow_opcode)ins->cmp);
+        emit_setcc(&c->as, c->flags_cc, RAX); // Flags are kept.
+        emit_store(&c->as, RBX, SLOT(ref), RAX);
+        c->flags_ref = ref;
+        break;
+
+    case IR_FCMP:
+        gen_float_cmp(c, ins, ref);
+        break;
+
+    case IR_GUARD:
+        if (ins->a == flags_ref) {
+            const enum jit_cond cc = c->flags_cc;
+            gen_exit_jcc(c, ins->cmp ? (enum jit_cond)(cc ^ 1) : cc, ins->exit);
+        } else {
+            emit_load(&c->as, RAX, RBX, SLOT(ins->a));
+            emit_alu(&c->as, ALU_OR, RAX, RAX);
+            gen_exit_jcc(c, ins->cmp ? CC_E : CC_NE, ins->exit);
+        }
+        break;
+
+    default:
+        ow_unreachable();
+    }
+}
+
+/// Copy values at loop end to variable homes.
+static void gen_loop_back(struct trace_compiler *c) {
+    const struct trace_recorder *const r = c->r;
+    // A home may be read as another variable's end value (e.g., swapping variables);
+    // then copy through temporaries.
+    bool direct = true;
+    for (size_t i = 0; i < r->var_count; i++) {
+        const struct trace_var *const v = &r->vars[i];
+        if (v->current != v->home && r->ins[v->current].op == IR_HOME)
+            direct = false;
+    }
+    for (size_t i = 0; i < r->var_count; i++) {
+        const struct trace_var *const v = &r->vars[i];
+        if (v->current == v->home)
+            continue;
+        emit_load(&c->as, RAX, RBX, SLOT(v->current));
+        emit_store(&c->as, RBX, SLOT(direct ? v->home : c->temp_base + i), RAX);
+    }
+    if (!direct) {
+        for (size_t i = 0; i < r->var_count; i++) {
+            const struct trace_var *const v = &r->vars[i];
+            if (v->current == v->home)
+                continue;
+            emit_load(&c->as, RAX, RBX, SLOT(c->temp_base + i));
+            emit_store(&c->as, RBX, SLOT(v->home), RAX);
+        }
+    }
+    emit_store_imm(&c->as, RBX, SLOT(c->loop_flag), 1);
+}
+
+/// Compile a recorded trace. Return NULL on failure.
+static struct trace *trace_compile(const struct trace_recorder *r, bool loops) {
+    struct trace_compiler c = {
+        .as = {NULL, 0, 0},
+        .r = r,
+        .temp_base = r->ins_count,
+        .loop_flag = r->ins_count + r->var_count,
+        .flags_ref = TRACE_NO_REF,
+        .jump_count = 0,
+    };
+    c.jumps = ow_malloc((r->ins_count * 2 + 1) * sizeof(struct trace_exit_jump)); // At most two for each.
+
+    // Prologue: `uint32_t (*)(int64_t *slots)`, returning exit index.
+    emit_u8(&c.as, 0x53); // push rbx
+    emit_alu(&c.as, ALU_MOV, RBX, RDI);
+    const size_t loop_pos = c.as.buf_size;
+    for (size_t i = 0; i < r->ins_count; i++)
+        gen_ins(&c, (uint32_t)i);
+    if (loops) {
+        gen_loop_back(&c);
+        patch_rel32(&c.as, emit_jmp(&c.as), loop_pos);
+    } else {
+        gen_exit_jmp(&c, (uint32_t)(r->exit_count - 1)); // Exit at loop head.
+    }
+    // Exits.
+    size_t *const exit_pos = ow_malloc(r->exit_count * sizeof(size_t));
+    for (size_t i = 0; i < r->exit_count; i++) {
+        exit_pos[i] = c.as.buf_size;
+        emit_u8(&c.as, 0xb8), emit_u32(&c.as, (uint32_t)i); // mov eax, i
+        if (i + 1 < r->exit_count)
+            emit_jmp(&c.as);
+    }
+    for (size_t i = 0; i + 1 < r->exit_count; i++)
+        patch_rel32_here(&c.as, exit_pos[i] + 6); // The rel32 after `mov eax, i`.
+    emit_u8(&c.as, 0x5b); // pop rbx
+    emit_u8(&c.as, 0xc3); // ret
+    for (size_t i = 0; i < c.jump_count; i++)
+        patch_rel32(&c.as, c.jumps[i].pos, exit_pos[c.jumps[i].exit]);
+    ow_free(exit_pos);
+    ow_free(c.jumps);
+
+    size_t memory_size;
+    void *const memory = jit_asm_install(&c.as, &memory_size);
+    ow_free(c.as.buf);
+    if (ow_unlikely(!memory))
+        return NULL;
+
+    struct trace *const t = ow_malloc(sizeof(struct trace));
+    t->memory = memory;
+    t->memory_size = memory_size;
+    t->args_offset = r->args_offset;
+    t->stack_depth = r->stack_depth;
+    t->misses = 0;
+    t->loop_flag = c.loop_flag;
+    t->slots = ow_malloc((c.loop_flag + 1) * sizeof(int64_t));
+    t->ins = ow_malloc(r->ins_count * sizeof(struct trace_ins));
+    memcpy(t->ins, r->ins, r->ins_count * sizeof(struct trace_ins));
+    for (size_t i = 0; i < r->ins_count; i++) {
+        if (r->ins[i].op == IR_CONST)
+            t->slots[i] = trace_slot_bits((enum trace_type)r->ins[i].type, r->values[i]);
+    }
+    t->var_count = r->var_count;
+    t->vars = ow_malloc(r->var_count * sizeof(struct trace_var));
+    memcpy(t->vars, r->vars, r->var_count * sizeof(struct trace_var));
+    t->exits = ow_malloc(r->exit_count * sizeof(struct trace_exit));
+    memcpy(t->exits, r->exits, r->exit_count * sizeof(struct trace_exit));
+    t->stack_refs = ow_malloc(r->stack_ref_count * sizeof(uint32_t));
+    memcpy(t->stack_refs, r->stack_refs, r->stack_ref_count * sizeof(uint32_t));
+    t->var_refs = ow_malloc(r->var_ref_count * sizeof(struct trace_var_ref));
+    memcpy(t->var_refs, r->var_refs, r->var_ref_count * sizeof(struct trace_var_ref));
+    return t;
+}
+
+static void trace_del(struct trace *t) {
+    munmap(t->memory, t->memory_size);
+    ow_free(t->slots);
+    ow_free(t->ins);
+    ow_free(t->vars);
+    ow_free(t->exits);
+    ow_free(t->stack_refs);
+    ow_free(t->var_refs);
+    ow_free(t);
+}
+
+/// Record and compile a trace for the loop at `head`. Return NULL on failure.
+static struct trace *trace_record(
+    struct ow_jit_context *ctx, struct ow_func_obj *func, size_t head
+) {
+    struct trace_recorder *const r = ow_malloc(sizeof(struct trace_recorder));
+    r->machine = ctx->machine;
+    r->func = func;
+    r->fp = ctx->fp;
+    r->args_offset = ctx->arg_list - ctx->fp;
+    r->stack_depth = (size_t)(ctx->sp - ctx->fp + 1);
+    r->head = head;
+    r->pc = head;
+    r->failed = false;
+    r->closed = false;
+    r->ins_count = 0;
+    r->var_count = 0;
+    r->stack_size = 0;
+    r->exit_count = 0;
+    r->stack_ref_count = 0;
+    r->var_ref_count = 0;
+
+    struct trace *t = NULL;
+    bool loops = false;
+    if (rec_iteration(r)) {
+        loops = rec_type_stable(r);
+        if (!loops)
+            rec_exit(r, head);
+        if (!r->failed)
+            t = trace_compile(r, loops);
+    }
+    if (t) {
+        ow_debuglog_print(
+            "jit", DBG, "traced loop at %zu in function %p: %zu values, %zu exits, %s",
+            head, (void *)func, r->ins_count, r->exit_count,
+            loops ? "looping" : "exiting at loop head");
+    } else {
+        ow_debuglog_print(
+            "jit", DBG, "tracing loop at %zu in function %p aborted at %zu (%s)",
+            head, (void *)func, r->pc,
+            ow_opcode_name(ow_opcode_generic((enum ow_opcode)func->code[r->pc])));
+    }
+    ow_free(r);
+    return t;
+}
+
+/* ----- Execution ---------------------------------------------------------- */
+
+/// Float that waits to be boxed.
+struct trace_float_box {
+    struct ow_object **slot;
+    double value;
+};
+
+/// Box a value and store it to `slot`. A Float that needs an object is left to `floats`.
+static void trace_box(
+    const struct trace *t, uint32_t ref, struct ow_machine_globals *globals,
+    struct ow_object **slot, struct trace_float_box *floats, size_t *float_count
+) {
+    const int64_t bits = t->slots[ref];
+    switch ((enum trace_type)t->ins[ref].type) {
+    case TRACE_INT:
+        *slot = ow_smallint_to_ptr(bits / 2);
+        break;
+    case TRACE_FLT: {
+        double value;
+        memcpy(&value, &bits, sizeof value);
+        struct ow_object *const ptr = ow_smallfloat_try_to_ptr(value);
+        if (ow_likely(ptr)) {
+            *slot = ptr;
+        } else {
+            *slot = globals->value_nil;
+            floats[(*float_count)++] = (struct trace_float_box){slot, value};
+        }
+        break;
+    }
+    case TRACE_BOOL:
+        *slot = bits ? globals->value_true : globals->value_false;
+        break;
+    default:
+        ow_unreachable();
+    }
+}
+
+/// Rebuild the frame from the snapshot of an exit.
+static void trace_restore(const struct trace *t, uint32_t exit, struct ow_jit_context *ctx) {
+    const struct trace_exit *const e = &t->exits[exit];
+    struct ow_object **const fp = ctx->fp;
+    const bool looped = t->slots[t->loop_flag] != 0;
+    struct trace_float_box floats[TRACE_MAX_VARS + TRACE_MAX_STACK];
+    size_t float_count = 0;
+    bool assigned[TRACE_MAX_VARS];
+
+    memset(assigned, 0, sizeof assigned);
+    for (uint32_t i = 0; i < e->var_count; i++) {
+        const struct trace_var_ref *const vr = &t->var_refs[e->var_begin + i];
+        trace_box(
+            t, vr->ref, ctx->globals, &fp[t->vars[vr->var].offset], floats, &float_count);
+        assigned[vr->var] = true;
+    }
+    if (looped) {
+        // The frame still has values from before the first iteration.
+        for (size_t i = 0; i < t->var_count; i++) {
+            if (assigned[i])
+                continue;
+            const struct trace_var *const v = &t->vars[i];
+            trace_box(t, v->home, ctx->globals, &fp[v->offset], floats, &float_count);
+        }
+    }
+    for (uint32_t i = 0; i < e->stack_count; i++) {
+        trace_box(
+            t, t->stack_refs[e->stack_begin + i], ctx->globals,
+            &fp[t->stack_depth + i], floats, &float_count);
+    }
+    ctx->sp = fp + t->stack_depth - 1 + e->stack_count;
+    ctx->ip_offset = e->resume;
+
+    // Allocating may trigger GC, which needs the stack to be complete.
+    ctx->machine->callstack.regs.sp = ctx->sp;
+    for (size_t i = 0; i < float_count; i++)
+        *floats[i].slot = ow_float_obj_or_smallfloat(ctx->machine, floats[i].value);
+}
+
+/// Run a trace if the frame matches. Return false if not run.
+static bool trace_enter(const struct trace *t, struct ow_jit_context *ctx) {
+    struct ow_object **const fp = ctx->fp;
+    if (ctx->arg_list - fp != t->args_offset ||
+            (size_t)(ctx->sp - fp + 1) != t->stack_depth)
+        return false;
+    for (size_t i = 0; i < t->var_count; i++) {
+        const struct trace_var *const v = &t->vars[i];
+        if (!v->live_in)
+            continue;
+        enum trace_type type;
+        union trace_value value;
+        if (!trace_unbox(ctx->machine, fp[v->offset], &type, &value) ||
+                type != (enum trace_type)t->ins[v->home].type)
+            return false;
+        t->slots[v->home] = trace_slot_bits(type, value);
+    }
+    t->slots[t->loop_flag] = 0;
+
+    uint32_t (*fn)(int64_t *);
+    static_assert(sizeof fn == sizeof t->memory, "");
+    memcpy(&fn, &t->memory, sizeof fn);
+    const uint32_t exit = fn(t->slots);
+    trace_restore(t, exit, ctx);
+    return true;
+}
+
+/// Create an empty trace table.
+static struct ow_trace_table *trace_table_new(size_t bucket_count) {
+    assert(bucket_count && !(bucket_count & (bucket_count - 1)));
+    struct ow_trace_table *const table = ow_malloc(
+        sizeof(struct ow_trace_table) + bucket_count * sizeof(struct ow_trace_table_entry));
+    table->count = 0;
+    table->mask = bucket_count - 1;
+    for (size_t i = 0; i < bucket_count; i++)
+        table->entries[i].head = SIZE_MAX;
+    return table;
+}
+
+/// Find the bucket of a loop, or the empty bucket where it shall be added.
+static struct ow_trace_table_entry *trace_table_bucket(
+    struct ow_trace_table *table, size_t head
+) {
+    for (size_t i = head & table->mask; ; i = (i + 1) & table->mask) {
+        struct ow_trace_table_entry *const entry = &table->entries[i];
+        if (entry->head == head || entry->head == SIZE_MAX)
+            return entry;
+    }
+}
+
+/// Find or add the entry of a loop. The entry is valid until another one is added.
+static struct ow_trace_table_entry *trace_table_entry(
+    struct ow_func_obj *func, size_t head
+) {
+    assert(head != SIZE_MAX);
+    struct ow_trace_table *table = func->trace_table;
+    if (ow_unlikely(!table))
+        func->trace_table = table = trace_table_new(TRACE_TABLE_INIT_SIZE);
+    struct ow_trace_table_entry *entry = trace_table_bucket(table, head);
+    if (ow_likely(entry->head == head))
+        return entry;
+
+    // Keep at least half of the buckets empty.
+    if ((table->count + 1) * 2 > table->mask + 1) {
+        struct ow_trace_table *const new_table = trace_table_new((table->mask + 1) * 2);
+        for (size_t i = 0; i <= table->mask; i++) {
+            if (table->entries[i].head != SIZE_MAX)
+                *trace_table_bucket(new_table, table->entries[i].head) = table->entries[i];
+        }
+        new_table->count = table->count;
+        ow_free(table);
+        func->trace_table = table = new_table;
+        entry = trace_table_bucket(table, head);
+    }
+    table->count++;
+    *entry = (struct ow_trace_table_entry){head, 0, 0, NULL};
+    return entry;
+}
+
+bool ow_trace_run(struct ow_jit_context *ctx, size_t head, size_t threshold) {
+    struct ow_func_obj *const func =
+        ow_object_cast(ctx->arg_list[-1], struct ow_func_obj);
+    struct ow_trace_table_entry *const entry = trace_table_entry(func, head);
+
+    struct trace *t = entry->trace;
+    if (ow_unlikely(!t)) {
+        if (entry->counter == SIZE_MAX || ++entry->counter < threshold)
+            return false;
+        entry->counter = 0;
+        t = trace_record(ctx, func, head);
+        if (!t) {
+            if (++entry->aborts >= TRACE_MAX_ABORTS)
+                entry->counter = SIZE_MAX;
+            return false;
+        }
+        entry->trace = t;
+    }
+
+    if (ow_likely(trace_enter(t, ctx)))
+        return true;
+    // Types have changed since recording. Record again if it keeps happening.
+    if (++t->misses >= threshold) {
+        trace_del(t);
+        entry->trace = NULL;
+        if (++entry->aborts >= TRACE_MAX_ABORTS)
+            entry->counter = SIZE_MAX;
+    }
+    return false;
+}
+
+void ow_trace_table_del(struct ow_trace_table *table) {
+    for (size_t i = 0; i <= table->mask; i++) {
+        if (table->entries[i].head != SIZE_MAX && table->entries[i].trace)
+            trace_del(table->entries[i].trace);
+    }
+    ow_free(table);
+}
+
+#endif // OW_JIT_AVAILABLE
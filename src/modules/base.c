@@ -1,22 +1,32 @@
 #include "modules_util.h"
 
 #include <inttypes.h>
+#include <math.h>
 #include <stdio.h>
 
 #include <machine/machine.h>
 #include <objects/classes.h>
 #include <objects/classobj.h>
+#include <objects/exceptionobj.h>
 #include <objects/floatobj.h>
 #include <objects/intobj.h>
 #include <objects/object.h>
+#include <objects/rangeobj.h>
 #include <objects/stringobj.h>
 #include <objects/symbolobj.h>
 
+static void print_float(FILE *fp, double val) {
+    // The sign of a NaN depends on how it was produced, so it is not printed.
+    fprintf(fp, "%f", isnan(val) ? fabs(val) : val);
+}
+
 static int func_print(struct ow_machine *om) {
     FILE *const fp = stdout;
     struct ow_object *const obj = om->callstack.regs.fp[-1];
     if (ow_smallint_check(obj)) {
         fprintf(fp, "%ji", (intmax_t)ow_smallint_from_ptr(obj));
+    } else if (ow_smallfloat_check(obj)) {
+        print_float(fp, ow_smallfloat_from_ptr(obj));
     } else {
         struct ow_class_obj *const obj_cls = ow_object_class(obj);
         if (obj_cls == om->builtin_classes->int_) {
@@ -26,7 +36,7 @@ static int func_print(struct ow_machine *om) {
         } else if (obj_cls == om->builtin_classes->float_) {
             struct ow_float_obj *const flt_o =
                 ow_object_cast(obj, struct ow_float_obj);
-            fprintf(fp, "%f", ow_float_obj_value(flt_o));
+            print_float(fp, ow_float_obj_value(flt_o));
         } else if (obj_cls == om->builtin_classes->string) {
             struct ow_string_obj *const str_o =
                 ow_object_cast(obj, struct ow_string_obj);
@@ -40,8 +50,47 @@ static int func_print(struct ow_machine *om) {
     return 0;
 }
 
+//# range(stop :: Int) :: Range
+//# range(start :: Int, stop :: Int) :: Range
+//# range(start :: Int, stop :: Int, step :: Int) :: Range
+//# Make a range of integers from `start` (default 0) to `stop` (excluded).
+static int func_range(struct ow_machine *om) {
+    struct ow_object **const args = om->callstack.frame_info_list.current->arg_list;
+    const size_t argc = (size_t)(om->callstack.regs.fp - args);
+    if (argc > 3) {
+        struct ow_exception_obj *const exc_o =
+            ow_exception_format(om, NULL, "too many arguments");
+        *++om->callstack.regs.sp = ow_object_from(exc_o);
+        return -1;
+    }
+
+    int64_t values[3] = {0, 0, 1};
+    for (size_t i = 0; i < argc; i++) {
+        struct ow_object *const arg = args[i];
+        if (!ow_smallint_check(arg)) {
+            struct ow_exception_obj *const exc_o = ow_exception_format(
+                om, NULL, "range argument %zu is not a small integer", i + 1);
+            *++om->callstack.regs.sp = ow_object_from(exc_o);
+            return -1;
+        }
+        values[argc == 1 ? 1 : i] = ow_smallint_from_ptr(arg);
+    }
+    if (!values[2]) {
+        struct ow_exception_obj *const exc_o =
+            ow_exception_format(om, NULL, "range step cannot be zero");
+        *++om->callstack.regs.sp = ow_object_from(exc_o);
+        return -1;
+    }
+
+    struct ow_range_obj *const range_o =
+        ow_range_obj_new(om, values[0], values[1], values[2]);
+    *++om->callstack.regs.sp = ow_object_from(range_o);
+    return 1;
+}
+
 static const struct ow_native_func_def functions[] = {
     {"print", func_print, 1, 0},
+    {"range", func_range, OW_NATIVE_FUNC_VARIADIC_ARGC(1), 0},
     {NULL, NULL, 0, 0},
 };
 
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <machine/globals.h>
+#include <machine/machine.h>
 #include <objects/natives.h>
+#include <objects/object.h>
+
+#include <config/definitions.h>
 
 #if !OW_EXPORT_MOD
 #    define OW_BIMOD_MODULE_ATTR
@@ -14,10 +19,36 @@
 
 #define OW_BIMOD_MODULE_DEF_NAME_PREFIX_STR "__ow_mod_"
 #define OW_BIMOD_MODULE_DEF_NAME_SUFFIX_STR "_def"
+#define OW_BIMOD_MODULE_ABI_NAME_SUFFIX_STR "_abi"
+
+/// Stamp of the runtime that a module is built for: the build stamp and sizes
+/// of structures that modules use directly.
+struct ow_native_module_abi {
+    char build[sizeof OW_BUILD_STAMP];
+    size_t layout[5];
+};
+
+/// Initializer of `struct ow_native_module_abi` for the current build.
+#define OW_BIMOD_MODULE_ABI_INIT \
+    { \
+        OW_BUILD_STAMP, \
+        { \
+            sizeof(struct ow_machine), sizeof(struct ow_machine_globals), \
+            sizeof(struct ow_object), sizeof(struct ow_native_module_def), \
+            sizeof(struct ow_native_func_def), \
+        }, \
+    } \
+// ^^^ OW_BIMOD_MODULE_ABI_INIT ^^^
 
 #define OW_BIMOD_MODULE_DEF_NAME(MODULE) \
     __ow_mod_##MODULE##_def
 
+#define OW_BIMOD_MODULE_ABI_NAME(MODULE) \
+    __ow_mod_##MODULE##_abi
+
 #define OW_BIMOD_MODULE_DEF(MODULE) \
     OW_BIMOD_MODULE_ATTR \
+    const struct ow_native_module_abi OW_BIMOD_MODULE_ABI_NAME(MODULE) = \
+        OW_BIMOD_MODULE_ABI_INIT; \
+    OW_BIMOD_MODULE_ATTR \
     const struct ow_native_module_def OW_BIMOD_MODULE_DEF_NAME(MODULE)
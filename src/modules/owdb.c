@@ -1,9 +1,18 @@
 #include "modules_util.h"
 
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
 #include <owiz.h>
+#include <bytecode/disassemble.h>
 #include <machine/machine.h>
+#include <objects/classes.h>
+#include <objects/exceptionobj.h>
+#include <objects/funcobj.h>
 #include <objects/objmem.h>
-
+#include <objects/stringobj.h>
+#include <utilities/memalloc.h>
 
 #include <config/options.h>
 
@@ -18,7 +27,54 @@ static int func_memory_usage(struct ow_machine *om) {
 
 #endif // OW_DEBUG_MEMORY
 
+struct disassemble_buffer {
+    char *data;
+    size_t size;
+    size_t capacity;
+};
+
+static int disassemble_walker(
+    void *_arg, size_t offset,
+    const unsigned char *instruction, size_t instruction_width,
+    enum ow_opcode opcode, int operand
+) {
+    ow_unused_var(offset), ow_unused_var(instruction), ow_unused_var(instruction_width);
+    struct disassemble_buffer *const buf = _arg;
+    char line[48];
+    const int n = operand == OW_BYTECODE_DISASSEMBLE_NO_OPERAND ?
+        snprintf(line, sizeof line, "%s\n", ow_opcode_name(opcode)) :
+        snprintf(line, sizeof line, "%s %i\n", ow_opcode_name(opcode), operand);
+    assert(n > 0 && (size_t)n < sizeof line);
+    if (buf->size + (size_t)n > buf->capacity) {
+        buf->capacity = (buf->size + (size_t)n) * 2;
+        buf->data = ow_realloc(buf->data, buf->capacity);
+    }
+    memcpy(buf->data + buf->size, line, (size_t)n);
+    buf->size += (size_t)n;
+    return 0;
+}
+
+//# disassemble(func :: Func) :: String
+//# Get the instructions of a function, one per line, with decimal operands.
+static int func_disassemble(struct ow_machine *om) {
+    struct ow_object *const obj = om->callstack.regs.fp[-1];
+    if (ow_smallval_check(obj) || ow_object_class(obj) != om->builtin_classes->func) {
+        struct ow_exception_obj *const exc_o =
+            ow_exception_format(om, NULL, "not a compiled function");
+        *++om->callstack.regs.sp = ow_object_from(exc_o);
+        return -1;
+    }
+    struct ow_func_obj *const func = ow_object_cast(obj, struct ow_func_obj);
+    struct disassemble_buffer buf = {NULL, 0, 0};
+    ow_bytecode_disassemble(func->code, 0, func->code_size, disassemble_walker, &buf);
+    *++om->callstack.regs.sp =
+        ow_object_from(ow_string_obj_new(om, buf.data ? buf.data : "", buf.size));
+    ow_free(buf.data);
+    return 1;
+}
+
 static const struct ow_native_func_def functions[] = {
+    {"disassemble", func_disassemble, 1, 0},
 #if OW_DEBUG_MEMORY
     {"memory_usage", func_memory_usage, 0, 0},
 #endif // OW_DEBUG_MEMORY
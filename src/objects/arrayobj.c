@@ -29,7 +29,9 @@ struct ow_array_obj *ow_array_obj_new(
     struct ow_machine *om, struct ow_object *elems[], size_t elem_count
 ) {
     struct ow_array_obj *const obj = ow_object_cast(
-        ow_objmem_allocate(om, om->builtin_classes->array),
+        ow_objmem_allocate_fast(
+            om, om->builtin_classes->array,
+            OW_OBJ_STRUCT_FIELD_COUNT(struct ow_array_obj)),
         struct ow_array_obj
     );
     ow_array_init(&obj->array, elem_count);
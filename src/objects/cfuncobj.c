@@ -28,7 +28,8 @@ struct ow_cfunc_obj *ow_cfunc_obj_new(
     obj->module = module;
     obj->name = name;
     obj->code = code;
-    ow_object_assert_no_write_barrier_2(obj, ow_object_from(module));
+    if (module) // Methods of builtin classes have no module.
+        ow_object_assert_no_write_barrier_2(obj, ow_object_from(module));
     return obj;
 }
 
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "object.h"
+#include "smallint.h"
+#include <utilities/attributes.h>
+
 struct ow_class_obj;
 struct ow_machine;
 
@@ -19,6 +23,7 @@ struct ow_machine;
     ELEM(map)         \
     ELEM(module)      \
     ELEM(nil)         \
+    ELEM(range)       \
     ELEM(set)         \
     ELEM(objslots)    \
     ELEM(objslotz)    \
@@ -36,6 +41,17 @@ struct ow_builtin_classes {
 #undef ELEM
 };
 
+/// Get class of an object, which can be a small int or a small float.
+ow_static_forceinline struct ow_class_obj *ow_builtin_classes_class_of(
+    const struct ow_builtin_classes *bic, const struct ow_object *obj
+) {
+    if (ow_unlikely(ow_smallint_check(obj)))
+        return bic->int_;
+    if (ow_unlikely(ow_smallfloat_check(obj)))
+        return bic->float_;
+    return ow_object_class(obj);
+}
+
 /// Create a `struct ow_builtin_classes`. Not fully initialized.
 struct ow_builtin_classes *_ow_builtin_classes_new(struct ow_machine *om);
 /// Load data.
@@ -280,9 +280,10 @@ static bool ow_class_obj_add_attribute_y(
 
     ow_hashmap_set(
         &self->attrs_and_methods_map, &ow_symbol_obj_hashmap_funcs,
-        name, (void *)(-1 - (intptr_t)field_index)
+        name, (void *)((intptr_t)field_index + 1)
     );
-    ow_object_assert_no_write_barrier_2(self, ow_object_from(name));
+    ow_object_write_barrier(self, ow_object_from(name));
+    self->pub_info.version++;
     return true;
 }
 
@@ -316,11 +317,12 @@ static size_t ow_class_obj_add_or_set_method_y(
             &self->attrs_and_methods_map, &ow_symbol_obj_hashmap_funcs,
             name, (void *)(-1 - (intptr_t)index)
         );
-        ow_object_assert_no_write_barrier_2(self, ow_object_from(name));
+        ow_object_write_barrier(self, ow_object_from(name));
     } else {
         ow_array_at(&self->methods, index) = method;
     }
     ow_object_write_barrier(self, method);
+    self->pub_info.version++; // Invalidate inline caches.
     return index;
 }
 
@@ -109,6 +109,7 @@ struct ow_class_obj_pub_info {
     struct ow_symbol_obj *class_name; // optional
     void (*finalizer)(struct ow_object *); // optional
     ow_objmem_obj_fields_visitor_t gc_visitor; // optional
+    size_t version; // increased when methods or attributes are changed
 };
 
 ow_static_forceinline const struct ow_class_obj_pub_info *
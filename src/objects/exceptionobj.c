@@ -117,7 +117,7 @@ void ow_exception_obj_print(
         snprintf(buffer, sizeof buffer, "Exception `%s': ", ow_symbol_obj_data(name_sym));
         ow_stream_puts(stream, buffer);
 
-        if (!ow_smallint_check(self->data) &&
+        if (!ow_smallval_check(self->data) &&
                 ow_object_class(self->data) == om->builtin_classes->string) {
             struct ow_string_obj *const str_o =
                 ow_object_cast(self->data, struct ow_string_obj);
@@ -133,12 +133,22 @@ void ow_exception_obj_print(
         if (ow_xarray_size(&self->backtrace))
             ow_stream_puts(stream, "Stack trace:\n");
 
+        // Deep recursion (e.g. a stack overflow) may leave a huge number of frames.
+        // Print only the innermost and the outermost ones.
+        const size_t edge_frames = 16;
         for (size_t i = 0, n = ow_xarray_size(&self->backtrace); i < n; i++) {
+            if (i == edge_frames && n > edge_frames * 2 + 1) {
+                snprintf(buffer, sizeof buffer, " ... %zu frames omitted\n",
+                    n - edge_frames * 2);
+                ow_stream_puts(stream, buffer);
+                i = n - edge_frames - 1;
+                continue;
+            }
             const struct ow_exception_obj_frame_info *const fi =
                 &ow_xarray_at(&self->backtrace, struct ow_exception_obj_frame_info, i);
             struct ow_object *const func = fi->function;
             const char *func_name;
-            assert(!ow_smallint_check(func));
+            assert(!ow_smallval_check(func));
             struct ow_class_obj *const func_class = ow_object_class(func);
             if (func_class == om->builtin_classes->cfunc)
                 func_name = ow_object_cast(func, struct ow_cfunc_obj)->name;
@@ -146,6 +156,11 @@ void ow_exception_obj_print(
                 func_name = "???"; // TODO: Get name of other type of functions.
             snprintf(buffer, sizeof buffer, " [%zu] %s @%p", i, func_name, (void *)fi->ip);
             ow_stream_puts(stream, buffer);
+            if (fi->tail_calls) {
+                snprintf(buffer, sizeof buffer, " (%zu tail call%s)",
+                    fi->tail_calls, fi->tail_calls > 1 ? "s" : "");
+                ow_stream_puts(stream, buffer);
+            }
             ow_stream_putc(stream, '\n');
         }
     }
@@ -17,6 +17,7 @@ struct ow_exception_obj;
 struct ow_exception_obj_frame_info {
     struct ow_object *function;
     const unsigned char *ip;
+    size_t tail_calls; ///< Number of frames elided by tail calls before this one.
 };
 
 /// Create a standard exception object. Pass `exc_type=NULL` to use base exception.
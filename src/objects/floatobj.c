@@ -1,6 +1,7 @@
 #include "floatobj.h"
 
 #include <assert.h>
+#include <math.h>
 #include <stddef.h>
 
 #include "classes.h"
@@ -17,11 +18,13 @@ struct ow_float_obj {
 
 struct ow_float_obj *ow_float_obj_new(struct ow_machine *om, double val) {
     struct ow_float_obj *const obj = ow_object_cast(
-        ow_objmem_allocate(om, om->builtin_classes->float_),
+        ow_objmem_allocate_fast(
+            om, om->builtin_classes->float_,
+            OW_OBJ_STRUCT_FIELD_COUNT(struct ow_float_obj)),
         struct ow_float_obj
     );
     obj->value = val;
-    assert(ow_float_obj_value(obj) == val);
+    assert(ow_float_obj_value(obj) == val || isnan(val));
     return obj;
 }
 
@@ -1,18 +1,32 @@
 #pragma once
 
+#include "object.h"
 #include "object_util.h"
+#include "smallint.h"
 #include <utilities/attributes.h>
 
 struct ow_machine;
+struct ow_object;
 
 /// Floating-point object.
 struct ow_float_obj;
 
+/// Make a small float or create a float object.
+ow_static_forceinline struct ow_object *ow_float_obj_or_smallfloat(struct ow_machine *om, double val);
 /// Create a float object.
 struct ow_float_obj *ow_float_obj_new(struct ow_machine *om, double val);
 /// Get float value.
 ow_static_forceinline double ow_float_obj_value(const struct ow_float_obj *self);
 
+ow_static_forceinline struct ow_object *ow_float_obj_or_smallfloat(
+    struct ow_machine *om, double val
+) {
+    struct ow_object *const ptr = ow_smallfloat_try_to_ptr(val);
+    if (ow_likely(ptr))
+        return ptr;
+    return ow_object_from(ow_float_obj_new(om, val));
+}
+
 ow_static_forceinline double ow_float_obj_value(const struct ow_float_obj *self) {
     return *(const double *)((const unsigned char *)self + OW_OBJECT_HEAD_SIZE);
 }
@@ -9,6 +9,11 @@
 #include "natives.h"
 #include "object.h"
 #include "object_util.h"
+#include <bytecode/opcode.h>
+#include <bytecode/operand.h>
+#include <machine/jit.h>
+#include <machine/regvm.h>
+#include <machine/trace.h>
 #include <machine/machine.h>
 #include <utilities/attributes.h>
 #include <utilities/memalloc.h>
@@ -27,6 +32,86 @@ static const size_t _zero_size = 0;
 #define empty_ow_func_obj_constants ((const struct ow_func_obj_constants *)&_zero_size)
 #define empty_ow_func_obj_symbols ((const struct ow_func_obj_symbols *)&_zero_size)
 
+/// Check whether an instruction looks up methods or attributes by name.
+static bool opcode_has_inline_cache(enum ow_opcode opcode) {
+    switch (opcode) {
+    case OW_OPC_LdAttrY:
+    case OW_OPC_LdAttrYW:
+    case OW_OPC_PrepMethY:
+    case OW_OPC_PrepMethYW:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// Check whether an instruction accesses global variables by name.
+static bool opcode_has_global_cell(enum ow_opcode opcode) {
+    switch (opcode) {
+    case OW_OPC_LdGlobY:
+    case OW_OPC_LdGlobYW:
+    case OW_OPC_StGlobY:
+    case OW_OPC_StGlobYW:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// Create inline caches for instructions in the code. Return NULL if no
+/// instruction requires a cache.
+static struct ow_func_obj_inline_caches *ow_func_obj_inline_caches_new(
+    const unsigned char *code, size_t code_size
+) {
+    size_t count = 0, cell_count = 0;
+    for (size_t pos = 0; pos < code_size; ) {
+        const enum ow_opcode opcode = ow_opcode_generic((enum ow_opcode)code[pos]);
+        pos += 1 + ow_operand_type_width(ow_operand_type(opcode));
+        if (opcode_has_inline_cache(opcode))
+            count++;
+        else if (opcode_has_global_cell(opcode))
+            cell_count++;
+    }
+    if (!count && !cell_count)
+        return NULL;
+    if (count > UINT16_MAX)
+        count = UINT16_MAX;
+    if (cell_count > UINT16_MAX)
+        cell_count = UINT16_MAX;
+
+    const size_t map_size = (code_size + 1) * sizeof(uint16_t);
+    struct ow_func_obj_inline_caches *const caches =
+        ow_malloc(sizeof(struct ow_func_obj_inline_caches) + map_size);
+    caches->count = count;
+    caches->caches = ow_malloc(count * sizeof(struct ow_func_obj_inline_cache));
+    memset(caches->caches, 0, count * sizeof(struct ow_func_obj_inline_cache));
+    caches->global_cell_count = cell_count;
+    caches->global_cells = ow_malloc(cell_count * sizeof(struct ow_func_obj_global_cell));
+    memset(caches->global_cells, 0, cell_count * sizeof(struct ow_func_obj_global_cell));
+    memset(caches->cache_at, 0, map_size);
+
+    size_t cache_index = 0, cell_index = 0;
+    for (size_t pos = 0; pos < code_size; ) {
+        const enum ow_opcode opcode = ow_opcode_generic((enum ow_opcode)code[pos]);
+        pos += 1 + ow_operand_type_width(ow_operand_type(opcode));
+        if (pos > code_size)
+            break;
+        if (opcode_has_inline_cache(opcode) && cache_index < count)
+            caches->cache_at[pos] = (uint16_t)++cache_index;
+        else if (opcode_has_global_cell(opcode) && cell_index < cell_count)
+            caches->cache_at[pos] = (uint16_t)++cell_index;
+    }
+
+    return caches;
+}
+
+/// Delete inline caches.
+static void ow_func_obj_inline_caches_del(struct ow_func_obj_inline_caches *caches) {
+    ow_free(caches->caches);
+    ow_free(caches->global_cells);
+    ow_free(caches);
+}
+
 static void ow_func_obj_finalizer(struct ow_object *obj) {
     struct ow_func_obj *const self = ow_object_cast(obj, struct ow_func_obj);
 
@@ -34,6 +119,18 @@ static void ow_func_obj_finalizer(struct ow_object *obj) {
         ow_free((void *)self->constants);
     if (ow_likely(self->symbols != empty_ow_func_obj_symbols))
         ow_free((void *)self->symbols);
+    if (self->inline_caches)
+        ow_func_obj_inline_caches_del(self->inline_caches);
+#if OW_JIT_AVAILABLE
+    if (self->jit_code)
+        ow_jit_code_del(self->jit_code);
+    if (self->trace_table)
+        ow_trace_table_del(self->trace_table);
+#endif // OW_JIT_AVAILABLE
+#if OW_BUILD_REGISTER_VM
+    if (self->regvm_code)
+        ow_regvm_code_del(self->regvm_code);
+#endif // OW_BUILD_REGISTER_VM
 }
 
 static void ow_func_obj_gc_visitor(void *_obj, int op) {
@@ -43,6 +140,16 @@ static void ow_func_obj_gc_visitor(void *_obj, int op) {
         ow_objmem_visit_object(self->constants->data[i], op);
     for (size_t i = 0, n = self->symbols->size; i < n; i++)
         ow_objmem_visit_object(self->symbols->data[i], op);
+    if (self->inline_caches) {
+        struct ow_func_obj_inline_caches *const caches = self->inline_caches;
+        for (size_t i = 0, n = caches->count; i < n; i++) {
+            struct ow_func_obj_inline_cache *const cache = &caches->caches[i];
+            for (size_t j = 0; j < OW_FUNC_OBJ_INLINE_CACHE_WAYS; j++) {
+                if (cache->entries[j].klass)
+                    ow_objmem_visit_object(cache->entries[j].klass, op);
+            }
+        }
+    }
 }
 
 struct ow_func_obj *ow_func_obj_new(
@@ -79,6 +186,11 @@ struct ow_func_obj *ow_func_obj_new(
     } else {
         obj->symbols = empty_ow_func_obj_symbols;
     }
+    obj->inline_caches = ow_func_obj_inline_caches_new(code, code_size);
+    obj->jit_code = NULL;
+    obj->jit_counter = 0;
+    obj->trace_table = NULL;
+    obj->regvm_code = NULL;
     obj->code_size = code_size;
     memcpy(obj->code, code, code_size);
     return obj;
@@ -96,6 +208,26 @@ struct ow_symbol_obj *ow_func_obj_get_symbol(struct ow_func_obj *self, size_t in
     return self->symbols->data[index];
 }
 
+void ow_func_obj_inline_cache_record(
+    struct ow_func_obj_inline_cache *cache, struct ow_class_obj *klass, size_t index
+) {
+    size_t entry_index;
+    for (entry_index = 0; entry_index < OW_FUNC_OBJ_INLINE_CACHE_WAYS; entry_index++) {
+        struct ow_class_obj *const entry_class = cache->entries[entry_index].klass;
+        if (!entry_class || entry_class == klass)
+            break; // Empty or outdated entry.
+    }
+    if (entry_index == OW_FUNC_OBJ_INLINE_CACHE_WAYS) {
+        entry_index = cache->next_entry;
+        cache->next_entry = (entry_index + 1) % OW_FUNC_OBJ_INLINE_CACHE_WAYS;
+    }
+    struct ow_func_obj_inline_cache_entry *const entry = &cache->entries[entry_index];
+    entry->klass = klass;
+    entry->class_version = ow_class_obj_pub_info(klass)->version;
+    entry->index = index;
+    assert(ow_object_meta_test_(OLD, ow_object_from(klass)->_meta));
+}
+
 const unsigned char *ow_func_obj_code(
     const struct ow_func_obj *self, size_t *size_out
 ) {
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
 
+#include "classobj.h"
 #include "funcspec.h"
 #include "object.h"
 #include <utilities/attributes.h>
@@ -11,9 +14,42 @@ struct ow_module_obj;
 struct ow_object;
 struct ow_symbol_obj;
 
+struct ow_jit_code;
+struct ow_regvm_code;
+struct ow_trace_table;
+
 struct ow_func_obj_constants;
 struct ow_func_obj_symbols;
 
+/// Number of entries in an inline cache.
+#define OW_FUNC_OBJ_INLINE_CACHE_WAYS 4
+
+/// Inline cache of a method or attribute lookup instruction, keyed by receiver class.
+struct ow_func_obj_inline_cache {
+    struct ow_func_obj_inline_cache_entry {
+        struct ow_class_obj *klass; // NULL if the entry is empty.
+        size_t class_version; // Value of `version` in class public info.
+        size_t index; // Method index or attribute index.
+    } entries[OW_FUNC_OBJ_INLINE_CACHE_WAYS];
+    size_t next_entry; // Entry to be replaced when the cache is full.
+};
+
+/// Binding of a global variable lookup instruction to a global slot.
+/// A global is never removed from its module, so the index remains valid.
+struct ow_func_obj_global_cell {
+    size_t index; // (global index + 1) or 0 if not bound
+    size_t base_guard; // 0 if bound to function module; otherwise bound to base module, (function module global count + 1)
+};
+
+/// Inline caches of a function.
+struct ow_func_obj_inline_caches {
+    size_t count;
+    struct ow_func_obj_inline_cache *caches;
+    size_t global_cell_count;
+    struct ow_func_obj_global_cell *global_cells;
+    uint16_t cache_at[]; // { offset after instruction => (cache or cell index + 1) or 0 }
+};
+
 /// Function object.
 struct ow_func_obj {
     OW_EXTENDED_OBJECT_HEAD
@@ -21,6 +57,11 @@ struct ow_func_obj {
     struct ow_module_obj *module;
     const struct ow_func_obj_constants *constants;
     const struct ow_func_obj_symbols *symbols;
+    struct ow_func_obj_inline_caches *inline_caches; // optional
+    struct ow_jit_code *jit_code; // optional
+    size_t jit_counter; // Number of calls and loop iterations, for deciding when to compile.
+    struct ow_trace_table *trace_table; // optional
+    struct ow_regvm_code *regvm_code; // optional
     size_t code_size;
     unsigned char code[];
 };
@@ -36,3 +77,55 @@ struct ow_func_obj *ow_func_obj_new(
 struct ow_object *ow_func_obj_get_constant(struct ow_func_obj *self, size_t index);
 /// Get symbols by index. If the index is out of range, return NULL.
 struct ow_symbol_obj *ow_func_obj_get_symbol(struct ow_func_obj *self, size_t index);
+/// Get the inline cache of the instruction that ends at `next_ip`.
+/// Return NULL if the instruction has no inline cache.
+ow_static_forceinline struct ow_func_obj_inline_cache *ow_func_obj_inline_cache(
+    struct ow_func_obj *self, const unsigned char *next_ip);
+/// Get the global cell of the instruction that ends at `next_ip`.
+/// Return NULL if the instruction has no global cell.
+ow_static_forceinline struct ow_func_obj_global_cell *ow_func_obj_global_cell(
+    struct ow_func_obj *self, const unsigned char *next_ip);
+/// Find receiver class in an inline cache. Return the cached index or -1.
+ow_static_forceinline size_t ow_func_obj_inline_cache_find(
+    const struct ow_func_obj_inline_cache *cache, const struct ow_class_obj *klass);
+/// Record a lookup result in an inline cache.
+void ow_func_obj_inline_cache_record(
+    struct ow_func_obj_inline_cache *cache, struct ow_class_obj *klass, size_t index);
+
+////////////////////////////////////////////////////////////////////////////////
+
+ow_static_forceinline struct ow_func_obj_inline_cache *ow_func_obj_inline_cache(
+    struct ow_func_obj *self, const unsigned char *next_ip
+) {
+    struct ow_func_obj_inline_caches *const caches = self->inline_caches;
+    if (ow_unlikely(!caches))
+        return NULL;
+    const size_t offset = (size_t)(next_ip - self->code);
+    assert(offset <= self->code_size);
+    const size_t n = caches->cache_at[offset];
+    return ow_likely(n) ? &caches->caches[n - 1] : NULL;
+}
+
+ow_static_forceinline struct ow_func_obj_global_cell *ow_func_obj_global_cell(
+    struct ow_func_obj *self, const unsigned char *next_ip
+) {
+    struct ow_func_obj_inline_caches *const caches = self->inline_caches;
+    if (ow_unlikely(!caches))
+        return NULL;
+    const size_t offset = (size_t)(next_ip - self->code);
+    assert(offset <= self->code_size);
+    const size_t n = caches->cache_at[offset];
+    return ow_likely(n) ? &caches->global_cells[n - 1] : NULL;
+}
+
+ow_static_forceinline size_t ow_func_obj_inline_cache_find(
+    const struct ow_func_obj_inline_cache *cache, const struct ow_class_obj *klass
+) {
+    const size_t class_version = ow_class_obj_pub_info(klass)->version;
+    for (size_t i = 0; i < OW_FUNC_OBJ_INLINE_CACHE_WAYS; i++) {
+        const struct ow_func_obj_inline_cache_entry *const entry = &cache->entries[i];
+        if (entry->klass == klass && entry->class_version == class_version)
+            return entry->index;
+    }
+    return (size_t)-1;
+}
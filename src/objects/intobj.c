@@ -17,7 +17,9 @@ struct ow_int_obj {
 
 struct ow_int_obj *_ow_int_obj_new(struct ow_machine *om, int64_t val) {
     struct ow_int_obj *const obj = ow_object_cast(
-        ow_objmem_allocate(om, om->builtin_classes->int_),
+        ow_objmem_allocate_fast(
+            om, om->builtin_classes->int_,
+            OW_OBJ_STRUCT_FIELD_COUNT(struct ow_int_obj)),
         struct ow_int_obj);
     obj->value = val;
     assert(ow_int_obj_value(obj) == val);
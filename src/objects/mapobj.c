@@ -65,6 +65,15 @@ int ow_map_obj_foreach(
     return ow_hashmap_foreach(&self->map, (ow_hashmap_walker_t)walker, arg);
 }
 
+struct ow_object *ow_map_obj_next(
+    const struct ow_map_obj *self, size_t *pos, struct ow_object **val
+) {
+    void *key;
+    if (!ow_hashmap_next(&self->map, pos, &key, (void **)val))
+        return NULL;
+    return key;
+}
+
 OW_BICLS_DEF_CLASS_EX(
     map,
     "Map",
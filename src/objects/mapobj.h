@@ -23,3 +23,8 @@ struct ow_object *ow_map_obj_get(
 int ow_map_obj_foreach(
     const struct ow_map_obj *self,
     int (*walker)(void *arg, struct ow_object *key, struct ow_object *val), void *arg);
+/// Step through the key-value pairs. `*pos` shall be 0 at the beginning and is
+/// advanced on each call. Return the next key and store its value to `*val` if
+/// `val` is not NULL, or return NULL at the end.
+struct ow_object *ow_map_obj_next(
+    const struct ow_map_obj *self, size_t *pos, struct ow_object **val);
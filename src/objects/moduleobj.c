@@ -50,8 +50,8 @@ static void module_dynlib_list_add(
 
 struct ow_module_obj {
     OW_OBJECT_HEAD
+    struct ow_module_obj_pub_info pub_info;
     struct ow_hashmap globals_map; // { name, index + 1 }
-    struct ow_array globals;
     struct ow_symbol_obj *name; // Optional.
     void (*finalizer)(void); // Optional.
     struct module_dynlib_list dynlib_list;
@@ -59,14 +59,15 @@ struct ow_module_obj {
 
 static void ow_module_obj_init(struct ow_module_obj *self) {
     ow_hashmap_init(&self->globals_map, 0);
-    ow_array_init(&self->globals, 0);
+    ow_array_init(&self->pub_info.globals, 0);
     self->name = NULL;
     self->finalizer = NULL;
     module_dynlib_list_init(&self->dynlib_list);
+    assert(ow_module_obj_pub_info(self) == &self->pub_info);
 }
 
 static void ow_module_obj_fini(struct ow_module_obj *self) {
-    ow_array_fini(&self->globals);
+    ow_array_fini(&self->pub_info.globals);
     ow_hashmap_fini(&self->globals_map);
     module_dynlib_list_fini(&self->dynlib_list);
 }
@@ -84,8 +85,8 @@ static void ow_module_obj_gc_visitor(void *_obj, int op) {
         (ow_unused_var(name), ow_unused_var(index));
         ow_objmem_visit_object(__node_p->key, op);
     });
-    for (size_t i = 0, n = ow_array_size(&self->globals); i < n; i++)
-        ow_objmem_visit_object(ow_array_at(&self->globals, i), op);
+    for (size_t i = 0, n = ow_array_size(&self->pub_info.globals); i < n; i++)
+        ow_objmem_visit_object(ow_array_at(&self->pub_info.globals, i), op);
     if (ow_likely(self->name))
         ow_objmem_visit_object(self->name, op);
 }
@@ -106,13 +107,13 @@ void ow_module_obj_load_native_def(
     struct ow_machine *om, struct ow_module_obj *self,
     const struct ow_native_module_def *def
 ) {
-    assert(!ow_hashmap_size(&self->globals_map) && !ow_array_size(&self->globals));
+    assert(!ow_hashmap_size(&self->globals_map) && !ow_array_size(&self->pub_info.globals));
 
     size_t func_count = 0;
     for (const struct ow_native_func_def *p = def->functions; p->func; p++)
         func_count++;
     ow_hashmap_reserve(&self->globals_map, func_count);
-    ow_array_reserve(&self->globals, func_count);
+    ow_array_reserve(&self->pub_info.globals, func_count);
 
     ow_objmem_push_ngc(om);
 
@@ -124,8 +125,6 @@ void ow_module_obj_load_native_def(
         struct ow_symbol_obj *const name_obj =
             ow_symbol_obj_new(om, func_def.name, (size_t)-1);
         ow_module_obj_set_global_y(self, name_obj, ow_object_from(func_obj));
-        ow_object_assert_no_write_barrier_2(self, ow_object_from(name_obj));
-        ow_object_assert_no_write_barrier_2(self, ow_object_from(func_obj));
     }
 
     ow_objmem_pop_ngc(om);
@@ -142,14 +141,6 @@ size_t ow_module_obj_find_global(
     return (size_t)index - 1;
 }
 
-struct ow_object *ow_module_obj_get_global(
-    const struct ow_module_obj *self, size_t index
-) {
-    if (ow_unlikely(index >= ow_array_size(&self->globals)))
-        return NULL;
-    return ow_array_at(&self->globals, index);
-}
-
 struct ow_object *ow_module_obj_get_global_y(
     const struct ow_module_obj *self, const struct ow_symbol_obj *name
 ) {
@@ -158,16 +149,16 @@ struct ow_object *ow_module_obj_get_global_y(
     if (ow_unlikely(!index_raw))
         return NULL;
     const size_t index = (size_t)index_raw - 1;
-    assert(index < ow_array_size(&self->globals));
-    return ow_array_at(&self->globals, index);
+    assert(index < ow_array_size(&self->pub_info.globals));
+    return ow_array_at(&self->pub_info.globals, index);
 }
 
 bool ow_module_obj_set_global(
     struct ow_module_obj *self, size_t index, struct ow_object *value
 ) {
-    if (ow_unlikely(index >= ow_array_size(&self->globals)))
+    if (ow_unlikely(index >= ow_array_size(&self->pub_info.globals)))
         return false;
-    ow_array_at(&self->globals, index) = value;
+    ow_array_at(&self->pub_info.globals, index) = value;
     ow_object_write_barrier(self, value);
     return true;
 }
@@ -178,26 +169,20 @@ size_t ow_module_obj_set_global_y(
 ) {
     size_t index = ow_module_obj_find_global(self, name);
     if (index == (size_t)-1) {
-        index = ow_array_size(&self->globals);
-        ow_array_append(&self->globals, value);
+        index = ow_array_size(&self->pub_info.globals);
+        ow_array_append(&self->pub_info.globals, value);
         ow_hashmap_set(
             &self->globals_map, &ow_symbol_obj_hashmap_funcs,
             name, (void *)(index + 1)
         );
-        ow_object_assert_no_write_barrier_2(self, ow_object_from(name));
+        ow_object_write_barrier(self, ow_object_from(name));
     } else {
-        ow_array_at(&self->globals, index) = value;
+        ow_array_at(&self->pub_info.globals, index) = value;
     }
     ow_object_write_barrier(self, value);
     return index;
 }
 
-size_t ow_module_obj_global_count(const struct ow_module_obj *self) {
-    const size_t n = ow_array_size(&self->globals);
-    assert(n == ow_hashmap_size(&self->globals_map));
-    return n;
-}
-
 struct _ow_module_obj_foreach_global_context {
     const struct ow_module_obj *module;
     int(*walker)(void *, struct ow_symbol_obj *, size_t, struct ow_object *);
@@ -210,7 +195,7 @@ static int _ow_module_obj_foreach_global_walker(
     struct _ow_module_obj_foreach_global_context *const ctx = _ctx;
     struct ow_symbol_obj *const name = (void *)key;
     const size_t index = (uintptr_t)val - 1;
-    struct ow_object *const value = ow_array_at(&ctx->module->globals, index);
+    struct ow_object *const value = ow_array_at(&ctx->module->pub_info.globals, index);
     return ctx->walker(ctx->arg, name, index, value);
 }
 
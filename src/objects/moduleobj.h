@@ -3,6 +3,10 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "object_util.h"
+#include <utilities/array.h>
+#include <utilities/attributes.h>
+
 struct ow_machine;
 struct ow_native_module_def;
 struct ow_object;
@@ -21,7 +25,7 @@ void ow_module_obj_load_native_def(
 size_t ow_module_obj_find_global(
     const struct ow_module_obj *self, const struct ow_symbol_obj *name);
 /// Get global by index. If not exists, return NULL.
-struct ow_object *ow_module_obj_get_global(
+ow_static_forceinline struct ow_object *ow_module_obj_get_global(
     const struct ow_module_obj *self, size_t index);
 /// Get global by name. If not exists, return NULL.
 struct ow_object *ow_module_obj_get_global_y(
@@ -32,8 +36,9 @@ bool ow_module_obj_set_global(
 /// Set or add global by name. Return its index.
 size_t ow_module_obj_set_global_y(
     struct ow_module_obj *self, const struct ow_symbol_obj *name, struct ow_object *value);
-/// Get number of global variables.
-size_t ow_module_obj_global_count(const struct ow_module_obj *self);
+/// Get number of global variables. Globals are never removed, so the number
+/// changes only when a new global is added.
+ow_static_forceinline size_t ow_module_obj_global_count(const struct ow_module_obj *self);
 /// View each global variable.
 int ow_module_obj_foreach_global(
     const struct ow_module_obj *self,
@@ -41,3 +46,28 @@ int ow_module_obj_foreach_global(
     void *arg);
 /// Store a handle to a dynamic library and close it when finalizing.
 void ow_module_obj_keep_dynlib(struct ow_module_obj *self, void *lib_handle);
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct ow_module_obj_pub_info {
+    struct ow_array globals;
+};
+
+ow_static_forceinline const struct ow_module_obj_pub_info *
+ow_module_obj_pub_info(const struct ow_module_obj *self) {
+    return (const struct ow_module_obj_pub_info *)
+        ((const unsigned char *)self + OW_OBJECT_HEAD_SIZE);
+}
+
+ow_static_forceinline struct ow_object *ow_module_obj_get_global(
+    const struct ow_module_obj *self, size_t index
+) {
+    const struct ow_array *const globals = &ow_module_obj_pub_info(self)->globals;
+    if (ow_unlikely(index >= ow_array_size(globals)))
+        return NULL;
+    return ow_array_at(globals, index);
+}
+
+ow_static_forceinline size_t ow_module_obj_global_count(const struct ow_module_obj *self) {
+    return ow_array_size(&ow_module_obj_pub_info(self)->globals);
+}
@@ -46,6 +46,8 @@ static bool _ow_object_hashmap_funcs_key_equal(
         return false; // TODO: Return an exception.
     if (ow_smallint_check(cmp_res))
         return ow_smallint_from_ptr(cmp_res) == 0;
+    if (ow_smallfloat_check(cmp_res))
+        return false;
     if (ow_object_class(cmp_res) == om->builtin_classes->int_)
         return ow_int_obj_value(ow_object_cast(cmp_res, struct ow_int_obj)) == 0;
     return false;
@@ -70,6 +72,8 @@ static ow_hash_t _ow_object_hashmap_funcs_key_hash(void *ctx, const void *key_ne
         return 0; // TODO: Return an exception.
     if (ow_smallint_check(hash_res))
         return (ow_hash_t)ow_smallint_from_ptr(hash_res);
+    if (ow_smallfloat_check(hash_res))
+        return 0; // TODO: Return an exception.
     if (ow_object_class(hash_res) == om->builtin_classes->int_)
         return (ow_hash_t)ow_int_obj_value(ow_object_cast(hash_res, struct ow_int_obj));
     return 0; // TODO: Return an exception.
@@ -4,6 +4,12 @@
 #include <stddef.h>
 #include <stdint.h> // uintptr_t
 
+#ifdef _MSC_VER
+#    include <compat/msvc_stdatomic.h>
+#else
+#    include <stdatomic.h>
+#endif
+
 #include "objmeta.h"
 #include "smallint.h"
 #include <utilities/attributes.h>
@@ -12,6 +18,7 @@ struct ow_class_obj;
 struct ow_object;
 
 void ow_objmem_record_o2y_object(struct ow_object *); // Declared in "objmem.h"
+extern atomic_int _ow_objmem_concurrent_marking; // Defined in "objmem.c"
 
 /// Common head of any object struct.
 #define OW_OBJECT_HEAD \
@@ -76,12 +83,14 @@ struct ow_object {
 };
 
 /*
- * ## Small int as object pointer
+ * ## Small int and small float as object pointer
  *
  * A `struct ow_object *` variable does not always hold a pointer to an object.
  * If the LSB of a `struct ow_object *` variable `x` is `1`, then it actually holds
- * a small int, and its values is `(intptr_t)x >> 1`. The header file "objmeta.h"
- * provides utilities for small int judgement and conversions.
+ * a small int, and its values is `(intptr_t)x >> 1`. If the lowest two bits
+ * are `10`, it holds a small float. Use `ow_smallval_check()` to tell whether
+ * it is a real object pointer. The header file "smallint.h" provides utilities
+ * for judgement and conversions.
  */
 
 /// Convert from object struct pointer to `struct ow_object *`.
@@ -92,13 +101,26 @@ struct ow_object {
 #define ow_object_cast(obj_ptr, type) \
     ((type *)(obj_ptr))
 
+/// Test whether storing `val` into old object `obj` shall be recorded: `val` is
+/// young, or `obj` has been marked by incremental marking while `val` has not.
+/// When marking runs on another thread, the mark of `obj` may be stale, so any
+/// unmarked `val` is recorded. The marks are read atomically for that thread.
+/// The count is changed on the thread that owns the marking, so a relaxed load suffices.
+#define _ow_object_write_barrier_test(__obj, __val) \
+    (!ow_object_meta_test_(OLD, (__val)->_meta) ||   \
+        ow_unlikely((ow_object_meta_atomic_test_(IMK, (__obj)->_meta) || \
+                atomic_load_explicit(&_ow_objmem_concurrent_marking,     \
+                    memory_order_relaxed)) &&                            \
+            !ow_object_meta_atomic_test_(IMK, (__val)->_meta)))     \
+// ^^^ _ow_object_write_barrier_test() ^^^
+
 /// Object write barrier. Place this after where a value is stored into an object.
 /// Function `ow_object_set_field()` already uses such barrier.
 #define ow_object_write_barrier(__obj, __val) \
     do {                                      \
         if (ow_unlikely(ow_object_meta_test_(OLD, (__obj)->_meta))) { \
-            if (!ow_smallint_check(ow_object_from((__val))) &&        \
-                !ow_object_meta_test_(OLD, (__val)->_meta))           \
+            if (!ow_smallval_check(ow_object_from((__val))) &&        \
+                _ow_object_write_barrier_test((__obj), ow_object_from((__val)))) \
                 ow_objmem_record_o2y_object(ow_object_from((__obj))); \
         }                                     \
     } while (0)                               \
@@ -112,7 +134,7 @@ ow_static_forceinline void ow_object_write_barrier_n(
         return;
     for (size_t i = 0; i < var_cnt; i++) {
         struct ow_object *const val = val_arr[i];
-        if (!ow_smallint_check(val) && !ow_object_meta_test_(OLD, val->_meta)) {
+        if (!ow_smallval_check(val) && _ow_object_write_barrier_test(obj, val)) {
             ow_objmem_record_o2y_object(obj);
             return;
         }
@@ -127,22 +149,23 @@ ow_static_forceinline void ow_object_write_barrier_n(
 #define ow_object_assert_no_write_barrier_2(__obj, __val) \
     assert(                                      \
         !ow_object_meta_test_(OLD, (__obj)->_meta) || \
-        ow_smallint_check((__val)) ||            \
-        ow_object_meta_test_(OLD, (__val)->_meta)\
+        ow_smallval_check((__val)) ||            \
+        !_ow_object_write_barrier_test((__obj), (__val)) \
     )                                            \
 // ^^^ ow_object_assert_no_write_barrier_2() ^^^
 
 /// Get class of an object.
 ow_static_forceinline struct ow_class_obj *
 ow_object_class(const struct ow_object *obj) {
-    assert(!ow_smallint_check(obj));
-    return ow_object_meta_load_(CLS, struct ow_class_obj *, obj->_meta);
+    assert(!ow_smallval_check(obj));
+    // The word is shared with GC marks, which may be set by a GC thread.
+    return ow_object_meta_atomic_load_(CLS, struct ow_class_obj *, obj->_meta);
 }
 
 /// Get field by index. No bounds checking.
 ow_static_forceinline struct ow_object *
 ow_object_get_field(const struct ow_object *obj, size_t index) {
-    assert(!ow_smallint_check(obj));
+    assert(!ow_smallval_check(obj));
     return obj->_fields[index];
 }
 
@@ -151,7 +174,7 @@ ow_static_forceinline void ow_object_set_field(
     struct ow_object *obj,
     size_t index, struct ow_object *value
 ) {
-    assert(!ow_smallint_check(obj));
+    assert(!ow_smallval_check(obj));
     obj->_fields[index] = value;
     ow_object_write_barrier(obj, value);
 }
@@ -4,6 +4,13 @@
 #include <stddef.h>
 #include <stdlib.h> // abort()
 #include <string.h>
+#include <time.h>
+
+#ifdef _MSC_VER
+#    include <compat/msvc_stdatomic.h>
+#else
+#    include <stdatomic.h>
+#endif
 
 #include "classobj.h"
 #include "natives.h"
@@ -12,20 +19,21 @@
 #include "smallint.h"
 #include <compat/kw_static.h>
 #include <machine/machine.h>
+#include <machine/sysparam.h>
 #include <utilities/bitset.h>
 #include <utilities/debuglog.h>
 #include <utilities/memalloc.h>
+#include <utilities/thread.h>
 
 #include <config/options.h>
 
 #if OW_DEBUG_MEMORY
 #    include <stdio.h>
-#    include <time.h>
 #endif // OW_DEBUG_MEMORY
 
 /* ----- Configurations ----------------------------------------------------- */
 
-#define NON_BIG_SPACE_MAX_ALLOC_SIZE   ((size_t)8 * 1024)
+#define NON_BIG_SPACE_MAX_ALLOC_SIZE   _OW_OBJMEM_NON_BIG_SPACE_MAX_ALLOC_SIZE
 #define NEW_SPACE_CHUNK_SIZE           ((size_t)512 * 1024)
 #define OLD_SPACE_CHUNK_SIZE           ((size_t)256 * 1024)
 #define BIG_SPACE_THRESHOLD_INIT       ((size_t)16 * NON_BIG_SPACE_MAX_ALLOC_SIZE)
@@ -44,6 +52,267 @@ static_assert(NON_BIG_SPACE_MAX_ALLOC_SIZE < OLD_SPACE_CHUNK_SIZE / 16, "");
     } while (0)                         \
 // ^^^ call_object_finalizer() ^^^
 
+/* ----- Mark stack --------------------------------------------------------- */
+
+/*
+ * Marked objects whose fields have not been visited are kept in a stack rather
+ * than visited recursively, so that marking a long chain of references does not
+ * overflow the native stack. An entry is an object pointer with the marking
+ * operation for its fields stored in the lowest 2 bits. The stack for incremental
+ * marking holds `OW_OBJMEM_OBJ_VISIT_MARK_INC` entries only, whose lowest bits
+ * are not used.
+ */
+
+/// Marked objects whose fields are to be visited.
+struct mark_stack {
+    uintptr_t *_data;
+    size_t     _size;
+    size_t     _capacity;
+    bool       _draining; ///< Whether objects are being popped and visited.
+};
+
+/// Max capacity of a mark stack to keep after GC.
+#define MARK_STACK_KEPT_CAPACITY  ((size_t)4 * 1024)
+
+static_assert(
+    OW_OBJMEM_OBJ_VISIT_MARK_REC <= 3 && OW_OBJMEM_OBJ_VISIT_MARK_REC_Y <= 3 &&
+    OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X <= 3 && OW_OBJMEM_OBJ_VISIT_MARK_REC_O2Y <= 3,
+    "struct mark_stack");
+
+/// Mark stack of the GC running in current thread.
+static thread_local struct mark_stack *current_mark_stack;
+
+static void mark_object_fields(struct ow_object *obj, enum ow_objmem_obj_visit_op op);
+
+static void mark_stack_init(struct mark_stack *stack) {
+    stack->_data = NULL;
+    stack->_size = 0;
+    stack->_capacity = 0;
+    stack->_draining = false;
+}
+
+static void mark_stack_fini(struct mark_stack *stack) {
+    assert(!stack->_size);
+    if (stack->_data)
+        ow_free(stack->_data);
+}
+
+/// Check whether there are no entries.
+ow_forceinline static bool mark_stack_empty(const struct mark_stack *stack) {
+    return !stack->_size;
+}
+
+/// Drop all entries.
+static void mark_stack_clear(struct mark_stack *stack) {
+    assert(!stack->_draining);
+    stack->_size = 0;
+}
+
+/// Release memory if the stack has grown too large.
+static void mark_stack_shrink(struct mark_stack *stack) {
+    assert(!stack->_size && !stack->_draining);
+    if (stack->_capacity <= MARK_STACK_KEPT_CAPACITY)
+        return;
+    ow_free(stack->_data);
+    mark_stack_init(stack);
+}
+
+ow_forceinline static void mark_stack_push(
+    struct mark_stack *stack, struct ow_object *obj, enum ow_objmem_obj_visit_op op
+) {
+    assert(!((uintptr_t)obj & 3));
+    if (ow_unlikely(stack->_size == stack->_capacity)) {
+        stack->_capacity = stack->_capacity ? stack->_capacity * 2 : 256;
+        stack->_data = ow_realloc(stack->_data, stack->_capacity * sizeof stack->_data[0]);
+    }
+    stack->_data[stack->_size++] = (uintptr_t)obj | (uintptr_t)op;
+}
+
+ow_forceinline static bool mark_stack_pop(
+    struct mark_stack *stack, struct ow_object **obj, enum ow_objmem_obj_visit_op *op
+) {
+    if (ow_unlikely(!stack->_size))
+        return false;
+    const uintptr_t entry = stack->_data[--stack->_size];
+    *obj = (struct ow_object *)(entry & ~(uintptr_t)3);
+    *op = (enum ow_objmem_obj_visit_op)(int)(entry & 3);
+    return true;
+}
+
+/// Push an object to a stack for incremental marking.
+ow_forceinline static void inc_mark_stack_push(
+    struct mark_stack *stack, struct ow_object *obj
+) {
+    mark_stack_push(stack, obj, OW_OBJMEM_OBJ_VISIT_MARK_REC); // The op is not used.
+}
+
+/// Pop an object from a stack for incremental marking. Return NULL if empty.
+ow_forceinline static struct ow_object *inc_mark_stack_pop(struct mark_stack *stack) {
+    struct ow_object *obj;
+    enum ow_objmem_obj_visit_op op;
+    return mark_stack_pop(stack, &obj, &op) ? obj : NULL;
+}
+
+/// Move at most `count` entries from the top of a stack to another one.
+/// Return the number of moved entries.
+static size_t mark_stack_move(struct mark_stack *dst, struct mark_stack *src, size_t count) {
+    if (count > src->_size)
+        count = src->_size;
+    if (!count)
+        return 0; // Data of empty stacks may be NULL.
+    if (dst->_size + count > dst->_capacity) {
+        size_t new_capacity = dst->_capacity ? dst->_capacity : 256;
+        while (new_capacity < dst->_size + count)
+            new_capacity *= 2;
+        dst->_capacity = new_capacity;
+        dst->_data = ow_realloc(dst->_data, new_capacity * sizeof dst->_data[0]);
+    }
+    src->_size -= count;
+    memcpy(dst->_data + dst->_size, src->_data + src->_size, count * sizeof src->_data[0]);
+    dst->_size += count;
+    return count;
+}
+
+/* ----- Parallel tasks ----------------------------------------------------- */
+
+/*
+ * Some phases of a full GC can be shared among threads. In parallel marking,
+ * each thread has a private mark stack and a shared one. When some threads are
+ * idle, a thread moves half of its private entries to its shared stack, from
+ * which idle threads steal. Objects are claimed by setting the `MRK` flag
+ * atomically, so that fields of each object are visited once.
+ */
+
+/// Max number of threads in a parallel task.
+#define PAR_MAX_THREADS  64
+
+/// Min number of private entries of a marking thread before some are shared.
+#define PAR_MARK_SHARE_MIN  ((size_t)64)
+
+/// Run `func(arg)` on at most `thread_count` threads, including the calling
+/// one, and wait until all of them return.
+static void par_run(size_t thread_count, ow_thrd_start_t func, void *arg) {
+    ow_thrd_t threads[PAR_MAX_THREADS - 1];
+    size_t n = 0;
+    for (; n + 1 < thread_count && n < PAR_MAX_THREADS - 1; n++) {
+        if (ow_thrd_create(&threads[n], func, arg) != ow_thrd_success)
+            break;
+    }
+    func(arg);
+    for (size_t i = 0; i < n; i++)
+        ow_thrd_join(threads[i], NULL);
+}
+
+/// A marking thread.
+struct par_mark_worker {
+    struct mark_stack stack; ///< Private entries.
+    struct mark_stack shared; ///< Entries that other threads may take. Guarded by `lock`.
+    ow_mtx_t lock;
+};
+
+/// Shared data of parallel marking.
+struct par_mark_context {
+    atomic_int joined_count; ///< Number of threads that have joined.
+    atomic_int idle_count; ///< Number of threads that have found no entries to visit.
+    atomic_int shared_count; ///< Number of entries in shared stacks.
+    size_t worker_count;
+    struct par_mark_worker workers[];
+};
+
+/// Create a parallel marking context with `n` workers.
+static struct par_mark_context *par_mark_context_new(size_t n) {
+    struct par_mark_context *const par =
+        ow_malloc(sizeof(struct par_mark_context) + n * sizeof(struct par_mark_worker));
+    atomic_store(&par->joined_count, 0);
+    atomic_store(&par->idle_count, 0);
+    atomic_store(&par->shared_count, 0);
+    par->worker_count = n;
+    for (size_t i = 0; i < n; i++) {
+        struct par_mark_worker *const w = &par->workers[i];
+        mark_stack_init(&w->stack);
+        mark_stack_init(&w->shared);
+        ow_mtx_init(&w->lock, ow_mtx_plain);
+    }
+    return par;
+}
+
+/// Delete a parallel marking context.
+static void par_mark_context_del(struct par_mark_context *par) {
+    for (size_t i = 0; i < par->worker_count; i++) {
+        struct par_mark_worker *const w = &par->workers[i];
+        ow_mtx_destroy(&w->lock);
+        mark_stack_fini(&w->shared);
+        mark_stack_fini(&w->stack);
+    }
+    ow_free(par);
+}
+
+/// Move private entries of a worker to its shared stack.
+static void par_mark_worker_share(
+    struct par_mark_context *par, struct par_mark_worker *w, size_t count
+) {
+    ow_mtx_lock(&w->lock);
+    count = mark_stack_move(&w->shared, &w->stack, count);
+    atomic_fetch_add(&par->shared_count, (int)count);
+    ow_mtx_unlock(&w->lock);
+}
+
+/// Move shared entries of worker `victim` to the private stack of worker `w`.
+/// Take half of them unless `victim` is `w`. Return whether any are taken.
+static bool par_mark_worker_take(
+    struct par_mark_context *par, struct par_mark_worker *w, struct par_mark_worker *victim
+) {
+    ow_mtx_lock(&victim->lock);
+    const size_t n = victim->shared._size;
+    const size_t count = mark_stack_move(
+        &w->stack, &victim->shared, victim == w ? n : (n + 1) / 2);
+    atomic_fetch_sub(&par->shared_count, (int)count);
+    ow_mtx_unlock(&victim->lock);
+    return count;
+}
+
+/// Routine of a marking thread.
+static int par_mark_thread_main(void *arg) {
+    struct par_mark_context *const par = arg;
+    const size_t index = (size_t)atomic_fetch_add(&par->joined_count, 1);
+    assert(index < par->worker_count);
+    struct par_mark_worker *const w = &par->workers[index];
+
+    struct mark_stack *const prev_mark_stack = current_mark_stack;
+    current_mark_stack = &w->stack;
+    w->stack._draining = true;
+
+    while (true) {
+        struct ow_object *obj;
+        enum ow_objmem_obj_visit_op op;
+        while (mark_stack_pop(&w->stack, &obj, &op)) {
+            mark_object_fields(obj, op == OW_OBJMEM_OBJ_VISIT_MARK_REC ?
+                OW_OBJMEM_OBJ_VISIT_MARK_PAR : OW_OBJMEM_OBJ_VISIT_MARK_PAR_O2X);
+            if (w->stack._size >= PAR_MARK_SHARE_MIN &&
+                    atomic_load(&par->idle_count) && !atomic_load(&par->shared_count))
+                par_mark_worker_share(par, w, w->stack._size / 2);
+        }
+
+        bool taken = par_mark_worker_take(par, w, w);
+        for (size_t i = 1; !taken && i < par->worker_count; i++)
+            taken = par_mark_worker_take(par, w, &par->workers[(index + i) % par->worker_count]);
+        if (taken)
+            continue;
+
+        // Finish when all threads that have joined are idle and nothing is shared.
+        atomic_fetch_add(&par->idle_count, 1);
+        while (!atomic_load(&par->shared_count)) {
+            if (atomic_load(&par->idle_count) == atomic_load(&par->joined_count)) {
+                w->stack._draining = false;
+                current_mark_stack = prev_mark_stack;
+                return 0;
+            }
+            ow_thrd_yield();
+        }
+        atomic_fetch_sub(&par->idle_count, 1);
+    }
+}
+
 /* ----- Memory span set with function pointer ------------------------------ */
 
 /// A record of span.
@@ -393,7 +662,8 @@ static void mem_chunk_list_destroy_after(
  * In big space, mark-sweep GC algorithm is used.
  * All allocated objects are put in a linked list.
  * The `PTR` field in object meta stores the next object in the list.
- * `PTR & 0b0100` indicates whether this object contains references to young objects.
+ * `PTR & 0b0100` indicates whether this object contains references to young objects,
+ * or has been recorded by the write barrier during incremental marking.
  */
 
 struct _big_space_head {
@@ -545,7 +815,8 @@ ow_forceinline static void big_space_remember_object(struct ow_object *obj) {
     if (!orig_young_ref) {
         uintptr_t new_ptr_data = big_space_make_meta_ptr_data(next_obj, true);
         assert(ow_object_meta_check_value(new_ptr_data));
-        ow_object_meta_store_(PTR, obj->_meta, new_ptr_data);
+        // The marking thread may be reading the `OLD` flag in the same word.
+        ow_object_meta_atomic_store_(PTR, obj->_meta, new_ptr_data);
     }
 }
 
@@ -558,7 +829,7 @@ static size_t big_space_mark_remembered_objects_young_fields(
         if (ow_unlikely(has_young)) {
             count++;
             assert(ow_object_meta_test_(OLD, obj->_meta));
-            _ow_objmem_mark_old_referred_object_young_fields_rec(obj);
+            _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_O2Y);
         }
     });
     return count;
@@ -640,9 +911,40 @@ static void big_space_update_references(struct big_space *space) {
     });
 }
 
+/// Incremental marking: push remembered objects that have been marked, so that
+/// their fields will be visited again.
+static void big_space_push_remembered_marked_objects(
+    struct big_space *space, struct mark_stack *stack
+) {
+    big_space_foreach(space, obj, has_young, {
+        if (ow_unlikely(has_young) && ow_object_meta_test_(IMK, obj->_meta))
+            inc_mark_stack_push(stack, obj);
+    });
+}
+
+/// Full GC: turn incremental marks into GC marks.
+static void big_space_convert_incremental_marks(struct big_space *space) {
+    big_space_foreach(space, obj, has_young, {
+        ow_unused_var(has_young);
+        if (ow_object_meta_test_(IMK, obj->_meta)) {
+            ow_object_meta_reset_(IMK, obj->_meta);
+            ow_object_meta_set_(MRK, obj->_meta);
+        }
+    });
+}
+
+/// Full GC: mark fields of remembered objects that have been marked.
+/// Call this after `big_space_convert_incremental_marks()`.
+static void big_space_mark_remembered_marked_objects_fields(struct big_space *space) {
+    big_space_foreach(space, obj, has_young, {
+        if (ow_unlikely(has_young) && ow_object_meta_test_(MRK, obj->_meta))
+            _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X);
+    });
+}
+
 #if OW_DEBUG_MEMORY
 
-static int big_space_post_gc_check(struct big_space *space) {
+static int big_space_post_gc_check(struct big_space *space, bool inc_marking) {
     big_space_foreach(space, obj, has_young, {
         if (has_young)
             return -1;
@@ -650,6 +952,8 @@ static int big_space_post_gc_check(struct big_space *space) {
             return -2;
         if (ow_object_meta_test_(MRK, obj->_meta))
             return -3;
+        if (!inc_marking && ow_object_meta_test_(IMK, obj->_meta))
+            return -4;
     });
     return 0;
 }
@@ -663,7 +967,8 @@ static int big_space_post_gc_check(struct big_space *space) {
  * Object storage is allocated from chunks, while the chunks are put in a list.
  * The PTR field in object meta stores a pointer to chunk meta when GC is not running.
  * A remembered set is available for each chunk (a pointer at the beginning of chunk)
- * indicating which objects in this chunk contains references to young objects.
+ * indicating which objects in this chunk contains references to young objects,
+ * or have been recorded by the write barrier during incremental marking.
  */
 
 #define OLD_SPACE_CHUNK_REMEMBERED_SET_BUCKET_BITS 1024
@@ -761,6 +1066,7 @@ ow_forceinline static void old_space_chunk_remembered_set_record(
 /// Old space manager.
 struct old_space {
     struct mem_chunk_list _chunks;
+    size_t chunk_count;
 };
 
 /// Meta data of a old space chunk.
@@ -859,6 +1165,7 @@ static struct mem_chunk *old_space_add_chunk(struct old_space *);
 /// Initialize space.
 static void old_space_init(struct old_space *space) {
     mem_chunk_list_init(&space->_chunks);
+    space->chunk_count = 0;
     old_space_add_chunk(space);
 }
 
@@ -890,6 +1197,7 @@ ow_noinline static struct mem_chunk *old_space_add_chunk(struct old_space *space
     assert(chunk_meta);
     assert(chunk_meta == old_space_chunk_meta_addr(chunk));
     old_space_chunk_meta_init(chunk_meta);
+    space->chunk_count++;
     return chunk;
 }
 
@@ -897,8 +1205,11 @@ ow_noinline static struct mem_chunk *old_space_add_chunk(struct old_space *space
 static void old_space_remove_chunks_after(
     struct old_space *space, struct mem_chunk *after_chunk
 ) {
-    for (struct mem_chunk *chunk = after_chunk->_next; chunk; chunk = chunk->_next)
+    for (struct mem_chunk *chunk = after_chunk->_next; chunk; chunk = chunk->_next) {
         old_space_chunk_meta_fini(old_space_chunk_meta_addr(chunk));
+        assert(space->chunk_count > 1);
+        space->chunk_count--;
+    }
     mem_chunk_list_destroy_after(&space->_chunks, after_chunk);
 }
 
@@ -1061,7 +1372,7 @@ static size_t old_space_mark_remembered_objects_young_fields(struct old_space *s
             struct ow_object *const obj =
                 (struct ow_object *)((char *)chunk_meta + obj_offset);
             assert(ow_object_meta_test_(OLD, obj->_meta));
-            _ow_objmem_mark_old_referred_object_young_fields_rec(obj);
+            _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_O2Y);
         });
     });
     return count;
@@ -1120,15 +1431,131 @@ static size_t old_space_update_remembered_objects_references_forget_remembered_o
 }
 
 /// Full GC: update references to objects. References in unmarked objects are skipped.
-static void old_space_update_references(struct old_space *space) {
+static void old_space_chunk_update_references(struct mem_chunk *chunk) {
+    mem_chunk_foreach_allocated_object(
+        chunk, sizeof(struct old_space_chunk_meta), obj, obj_class, obj_size,
+    {
+        (ow_unused_var(obj_class), ow_unused_var(obj_size));
+        if (ow_unlikely(!ow_object_meta_test_(MRK, obj->_meta)))
+            continue;
+        _ow_objmem_move_object_fields(obj);
+    });
+}
+
+/// Chunks whose references are updated in parallel.
+struct old_space_par_update_task {
+    struct mem_chunk **chunks;
+    size_t chunk_count;
+    atomic_int next_index;
+};
+
+static int old_space_par_update_thread_main(void *arg) {
+    struct old_space_par_update_task *const task = arg;
+    while (true) {
+        const size_t i = (size_t)atomic_fetch_add(&task->next_index, 1);
+        if (i >= task->chunk_count)
+            return 0;
+        old_space_chunk_update_references(task->chunks[i]);
+    }
+}
+
+/// Update references in old space with at most `thread_count` threads.
+/// Objects in different chunks are visited in parallel.
+static void old_space_update_references(struct old_space *space, size_t thread_count) {
+    if (thread_count <= 1 || space->chunk_count <= 1) {
+        mem_chunk_list_foreach(&space->_chunks, chunk, {
+            old_space_chunk_update_references(chunk);
+        });
+        return;
+    }
+
+    struct old_space_par_update_task task;
+    task.chunks = ow_malloc(space->chunk_count * sizeof task.chunks[0]);
+    task.chunk_count = 0;
+    atomic_store(&task.next_index, 0);
+    mem_chunk_list_foreach(&space->_chunks, chunk, {
+        task.chunks[task.chunk_count++] = chunk;
+    });
+    assert(task.chunk_count == space->chunk_count);
+    if (thread_count > task.chunk_count)
+        thread_count = task.chunk_count;
+    par_run(thread_count, old_space_par_update_thread_main, &task);
+    ow_free(task.chunks);
+}
+
+/// Incremental marking: push recorded objects in remembered set that have been
+/// marked, so that their fields will be visited again.
+static void old_space_push_remembered_marked_objects(
+    struct old_space *space, struct mark_stack *stack
+) {
+    mem_chunk_list_foreach(&space->_chunks, chunk, {
+        struct old_space_chunk_meta *const chunk_meta =
+            old_space_chunk_meta_addr(chunk);
+        struct old_space_chunk_remembered_set *const r_set =
+            chunk_meta->remembered_set;
+        if (ow_likely(!r_set))
+            continue;
+        old_space_chunk_remembered_set_foreach(r_set, obj_offset, {
+            struct ow_object *const obj =
+                (struct ow_object *)((char *)chunk_meta + obj_offset);
+            if (ow_object_meta_test_(IMK, obj->_meta))
+                inc_mark_stack_push(stack, obj);
+        });
+    });
+}
+
+/// Incremental marking: push objects in a region starting from `begin`.
+static void old_space_push_objects_from(
+    struct old_space *space, struct old_space_iterator begin, struct mark_stack *stack
+) {
+    ow_unused_var(space);
+    assert(mem_chunk_list_contains(&space->_chunks, begin.chunk));
+    struct mem_chunk *chunk = begin.chunk;
+    size_t chunk_start_offset = (size_t)((char *)begin.point - begin.chunk->_mem);
+
+    while (chunk) {
+        mem_chunk_foreach_allocated_object(
+            chunk, chunk_start_offset, obj, obj_class, obj_size,
+        {
+            (ow_unused_var(obj_class), ow_unused_var(obj_size));
+            inc_mark_stack_push(stack, obj);
+        });
+
+        chunk = chunk->_next;
+        chunk_start_offset = sizeof(struct old_space_chunk_meta);
+    }
+}
+
+/// Full GC: turn incremental marks into GC marks.
+static void old_space_convert_incremental_marks(struct old_space *space) {
     mem_chunk_list_foreach(&space->_chunks, chunk, {
         mem_chunk_foreach_allocated_object(
             chunk, sizeof(struct old_space_chunk_meta), obj, obj_class, obj_size,
         {
             (ow_unused_var(obj_class), ow_unused_var(obj_size));
-            if (ow_unlikely(!ow_object_meta_test_(MRK, obj->_meta)))
-                continue;
-            _ow_objmem_move_object_fields(obj);
+            if (ow_object_meta_test_(IMK, obj->_meta)) {
+                ow_object_meta_reset_(IMK, obj->_meta);
+                ow_object_meta_set_(MRK, obj->_meta);
+            }
+        });
+    });
+}
+
+/// Full GC: mark fields of recorded objects in remembered set that have been
+/// marked. Call this after `old_space_convert_incremental_marks()`.
+static void old_space_mark_remembered_marked_objects_fields(struct old_space *space) {
+    mem_chunk_list_foreach(&space->_chunks, chunk, {
+        struct old_space_chunk_meta *const chunk_meta =
+            old_space_chunk_meta_addr(chunk);
+        struct old_space_chunk_remembered_set *const r_set =
+            chunk_meta->remembered_set;
+        if (ow_likely(!r_set))
+            continue;
+        old_space_chunk_remembered_set_foreach(r_set, obj_offset, {
+            struct ow_object *const obj =
+                (struct ow_object *)((char *)chunk_meta + obj_offset);
+            if (ow_object_meta_test_(MRK, obj->_meta))
+                _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X);
         });
     });
 }
@@ -1244,7 +1671,7 @@ static void old_space_move_reallocated_objects(
 
 #if OW_DEBUG_MEMORY
 
-static int old_space_post_gc_check(struct old_space *space) {
+static int old_space_post_gc_check(struct old_space *space, bool inc_marking) {
     mem_chunk_list_foreach(&space->_chunks, chunk, {
         struct old_space_chunk_meta *const chunk_meta = old_space_chunk_meta_addr(chunk);
         if (chunk_meta->remembered_set)
@@ -1261,6 +1688,8 @@ static int old_space_post_gc_check(struct old_space *space) {
                 return -9;
             if (old_space_chunk_meta_of_obj(obj) != chunk_meta)
                 return -10;
+            if (!inc_marking && ow_object_meta_test_(IMK, obj->_meta))
+                return -11;
         });
     });
     return 0;
@@ -1338,12 +1767,13 @@ new_space_alloc(struct new_space *space, void *class_, size_t size) {
 /// For objects that survived only once, new storages are in the other chunk,
 /// which are still in new space. But the `MID` flag in object meta is set.
 /// For other (older) objects, new storages are allocated in old space.
-/// If the old space fails to allocate storage, they are kept in new space,
+/// If the old space fails to allocate storage, a chunk is added to it when
+/// `old_space_growable` is true; otherwise, they are kept in new space,
 /// and `false` will be returned at the end of function.
 /// New storage address is written to the `PTR` field of object meta.
 /// Dead objects are finalized.
 static bool new_space_realloc_and_copy_survivors(
-    struct new_space *space, struct old_space *old_space
+    struct new_space *space, struct old_space *old_space, bool old_space_growable
 ) {
     struct mem_chunk *const to_chunk = space->_free_chunk;
     mem_chunk_forget(to_chunk);
@@ -1369,8 +1799,14 @@ static bool new_space_realloc_and_copy_survivors(
                 goto alloc_in_new_space;
             new_obj = old_space_alloc(old_space, obj_class, obj_size);
             if (ow_unlikely(!new_obj)) {
-                old_space_is_full = true;
-                goto alloc_in_new_space;
+                if (old_space_growable) {
+                    old_space_add_chunk(old_space);
+                    new_obj = old_space_alloc(old_space, obj_class, obj_size);
+                    assert(new_obj);
+                } else {
+                    old_space_is_full = true;
+                    goto alloc_in_new_space;
+                }
             }
         }
 
@@ -1440,6 +1876,17 @@ static void new_space_update_references(struct new_space *space) {
     });
 }
 
+/// Incremental marking: mark old objects referred by objects in `working_chunk`,
+/// which shall be the survivors of a fast GC.
+static void new_space_mark_survivors_fields(struct new_space *space) {
+    mem_chunk_foreach_allocated_object(
+        space->_working_chunk, 0, obj, obj_class, obj_size,
+    {
+        (ow_unused_var(obj_class), ow_unused_var(obj_size));
+        mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_INC);
+    });
+}
+
 /// Full GC: update references like `new_space_update_references()`, but only
 /// references in objects that are not marked will be skipped.
 static void new_space_update_marked_references(struct new_space *space) {
@@ -1503,23 +1950,56 @@ static int new_space_post_gc_check(struct new_space *space) {
 
 /* ----- Public functions --------------------------------------------------- */
 
+/// Max number of objects visited in an incremental marking slice, or 0 if
+/// objects shall not be marked incrementally.
+static size_t gc_inc_slice_budget(void) {
+    return ow_sysparam.gc_slice_budget;
+}
+
+/// Number of threads to run parallel phases of a full GC.
+static size_t gc_full_thread_count(void) {
+    const size_t n = ow_sysparam.gc_threads;
+    if (!OW_OBJMETA_ATOMIC || n <= 1)
+        return 1;
+    return n < PAR_MAX_THREADS ? n : PAR_MAX_THREADS;
+}
+
 struct ow_objmem_context {
     size_t no_gc_count;   ///< If greater than 0, do not run GC.
+    struct new_space new_space;
     bool   force_full_gc; ///< GC type must be full GC.
     int8_t current_gc_type;
 
-    struct new_space new_space;
     struct old_space old_space;
     struct big_space big_space;
 
     struct mem_span_set gc_roots;
     struct mem_span_set weak_refs;
+
+    struct mark_stack mark_stack;
+
+    bool   inc_marking; ///< Incremental marking of old objects is in progress.
+    size_t inc_mark_chunk_limit; ///< Old space chunk count to start incremental marking, or to give it up.
+    struct mark_stack inc_mark_stack; ///< Marked old objects whose fields are to be visited.
+    struct mark_stack inc_defer_stack; ///< Marked old objects left to the mutator by the marking thread.
+
+    bool   conc_marking; ///< The marking thread is running.
+    bool   conc_quit; ///< Asks the marking thread to exit. Guarded by `conc_mutex`.
+    atomic_int conc_pausing; ///< The mutator is waiting for `conc_mutex`.
+    ow_mtx_t conc_mutex; ///< Held by the marking thread during a batch, and by the mutator during GC.
+    ow_thrd_t conc_thread;
 };
 
 static_assert(
     offsetof(struct ow_machine, objmem_context) == 0 &&
-    offsetof(struct ow_objmem_context, no_gc_count) == 0,
-    "_ow_objmem_ngc_count()");
+    offsetof(struct ow_objmem_context, no_gc_count) ==
+        offsetof(struct _ow_objmem_context_head, no_gc_count) &&
+    offsetof(struct ow_objmem_context, new_space) +
+        offsetof(struct new_space, _working_chunk) ==
+        offsetof(struct _ow_objmem_context_head, new_space_chunk) &&
+    offsetof(struct mem_chunk, _free) == offsetof(struct _ow_objmem_chunk_head, _free) &&
+    offsetof(struct mem_chunk, _end) == offsetof(struct _ow_objmem_chunk_head, _end),
+    "struct _ow_objmem_context_head");
 
 struct ow_objmem_context *ow_objmem_context_new(void) {
     struct ow_objmem_context *const ctx = ow_malloc(sizeof(struct ow_objmem_context));
@@ -1531,10 +2011,32 @@ struct ow_objmem_context *ow_objmem_context_new(void) {
     big_space_init(&ctx->big_space);
     mem_span_set_init(&ctx->gc_roots);
     mem_span_set_init(&ctx->weak_refs);
+    mark_stack_init(&ctx->mark_stack);
+    ctx->inc_marking = false;
+    ctx->inc_mark_chunk_limit = ctx->old_space.chunk_count;
+    mark_stack_init(&ctx->inc_mark_stack);
+    mark_stack_init(&ctx->inc_defer_stack);
+    ctx->conc_marking = false;
+    ctx->conc_quit = false;
+    atomic_store(&ctx->conc_pausing, 0);
+    ow_mtx_init(&ctx->conc_mutex, ow_mtx_plain);
     return ctx;
 }
 
+static void gc_conc_pause(struct ow_objmem_context *ctx);
+static void gc_conc_stop(struct ow_objmem_context *ctx);
+
 void ow_objmem_context_del(struct ow_objmem_context *ctx) {
+    if (ctx->conc_marking) {
+        gc_conc_pause(ctx);
+        gc_conc_stop(ctx);
+    }
+    ow_mtx_destroy(&ctx->conc_mutex);
+    mark_stack_clear(&ctx->inc_defer_stack);
+    mark_stack_fini(&ctx->inc_defer_stack);
+    mark_stack_clear(&ctx->inc_mark_stack);
+    mark_stack_fini(&ctx->inc_mark_stack);
+    mark_stack_fini(&ctx->mark_stack);
     mem_span_set_fini(&ctx->weak_refs);
     mem_span_set_fini(&ctx->gc_roots);
 
@@ -1576,7 +2078,7 @@ struct ow_object *ow_objmem_allocate(
         }
     }
 
-    assert(!ow_smallint_check(obj));
+    assert(!ow_smallval_check(obj));
     assert(ow_object_class(obj) == obj_class);
     return obj;
 }
@@ -1612,7 +2114,11 @@ struct ow_object *ow_objmem_allocate_ex(
     alloc_type_surv:
         obj = old_space_alloc(&ctx->old_space, obj_class, obj_size);
         if (ow_unlikely(!obj)) {
-            ow_objmem_gc(om, OW_OBJMEM_GC_FULL);
+            // Leave the space to incremental marking if it is in progress.
+            if (ctx->inc_marking)
+                old_space_add_chunk(&ctx->old_space);
+            else
+                ow_objmem_gc(om, OW_OBJMEM_GC_FULL);
             goto alloc_type_surv;
         }
     } else if (ow_likely(alloc_type == OW_OBJMEM_ALLOC_HUGE)) {
@@ -1640,12 +2146,33 @@ struct ow_object *ow_objmem_allocate_ex(
         ((struct _fake_extended_object *)obj)->field_count = obj_field_count;
     }
 
-    assert(!ow_smallint_check(obj));
+    assert(!ow_smallval_check(obj));
     assert(ow_object_class(obj) == obj_class);
     assert(ow_class_obj_object_field_count(obj_class, obj) == obj_field_count);
     return obj;
 }
 
+struct ow_object *_ow_objmem_allocate_slow(
+    struct ow_machine *om, struct ow_class_obj *obj_class, size_t field_count
+) {
+    const size_t basic_field_count = ow_class_obj_pub_info(obj_class)->basic_field_count;
+    assert(field_count >= basic_field_count);
+    return ow_objmem_allocate_ex(
+        om, OW_OBJMEM_ALLOC_AUTO, obj_class, field_count - basic_field_count);
+}
+
+bool _ow_objmem_check_field_count(
+    struct ow_class_obj *obj_class, bool extended, size_t field_count
+) {
+    const struct ow_class_obj_pub_info *const obj_class_info =
+        ow_class_obj_pub_info(obj_class);
+    if (obj_class_info->has_extra_fields != extended)
+        return false;
+    return extended ?
+        field_count >= obj_class_info->basic_field_count :
+        field_count == obj_class_info->basic_field_count;
+}
+
 void ow_objmem_add_gc_root(
     struct ow_machine *om,
     void *root, ow_objmem_obj_fields_visitor_t fn
@@ -1672,6 +2199,182 @@ bool ow_objmem_remove_weak_ref(struct ow_machine *om, void *ref_container) {
     return mem_span_set_remove(&ctx->weak_refs, ref_container);
 }
 
+/*
+ * Marking of a full GC can be done incrementally. Old objects reachable from GC
+ * roots are marked with the `IMK` flag in slices that run after fast GCs, while
+ * young objects are left to the final remark at the beginning of `gc_full()`.
+ * Marking starts from the GC roots and the young objects that survived a fast GC.
+ * Old objects do not move between slices. The write barrier records marked old
+ * objects that store unmarked old ones in remembered sets, whose fields will
+ * be visited again. Objects promoted during marking are visited as well.
+ *
+ * If enabled, old objects are marked on a helper thread while the mutator runs.
+ * The thread holds `conc_mutex` while marking a batch of objects, and the mutator
+ * holds it during each GC, so the GC itself never runs concurrently with marking.
+ * Objects whose fields are visited by native visitors, such as containers, may be
+ * changed by the mutator at any time. They are left to slices on the mutator.
+ * As the mark of an object may be stale for the mutator, the write barrier
+ * records any unmarked old object stored into an old one.
+ */
+
+/// Number of contexts whose old objects are being marked on helper threads.
+atomic_int _ow_objmem_concurrent_marking;
+
+/// Max number of objects visited by the marking thread each time it takes the mutex.
+#define CONC_MARK_BATCH_SIZE  ((size_t)256)
+
+/// Check whether fields of an object can be visited on the marking thread,
+/// i.e., they are all object fields rather than native data of the mutator.
+static bool object_fields_visitable_concurrently(struct ow_object *obj) {
+    return !ow_class_obj_pub_info(ow_object_class(obj))->gc_visitor;
+}
+
+/// Visit fields of at most `budget` objects in an incremental marking stack.
+/// Fields are pushed to `ctx->inc_mark_stack`. If `concurrent` is true, objects
+/// that cannot be visited on the marking thread are moved to `ctx->inc_defer_stack`.
+/// Return whether the stack becomes empty.
+static bool gc_inc_mark(
+    struct ow_objmem_context *ctx, struct mark_stack *stack, size_t budget, bool concurrent
+) {
+    struct mark_stack *const prev_mark_stack = current_mark_stack;
+    current_mark_stack = &ctx->inc_mark_stack;
+    for (; budget; budget--) {
+        struct ow_object *const obj = inc_mark_stack_pop(stack);
+        if (!obj)
+            break;
+        // Objects pushed by `gc_fast()` may have not been marked.
+        ow_object_meta_atomic_set_(IMK, obj->_meta);
+        if (concurrent && !object_fields_visitable_concurrently(obj))
+            inc_mark_stack_push(&ctx->inc_defer_stack, obj);
+        else
+            mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_INC);
+    }
+    current_mark_stack = prev_mark_stack;
+    return mark_stack_empty(stack);
+}
+
+/// Routine of the marking thread.
+static int gc_conc_thread_main(void *arg) {
+    struct ow_objmem_context *const ctx = arg;
+    for (bool idle = false; ; ) {
+        if (idle)
+            ow_thrd_sleep(&(struct timespec){.tv_sec = 0, .tv_nsec = 1000000}, NULL);
+        while (atomic_load(&ctx->conc_pausing))
+            ow_thrd_yield();
+        ow_mtx_lock(&ctx->conc_mutex);
+        if (ctx->conc_quit) {
+            ow_mtx_unlock(&ctx->conc_mutex);
+            return 0;
+        }
+        idle = gc_inc_mark(ctx, &ctx->inc_mark_stack, CONC_MARK_BATCH_SIZE, true);
+        ow_mtx_unlock(&ctx->conc_mutex);
+    }
+}
+
+/// Start the marking thread. It waits for the mutex, which is held by the
+/// caller until `gc_conc_resume()`. Return false if the thread cannot be created.
+static bool gc_conc_start(struct ow_objmem_context *ctx) {
+    assert(!ctx->conc_marking);
+    ow_mtx_lock(&ctx->conc_mutex);
+    ctx->conc_quit = false;
+    if (ow_thrd_create(&ctx->conc_thread, gc_conc_thread_main, ctx) != ow_thrd_success) {
+        ow_mtx_unlock(&ctx->conc_mutex);
+        return false;
+    }
+    ctx->conc_marking = true;
+    atomic_fetch_add(&_ow_objmem_concurrent_marking, 1);
+    return true;
+}
+
+/// Stop the marking thread, which shall have been paused. The mutex is released.
+static void gc_conc_stop(struct ow_objmem_context *ctx) {
+    assert(ctx->conc_marking);
+    ctx->conc_quit = true;
+    ow_mtx_unlock(&ctx->conc_mutex);
+    ow_thrd_join(ctx->conc_thread, NULL);
+    ctx->conc_marking = false;
+    atomic_fetch_sub(&_ow_objmem_concurrent_marking, 1);
+}
+
+/// Wait for the marking thread, if any, to finish its batch, and keep it waiting.
+static void gc_conc_pause(struct ow_objmem_context *ctx) {
+    if (!ctx->conc_marking)
+        return;
+    atomic_store(&ctx->conc_pausing, 1);
+    ow_mtx_lock(&ctx->conc_mutex);
+    atomic_store(&ctx->conc_pausing, 0);
+}
+
+/// Let the marking thread, if any, go on.
+static void gc_conc_resume(struct ow_objmem_context *ctx) {
+    if (ctx->conc_marking)
+        ow_mtx_unlock(&ctx->conc_mutex);
+}
+
+/// Start incremental marking right after a fast GC: mark old objects referred
+/// by GC roots and by young objects, all of which have just survived.
+static void gc_inc_start(struct ow_objmem_context *ctx) {
+    assert(!ctx->inc_marking && mark_stack_empty(&ctx->inc_mark_stack));
+    ctx->inc_marking = true;
+    ctx->inc_mark_chunk_limit = ctx->old_space.chunk_count * 2 + 2;
+
+    struct mark_stack *const prev_mark_stack = current_mark_stack;
+    current_mark_stack = &ctx->inc_mark_stack;
+    mem_span_set_foreach(
+        &ctx->gc_roots,
+        void *, gc_root,
+        ow_objmem_obj_fields_visitor_t, fields_visitor,
+    {
+        fields_visitor(gc_root, OW_OBJMEM_OBJ_VISIT_MARK_INC);
+    });
+    new_space_mark_survivors_fields(&ctx->new_space);
+    current_mark_stack = prev_mark_stack;
+
+    if (ow_sysparam.gc_concurrent)
+        gc_conc_start(ctx); // Marked in slices if failed.
+}
+
+/// Finish incremental marking. Incremental marks become GC marks, so that the
+/// marked objects will be taken as visited by `gc_full()`.
+static void gc_inc_finish(struct ow_objmem_context *ctx) {
+    assert(ctx->inc_marking);
+
+    if (ctx->conc_marking)
+        gc_conc_stop(ctx);
+    gc_inc_mark(ctx, &ctx->inc_defer_stack, (size_t)-1, false);
+    gc_inc_mark(ctx, &ctx->inc_mark_stack, (size_t)-1, false);
+    old_space_convert_incremental_marks(&ctx->old_space);
+    big_space_convert_incremental_marks(&ctx->big_space);
+
+    // Recorded objects may refer to young objects or unmarked old objects.
+    old_space_mark_remembered_marked_objects_fields(&ctx->old_space);
+    big_space_mark_remembered_marked_objects_fields(&ctx->big_space);
+
+    ctx->inc_marking = false;
+    mark_stack_shrink(&ctx->inc_mark_stack);
+    mark_stack_shrink(&ctx->inc_defer_stack);
+}
+
+/// Incremental marking after a fast GC: start marking if old space has grown
+/// since last full GC, and run a slice, which visits objects left by the marking
+/// thread if it is running. Ask for a full GC if marking is done, or if it falls behind.
+static void gc_inc_step(struct ow_objmem_context *ctx) {
+    const size_t budget = gc_inc_slice_budget();
+
+    if (!ctx->inc_marking) {
+        if (!budget || ctx->old_space.chunk_count <= ctx->inc_mark_chunk_limit)
+            return;
+        gc_inc_start(ctx);
+    }
+
+    struct mark_stack *const stack =
+        ctx->conc_marking ? &ctx->inc_defer_stack : &ctx->inc_mark_stack;
+    if (!budget || (gc_inc_mark(ctx, stack, budget, false) &&
+            mark_stack_empty(&ctx->inc_mark_stack)) ||
+            ctx->old_space.chunk_count > ctx->inc_mark_chunk_limit)
+        ctx->force_full_gc = true;
+}
+
 /// Fast (young) GC implementation.
 static void gc_fast(struct ow_objmem_context *ctx) {
     // ## 1  Mark reachable young objects.
@@ -1696,6 +2399,13 @@ static void gc_fast(struct ow_objmem_context *ctx) {
     const size_t big_spc_cnt_hint =
         big_space_mark_remembered_objects_young_fields(&ctx->big_space);
 
+    // ### 1.4  Visit remembered objects again if they have been marked incrementally.
+
+    if (ctx->inc_marking) {
+        old_space_push_remembered_marked_objects(&ctx->old_space, &ctx->inc_mark_stack);
+        big_space_push_remembered_marked_objects(&ctx->big_space, &ctx->inc_mark_stack);
+    }
+
     // ## 2  Clean up unused weak references.
 
     mem_span_set_foreach(
@@ -1711,7 +2421,9 @@ static void gc_fast(struct ow_objmem_context *ctx) {
     const struct old_space_iterator old_spc_orig_end =
         old_space_allocated_end(&ctx->old_space);
 
-    if (!new_space_realloc_and_copy_survivors(&ctx->new_space, &ctx->old_space))
+    const bool old_spc_growable = ctx->inc_marking || gc_inc_slice_budget();
+    if (!new_space_realloc_and_copy_survivors(
+            &ctx->new_space, &ctx->old_space, old_spc_growable))
         ctx->force_full_gc = true; // Run full GC next time.
 
     /* `_ow_objmem_mark_old_referred_object_young_fields()` is used when marking
@@ -1759,19 +2471,57 @@ static void gc_fast(struct ow_objmem_context *ctx) {
     {
         visitor(weak_ref, OW_OBJMEM_WEAK_REF_VISIT_MOVE);
     });
+
+    // ## 5  Visit promoted objects if marking incrementally.
+
+    if (ctx->inc_marking)
+        old_space_push_objects_from(&ctx->old_space, old_spc_orig_end, &ctx->inc_mark_stack);
 }
 
 /// Full (young + old) GC implementation.
-static void gc_full(struct ow_objmem_context *ctx) {
-    // ## 1  Mark reachable objects in GC roots.
-
+/// Mark objects reachable from GC roots with `thread_count` threads.
+static void gc_full_mark_parallel(struct ow_objmem_context *ctx, size_t thread_count) {
+    struct par_mark_context *const par = par_mark_context_new(thread_count);
+    struct par_mark_worker *const w0 = &par->workers[0];
+
+    // Objects in GC roots are shared, so that any thread can start with them.
+    struct mark_stack *const prev_mark_stack = current_mark_stack;
+    current_mark_stack = &w0->stack;
     mem_span_set_foreach(
         &ctx->gc_roots,
         void *, gc_root,
         ow_objmem_obj_fields_visitor_t, fields_visitor,
     {
-        fields_visitor(gc_root, OW_OBJMEM_OBJ_VISIT_MARK_REC);
+        fields_visitor(gc_root, OW_OBJMEM_OBJ_VISIT_MARK_PAR);
     });
+    current_mark_stack = prev_mark_stack;
+    par_mark_worker_share(par, w0, w0->stack._size);
+
+    par_run(thread_count, par_mark_thread_main, par);
+    par_mark_context_del(par);
+}
+
+static void gc_full(struct ow_objmem_context *ctx) {
+    const size_t thread_count = gc_full_thread_count();
+
+    // ## 0  Finish incremental marking, which is the remark phase.
+
+    if (ctx->inc_marking)
+        gc_inc_finish(ctx);
+
+    // ## 1  Mark reachable objects in GC roots.
+
+    if (thread_count > 1) {
+        gc_full_mark_parallel(ctx, thread_count);
+    } else {
+        mem_span_set_foreach(
+            &ctx->gc_roots,
+            void *, gc_root,
+            ow_objmem_obj_fields_visitor_t, fields_visitor,
+        {
+            fields_visitor(gc_root, OW_OBJMEM_OBJ_VISIT_MARK_REC);
+        });
+    }
 
     // ## 2  Clean up unused weak references.
 
@@ -1806,7 +2556,7 @@ static void gc_full(struct ow_objmem_context *ctx) {
 
     // ### 4.2  Update references in old space.
 
-    old_space_update_references(&ctx->old_space);
+    old_space_update_references(&ctx->old_space, thread_count);
 
     // ### 4.3  Update references in big space.
 
@@ -1848,6 +2598,7 @@ static void gc_full(struct ow_objmem_context *ctx) {
     // ### 5.3  Clean up unused old space chunks.
 
     old_space_truncate(&ctx->old_space, old_spc_realloc_iter);
+    ctx->inc_mark_chunk_limit = ctx->old_space.chunk_count;
 
     // TODO: adjust big space threshold.
 }
@@ -1865,6 +2616,7 @@ int ow_objmem_gc(struct ow_machine *om, enum ow_objmem_gc_type type) {
         type = OW_OBJMEM_GC_FAST;
     }
     ctx->current_gc_type = (int8_t)type;
+    gc_conc_pause(ctx);
 
 #if OW_DEBUG_MEMORY
     ow_debuglog_print(
@@ -1876,12 +2628,17 @@ int ow_objmem_gc(struct ow_machine *om, enum ow_objmem_gc_type type) {
     timespec_get(&ts0, TIME_UTC);
 #endif // OW_DEBUG_MEMORY
 
-    if (type == OW_OBJMEM_GC_FAST)
+    struct mark_stack *const prev_mark_stack = current_mark_stack;
+    current_mark_stack = &ctx->mark_stack;
+    if (type == OW_OBJMEM_GC_FAST) {
         gc_fast(ctx);
-    else if (type == OW_OBJMEM_GC_FULL)
+        gc_inc_step(ctx);
+    } else if (type == OW_OBJMEM_GC_FULL)
         gc_full(ctx);
     else
         type = OW_OBJMEM_GC_NONE; // Illegal type.
+    current_mark_stack = prev_mark_stack;
+    mark_stack_shrink(&ctx->mark_stack);
 
 #if OW_DEBUG_MEMORY
     struct timespec ts1;
@@ -1900,10 +2657,11 @@ int ow_objmem_gc(struct ow_machine *om, enum ow_objmem_gc_type type) {
     });
 
     assert(!new_space_post_gc_check(&ctx->new_space));
-    assert(!old_space_post_gc_check(&ctx->old_space));
-    assert(!big_space_post_gc_check(&ctx->big_space));
+    assert(!old_space_post_gc_check(&ctx->old_space, ctx->inc_marking));
+    assert(!big_space_post_gc_check(&ctx->big_space, ctx->inc_marking));
 #endif // OW_DEBUG_MEMORY
 
+    gc_conc_resume(ctx);
     ctx->current_gc_type = (int8_t)OW_OBJMEM_GC_NONE;
 
     return (int)type;
@@ -1928,8 +2686,8 @@ void ow_objmem_print_usage(struct ow_objmem_context *ctx, void *FILE_ptr) {
     FILE *stream = FILE_ptr ? FILE_ptr : stderr;
 
     fprintf(
-        stream, "<ObjMem context=\"%p\" force_full_gc=\"%s\">\n",
-        (void *)ctx, ctx->force_full_gc ? "yes" : "no"
+        stream, "<ObjMem context=\"%p\" force_full_gc=\"%s\" inc_marking=\"%s\">\n",
+        (void *)ctx, ctx->force_full_gc ? "yes" : "no", ctx->inc_marking ? "yes" : "no"
     );
     new_space_print_usage(&ctx->new_space, stream);
     old_space_print_usage(&ctx->old_space, stream);
@@ -1946,21 +2704,23 @@ void ow_objmem_print_usage(struct ow_objmem_context *ctx, void *FILE_ptr) {
 #endif
 }
 
-ow_noinline void _ow_objmem_mark_object_fields_rec(struct ow_object *obj) {
+/// Visit fields of a marked object with a marking operation.
+static void mark_object_fields(struct ow_object *obj, enum ow_objmem_obj_visit_op op) {
     struct ow_class_obj *const obj_class = ow_object_class(obj);
     const struct ow_class_obj_pub_info *const info =
         ow_class_obj_pub_info(obj_class);
 
-    _ow_objmem_visit_object_do_mark(
-        ow_object_from(obj_class),
-        OW_OBJMEM_OBJ_VISIT_MARK_REC
-    );
+    if (op == OW_OBJMEM_OBJ_VISIT_MARK_REC || op == OW_OBJMEM_OBJ_VISIT_MARK_INC ||
+            op == OW_OBJMEM_OBJ_VISIT_MARK_PAR)
+        _ow_objmem_visit_object_do_mark(ow_object_from(obj_class), op);
+    else
+        assert(ow_object_meta_test_(OLD, ow_object_from(obj_class)->_meta));
 
     size_t field_index;
     if (ow_unlikely(info->native_field_count)) {
         const ow_objmem_obj_fields_visitor_t fields_visitor = info->gc_visitor;
         if (fields_visitor)
-            fields_visitor(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC);
+            fields_visitor(obj, op);
         if (info->has_extra_fields)
             return; // Extra fields shall have been visited by `fields_visitor`.
         field_index = info->native_field_count;
@@ -1972,122 +2732,45 @@ ow_noinline void _ow_objmem_mark_object_fields_rec(struct ow_object *obj) {
 
     const size_t field_count = info->basic_field_count;
     assert(field_index <= field_count);
-    for (; field_index < field_count; field_index++) {
-        ow_objmem_visit_object(
-            obj->_fields[field_index],
-            OW_OBJMEM_OBJ_VISIT_MARK_REC
-        );
-    }
-}
-
-ow_noinline void _ow_objmem_mark_object_young_fields_rec(struct ow_object *obj) {
-    // Modified from `_ow_objmem_mark_object_fields_rec()`.
-
-    struct ow_class_obj *const obj_class = ow_object_class(obj);
-    const struct ow_class_obj_pub_info *const info =
-        ow_class_obj_pub_info(obj_class);
-
-    assert(ow_object_meta_test_(OLD, ow_object_from(obj_class)->_meta));
-
-    size_t field_index;
-    if (ow_unlikely(info->native_field_count)) {
-        const ow_objmem_obj_fields_visitor_t fields_visitor = info->gc_visitor;
-        if (fields_visitor)
-            fields_visitor(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_Y);
-        if (info->has_extra_fields)
-            return;
-        field_index = info->native_field_count;
-    } else {
-        assert(!info->gc_visitor);
-        assert(!info->has_extra_fields);
-        field_index = 0;
-    }
-
-    const size_t field_count = info->basic_field_count;
-    assert(field_index <= field_count);
-    for (; field_index < field_count; field_index++) {
-        ow_objmem_visit_object(
-            obj->_fields[field_index],
-            OW_OBJMEM_OBJ_VISIT_MARK_REC_Y
-        );
-    }
+    for (; field_index < field_count; field_index++)
+        ow_objmem_visit_object(obj->_fields[field_index], op);
 }
 
-void _ow_objmem_mark_old_referred_object_fields_rec(struct ow_object *obj) {
-    // Modified from `_ow_objmem_mark_object_fields_rec()`.
-
-    struct ow_class_obj *const obj_class = ow_object_class(obj);
-    const struct ow_class_obj_pub_info *const info =
-        ow_class_obj_pub_info(obj_class);
-
-    assert(ow_object_meta_test_(OLD, ow_object_from(obj_class)->_meta));
-
-    size_t field_index;
-    if (ow_unlikely(info->native_field_count)) {
-        const ow_objmem_obj_fields_visitor_t fields_visitor = info->gc_visitor;
-        if (fields_visitor)
-            fields_visitor(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X);
-        if (info->has_extra_fields)
-            return;
-        field_index = info->native_field_count;
-    } else {
-        assert(!info->gc_visitor);
-        assert(!info->has_extra_fields);
-        field_index = 0;
+ow_noinline void _ow_objmem_mark_object_fields(
+    struct ow_object *obj, enum ow_objmem_obj_visit_op op
+) {
+    struct mark_stack *const stack = current_mark_stack;
+    assert(stack);
+    if (op == OW_OBJMEM_OBJ_VISIT_MARK_INC) {
+        inc_mark_stack_push(stack, obj); // Visited by `gc_inc_mark()`.
+        return;
     }
-
-    const size_t field_count = info->basic_field_count;
-    assert(field_index <= field_count);
-    for (; field_index < field_count; field_index++) {
-        ow_objmem_visit_object(
-            obj->_fields[field_index],
-            OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X
-        );
+    if (op == OW_OBJMEM_OBJ_VISIT_MARK_PAR || op == OW_OBJMEM_OBJ_VISIT_MARK_PAR_O2X) {
+        // Visited by `par_mark_thread_main()`, where the op is restored.
+        mark_stack_push(stack, obj, op == OW_OBJMEM_OBJ_VISIT_MARK_PAR ?
+            OW_OBJMEM_OBJ_VISIT_MARK_REC : OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X);
+        return;
     }
-}
-
-ow_noinline void _ow_objmem_mark_old_referred_object_young_fields_rec(struct ow_object *obj) {
-    // Modified from `_ow_objmem_mark_object_fields_rec()`.
-
-    struct ow_class_obj *const obj_class = ow_object_class(obj);
-    const struct ow_class_obj_pub_info *const info =
-        ow_class_obj_pub_info(obj_class);
+    mark_stack_push(stack, obj, op);
+    if (stack->_draining)
+        return; // The caller is visiting fields of another object.
 
-    assert(ow_object_meta_test_(OLD, ow_object_from(obj_class)->_meta));
-
-    size_t field_index;
-    if (ow_unlikely(info->native_field_count)) {
-        const ow_objmem_obj_fields_visitor_t fields_visitor = info->gc_visitor;
-        if (fields_visitor)
-            fields_visitor(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_O2Y);
-        if (info->has_extra_fields)
-            return;
-        field_index = info->native_field_count;
-    } else {
-        assert(!info->gc_visitor);
-        assert(!info->has_extra_fields);
-        field_index = 0;
-    }
-
-    const size_t field_count = info->basic_field_count;
-    assert(field_index <= field_count);
-    for (; field_index < field_count; field_index++) {
-        ow_objmem_visit_object(
-            obj->_fields[field_index],
-            OW_OBJMEM_OBJ_VISIT_MARK_REC_O2Y
-        );
-    }
+    stack->_draining = true;
+    while (mark_stack_pop(stack, &obj, &op))
+        mark_object_fields(obj, op);
+    stack->_draining = false;
 }
 
 ow_noinline void _ow_objmem_move_object_fields(struct ow_object *obj) {
-    // Modified from `_ow_objmem_mark_object_fields_rec()`.
+    // Modified from `mark_object_fields()`.
 
     struct ow_class_obj *obj_class = ow_object_class(obj);
     const struct ow_class_obj_pub_info *const info =
         ow_class_obj_pub_info(obj_class); // DO NOT get info after class ptr updated.
 
+    // Other update threads may be reading the `MRK` flag in the same word.
     if (ow_unlikely(_ow_objmem_visit_object_do_move((struct ow_object **)&obj_class)))
-        ow_object_meta_store_(CLS, obj->_meta, obj_class);
+        ow_object_meta_atomic_store_(CLS, obj->_meta, obj_class);
 
     size_t field_index;
     if (ow_unlikely(info->native_field_count)) {
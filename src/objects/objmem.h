@@ -5,11 +5,13 @@
 #include <stddef.h>
 
 #include "object.h"
+#include "object_util.h"
 #include "smallint.h"
 
 #include <utilities/attributes.h>
 #include <utilities/unreachable.h>
 
+struct ow_class_obj;
 struct ow_machine;
 
 /// Context of object memory management.
@@ -47,6 +49,15 @@ struct ow_object *ow_objmem_allocate(
 struct ow_object *ow_objmem_allocate_ex(
     struct ow_machine *om, enum ow_objmem_alloc_type alloc_type,
     struct ow_class_obj *obj_class, size_t extra_field_count);
+/// Allocate object memory like `ow_objmem_allocate()`, but the number of fields
+/// is given by the caller. Allocation in new space is inlined.
+ow_static_forceinline struct ow_object *ow_objmem_allocate_fast(
+    struct ow_machine *om, struct ow_class_obj *obj_class, size_t field_count);
+/// Allocate object memory like `ow_objmem_allocate_ex()` with type `OW_OBJMEM_ALLOC_AUTO`
+/// for a class that has extra fields. Param `field_count` is the total number of
+/// fields, i.e., the basic field count plus the extra field count.
+ow_static_forceinline struct ow_object *ow_objmem_allocate_fast_ex(
+    struct ow_machine *om, struct ow_class_obj *obj_class, size_t field_count);
 
 /// Add GC root, along with its GC functions.
 void ow_objmem_add_gc_root(
@@ -85,6 +96,9 @@ enum ow_objmem_obj_visit_op {
     OW_OBJMEM_OBJ_VISIT_MARK_REC_Y, ///< mark reachable young object and its fields recursively
     OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X, ///< mark reachable object referred by old and its fields recursively
     OW_OBJMEM_OBJ_VISIT_MARK_REC_O2Y, ///< mark reachable young object referred by old and its fields recursively
+    OW_OBJMEM_OBJ_VISIT_MARK_INC, ///< mark reachable old object for incremental marking; fields are visited later
+    OW_OBJMEM_OBJ_VISIT_MARK_PAR, ///< mark reachable object like `MARK_REC` in parallel marking; fields are visited later
+    OW_OBJMEM_OBJ_VISIT_MARK_PAR_O2X, ///< mark reachable object like `MARK_REC_O2X` in parallel marking; fields are visited later
     OW_OBJMEM_OBJ_VISIT_MOVE, ///< update reference to moved object
 };
 
@@ -94,17 +108,18 @@ enum ow_objmem_weak_ref_visit_op {
     OW_OBJMEM_WEAK_REF_VISIT_MOVE, ///< update reference to moved object
 };
 
-/// Record an old object that stores an young object.
-/// `obj` must be in old generation and contains young object field.
+/// Record an old object that stores an young object, or, during incremental
+/// marking, a marked old object that stores an unmarked one.
+/// `obj` must be in old generation. See `ow_object_write_barrier()`.
 void ow_objmem_record_o2y_object(struct ow_object *obj);
 
 /// GC: visit an object. Parameter `obj` must be a field in an object, and be
 /// the variable itself, so that it is assignable and can be updated correctly.
-/// If `obj` is a small int, it will be ignored. Usually used in a
+/// If `obj` is a small int or small float, it will be ignored. Usually used in a
 /// `ow_objmem_obj_fields_visitor_t` function.
 #define ow_objmem_visit_object(obj, op) \
     do {                                \
-        if (ow_unlikely(ow_smallint_check((struct ow_object *)(obj)))) \
+        if (ow_unlikely(ow_smallval_check((struct ow_object *)(obj)))) \
             break;                      \
         const enum ow_objmem_obj_visit_op __op = (enum ow_objmem_obj_visit_op)(op); \
         if (__op != OW_OBJMEM_OBJ_VISIT_MOVE)                          \
@@ -144,8 +159,26 @@ void ow_objmem_print_usage(struct ow_objmem_context *ctx, void *FILE_ptr);
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Max size of an object allocated in new space or old space.
+#define _OW_OBJMEM_NON_BIG_SPACE_MAX_ALLOC_SIZE ((size_t)8 * 1024)
+
+/// Leading members of `struct ow_objmem_context`.
+struct _ow_objmem_context_head {
+    size_t no_gc_count;
+    struct _ow_objmem_chunk_head {
+        char *_free;
+        char *_end;
+    } *new_space_chunk; // The chunk where new objects are allocated.
+};
+
+ow_static_forceinline struct _ow_objmem_context_head *_ow_objmem_context_head(
+    struct ow_machine *om
+) {
+    return *(struct _ow_objmem_context_head **)om;
+}
+
 ow_static_forceinline size_t *_ow_objmem_ngc_count(struct ow_machine *om) {
-    return (size_t *)*(struct ow_objmem_context **)om;
+    return &_ow_objmem_context_head(om)->no_gc_count;
 }
 
 ow_static_forceinline void ow_objmem_push_ngc(struct ow_machine *om) {
@@ -162,16 +195,60 @@ ow_static_forceinline bool ow_objmem_test_ngc(struct ow_machine *om) {
     return *_ow_objmem_ngc_count(om) > 0;
 }
 
-void _ow_objmem_mark_object_fields_rec(struct ow_object *obj);
-void _ow_objmem_mark_object_young_fields_rec(struct ow_object *obj);
-void _ow_objmem_mark_old_referred_object_fields_rec(struct ow_object *obj);
-void _ow_objmem_mark_old_referred_object_young_fields_rec(struct ow_object *obj);
+struct ow_object *_ow_objmem_allocate_slow(
+    struct ow_machine *om, struct ow_class_obj *obj_class, size_t field_count);
+bool _ow_objmem_check_field_count(
+    struct ow_class_obj *obj_class, bool extended, size_t field_count);
+
+/// Allocate in new space by bumping the free pointer. Return NULL if not possible.
+ow_static_forceinline struct ow_object *_ow_objmem_allocate_bump(
+    struct ow_machine *om, struct ow_class_obj *obj_class, size_t obj_size
+) {
+    if (ow_unlikely(obj_size > _OW_OBJMEM_NON_BIG_SPACE_MAX_ALLOC_SIZE))
+        return NULL;
+    struct _ow_objmem_chunk_head *const chunk = _ow_objmem_context_head(om)->new_space_chunk;
+    char *const ptr = chunk->_free;
+    if (ow_unlikely((size_t)(chunk->_end - ptr) <= obj_size))
+        return NULL;
+    chunk->_free = ptr + obj_size;
+    struct ow_object *const obj = (struct ow_object *)ptr;
+    assert(ow_object_meta_check_value(obj_class));
+    ow_object_meta_init(obj->_meta, false, false, 0U, obj_class);
+    return obj;
+}
+
+ow_static_forceinline struct ow_object *ow_objmem_allocate_fast(
+    struct ow_machine *om, struct ow_class_obj *obj_class, size_t field_count
+) {
+    assert(_ow_objmem_check_field_count(obj_class, false, field_count));
+    struct ow_object *const obj =
+        _ow_objmem_allocate_bump(om, obj_class, OW_OBJECT_SIZE(field_count));
+    if (ow_likely(obj))
+        return obj;
+    return _ow_objmem_allocate_slow(om, obj_class, field_count);
+}
+
+ow_static_forceinline struct ow_object *ow_objmem_allocate_fast_ex(
+    struct ow_machine *om, struct ow_class_obj *obj_class, size_t field_count
+) {
+    assert(_ow_objmem_check_field_count(obj_class, true, field_count));
+    struct ow_object *const obj =
+        _ow_objmem_allocate_bump(om, obj_class, OW_OBJECT_SIZE(field_count));
+    if (ow_likely(obj)) {
+        struct _fake_extended_object { OW_EXTENDED_OBJECT_HEAD };
+        ((struct _fake_extended_object *)obj)->field_count = field_count;
+        return obj;
+    }
+    return _ow_objmem_allocate_slow(om, obj_class, field_count);
+}
+
+void _ow_objmem_mark_object_fields(struct ow_object *obj, enum ow_objmem_obj_visit_op op);
 void _ow_objmem_move_object_fields(struct ow_object *obj);
 
 ow_static_forceinline void _ow_objmem_visit_object_do_mark(
     struct ow_object *obj, enum ow_objmem_obj_visit_op op
 ) {
-    assert(!ow_smallint_check(obj));
+    assert(!ow_smallval_check(obj));
 
     switch (op) {
     case OW_OBJMEM_OBJ_VISIT_MARK_REC:
@@ -182,9 +259,9 @@ ow_static_forceinline void _ow_objmem_visit_object_do_mark(
         ow_object_meta_set_(MRK, obj->_meta);
         // Mark its fields. If old or newly-old (`YOUNG-MID`), use op `OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X`.
         if (ow_object_meta_test_(OLD, obj->_meta) || ow_object_meta_test_(MID, obj->_meta))
-            _ow_objmem_mark_old_referred_object_fields_rec(obj);
+            _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X);
         else
-            _ow_objmem_mark_object_fields_rec(obj);
+            _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC);
         return;
 
     case OW_OBJMEM_OBJ_VISIT_MARK_REC_Y:
@@ -195,9 +272,9 @@ ow_static_forceinline void _ow_objmem_visit_object_do_mark(
         ow_object_meta_set_(MRK, obj->_meta);
         // Mark its fields. If newly-old (`YOUNG-MID`), use op `OW_OBJMEM_OBJ_VISIT_MARK_REC_O2Y`.
         if (ow_object_meta_test_(MID, obj->_meta))
-            _ow_objmem_mark_old_referred_object_young_fields_rec(obj);
+            _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_O2Y);
         else
-            _ow_objmem_mark_object_young_fields_rec(obj);
+            _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_Y);
         return;
 
     case OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X:
@@ -210,7 +287,7 @@ ow_static_forceinline void _ow_objmem_visit_object_do_mark(
         if (!ow_object_meta_test_(OLD, obj->_meta) && !ow_object_meta_test_(MID, obj->_meta))
             ow_object_meta_set_(MID, obj->_meta);
         // Mark its fields.
-        _ow_objmem_mark_old_referred_object_fields_rec(obj);
+        _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X);
         return;
 
     case OW_OBJMEM_OBJ_VISIT_MARK_REC_O2Y:
@@ -223,7 +300,45 @@ ow_static_forceinline void _ow_objmem_visit_object_do_mark(
         if (!ow_object_meta_test_(MID, obj->_meta))
             ow_object_meta_set_(MID, obj->_meta);
         // Mark its fields.
-        _ow_objmem_mark_old_referred_object_young_fields_rec(obj);
+        _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_REC_O2Y);
+        return;
+
+    case OW_OBJMEM_OBJ_VISIT_MARK_INC:
+        // Ignore if young or marked. Young objects are marked in the final remark.
+        // Flags are accessed atomically, as the mutator and the marking thread
+        // may access them at the same time.
+        if (!ow_object_meta_atomic_test_(OLD, obj->_meta) ||
+                ow_object_meta_atomic_test_(IMK, obj->_meta))
+            return;
+        // Mark itself.
+        ow_object_meta_atomic_set_(IMK, obj->_meta);
+        // Mark its fields later.
+        _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_INC);
+        return;
+
+    case OW_OBJMEM_OBJ_VISIT_MARK_PAR:
+        // Ignore if marked, or if another thread marks it first.
+        if (ow_object_meta_atomic_test_(MRK, obj->_meta) ||
+                ow_object_meta_test_and_set_(MRK, obj->_meta))
+            return;
+        // Mark its fields later, like `OW_OBJMEM_OBJ_VISIT_MARK_REC`.
+        if (ow_object_meta_test_(OLD, obj->_meta) || ow_object_meta_test_(MID, obj->_meta))
+            _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_PAR_O2X);
+        else
+            _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_PAR);
+        return;
+
+    case OW_OBJMEM_OBJ_VISIT_MARK_PAR_O2X:
+        // Ignore if marked, or if another thread marks it first.
+        if (ow_object_meta_atomic_test_(MRK, obj->_meta) ||
+                ow_object_meta_test_and_set_(MRK, obj->_meta))
+            return;
+        // Make it `YOUNG/MID` like `OW_OBJMEM_OBJ_VISIT_MARK_REC_O2X`.
+        // Set atomically like other flags written during parallel marking.
+        if (!ow_object_meta_test_(OLD, obj->_meta) && !ow_object_meta_test_(MID, obj->_meta))
+            ow_object_meta_atomic_set_(MID, obj->_meta);
+        // Mark its fields later.
+        _ow_objmem_mark_object_fields(obj, OW_OBJMEM_OBJ_VISIT_MARK_PAR_O2X);
         return;
 
     default:
@@ -233,9 +348,11 @@ ow_static_forceinline void _ow_objmem_visit_object_do_mark(
 
 ow_static_forceinline bool _ow_objmem_visit_object_do_move(struct ow_object **obj_ref) {
     struct ow_object *obj = *obj_ref;
-    assert(!ow_smallint_check(obj));
+    assert(!ow_smallval_check(obj));
 
-    if (!ow_object_meta_test_(MRK, obj->_meta))
+    // Atomic, as the class pointer in the same word may be being updated by
+    // another thread in parallel reference updating.
+    if (!ow_object_meta_atomic_test_(MRK, obj->_meta))
         return false;
 
     // Pointer to the new storage shall have been stored in the PTR field in object meta.
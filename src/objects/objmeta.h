@@ -15,7 +15,7 @@ struct ow_object_meta {
      * - `MID`: valid when OLD = 0; 0 = new object, 1 = young object survived once
      * - `BIG`: valid when OLD = 1; 0 = small object, 1 = large object
      * - `MRK`: GC reachable mark; 0 = unreachable or not marking, 1 = reachable
-     * - `XXX`: (reserved)
+     * - `IMK`: valid when OLD = 1; incremental marking mark; 0 = not marked, 1 = marked
      *
      * Values:
      * - `PTR`: pointer used by GC system
@@ -41,8 +41,8 @@ struct ow_object_meta {
 #define OW_OBJMETA_PTR_MVAR    _1
 #define OW_OBJMETA_PTR_MASK    (~(uintptr_t)3U)
 
-#define OW_OBJMETA_XXX_MVAR    _2
-#define OW_OBJMETA_XXX_MASK    ((uintptr_t)1U)
+#define OW_OBJMETA_IMK_MVAR    _2
+#define OW_OBJMETA_IMK_MASK    ((uintptr_t)1U)
 
 #define OW_OBJMETA_MRK_MVAR    _2
 #define OW_OBJMETA_MRK_MASK    ((uintptr_t)2U)
@@ -94,6 +94,76 @@ struct ow_object_meta {
 #define ow_object_meta_reset_(NAME, obj_meta) \
     ((obj_meta). OW_OBJMETA_##NAME##_MVAR &= ~ OW_OBJMETA_##NAME##_MASK)
 
+/*
+ * Meta words that another thread may access at the same time (by GC threads, or
+ * by the mutator while a GC thread is marking) are accessed with the relaxed
+ * atomic operations below. Macro `OW_OBJMETA_ATOMIC` is 0 if they are not atomic.
+ */
+
+#if defined(__GNUC__)
+#    define OW_OBJMETA_ATOMIC 1
+#    define _ow_object_meta_word_load(var) \
+    __atomic_load_n(&(var), __ATOMIC_RELAXED)
+#    define _ow_object_meta_word_store(var, val) \
+    __atomic_store_n(&(var), (val), __ATOMIC_RELAXED)
+#    define _ow_object_meta_word_fetch_or(var, val) \
+    __atomic_fetch_or(&(var), (val), __ATOMIC_RELAXED)
+#elif defined(_MSC_VER)
+#    include <intrin.h>
+#    define OW_OBJMETA_ATOMIC 1
+#    define _ow_object_meta_word_load(var) \
+    (*(volatile uintptr_t *)&(var))
+#    define _ow_object_meta_word_store(var, val) \
+    (*(volatile uintptr_t *)&(var) = (val))
+#    if OW_WORDSIZE == 64
+#        define _ow_object_meta_word_fetch_or(var, val) \
+    ((uintptr_t)_InterlockedOr64((volatile long long *)&(var), (long long)(val)))
+#    else
+#        define _ow_object_meta_word_fetch_or(var, val) \
+    ((uintptr_t)_InterlockedOr((volatile long *)&(var), (long)(val)))
+#    endif
+#else
+#    define OW_OBJMETA_ATOMIC 0
+#    define _ow_object_meta_word_load(var) \
+    (var)
+#    define _ow_object_meta_word_store(var, val) \
+    ((var) = (val))
+#    define _ow_object_meta_word_fetch_or(var, val) \
+    _ow_object_meta_word_fetch_or_func(&(var), (val))
+static inline uintptr_t _ow_object_meta_word_fetch_or_func(uintptr_t *p, uintptr_t val) {
+    const uintptr_t orig = *p;
+    *p = orig | val;
+    return orig;
+}
+#endif
+
+/// Get value atomically.
+#define ow_object_meta_atomic_load_(NAME, type, obj_meta) \
+    ((type)(_ow_object_meta_word_load((obj_meta). OW_OBJMETA_##NAME##_MVAR) \
+        & OW_OBJMETA_##NAME##_MASK))
+
+/// Set value atomically. Other threads may read the word, but not write it.
+#define ow_object_meta_atomic_store_(NAME, obj_meta, value) \
+    _ow_object_meta_word_store((obj_meta). OW_OBJMETA_##NAME##_MVAR, \
+        (_ow_object_meta_word_load((obj_meta). OW_OBJMETA_##NAME##_MVAR) \
+            & ~ OW_OBJMETA_##NAME##_MASK) | (uintptr_t)(value))
+
+/// Test flag atomically (return 0 for false and non-0 for true).
+#define ow_object_meta_atomic_test_(NAME, obj_meta) \
+    (_ow_object_meta_word_load((obj_meta). OW_OBJMETA_##NAME##_MVAR) \
+        & OW_OBJMETA_##NAME##_MASK)
+
+/// Set flag to true atomically.
+#define ow_object_meta_atomic_set_(NAME, obj_meta) \
+    ((void)_ow_object_meta_word_fetch_or((obj_meta). OW_OBJMETA_##NAME##_MVAR, \
+        OW_OBJMETA_##NAME##_MASK))
+
+/// Set flag to true atomically, and test the original value (return 0 for false
+/// and non-0 for true).
+#define ow_object_meta_test_and_set_(NAME, obj_meta) \
+    (_ow_object_meta_word_fetch_or((obj_meta). OW_OBJMETA_##NAME##_MVAR, \
+        OW_OBJMETA_##NAME##_MASK) & OW_OBJMETA_##NAME##_MASK)
+
 /// Check whether a value can be stored into the meta.
 #define ow_object_meta_check_value(val) \
     ((sizeof(val) <= sizeof(uintptr_t)) && !((uintptr_t)val & (uintptr_t)3U))
@@ -0,0 +1,216 @@
+#include "rangeobj.h"
+
+#include <assert.h>
+
+#include "classes.h"
+#include "classes_util.h"
+#include "exceptionobj.h"
+#include "intobj.h"
+#include "objmem.h"
+#include "natives.h"
+#include "object_util.h"
+#include "smallint.h"
+#include <machine/globals.h>
+#include <machine/machine.h>
+
+struct ow_range_obj {
+    OW_OBJECT_HEAD
+    int64_t start;
+    int64_t stop;
+    int64_t step;
+    size_t length; // Computed when created, so that indexing does not divide.
+};
+
+struct ow_range_obj *ow_range_obj_new(
+    struct ow_machine *om, int64_t start, int64_t stop, int64_t step
+) {
+    assert(start >= OW_SMALLINT_MIN && start <= OW_SMALLINT_MAX);
+    assert(stop >= OW_SMALLINT_MIN && stop <= OW_SMALLINT_MAX);
+    assert(step >= OW_SMALLINT_MIN && step <= OW_SMALLINT_MAX && step);
+    struct ow_range_obj *const obj = ow_object_cast(
+        ow_objmem_allocate(om, om->builtin_classes->range),
+        struct ow_range_obj
+    );
+    obj->start = start;
+    obj->stop = stop;
+    obj->step = step;
+    // Bounds are small ints, so the differences do not overflow.
+    if (step > 0)
+        obj->length = start >= stop ? 0 : (size_t)((stop - start - 1) / step) + 1;
+    else
+        obj->length = start <= stop ? 0 : (size_t)((start - stop - 1) / -step) + 1;
+    return obj;
+}
+
+int64_t ow_range_obj_start(const struct ow_range_obj *self) {
+    return self->start;
+}
+
+int64_t ow_range_obj_stop(const struct ow_range_obj *self) {
+    return self->stop;
+}
+
+int64_t ow_range_obj_step(const struct ow_range_obj *self) {
+    return self->step;
+}
+
+size_t ow_range_obj_length(const struct ow_range_obj *self) {
+    return self->length;
+}
+
+struct ow_object *ow_range_obj_get(const struct ow_range_obj *self, size_t index) {
+    if (ow_unlikely(index >= self->length))
+        return NULL;
+    return ow_smallint_to_ptr(self->start + (int64_t)index * self->step);
+}
+
+bool ow_range_obj_contains(const struct ow_range_obj *self, int64_t value) {
+    if (self->step > 0) {
+        if (value < self->start || value >= self->stop)
+            return false;
+        return (value - self->start) % self->step == 0;
+    } else {
+        if (value > self->start || value <= self->stop)
+            return false;
+        return (self->start - value) % -self->step == 0;
+    }
+}
+
+struct ow_range_obj *ow_range_obj_slice(
+    struct ow_machine *om, struct ow_range_obj *self, size_t pos, size_t len
+) {
+    const size_t self_length = self->length;
+
+    if (ow_unlikely(pos == 0 && len >= self_length))
+        return self;
+
+    if (ow_unlikely(pos >= self_length)) {
+        // Empty. One step past the last element may overflow.
+        return ow_range_obj_new(om, self->stop, self->stop, self->step);
+    }
+    if (ow_unlikely(pos + len >= self_length || pos + len < pos))
+        len = self_length - pos;
+
+    const int64_t start = self->start + (int64_t)pos * self->step;
+    // An element or the original end; one step past the last element may overflow.
+    const int64_t stop = pos + len == self_length ?
+        self->stop : start + (int64_t)len * self->step;
+    return ow_range_obj_new(om, start, stop, self->step);
+}
+
+/// Get value of an int. Return false if it is not an int.
+static bool ow_range_obj_int_value(
+    struct ow_machine *om, struct ow_object *obj, int64_t *val
+) {
+    if (ow_likely(ow_smallint_check(obj))) {
+        *val = ow_smallint_from_ptr(obj);
+        return true;
+    }
+    if (ow_builtin_classes_class_of(om->builtin_classes, obj) == om->builtin_classes->int_) {
+        *val = ow_int_obj_value(ow_object_cast(obj, struct ow_int_obj));
+        return true;
+    }
+    return false;
+}
+
+/// Read an int argument. Push an exception and return false on failure.
+static bool ow_range_obj_read_int_arg(
+    struct ow_machine *om, struct ow_object *obj, int64_t *val
+) {
+    if (ow_likely(ow_range_obj_int_value(om, obj, val)))
+        return true;
+    struct ow_exception_obj *const exc_o =
+        ow_exception_format(om, NULL, "expected an integer");
+    *++om->callstack.regs.sp = ow_object_from(exc_o);
+    return false;
+}
+
+//# [](self, index :: Int) :: Int
+//# Get element by 0-based index.
+static int ow_range_obj_meth_get_elem(struct ow_machine *om) {
+    struct ow_range_obj *const self =
+        ow_object_cast(om->callstack.regs.fp[-2], struct ow_range_obj);
+    int64_t index;
+    if (!ow_range_obj_read_int_arg(om, om->callstack.regs.fp[-1], &index))
+        return -1;
+    struct ow_object *const elem =
+        index >= 0 ? ow_range_obj_get(self, (size_t)index) : NULL;
+    if (ow_unlikely(!elem)) {
+        struct ow_exception_obj *const exc_o =
+            ow_exception_format(om, NULL, "index out of range: %ji", (intmax_t)index);
+        *++om->callstack.regs.sp = ow_object_from(exc_o);
+        return -1;
+    }
+    *++om->callstack.regs.sp = elem;
+    return 1;
+}
+
+//# length(self) :: Int
+//# Get number of elements.
+static int ow_range_obj_meth_length(struct ow_machine *om) {
+    struct ow_range_obj *const self =
+        ow_object_cast(om->callstack.regs.fp[-1], struct ow_range_obj);
+    // The length may exceed the small int range, e.g., `range(-2**62, 2**62-1)`.
+    *++om->callstack.regs.sp =
+        ow_int_obj_or_smallint(om, (int64_t)ow_range_obj_length(self));
+    return 1;
+}
+
+//# contains(self, value) :: Bool
+//# Check whether a value is one of the elements.
+static int ow_range_obj_meth_contains(struct ow_machine *om) {
+    struct ow_range_obj *const self =
+        ow_object_cast(om->callstack.regs.fp[-2], struct ow_range_obj);
+    int64_t value;
+    const bool res = ow_range_obj_int_value(om, om->callstack.regs.fp[-1], &value) &&
+        ow_range_obj_contains(self, value);
+    *++om->callstack.regs.sp =
+        res ? om->globals->value_true : om->globals->value_false;
+    return 1;
+}
+
+//# slice(self, pos :: Int, len :: Int) :: Range
+//# Get a sub-range of at most `len` elements starting from index `pos`.
+static int ow_range_obj_meth_slice(struct ow_machine *om) {
+    struct ow_range_obj *const self =
+        ow_object_cast(om->callstack.regs.fp[-3], struct ow_range_obj);
+    int64_t pos, len;
+    if (!ow_range_obj_read_int_arg(om, om->callstack.regs.fp[-2], &pos))
+        return -1;
+    if (!ow_range_obj_read_int_arg(om, om->callstack.regs.fp[-1], &len))
+        return -1;
+    struct ow_range_obj *const res = ow_range_obj_slice(
+        om, self, pos > 0 ? (size_t)pos : 0, len > 0 ? (size_t)len : 0);
+    *++om->callstack.regs.sp = ow_object_from(res);
+    return 1;
+}
+
+#define RANGE_FIELD_GETTER(NAME) \
+    static int ow_range_obj_meth_##NAME(struct ow_machine *om) { \
+        struct ow_range_obj *const self = \
+            ow_object_cast(om->callstack.regs.fp[-1], struct ow_range_obj); \
+        *++om->callstack.regs.sp = ow_smallint_to_ptr((ow_smallint_t)self->NAME); \
+        return 1; \
+    } \
+// ^^^ RANGE_FIELD_GETTER() ^^^
+
+RANGE_FIELD_GETTER(start)
+RANGE_FIELD_GETTER(stop)
+RANGE_FIELD_GETTER(step)
+
+#undef RANGE_FIELD_GETTER
+
+OW_BICLS_DEF_CLASS_EX(
+    range,
+    "Range",
+    false,
+    NULL,
+    NULL,
+    {"[]"      , ow_range_obj_meth_get_elem, 2, 0},
+    {"length"  , ow_range_obj_meth_length  , 1, 0},
+    {"contains", ow_range_obj_meth_contains, 2, 0},
+    {"slice"   , ow_range_obj_meth_slice   , 3, 0},
+    {"start"   , ow_range_obj_meth_start   , 1, 0},
+    {"stop"    , ow_range_obj_meth_stop    , 1, 0},
+    {"step"    , ow_range_obj_meth_step    , 1, 0},
+)
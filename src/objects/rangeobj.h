@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct ow_machine;
+struct ow_object;
+
+/// Range object. An immutable arithmetic sequence of integers, which stores
+/// only the bounds and the step. Bounds shall be in small int range.
+struct ow_range_obj;
+
+/// Create a range object `[start, stop)` with a non-zero step.
+struct ow_range_obj *ow_range_obj_new(
+    struct ow_machine *om, int64_t start, int64_t stop, int64_t step);
+/// Get the first value.
+int64_t ow_range_obj_start(const struct ow_range_obj *self);
+/// Get the end value, which is not included.
+int64_t ow_range_obj_stop(const struct ow_range_obj *self);
+/// Get the step.
+int64_t ow_range_obj_step(const struct ow_range_obj *self);
+/// Get number of elements.
+size_t ow_range_obj_length(const struct ow_range_obj *self);
+/// Get element by 0-based index as a small int. Return NULL if the index is out of range.
+struct ow_object *ow_range_obj_get(const struct ow_range_obj *self, size_t index);
+/// Check whether a value is one of the elements.
+bool ow_range_obj_contains(const struct ow_range_obj *self, int64_t value);
+/// Create a sub-range. Param `pos` and `len` can be out of range.
+struct ow_range_obj *ow_range_obj_slice(
+    struct ow_machine *om, struct ow_range_obj *self, size_t pos, size_t len);
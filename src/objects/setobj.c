@@ -72,6 +72,13 @@ int ow_set_obj_foreach(
         &(struct _ow_set_obj_foreach_walker_wrapper_arg){walker, arg});
 }
 
+struct ow_object *ow_set_obj_next(const struct ow_set_obj *self, size_t *pos) {
+    void *key;
+    if (!ow_hashmap_next(&self->data, pos, &key, NULL))
+        return NULL;
+    return key;
+}
+
 OW_BICLS_DEF_CLASS_EX(
     set,
     "Set",
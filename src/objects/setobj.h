@@ -19,3 +19,6 @@ size_t ow_set_obj_length(const struct ow_set_obj *self);
 int ow_set_obj_foreach(
     const struct ow_set_obj *self,
     int (*walker)(void *arg, struct ow_object *elem), void *arg);
+/// Step through the elements. `*pos` shall be 0 at the beginning and is advanced
+/// on each call. Return the next element, or NULL at the end.
+struct ow_object *ow_set_obj_next(const struct ow_set_obj *self, size_t *pos);
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <utilities/attributes.h>
 
@@ -40,3 +41,64 @@ ow_static_forceinline ow_smallint_t ow_smallint_from_ptr(const struct ow_object
     assert(ow_smallint_check(ptr));
     return (ow_smallint_t)ptr >> 1;
 }
+
+/// Small float is a double-precision float that can be hold in a pointer.
+/// Only floats whose exponents are in a certain range (about 2^-255 to 2^256,
+/// plus zero) are small floats. Available on 64-bit platforms only.
+#define OW_SMALLFLOAT_ENABLED (UINTPTR_MAX == UINT64_MAX)
+
+/// Check whether an object pointer is a small float.
+ow_static_forceinline bool ow_smallfloat_check(const struct ow_object *obj_ptr) {
+    return ((uintptr_t)obj_ptr & 3) == 2;
+}
+
+/// Check whether an object pointer is a small int or small float, i.e.,
+/// not a pointer to an object.
+ow_static_forceinline bool ow_smallval_check(const struct ow_object *obj_ptr) {
+    return (uintptr_t)obj_ptr & 3;
+}
+
+/*
+ * A small float is the bit pattern of the double rotated left by 3 bits, so that
+ * the sign bit ends up at bit 2. Bits 62..60 must be `011` or `100`, so that
+ * bits 62 and 61 can be rebuilt from bit 60, leaving bits 1..0 for the tag `10`.
+ * Positive zero gets a special encoding.
+ */
+
+#define _OW_SMALLFLOAT_ZERO ((uintptr_t)0x8000000000000002)
+
+/// Try to convert float to object pointer. If not representable, return NULL.
+ow_static_forceinline struct ow_object *ow_smallfloat_try_to_ptr(double val) {
+#if OW_SMALLFLOAT_ENABLED
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof bits);
+    const unsigned int exp_hi = (unsigned int)(bits >> 60) & 7;
+    if (ow_likely((exp_hi == 3 || exp_hi == 4) && bits != UINT64_C(0x3000000000000000))) {
+        const uint64_t rot = (bits << 3) | (bits >> 61);
+        return (void *)(uintptr_t)((rot & ~(uint64_t)3) | 2);
+    }
+    if (bits == 0)
+        return (void *)_OW_SMALLFLOAT_ZERO;
+#else
+    ow_unused_var(val);
+#endif
+    return NULL;
+}
+
+/// Convert object pointer to float.
+ow_static_forceinline double ow_smallfloat_from_ptr(const struct ow_object *ptr) {
+    assert(ow_smallfloat_check(ptr));
+#if OW_SMALLFLOAT_ENABLED
+    const uint64_t v = (uintptr_t)ptr;
+    if (ow_unlikely(v == _OW_SMALLFLOAT_ZERO))
+        return 0.0;
+    const uint64_t rot = (v & ~(uint64_t)3) | (2 - (v >> 63));
+    const uint64_t bits = (rot >> 3) | (rot << 61);
+    double val;
+    memcpy(&val, &bits, sizeof val);
+    return val;
+#else
+    ow_unused_var(ptr);
+    return 0.0;
+#endif
+}
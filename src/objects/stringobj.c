@@ -107,11 +107,11 @@ struct ow_string_obj *ow_string_obj_new(
     }
 
     struct ow_string_obj_impl_inner *const obj = ow_object_cast(
-        ow_objmem_allocate_ex(
+        ow_objmem_allocate_fast_ex(
             om,
-            OW_OBJMEM_ALLOC_AUTO,
             om->builtin_classes->string,
-            (ow_round_up_to(sizeof(void *), n + 1) / OW_OBJECT_FIELD_SIZE)
+            OW_OBJ_STRUCT_FIELD_COUNT(struct ow_string_obj) +
+                (ow_round_up_to(sizeof(void *), n + 1) / OW_OBJECT_FIELD_SIZE)
         ),
         struct ow_string_obj_impl_inner
     );
@@ -147,13 +147,10 @@ struct ow_string_obj *ow_string_obj_slice(
         return ow_string_obj_new(om, buffer, size);
     } else if (str_type == STR_INNER || str_type == STR_SLICE) {
     inner_or_slice_str:;
-        const size_t efc =
-            OW_OBJ_STRUCT_FIELD_COUNT(struct ow_string_obj_impl_slice) -
-            OW_OBJ_STRUCT_FIELD_COUNT(struct ow_string_obj);
         struct ow_string_obj_impl_slice *const obj = ow_object_cast(
-            ow_objmem_allocate_ex(
-                om, OW_OBJMEM_ALLOC_AUTO,
-                om->builtin_classes->string, efc
+            ow_objmem_allocate_fast_ex(
+                om, om->builtin_classes->string,
+                OW_OBJ_STRUCT_FIELD_COUNT(struct ow_string_obj_impl_slice)
             ),
             struct ow_string_obj_impl_slice
         );
@@ -224,13 +221,10 @@ struct ow_string_obj *ow_string_obj_concat(
     if (ow_unlikely(!str2_size))
         return str1;
 
-    const size_t efc =
-        OW_OBJ_STRUCT_FIELD_COUNT(struct ow_string_obj_impl_cons) -
-        OW_OBJ_STRUCT_FIELD_COUNT(struct ow_string_obj);
     struct ow_string_obj_impl_cons *const obj = ow_object_cast(
-        ow_objmem_allocate_ex(
-            om, OW_OBJMEM_ALLOC_AUTO,
-            om->builtin_classes->string, efc
+        ow_objmem_allocate_fast_ex(
+            om, om->builtin_classes->string,
+            OW_OBJ_STRUCT_FIELD_COUNT(struct ow_string_obj_impl_cons)
         ),
         struct ow_string_obj_impl_cons
     );
@@ -376,6 +370,23 @@ const char *ow_string_obj_flatten(
     }
 }
 
+int ow_string_obj_compare(
+    struct ow_machine *om, struct ow_string_obj *str1, struct ow_string_obj *str2
+) {
+    if (ow_unlikely(str1 == str2))
+        return 0;
+    // Flattening may allocate memory. Objects must not be moved before comparison.
+    ow_objmem_push_ngc(om);
+    size_t size1, size2;
+    const char *const s1 = ow_string_obj_flatten(om, str1, &size1);
+    const char *const s2 = ow_string_obj_flatten(om, str2, &size2);
+    const int res = memcmp(s1, s2, size1 < size2 ? size1 : size2);
+    ow_objmem_pop_ngc(om);
+    if (res)
+        return res;
+    return size1 == size2 ? 0 : size1 < size2 ? -1 : 1;
+}
+
 size_t ow_string_obj_size(const struct ow_string_obj *self) {
     return ow_string_obj_meta_size(self->str_meta);
 }
@@ -25,6 +25,11 @@ size_t ow_string_obj_copy(
 /// Param `s_size` can be NULL, if do not need the string size.
 const char *ow_string_obj_flatten(
     struct ow_machine *om, struct ow_string_obj *self, size_t *s_size);
+/// Compare two strings byte by byte (i.e., by Unicode code points).
+/// Return a negative value, zero, or a positive value if `str1` is less than,
+/// equal to, or greater than `str2`.
+int ow_string_obj_compare(
+    struct ow_machine *om, struct ow_string_obj *str1, struct ow_string_obj *str2);
 /// Get number of bytes in the string.
 size_t ow_string_obj_size(const struct ow_string_obj *self);
 /// Get number of characters in the string.
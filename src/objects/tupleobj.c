@@ -95,9 +95,9 @@ struct ow_tuple_obj *ow_tuple_obj_new(
     struct ow_machine *om, struct ow_object *elems[], size_t elem_count
 ) {
     struct ow_tuple_obj_impl_inner *const obj = ow_object_cast(
-        ow_objmem_allocate_ex(
-            om, OW_OBJMEM_ALLOC_AUTO,
-            om->builtin_classes->tuple, elem_count
+        ow_objmem_allocate_fast_ex(
+            om, om->builtin_classes->tuple,
+            OW_OBJ_STRUCT_FIELD_COUNT(struct ow_tuple_obj) + elem_count
         ),
         struct ow_tuple_obj_impl_inner
     );
@@ -218,13 +218,10 @@ struct ow_tuple_obj *ow_tuple_obj_slice(
         return ow_tuple_obj_new(om, buffer, len);
     } else if (tuple_type == TUPLE_INNER || tuple_type == TUPLE_SLICE) {
     inner_or_slice_tuple:;
-        const size_t efc =
-            OW_OBJ_STRUCT_FIELD_COUNT(struct ow_tuple_obj_impl_slice) -
-            OW_OBJ_STRUCT_FIELD_COUNT(struct ow_tuple_obj);
         struct ow_tuple_obj_impl_slice *const obj = ow_object_cast(
-            ow_objmem_allocate_ex(
-                om, OW_OBJMEM_ALLOC_AUTO,
-                om->builtin_classes->tuple, efc
+            ow_objmem_allocate_fast_ex(
+                om, om->builtin_classes->tuple,
+                OW_OBJ_STRUCT_FIELD_COUNT(struct ow_tuple_obj_impl_slice)
             ),
             struct ow_tuple_obj_impl_slice
         );
@@ -276,13 +273,10 @@ struct ow_tuple_obj *ow_tuple_obj_concat(
     if (ow_unlikely(!tuple2_size))
         return tuple1;
 
-    const size_t efc =
-        OW_OBJ_STRUCT_FIELD_COUNT(struct ow_tuple_obj_impl_cons) -
-        OW_OBJ_STRUCT_FIELD_COUNT(struct ow_tuple_obj);
     struct ow_tuple_obj_impl_cons *const obj = ow_object_cast(
-        ow_objmem_allocate_ex(
-            om, OW_OBJMEM_ALLOC_AUTO,
-            om->builtin_classes->tuple, efc
+        ow_objmem_allocate_fast_ex(
+            om, om->builtin_classes->tuple,
+            OW_OBJ_STRUCT_FIELD_COUNT(struct ow_tuple_obj_impl_cons)
         ),
         struct ow_tuple_obj_impl_cons
     );
@@ -14,8 +14,10 @@
 
 #include <compiler/compiler.h>
 #include <compiler/error.h>
+#include <machine/aot.h>
 #include <machine/globals.h>
 #include <machine/invoke.h>
+#include <machine/jit.h>
 #include <machine/machine.h>
 #include <machine/modmgr.h>
 #include <machine/sysparam.h>
@@ -31,6 +33,8 @@
 #include <objects/mapobj.h>
 #include <objects/objmem.h>
 #include <objects/moduleobj.h>
+#include <objects/natives.h>
+#include <objects/object_util.h>
 #include <objects/setobj.h>
 #include <objects/stringobj.h>
 #include <objects/symbolobj.h>
@@ -119,6 +123,54 @@ OWIZ_API int owiz_sysctl(int name, const void *val, size_t val_sz) {
         ow_sysparam_set_string(ow_sysparam_field_offset(default_paths), val, val_sz);
         return 0;
 
+    case OWIZ_CTL_JIT: {
+        const int64_t v = _owiz_sysctl_read_int(val, val_sz);
+        if (v < 0 || (v && !OW_JIT_AVAILABLE))
+            return OWIZ_ERR_FAIL;
+        ow_sysparam.jit_threshold = (size_t)v;
+        return 0;
+    }
+
+    case OWIZ_CTL_JITTRACE: {
+        const int64_t v = _owiz_sysctl_read_int(val, val_sz);
+        if (v < 0 || (v && !OW_JIT_AVAILABLE))
+            return OWIZ_ERR_FAIL;
+        ow_sysparam.trace_threshold = (size_t)v;
+        return 0;
+    }
+
+    case OWIZ_CTL_OPTIMIZE: {
+        const int64_t v = _owiz_sysctl_read_int(val, val_sz);
+        if (v < 0 || v > 2)
+            return OWIZ_ERR_FAIL;
+        ow_sysparam.opt_level = (int)v;
+        return 0;
+    }
+
+    case OWIZ_CTL_GCSLICE: {
+        const int64_t v = _owiz_sysctl_read_int(val, val_sz);
+        if (v < 0)
+            return OWIZ_ERR_FAIL;
+        ow_sysparam.gc_slice_budget = (size_t)v;
+        return 0;
+    }
+
+    case OWIZ_CTL_GCCONCURRENT: {
+        const int64_t v = _owiz_sysctl_read_int(val, val_sz);
+        if (v != 0 && v != 1)
+            return OWIZ_ERR_FAIL;
+        ow_sysparam.gc_concurrent = (bool)v;
+        return 0;
+    }
+
+    case OWIZ_CTL_GCTHREADS: {
+        const int64_t v = _owiz_sysctl_read_int(val, val_sz);
+        if (v < 1)
+            return OWIZ_ERR_FAIL;
+        ow_sysparam.gc_threads = (size_t)v;
+        return 0;
+    }
+
     default:
         return OWIZ_ERR_INDEX;
     }
@@ -156,21 +208,25 @@ OWIZ_API void owiz_push_bool(owiz_machine_t *om, bool val) {
 
 OWIZ_API void owiz_push_int(owiz_machine_t *om, intmax_t val) {
     static_assert(sizeof val == sizeof(int64_t), "");
-    *++om->callstack.regs.sp = ow_int_obj_or_smallint(om, val);
+    struct ow_object *const obj = ow_int_obj_or_smallint(om, val);
+    *++om->callstack.regs.sp = obj;
 }
 
 OWIZ_API void owiz_push_float(owiz_machine_t *om, double val) {
-    *++om->callstack.regs.sp = ow_object_from(ow_float_obj_new(om, val));
+    struct ow_object *const obj = ow_float_obj_or_smallfloat(om, val);
+    *++om->callstack.regs.sp = obj;
 }
 
 OWIZ_API void owiz_push_symbol(owiz_machine_t *om, const char *str, size_t len) {
     assert(str || !len);
-    *++om->callstack.regs.sp = ow_object_from(ow_symbol_obj_new(om, str, len));
+    struct ow_symbol_obj *const obj = ow_symbol_obj_new(om, str, len);
+    *++om->callstack.regs.sp = ow_object_from(obj);
 }
 
 OWIZ_API void owiz_push_string(owiz_machine_t *om, const char *str, size_t len) {
     assert(str || !len);
-    *++om->callstack.regs.sp = ow_object_from(ow_string_obj_new(om, str, len));
+    struct ow_string_obj *const obj = ow_string_obj_new(om, str, len);
+    *++om->callstack.regs.sp = ow_object_from(obj);
 }
 
 OWIZ_API void owiz_make_array(owiz_machine_t *om, size_t count) {
@@ -232,6 +288,44 @@ OWIZ_API int owiz_make_exception(owiz_machine_t *om, int type, const char *fmt,
     return 0;
 }
 
+static struct ow_object *_get_local(owiz_machine_t *om, int index);
+
+OWIZ_API void owiz_make_class(owiz_machine_t *om, const owiz_native_class_def_t *def) {
+    ow_objmem_push_ngc(om);
+    struct ow_class_obj *const class_o = ow_class_obj_new(om);
+    ow_class_obj_load_native_def(om, class_o, (const struct ow_native_class_def *)def, NULL);
+    ow_objmem_pop_ngc(om);
+    *++om->callstack.regs.sp = ow_object_from(class_o);
+}
+
+/// Check whether a class is one of the builtin classes, whose objects cannot be
+/// created or modified directly.
+static bool _is_builtin_class(owiz_machine_t *om, struct ow_class_obj *class_o) {
+    const struct ow_builtin_classes *const bic = om->builtin_classes;
+#define ELEM(NAME) if (class_o == bic-> NAME) return true;
+    OW_BICLS_LIST0
+    OW_BICLS_LIST
+#undef ELEM
+    return false;
+}
+
+OWIZ_API int owiz_make_object(owiz_machine_t *om, int index) {
+    struct ow_object *const v = _get_local(om, index);
+    if (ow_unlikely(!v))
+        return OWIZ_ERR_INDEX;
+    if (ow_unlikely(ow_smallval_check(v) ||
+            ow_object_class(v) != om->builtin_classes->class_))
+        return OWIZ_ERR_TYPE;
+    struct ow_class_obj *const class_o = ow_object_cast(v, struct ow_class_obj);
+    if (ow_unlikely(_is_builtin_class(om, class_o)))
+        return OWIZ_ERR_TYPE;
+    const size_t field_count = ow_class_obj_pub_info(class_o)->basic_field_count;
+    struct ow_object *const obj = ow_objmem_allocate(om, class_o);
+    memset((char *)obj + OW_OBJECT_HEAD_SIZE, 0, field_count * OW_OBJECT_FIELD_SIZE);
+    *++om->callstack.regs.sp = obj;
+    return 0;
+}
+
 /// Compile code from stream and store to the module object on stack top.
 /// If error occurs, replace the module object with an exception.
 ow_noinline static int _compile_module_from_stream(
@@ -243,7 +337,8 @@ ow_noinline static int _compile_module_from_stream(
         ow_object_cast(*om->callstack.regs.sp, struct ow_module_obj);
     struct ow_sharedstr *const file_name_ss = ow_sharedstr_new(file_name, (size_t)-1);
     const int compile_flags =
-        ow_unlikely(flags & OWIZ_MKMOD_RETLAST) ? OW_COMPILE_RETLASTEXPR : 0;
+        (ow_unlikely(flags & OWIZ_MKMOD_RETLAST) ? OW_COMPILE_RETLASTEXPR : 0) |
+        OW_COMPILE_OPTIMIZE(ow_sysparam.opt_level);
     const bool ok = ow_compiler_compile(
         compiler, source, file_name_ss, compile_flags, module);
     if (ow_unlikely(!ok)) {
@@ -267,7 +362,7 @@ OWIZ_API int owiz_make_module(
     if (ow_unlikely(flags & OWIZ_MKMOD_INCR)) {
         assert(om->callstack.regs.fp >= om->callstack._data);
         struct ow_object *const v = *om->callstack.regs.sp;
-        if (ow_smallint_check(v) ||
+        if (ow_smallval_check(v) ||
                 ow_object_class(v) != om->builtin_classes->module)
             *om->callstack.regs.sp = ow_object_from(ow_module_obj_new(om));
     } else {
@@ -376,7 +471,7 @@ OWIZ_API int owiz_load_global(owiz_machine_t *om, const char *name) {
     assert(om->callstack.frame_info_list.current->arg_list - 1 >= om->callstack._data);
     struct ow_object *const func_o =
         om->callstack.frame_info_list.current->arg_list[-1];
-    assert(!ow_smallint_check(func_o));
+    assert(!ow_smallval_check(func_o));
     struct ow_class_obj *const func_class = ow_object_class(func_o);
     struct ow_module_obj *module;
     if (func_class == om->builtin_classes->cfunc)
@@ -402,11 +497,8 @@ OWIZ_API int owiz_load_attribute(owiz_machine_t *om, int index, const char *name
     struct ow_object *const obj = _get_local(om, index);
     if (ow_unlikely(!obj))
         return OWIZ_ERR_INDEX;
-    struct ow_class_obj *obj_class;
-    if (ow_unlikely(ow_smallint_check(obj)))
-        obj_class = om->builtin_classes->int_;
-    else
-        obj_class = ow_object_class(obj);
+    struct ow_class_obj *const obj_class =
+        ow_builtin_classes_class_of(om->builtin_classes, obj);
     struct ow_symbol_obj *const name_o = ow_symbol_obj_new(om, name, (size_t)-1);
     struct ow_object *attr;
     if (obj_class == om->builtin_classes->module) {
@@ -445,7 +537,7 @@ OWIZ_API int owiz_read_nil(owiz_machine_t *om, int index) {
     struct ow_object *const v = _get_local(om, index);
     if (ow_unlikely(!v))
         return OWIZ_ERR_INDEX;
-    if (ow_unlikely(ow_smallint_check(v)))
+    if (ow_unlikely(ow_smallval_check(v)))
         return OWIZ_ERR_TYPE;
     if (ow_likely(ow_class_obj_is_base(
             om->builtin_classes->nil, ow_object_class(v))))
@@ -463,7 +555,7 @@ OWIZ_API int owiz_read_bool(owiz_machine_t *om, int index, bool *val_p) {
     } else if (v == om->globals->value_false) {
         *val_p = false;
         return 0;
-    } else if (!ow_smallint_check(v) && ow_class_obj_is_base(
+    } else if (!ow_smallval_check(v) && ow_class_obj_is_base(
             om->builtin_classes->bool_, ow_object_class(v))) {
         *val_p = ow_bool_obj_value(ow_object_cast(v, struct ow_bool_obj));
         return 0;
@@ -480,6 +572,8 @@ OWIZ_API int owiz_read_int(owiz_machine_t *om, int index, intmax_t *val_p) {
         *val_p = ow_smallint_from_ptr(v);
         return 0;
     }
+    if (ow_unlikely(ow_smallfloat_check(v)))
+        return OWIZ_ERR_TYPE;
     if (ow_likely(ow_class_obj_is_base(
             om->builtin_classes->int_, ow_object_class(v)))) {
         *val_p = ow_int_obj_value(ow_object_cast(v, struct ow_int_obj));
@@ -492,6 +586,10 @@ OWIZ_API int owiz_read_float(owiz_machine_t *om, int index, double *val_p) {
     struct ow_object *const v = _get_local(om, index);
     if (ow_unlikely(!v))
         return OWIZ_ERR_INDEX;
+    if (ow_likely(ow_smallfloat_check(v))) {
+        *val_p = ow_smallfloat_from_ptr(v);
+        return 0;
+    }
     if (ow_unlikely(ow_smallint_check(v)))
         return OWIZ_ERR_TYPE;
     if (ow_likely(ow_class_obj_is_base(
@@ -508,7 +606,7 @@ OWIZ_API int owiz_read_symbol(
     struct ow_object *const v = _get_local(om, index);
     if (ow_unlikely(!v))
         return OWIZ_ERR_INDEX;
-    if (ow_unlikely(ow_smallint_check(v)))
+    if (ow_unlikely(ow_smallval_check(v)))
         return OWIZ_ERR_TYPE;
     if (ow_unlikely(!ow_class_obj_is_base(
             om->builtin_classes->symbol, ow_object_class(v))))
@@ -528,7 +626,7 @@ OWIZ_API int owiz_read_string(
     struct ow_object *const v = _get_local(om, index);
     if (ow_unlikely(!v))
         return OWIZ_ERR_INDEX;
-    if (ow_unlikely(ow_smallint_check(v)))
+    if (ow_unlikely(ow_smallval_check(v)))
         return OWIZ_ERR_TYPE;
     if (ow_unlikely(!ow_class_obj_is_base(
             om->builtin_classes->string, ow_object_class(v))))
@@ -548,7 +646,7 @@ OWIZ_API int owiz_read_string_to(
     struct ow_object *const v = _get_local(om, index);
     if (ow_unlikely(!v))
         return OWIZ_ERR_INDEX;
-    if (ow_unlikely(ow_smallint_check(v)))
+    if (ow_unlikely(ow_smallval_check(v)))
         return OWIZ_ERR_TYPE;
     if (ow_unlikely(!ow_class_obj_is_base(
             om->builtin_classes->string, ow_object_class(v))))
@@ -572,7 +670,7 @@ size_t owiz_read_array(owiz_machine_t *om, int index, size_t elem_idx) {
     struct ow_object *const v = _get_local(om, index);
     if (ow_unlikely(!v))
         return (size_t)OWIZ_ERR_INDEX;
-    if (ow_unlikely(ow_smallint_check(v)))
+    if (ow_unlikely(ow_smallval_check(v)))
         return (size_t)OWIZ_ERR_TYPE;
     if (ow_unlikely(!ow_class_obj_is_base(
             om->builtin_classes->array, ow_object_class(v))))
@@ -599,7 +697,7 @@ size_t owiz_read_tuple(owiz_machine_t *om, int index, size_t elem_idx) {
     struct ow_object *const v = _get_local(om, index);
     if (ow_unlikely(!v))
         return (size_t)OWIZ_ERR_INDEX;
-    if (ow_unlikely(ow_smallint_check(v)))
+    if (ow_unlikely(ow_smallval_check(v)))
         return (size_t)OWIZ_ERR_TYPE;
     if (ow_unlikely(!ow_class_obj_is_base(
             om->builtin_classes->tuple, ow_object_class(v))))
@@ -626,6 +724,16 @@ size_t owiz_read_tuple(owiz_machine_t *om, int index, size_t elem_idx) {
     return (size_t)OWIZ_ERR_FAIL;
 }
 
+OWIZ_API int owiz_read_data(owiz_machine_t *om, int index, void **data_p) {
+    struct ow_object *const v = _get_local(om, index);
+    if (ow_unlikely(!v))
+        return OWIZ_ERR_INDEX;
+    if (ow_unlikely(ow_smallval_check(v) || _is_builtin_class(om, ow_object_class(v))))
+        return OWIZ_ERR_TYPE;
+    *data_p = (char *)v + OW_OBJECT_HEAD_SIZE;
+    return 0;
+}
+
 static int _set_expand_walker(void *arg, struct ow_object *elem) {
     struct ow_machine *const om = arg;
     *++om->callstack.regs.sp = elem;
@@ -636,7 +744,7 @@ OWIZ_API size_t owiz_read_set(owiz_machine_t *om, int index, int op) {
     struct ow_object *const v = _get_local(om, index);
     if (ow_unlikely(!v))
         return (size_t)OWIZ_ERR_INDEX;
-    if (ow_unlikely(ow_smallint_check(v)))
+    if (ow_unlikely(ow_smallval_check(v)))
         return (size_t)OWIZ_ERR_TYPE;
     if (ow_unlikely(!ow_class_obj_is_base(
             om->builtin_classes->set, ow_object_class(v))))
@@ -666,7 +774,7 @@ OWIZ_API size_t owiz_read_map(owiz_machine_t *om, int index, int key_idx) {
     struct ow_object *const v = _get_local(om, index);
     if (ow_unlikely(!v))
         return (size_t)OWIZ_ERR_INDEX;
-    if (ow_unlikely(ow_smallint_check(v)))
+    if (ow_unlikely(ow_smallval_check(v)))
         return (size_t)OWIZ_ERR_TYPE;
     if (ow_unlikely(!ow_class_obj_is_base(
             om->builtin_classes->map, ow_object_class(v))))
@@ -696,7 +804,7 @@ OWIZ_API int owiz_read_exception(owiz_machine_t *om, int index, int flags, ...)
     struct ow_object *const v = _get_local(om, index);
     if (ow_unlikely(!v))
         return OWIZ_ERR_INDEX;
-    if (ow_unlikely(ow_smallint_check(v)))
+    if (ow_unlikely(ow_smallval_check(v)))
         return OWIZ_ERR_TYPE;
     if (ow_unlikely(!ow_class_obj_is_base(
             om->builtin_classes->exception, ow_object_class(v))))
@@ -804,16 +912,19 @@ OWIZ_API int owiz_read_args(owiz_machine_t *om, int flags, const char *fmt, ...)
                 if (flags & OWIZ_RDARG_MKEXC) {
                     const char *const type_name =
                         ow_symbol_obj_data(ow_class_obj_pub_info(
-                            ow_object_class(_get_local(om, index)))->class_name);
-                    *++om->callstack.regs.sp = ow_object_from(ow_exception_format(om, NULL,
-                        "unexpected %s object for argument %i", type_name, -index));
+                            ow_builtin_classes_class_of(
+                                om->builtin_classes, _get_local(om, index)))->class_name);
+                    struct ow_exception_obj *const exc_o = ow_exception_format(om, NULL,
+                        "unexpected %s object for argument %i", type_name, -index);
+                    *++om->callstack.regs.sp = ow_object_from(exc_o);
                     status = OWIZ_ERR_FAIL;
                 }
                 break;
             } else if (status == OWIZ_ERR_FAIL) {
                 if (flags & OWIZ_RDARG_MKEXC) {
-                    *++om->callstack.regs.sp = ow_object_from(
-                        ow_exception_format(om, NULL, "illegal usage of API"));
+                    struct ow_exception_obj *const exc_o =
+                        ow_exception_format(om, NULL, "illegal usage of API");
+                    *++om->callstack.regs.sp = ow_object_from(exc_o);
                     status = OWIZ_ERR_FAIL;
                 }
                 break;
@@ -854,7 +965,7 @@ OWIZ_API int owiz_store_global(owiz_machine_t *om, const char *name) {
     assert(om->callstack.frame_info_list.current->arg_list - 1 >= om->callstack._data);
     struct ow_object *const func_o =
         om->callstack.frame_info_list.current->arg_list[-1];
-    assert(!ow_smallint_check(func_o));
+    assert(!ow_smallval_check(func_o));
     struct ow_class_obj *const func_class = ow_object_class(func_o);
     struct ow_module_obj *module;
     if (func_class == om->builtin_classes->cfunc)
@@ -876,11 +987,8 @@ OWIZ_API int owiz_store_attribute(owiz_machine_t *om, int index, const char *nam
     struct ow_object *const obj = _get_local(om, index);
     if (ow_unlikely(!obj))
         return OWIZ_ERR_INDEX;
-    struct ow_class_obj *obj_class;
-    if (ow_unlikely(ow_smallint_check(obj)))
-        obj_class = om->builtin_classes->int_;
-    else
-        obj_class = ow_object_class(obj);
+    struct ow_class_obj *const obj_class =
+        ow_builtin_classes_class_of(om->builtin_classes, obj);
     struct ow_symbol_obj *const name_o = ow_symbol_obj_new(om, name, (size_t)-1);
     struct ow_object *const attr_o = *om->callstack.regs.sp;
     *++om->callstack.regs.sp = ow_object_from(name_o);
@@ -923,7 +1031,7 @@ OWIZ_API int owiz_invoke(owiz_machine_t *om, int argc, int flags) {
         status = ow_machine_invoke(om, argc, &result);
     } else if (mode == OWIZ_IVK_METHOD) {
         struct ow_object *const name_o = *(om->callstack.regs.sp - argc);
-        if (ow_unlikely(ow_smallint_check(name_o) ||
+        if (ow_unlikely(ow_smallval_check(name_o) ||
                 ow_object_class(name_o) != om->builtin_classes->symbol)) {
             result = ow_object_from(ow_exception_format(
                 om, NULL, "%s is not a %s object", "method name", "Symbol"));
@@ -934,7 +1042,7 @@ OWIZ_API int owiz_invoke(owiz_machine_t *om, int argc, int flags) {
             om, ow_object_cast(name_o, struct ow_symbol_obj), argc, NULL, &result);
     } else if (mode == OWIZ_IVK_MODULE) {
         struct ow_object *const mod_o = *(om->callstack.regs.sp - argc);
-        if (ow_unlikely(ow_smallint_check(mod_o) ||
+        if (ow_unlikely(ow_smallval_check(mod_o) ||
                 ow_object_class(mod_o) != om->builtin_classes->module)) {
             result = ow_object_from(ow_exception_format(
                 om, NULL, "%s is not a %s object", "module", "Module"));
@@ -967,6 +1075,22 @@ OWIZ_API int owiz_syscmd(owiz_machine_t *om, int name, ...) {
             status = OWIZ_ERR_FAIL;
         break;
 
+    case OWIZ_CMD_AOTCOMPILE: {
+        struct ow_object **const top = om->callstack.regs.sp;
+        if (ow_unlikely(ow_smallval_check(*top)
+                || ow_object_class(*top) != om->builtin_classes->module)) {
+            status = OWIZ_ERR_TYPE;
+            break;
+        }
+        struct ow_exception_obj *const exc = ow_aot_compile(
+            om, ow_object_cast(*top, struct ow_module_obj), va_arg(ap, const char *));
+        if (exc) {
+            *top = ow_object_from(exc);
+            status = OWIZ_ERR_FAIL;
+        }
+        break;
+    }
+
     default:
         status = OWIZ_ERR_INDEX;
         break;
@@ -358,6 +358,8 @@ struct ow_args {
     bool        repl;
     const char *code;
     const char *file;
+    const char *aot;
+    const char *output;
     size_t      argc;
     char      **argv;
 };
@@ -432,16 +434,40 @@ static_cold_func int opt_run(
 ) {
     ow_unused_var(opt), ow_unused_var(arg);
     struct ow_args *const args = ctx;
-    if (args->code || args->repl) {
+    if (args->code || args->repl || args->aot) {
         fprintf(stderr,
-            "%s: mutually exclusive options: `%s', `%s' and `%s'\n",
-            args->prog, "-r/--run", "-e/--eval", "-i/--repl");
+            "%s: mutually exclusive options: `%s', `%s', `%s' and `%s'\n",
+            args->prog, "-r/--run", "-e/--eval", "-i/--repl", "--aot");
         cleanup_mom_and_exit(EXIT_FAILURE);
     }
     args->file = arg;
     return 0;
 }
 
+static_cold_func int opt_aot(
+    void *ctx, const argparse_option_t *opt, const char *arg
+) {
+    ow_unused_var(opt);
+    struct ow_args *const args = ctx;
+    if (args->code || args->file || args->repl) {
+        fprintf(stderr,
+            "%s: mutually exclusive options: `%s' and `%s', `%s' or `%s'\n",
+            args->prog, "--aot", "-r/--run", "-e/--eval", "-i/--repl");
+        cleanup_mom_and_exit(EXIT_FAILURE);
+    }
+    args->aot = arg;
+    return 0;
+}
+
+static_cold_func int opt_output(
+    void *ctx, const argparse_option_t *opt, const char *arg
+) {
+    ow_unused_var(opt);
+    struct ow_args *const args = ctx;
+    args->output = arg;
+    return 0;
+}
+
 static_cold_func int opt_path(
     void *ctx, const argparse_option_t *opt, const char *arg
 ) {
@@ -465,6 +491,79 @@ static_cold_func int opt_stack_size(
     return 0;
 }
 
+static_cold_func int opt_jit(
+    void *ctx, const argparse_option_t *opt, const char *arg
+) {
+    ow_unused_var(opt);
+    const long long n = atoll(arg);
+    if (n < 0 || owiz_sysctl(OWIZ_CTL_JIT, &n, sizeof n) != 0) {
+        struct ow_args *const args = ctx;
+        fprintf(stderr, "%s: invalid JIT threshold: `%s'\n", args->prog, arg);
+        cleanup_mom_and_exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
+static_cold_func int opt_jit_trace(
+    void *ctx, const argparse_option_t *opt, const char *arg
+) {
+    ow_unused_var(opt);
+    const long long n = atoll(arg);
+    if (n < 0 || owiz_sysctl(OWIZ_CTL_JITTRACE, &n, sizeof n) != 0) {
+        struct ow_args *const args = ctx;
+        fprintf(stderr, "%s: invalid loop tracing threshold: `%s'\n", args->prog, arg);
+        cleanup_mom_and_exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
+static_cold_func int opt_optimize(
+    void *ctx, const argparse_option_t *opt, const char *arg
+) {
+    ow_unused_var(opt);
+    const long long n = atoll(arg);
+    if (n < 0 || owiz_sysctl(OWIZ_CTL_OPTIMIZE, &n, sizeof n) != 0) {
+        struct ow_args *const args = ctx;
+        fprintf(stderr, "%s: invalid optimization level: `%s'\n", args->prog, arg);
+        cleanup_mom_and_exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
+static_cold_func int opt_gc_slice(
+    void *ctx, const argparse_option_t *opt, const char *arg
+) {
+    ow_unused_var(opt);
+    const long long n = atoll(arg);
+    if (n < 0 || owiz_sysctl(OWIZ_CTL_GCSLICE, &n, sizeof n) != 0) {
+        struct ow_args *const args = ctx;
+        fprintf(stderr, "%s: invalid GC slice size: `%s'\n", args->prog, arg);
+        cleanup_mom_and_exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
+static_cold_func int opt_gc_concurrent(
+    void *ctx, const argparse_option_t *opt, const char *arg
+) {
+    ow_unused_var(ctx), ow_unused_var(opt), ow_unused_var(arg);
+    owiz_sysctl(OWIZ_CTL_GCCONCURRENT, &(int){1}, sizeof(int));
+    return 0;
+}
+
+static_cold_func int opt_gc_threads(
+    void *ctx, const argparse_option_t *opt, const char *arg
+) {
+    ow_unused_var(opt);
+    const long long n = atoll(arg);
+    if (owiz_sysctl(OWIZ_CTL_GCTHREADS, &n, sizeof n) != 0) {
+        struct ow_args *const args = ctx;
+        fprintf(stderr, "%s: invalid GC thread count: `%s'\n", args->prog, arg);
+        cleanup_mom_and_exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
 static_cold_func int opt_file_or_arg(
     void *ctx, const argparse_option_t *opt, const char *arg
 ) {
@@ -494,6 +593,12 @@ static const char opt_run_help[] =
     "This option will be automatically used if neither `-i' nor `-e' is specified "
     "and there are reset command-line arguments.";
 
+static const char opt_aot_help[] =
+    "Compile the source FILE to a native module and exit. "
+    "The output file defaults to FILE with extension `.owo'. "
+    "Environment variables OWIZ_AOT_CC, OWIZ_AOT_CFLAGS and OWIZ_AOT_INCLUDE "
+    "override the C compiler, add compiler flags, and set header directories.";
+
 static const argparse_option_t options[] = {
     {'h', "help"   , NULL   , "Print help message and exit.", opt_help        },
     {'v', "version", NULL   , "Print version and exit."     , opt_version     },
@@ -502,7 +607,15 @@ static const argparse_option_t options[] = {
     {'e', "eval"   , "CODE" , "Evaluate the given CODE."    , opt_eval        },
     {'r', "run"    , ":MODULE|FILE|-", opt_run_help         , opt_run         },
     {'P', "path"   , "PATH" , "Add a module search path."   , opt_path        },
-    {0  , "stack-size", "N" , "Set stack size (object count).", opt_stack_size},
+    {0  , "aot"    , "FILE" , opt_aot_help                  , opt_aot         },
+    {'o', "output" , "FILE" , "Set output file of `--aot'." , opt_output      },
+    {0  , "stack-size", "N" , "Set max stack size (object count).", opt_stack_size},
+    {0  , "jit"    , "N"    , "Set JIT threshold (0 to disable, default 0).", opt_jit},
+    {0  , "jit-trace", "N"  , "Set loop tracing threshold (0 to disable, default 0).", opt_jit_trace},
+    {'O', "optimize", "N"  , "Set optimization level (0-2, default 1).", opt_optimize},
+    {0  , "gc-slice", "N"  , "Set objects marked per incremental GC slice (0 to disable, default 0).", opt_gc_slice},
+    {0  , "gc-concurrent", NULL, "Mark old objects on a helper thread (needs `--gc-slice').", opt_gc_concurrent},
+    {0  , "gc-threads", "N", "Set threads that run a full GC (default 1).", opt_gc_threads},
     {0  , NULL     , "..."  , NULL                          , opt_file_or_arg },
     {0  , NULL     , NULL   , NULL                          , NULL            },
 };
@@ -554,13 +667,13 @@ static void parse_args(int argc, char *argv[], struct ow_args *args) {
         // See opt_file_or_arg().
         assert(!args->argc && !args->argv);
         int index = ARGPARSE_GETINDEX(status);
-        if (!(args->repl || args->code || args->file))
+        if (!(args->repl || args->code || args->file || args->aot))
             args->file = argv[index++];
         assert(index <= argc);
         args->argc = (size_t)(argc - index);
         args->argv = argv + index;
     }
-    if (!args->file && !args->code && !args->repl) {
+    if (!args->file && !args->code && !args->repl && !args->aot) {
         if (stdin_is_tty())
             args->repl = true;
         else
@@ -587,6 +700,31 @@ static_cold_func ow_noreturn void print_top_exception_and_exit(void) {
     cleanup_mom_and_exit(EXIT_FAILURE);
 }
 
+/// Compile a source file to a native module and exit.
+static_cold_func ow_noreturn void aot_compile_and_exit(const struct ow_args *args) {
+    char *output = NULL;
+    const char *out_path = args->output;
+    if (!out_path) {
+        const char *const file_name_sep = strrchr(args->aot, '/');
+        const char *const file_name = file_name_sep ? file_name_sep + 1 : args->aot;
+        const char *const ext = strrchr(file_name, '.');
+        const size_t stem_len = ext && ext != file_name ?
+            (size_t)(ext - args->aot) : strlen(args->aot);
+        output = malloc(stem_len + sizeof ".owo");
+        memcpy(output, args->aot, stem_len);
+        strcpy(output + stem_len, ".owo");
+        out_path = output;
+    }
+
+    if (owiz_make_module(main_om, "__main__", args->aot, OWIZ_MKMOD_FILE) != 0 ||
+            owiz_syscmd(main_om, OWIZ_CMD_AOTCOMPILE, out_path) != 0) {
+        free(output);
+        print_top_exception_and_exit();
+    }
+    free(output);
+    cleanup_mom_and_exit(EXIT_SUCCESS);
+}
+
 static int ow_main(int argc, char *argv[]) {
     int status;
     struct ow_args args;
@@ -600,6 +738,9 @@ static int ow_main(int argc, char *argv[]) {
 
     owiz_syscmd(main_om, OWIZ_CMD_ADDPATH, ".");
 
+    if (args.aot)
+        aot_compile_and_exit(&args);
+
     if (args.repl) {
         status = owiz_make_module(main_om, "repl", NULL, OWIZ_MKMOD_LOAD);
     } else {
@@ -62,7 +62,8 @@ void ow_hashmap_reserve(struct ow_hashmap *map, size_t size) {
 void ow_hashmap_shrink(struct ow_hashmap *map) {
     if (ow_unlikely(map->_size > map->_bucket_count))
         return;
-    ow_hashmap_rehash(map, map->_size);
+    // Empty bucket array may cause SIGFPE.
+    ow_hashmap_rehash(map, map->_size >= 3 ? map->_size : 3);
 }
 
 struct _ow_hashmap_extend_walker_context {
@@ -190,3 +191,32 @@ int ow_hashmap_foreach(
     }
     return 0;
 }
+
+/// Number of low bits of a position for `ow_hashmap_next()` that store the
+/// node index in a bucket. The other bits store the bucket index.
+#define NEXT_POS_NODE_BITS 24
+
+bool ow_hashmap_next(
+    const struct ow_hashmap *map, size_t *pos, void **key, void **val
+) {
+    bucket_t *const buckets = map->_buckets;
+    const size_t bucket_cnt = map->_bucket_count;
+    size_t bucket_i = *pos >> NEXT_POS_NODE_BITS;
+    size_t node_i = *pos & (((size_t)1 << NEXT_POS_NODE_BITS) - 1);
+    for (; bucket_i < bucket_cnt; bucket_i++, node_i = 0) {
+        node_t *node_p = buckets[bucket_i].nodes;
+        for (size_t i = 0; node_p && i < node_i; i++)
+            node_p = node_p->next_node;
+        if (!node_p)
+            continue;
+        assert(node_i + 1 < ((size_t)1 << NEXT_POS_NODE_BITS));
+        *pos = (bucket_i << NEXT_POS_NODE_BITS) | (node_i + 1);
+        if (key)
+            *key = node_p->key;
+        if (val)
+            *val = node_p->value;
+        return true;
+    }
+    *pos = bucket_cnt << NEXT_POS_NODE_BITS;
+    return false;
+}
@@ -58,6 +58,11 @@ void *ow_hashmap_get(
 /// Traverse through the hash map.
 int ow_hashmap_foreach(
     const struct ow_hashmap *map, ow_hashmap_walker_t walker, void *arg);
+/// Step through the hash map. `*pos` is an opaque position, which shall be 0 at
+/// the beginning and is advanced on each call. Return false at the end.
+/// If the map is modified meanwhile, elements may be skipped or visited twice.
+bool ow_hashmap_next(
+    const struct ow_hashmap *map, size_t *pos, void **key, void **val);
 /// Get the number of elements.
 static inline size_t ow_hashmap_size(const struct ow_hashmap *map) { return map->_size; }
 
@@ -50,6 +50,25 @@ void *ow_mem_allocate_virtual(size_t size) {
 #endif
 }
 
+ow_malloc_fn_attrs(1, size)
+void *ow_mem_reserve_virtual(size_t size) {
+#if _IS_WINDOWS_
+    return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    // Mapped pages are backed by memory only when touched.
+    return ow_mem_allocate_virtual(size);
+#endif
+}
+
+bool ow_mem_commit_virtual(void *ptr, size_t size) {
+#if _IS_WINDOWS_
+    return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    ow_unused_var(ptr), ow_unused_var(size);
+    return true;
+#endif
+}
+
 bool ow_mem_deallocate_virtual(void *ptr, size_t size) {
     bool ok;
 #if _IS_POSIX_
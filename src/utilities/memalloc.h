@@ -20,6 +20,12 @@ void ow_mem_deallocate(void *ptr);
 /// Allocate virtual memory like `mmap()` or `VirtualAlloc()`.
 ow_malloc_fn_attrs(1, size)
 void *ow_mem_allocate_virtual(size_t size);
+/// Reserve virtual memory, which shall be committed with `ow_mem_commit_virtual()`
+/// before use. Deallocate it with `ow_mem_deallocate_virtual()`.
+ow_malloc_fn_attrs(1, size)
+void *ow_mem_reserve_virtual(size_t size);
+/// Commit pages of reserved virtual memory. Committed pages can be committed again.
+bool ow_mem_commit_virtual(void *ptr, size_t size);
 /// Deallocate virtual memory like `munmap()` or `VirtualFree()`.
 bool ow_mem_deallocate_virtual(void *ptr, size_t size);
 /// Get memory page size.
@@ -104,6 +104,39 @@ static void test_all_garbage(owiz_machine_t *om) {
     }
 }
 
+// The owiz_push_*() functions allocate the object before growing the stack, so a
+// GC during the allocation does not scan the stale slot above the stack top.
+static void test_push_over_stale_slots(owiz_machine_t *om) {
+    const int N = 10000;
+
+    char buffer[256];
+    const int top_base = owiz_drop(om, 0);
+
+    for (int i = 0; i < N; i++) {
+        snprintf(buffer, sizeof buffer, "%0200i", i);
+        owiz_push_string(om, buffer, (size_t)-1);
+        owiz_push_symbol(om, buffer, (size_t)-1);
+        owiz_push_int(om, INTMAX_MAX - i); // Boxed.
+        owiz_push_float(om, 1e300 * i); // Boxed.
+
+        const char *str;
+        intmax_t int_val;
+        double flt_val;
+        TEST_ASSERT_EQ(owiz_read_string(om, top_base + 1, &str, NULL), 0);
+        TEST_ASSERT_EQ(strcmp(str, buffer), 0);
+        TEST_ASSERT_EQ(owiz_read_symbol(om, top_base + 2, &str, NULL), 0);
+        TEST_ASSERT_EQ(strcmp(str, buffer), 0);
+        TEST_ASSERT_EQ(owiz_read_int(om, top_base + 3, &int_val), 0);
+        TEST_ASSERT_EQ(int_val, INTMAX_MAX - i);
+        TEST_ASSERT_EQ(owiz_read_float(om, top_base + 4, &flt_val), 0);
+        TEST_ASSERT_EQ(flt_val, 1e300 * i);
+
+        // The dropped objects become garbage but stay in the slots above the top.
+        owiz_drop(om, 4);
+        assert(owiz_drop(om, 0) == top_base);
+    }
+}
+
 static void test_massive_garbage(owiz_machine_t *om) {
     const intmax_t N = 100;
 
@@ -200,13 +233,148 @@ static void test_complex_references(owiz_machine_t *om) {
     assert(owiz_drop(om, 0) == module_index - 1);
 }
 
+static void make_long_chain(owiz_machine_t *om, int n, bool use_array) {
+    const int top = owiz_drop(om, 0);
+    owiz_push_nil(om);
+    for (int i = 0; i < n; i++) {
+        owiz_push_int(om, i);
+        if (use_array)
+            owiz_make_array(om, 2);
+        else
+            owiz_make_tuple(om, 2);
+    }
+    TEST_ASSERT_EQ(owiz_drop(om, 0), top + 1);
+}
+
+static void check_long_chain(owiz_machine_t *om, int n, bool use_array) {
+    const int top = owiz_drop(om, 0);
+    owiz_dup(om, 1);
+    for (int i = n - 1; i >= 0; i--) {
+        intmax_t int_val;
+        TEST_ASSERT_EQ(
+            use_array ? owiz_read_array(om, 0, 2) : owiz_read_tuple(om, 0, 2), 0);
+        TEST_ASSERT_EQ(owiz_read_int(om, 0, &int_val), 0);
+        TEST_ASSERT_EQ(int_val, i);
+        owiz_drop(om, 1);
+        TEST_ASSERT_EQ(
+            use_array ? owiz_read_array(om, 0, 1) : owiz_read_tuple(om, 0, 1), 0);
+        owiz_swap(om);
+        owiz_drop(om, 1);
+    }
+    TEST_ASSERT_EQ(owiz_read_nil(om, 0), 0);
+    owiz_drop(om, 1);
+    TEST_ASSERT_EQ(owiz_drop(om, 0), top);
+}
+
+static void test_long_chains(owiz_machine_t *om) {
+    const int N = 1000000;
+
+    const int top_base = owiz_drop(om, 0);
+    (void)top_base;
+
+    make_long_chain(om, N, false);
+    make_long_chain(om, N, true);
+
+    // Large objects fill up big space and cause full GCs,
+    // which mark the chains from end to end.
+    for (int i = 0; i < 8; i++) {
+        make_random_large_object(om, i);
+        owiz_drop(om, 1);
+    }
+
+    check_long_chain(om, N, true);
+    owiz_drop(om, 1);
+    check_long_chain(om, N, false);
+    owiz_drop(om, 1);
+    assert(owiz_drop(om, 0) == top_base);
+}
+
+static void test_incremental_marking(bool concurrent) {
+    const int N = 16;
+
+    // Small slices, so that objects are moved while old objects are being marked.
+    owiz_sysctl(OWIZ_CTL_GCSLICE, &(size_t){1024}, sizeof(size_t));
+    owiz_sysctl(OWIZ_CTL_GCCONCURRENT, &(int){concurrent}, sizeof(int));
+    owiz_machine_t *om = owiz_create();
+
+    owiz_make_module(om, "TEST", NULL, OWIZ_MKMOD_EMPTY);
+    const int module_index = owiz_drop(om, 0);
+    char name[32];
+
+    for (int i = 0; i < N; i++) {
+        owiz_make_module(om, "SUB", NULL, OWIZ_MKMOD_EMPTY);
+        make_random_data(om, i);
+        owiz_store_attribute(om, module_index + 1, "data");
+        snprintf(name, sizeof name, "sub%i", i);
+        owiz_store_attribute(om, module_index, name);
+    }
+    test_massive_garbage(om);
+
+    // Move data between the module and sub-modules back and forth, so that
+    // objects move from unmarked holders to marked ones while marking.
+    for (int round = 0; round < 8; round++) {
+        const bool to_subs = round & 1;
+        for (int i = 0; i < N; i++) {
+            snprintf(name, sizeof name, "sub%i", i);
+            TEST_ASSERT_EQ(owiz_load_attribute(om, module_index, name), 0);
+            snprintf(name, sizeof name, "data%i", i);
+            const int src = to_subs ? module_index : module_index + 1;
+            const int dst = to_subs ? module_index + 1 : module_index;
+            const char *const src_name = to_subs ? name : "data";
+            const char *const dst_name = to_subs ? "data" : name;
+            TEST_ASSERT_EQ(owiz_load_attribute(om, src, src_name), 0);
+            owiz_store_attribute(om, dst, dst_name);
+            owiz_push_nil(om);
+            owiz_store_attribute(om, src, src_name);
+            owiz_drop(om, 1);
+            make_random_data(om, N + i);
+            owiz_drop(om, 1);
+        }
+        // Large objects fill up big space and cause full GCs, which finish marking.
+        make_random_large_object(om, round);
+        owiz_drop(om, 1);
+        for (int i = 0; i < N; i++) {
+            snprintf(name, sizeof name, "sub%i", i);
+            TEST_ASSERT_EQ(owiz_load_attribute(om, module_index, name), 0);
+            snprintf(name, sizeof name, "data%i", i);
+            if (to_subs)
+                TEST_ASSERT_EQ(owiz_load_attribute(om, 0, "data"), 0);
+            else
+                TEST_ASSERT_EQ(owiz_load_attribute(om, module_index, name), 0);
+            check_random_data(om, i);
+            owiz_drop(om, 2);
+        }
+    }
+
+    owiz_drop(om, 1);
+    assert(owiz_drop(om, 0) == module_index - 1);
+    owiz_destroy(om);
+}
+
+static void test_parallel_marking(void) {
+    owiz_sysctl(OWIZ_CTL_GCSLICE, &(size_t){0}, sizeof(size_t));
+    owiz_sysctl(OWIZ_CTL_GCTHREADS, &(int){4}, sizeof(int));
+    owiz_machine_t *om = owiz_create();
+    test_massive_survivors(om);
+    test_large_object(om);
+    test_complex_references(om);
+    test_long_chains(om);
+    owiz_destroy(om);
+    owiz_sysctl(OWIZ_CTL_GCTHREADS, &(int){1}, sizeof(int));
+}
+
 int main(void) {
     owiz_sysctl(OWIZ_CTL_STACKSIZE, &(size_t){64 * 1024}, sizeof(size_t));
     owiz_machine_t *om = owiz_create();
     test_all_garbage(om);
+    test_push_over_stale_slots(om);
     test_massive_garbage(om);
     test_massive_survivors(om);
     test_large_object(om);
     test_complex_references(om);
+    test_long_chains(om);
     owiz_destroy(om);
+    test_incremental_marking(false);
+    test_incremental_marking(true);
+    test_parallel_marking();
 }
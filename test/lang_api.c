@@ -1,4 +1,6 @@
 #include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <owiz.h>
@@ -35,10 +37,13 @@ static void test_simple_values(owiz_machine_t *om) {
         owiz_push_float(om, ((double)i - 7) / 8.0); // 304 ~ 320
     owiz_push_symbol(om, "print", (size_t)-1); // 321
     owiz_push_string(om, "Hello, world!!!", 13); // 322
+    const double big_floats[] = {1e300, -1e300, 1e-300, -0.0, 0.0};
+    for (int i = 0; i < 5; i++)
+        owiz_push_float(om, big_floats[i]); // 323 ~ 327
     // TODO: Test strings with complicated structure.
 
     const int stack_depth = owiz_drop(om, 0);
-    TEST_ASSERT_EQ(stack_depth, 322);
+    TEST_ASSERT_EQ(stack_depth, 327);
 
     status = owiz_read_nil(om, stack_depth + 1);
     TEST_ASSERT_EQ(status, OWIZ_ERR_INDEX);
@@ -83,6 +88,14 @@ static void test_simple_values(owiz_machine_t *om) {
         TEST_ASSERT_EQ(tmp_double, ((double)i - 7) / 8.0);
     }
 
+    for (int i = 0; i < 5; i++) {
+        status = owiz_read_float(om, i + 323, &tmp_double);
+        TEST_ASSERT_EQ(status, 0);
+        TEST_ASSERT(!memcmp(&tmp_double, &big_floats[i], sizeof(double)));
+        status = owiz_read_int(om, i + 323, &tmp_int64);
+        TEST_ASSERT_EQ(status, OWIZ_ERR_TYPE);
+    }
+
     status = owiz_read_symbol(om, 321, &tmp_char_p, &tmp_size);
     TEST_ASSERT_EQ(status, 0);
     TEST_ASSERT_EQ(tmp_size, 5);
@@ -210,11 +223,243 @@ static void test_load_and_store(owiz_machine_t *om) {
     owiz_drop(om, -1);
 }
 
+static void test_stack_overflow(owiz_machine_t *om) {
+    int status;
+    int64_t tmp_int64;
+    char buf[64];
+
+    assert(owiz_drop(om, 0) == 0);
+
+    status = owiz_make_module(
+        om, "", "func f(n)\n return 1 + f(n + 1)\nend\nf(0)\n", OWIZ_MKMOD_STRING);
+    TEST_ASSERT_EQ(status, 0);
+    status = owiz_invoke(om, 0, OWIZ_IVK_MODULE);
+    TEST_ASSERT_NE(status, 0);
+    owiz_read_exception(om, 0, OWIZ_RDEXC_MSG | OWIZ_RDEXC_TOBUF, buf, sizeof buf);
+    TEST_ASSERT_NE(strstr(buf, "stack overflow"), NULL);
+    {
+        // Only the frames at both ends are printed.
+        char bt_buf[4096];
+        owiz_read_exception(om, 0, OWIZ_RDEXC_BT | OWIZ_RDEXC_TOBUF, bt_buf, sizeof bt_buf);
+        TEST_ASSERT_NE(strstr(bt_buf, " frames omitted\n"), NULL);
+        TEST_ASSERT(strlen(bt_buf) < sizeof bt_buf - 1);
+    }
+    owiz_drop(om, -1);
+
+    // The machine is still usable, and the memory is reused.
+    status = owiz_make_module(
+        om, "",
+        "func d(n)\n if n == 0\n  return 0\n end\n return 1 + d(n - 1)\nend\nd(100000)\n",
+        OWIZ_MKMOD_STRING | OWIZ_MKMOD_RETLAST);
+    TEST_ASSERT_EQ(status, 0);
+    status = owiz_invoke(om, 0, OWIZ_IVK_MODULE);
+    TEST_ASSERT_EQ(status, 0);
+    owiz_read_int(om, 0, &tmp_int64);
+    TEST_ASSERT_EQ(tmp_int64, 100000);
+
+    owiz_drop(om, -1);
+}
+
+static void test_aot_compile(owiz_machine_t *om) {
+    int status;
+    const char *const out_file = "lang_api_aot.owo";
+
+    owiz_push_int(om, 1);
+    status = owiz_syscmd(om, OWIZ_CMD_AOTCOMPILE, out_file);
+    TEST_ASSERT_EQ(status, OWIZ_ERR_TYPE);
+    owiz_drop(om, 1);
+
+    status = owiz_make_module(
+        om, "lang_api_aot",
+        "func f(x)\n return x * 2 + 1\nend\n"
+        "func g(n)\n s = 0\n i = 0\n while i < n\n s += f(i)\n i += 1\n end\n return s\nend\n",
+        OWIZ_MKMOD_STRING);
+    TEST_ASSERT_EQ(status, 0);
+    status = owiz_syscmd(om, OWIZ_CMD_AOTCOMPILE, out_file);
+    if (status != 0) {
+        char msg[256];
+        owiz_read_exception(om, 0, OWIZ_RDEXC_MSG | OWIZ_RDEXC_TOBUF, msg, sizeof msg);
+        // Skip if native modules cannot be built here.
+        TEST_ASSERT(strstr(msg, "not available") || strstr(msg, "not supported"));
+        fprintf(stderr, "%s: skipped: %s\n", __func__, msg);
+        owiz_drop(om, -1);
+        return;
+    }
+    owiz_drop(om, 1);
+
+    // Load the native module, run its initializer, and call its functions.
+    TEST_ASSERT_EQ(owiz_syscmd(om, OWIZ_CMD_ADDPATH, "."), 0);
+    TEST_ASSERT_EQ(owiz_make_module(om, "lang_api_aot", NULL, OWIZ_MKMOD_LOAD), 0);
+    owiz_dup(om, 0);
+    TEST_ASSERT_EQ(owiz_invoke(om, 0, OWIZ_IVK_MODULE | OWIZ_IVK_NORETVAL), 0);
+    TEST_ASSERT_EQ(owiz_load_attribute(om, 0, "g"), 0);
+    owiz_push_int(om, 100);
+    TEST_ASSERT_EQ(owiz_invoke(om, 1, 0), 0);
+    intmax_t int_val;
+    TEST_ASSERT_EQ(owiz_read_int(om, 0, &int_val), 0);
+    TEST_ASSERT_EQ(int_val, 10000);
+    owiz_drop(om, 2);
+
+    // Import it from a source module.
+    TEST_ASSERT_EQ(owiz_make_module(
+        om, "", "import lang_api_aot\nlang_api_aot.f(20)\n",
+        OWIZ_MKMOD_STRING | OWIZ_MKMOD_RETLAST), 0);
+    TEST_ASSERT_EQ(owiz_invoke(om, 0, OWIZ_IVK_MODULE), 0);
+    TEST_ASSERT_EQ(owiz_read_int(om, 0, &int_val), 0);
+    TEST_ASSERT_EQ(int_val, 41);
+    remove(out_file);
+    owiz_drop(om, -1);
+
+#ifndef _WIN32
+    // A module built for another runtime is rejected.
+    const char *const stamp_header = "lang_api_abi.h";
+    FILE *const stamp_file = fopen(stamp_header, "w");
+    TEST_ASSERT_NE(stamp_file, NULL);
+    fputs("#include <config/definitions.h>\n#undef OW_BUILD_STAMP\n"
+        "#define OW_BUILD_STAMP \"0000000000000000000000000000000000000000\"\n", stamp_file);
+    fclose(stamp_file);
+    setenv("OWIZ_AOT_CFLAGS", "-include lang_api_abi.h", 1);
+    TEST_ASSERT_EQ(owiz_make_module(
+        om, "lang_api_abi", "func f()\n return 1\nend\n", OWIZ_MKMOD_STRING), 0);
+    status = owiz_syscmd(om, OWIZ_CMD_AOTCOMPILE, "lang_api_abi.owo");
+    unsetenv("OWIZ_AOT_CFLAGS");
+    remove(stamp_header);
+    TEST_ASSERT_EQ(status, 0);
+    owiz_drop(om, 1);
+    TEST_ASSERT_NE(owiz_make_module(om, "lang_api_abi", NULL, OWIZ_MKMOD_LOAD), 0);
+    char msg[256];
+    owiz_read_exception(om, 0, OWIZ_RDEXC_MSG | OWIZ_RDEXC_TOBUF, msg, sizeof msg);
+    TEST_ASSERT(strstr(msg, "built for a different runtime"));
+    remove("lang_api_abi.owo");
+    owiz_drop(om, -1);
+#endif
+}
+
+static int native_cmp_calls;
+
+// `<=>` of the native class below, which compares the integers in the data.
+static int native_cmp(owiz_machine_t *om) {
+    void *self_data, *other_data;
+    native_cmp_calls++;
+    owiz_read_data(om, -1, &self_data);
+    if (owiz_read_data(om, -2, &other_data) != 0) {
+        owiz_make_exception(om, 0, "not comparable");
+        return -1;
+    }
+    const intmax_t self_val = *(intmax_t *)self_data, other_val = *(intmax_t *)other_data;
+    owiz_push_int(om, self_val == other_val ? 0 : self_val < other_val ? -1 : 1);
+    return 1;
+}
+
+static void test_native_class_cmp(owiz_machine_t *om) {
+    int status;
+    intmax_t int_val;
+    bool bool_val;
+    void *data;
+
+    assert(owiz_drop(om, 0) == 0);
+
+    static const owiz_native_func_def_t methods[] = {
+        {"<=>", native_cmp, 2, 0},
+        {NULL, NULL, 0, 0},
+    };
+    static const owiz_native_class_def_t class_def = {
+        "Num", sizeof(intmax_t), methods, NULL,
+    };
+    owiz_make_class(om, &class_def); // #1
+    TEST_ASSERT_EQ(owiz_make_object(om, 0), 0);
+    owiz_drop(om, 1);
+    owiz_push_int(om, 1);
+    TEST_ASSERT_EQ(owiz_make_object(om, 0), OWIZ_ERR_TYPE);
+    TEST_ASSERT_EQ(owiz_read_data(om, 0, &data), OWIZ_ERR_TYPE);
+    owiz_drop(om, 1);
+
+    status = owiz_make_module(
+        om, "",
+        "func cmp(a, b)\n return (a < b, a <= b, a > b, a >= b, a == b, a != b)\nend\n"
+        "func sort4(a, b, c, d)\n"
+        " if b < a\n  t = a\n  a = b\n  b = t\n end\n"
+        " if d < c\n  t = c\n  c = d\n  d = t\n end\n"
+        " if c < a\n  t = a\n  a = c\n  c = t\n end\n"
+        " if d < b\n  t = b\n  b = d\n  d = t\n end\n"
+        " if c < b\n  t = b\n  b = c\n  c = t\n end\n"
+        " return (a, b, c, d)\nend\n"
+        "func count_lt(a, b, n)\n c = 0\n i = 0\n"
+        " while i < n\n  if a < b\n   c += 1\n  end\n  i += 1\n end\n return c\nend\n",
+        OWIZ_MKMOD_STRING);
+    TEST_ASSERT_EQ(status, 0);
+    TEST_ASSERT_EQ(owiz_invoke(om, 0, OWIZ_IVK_MODULE | OWIZ_IVK_NORETVAL), 0); // #2
+
+    const intmax_t values[] = {8, 3, 5, 1};
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQ(owiz_make_object(om, 1), 0); // #3 ~ #6
+        owiz_read_data(om, 0, &data);
+        *(intmax_t *)data = values[i];
+    }
+
+    // Comparison operators call `<=>`.
+    native_cmp_calls = 0;
+    TEST_ASSERT_EQ(owiz_load_attribute(om, 2, "cmp"), 0);
+    owiz_load_local(om, 4);
+    owiz_load_local(om, 5);
+    TEST_ASSERT_EQ(owiz_invoke(om, 2, 0), 0);
+    TEST_ASSERT_EQ(native_cmp_calls, 6);
+    const bool cmp_expected[] = {true, true, false, false, false, true}; // 3 <=> 5
+    for (int i = 0; i < 6; i++) {
+        owiz_read_tuple(om, 0, (size_t)i + 1);
+        TEST_ASSERT_EQ(owiz_read_bool(om, 0, &bool_val), 0);
+        TEST_ASSERT_EQ(bool_val, cmp_expected[i]);
+        owiz_drop(om, 1);
+    }
+    owiz_drop(om, 1);
+
+    // Sorting calls `<=>`.
+    native_cmp_calls = 0;
+    TEST_ASSERT_EQ(owiz_load_attribute(om, 2, "sort4"), 0);
+    for (int i = 0; i < 4; i++)
+        owiz_load_local(om, 3 + i);
+    TEST_ASSERT_EQ(owiz_invoke(om, 4, 0), 0);
+    TEST_ASSERT_EQ(native_cmp_calls, 5);
+    const intmax_t sorted[] = {1, 3, 5, 8};
+    for (int i = 0; i < 4; i++) {
+        owiz_read_tuple(om, 0, (size_t)i + 1);
+        TEST_ASSERT_EQ(owiz_read_data(om, 0, &data), 0);
+        TEST_ASSERT_EQ(*(intmax_t *)data, sorted[i]);
+        owiz_drop(om, 1);
+    }
+    owiz_drop(om, 1);
+
+    // A hot comparison site still calls it, and its exceptions propagate.
+    native_cmp_calls = 0;
+    TEST_ASSERT_EQ(owiz_load_attribute(om, 2, "count_lt"), 0);
+    owiz_load_local(om, 6);
+    owiz_load_local(om, 3);
+    owiz_push_int(om, 3000);
+    TEST_ASSERT_EQ(owiz_invoke(om, 3, 0), 0);
+    TEST_ASSERT_EQ(owiz_read_int(om, 0, &int_val), 0);
+    TEST_ASSERT_EQ(int_val, 3000);
+    TEST_ASSERT_EQ(native_cmp_calls, 3000);
+    owiz_drop(om, 1);
+    TEST_ASSERT_EQ(owiz_load_attribute(om, 2, "count_lt"), 0);
+    owiz_load_local(om, 3);
+    owiz_push_int(om, 1);
+    owiz_push_int(om, 10);
+    TEST_ASSERT_EQ(owiz_invoke(om, 3, 0), OWIZ_ERR_FAIL);
+    char msg[64];
+    owiz_read_exception(om, 0, OWIZ_RDEXC_MSG | OWIZ_RDEXC_TOBUF, msg, sizeof msg);
+    TEST_ASSERT_NE(strstr(msg, "not comparable"), NULL);
+
+    owiz_drop(om, -1);
+}
+
 int main(void) {
     test_create();
     owiz_machine_t *const om = owiz_create();
     test_simple_values(om);
     test_containers(om);
     test_load_and_store(om);
+    test_stack_overflow(om);
+    test_native_class_cmp(om);
+    test_aot_compile(om);
     owiz_destroy(om);
 }
@@ -1,9 +1,12 @@
 #include <assert.h>
+#include <math.h>
 #include <string.h>
 
 #include <owiz.h>
 #include "test_util.h"
 
+#include <config/options.h>
+
 // Execute the given source string and return whether succeeded.
 // If no exception was thrown, push the result on stack.
 static bool eval(owiz_machine_t *om, const char *src) {
@@ -36,6 +39,16 @@ static bool eval_and_cmp_int(owiz_machine_t *om, const char *expr, intmax_t val)
     return val == ret;
 }
 
+static bool eval_and_cmp_bool(owiz_machine_t *om, const char *expr, bool val) {
+    if (!eval(om, expr))
+        return false;
+    bool ret;
+    if (owiz_read_bool(om, 0, &ret))
+        return false;
+    owiz_drop(om, 1);
+    return val == ret;
+}
+
 static bool eval_and_cmp_flt(owiz_machine_t *om, const char *expr, double val) {
     if (!eval(om, expr))
         return false;
@@ -46,6 +59,16 @@ static bool eval_and_cmp_flt(owiz_machine_t *om, const char *expr, double val) {
     return val == ret;
 }
 
+static bool eval_and_check_nan(owiz_machine_t *om, const char *expr) {
+    if (!eval(om, expr))
+        return false;
+    double ret;
+    if (owiz_read_float(om, 0, &ret))
+        return false;
+    owiz_drop(om, 1);
+    return isnan(ret);
+}
+
 static bool eval_and_cmp_str(owiz_machine_t *om, const char *expr, const char *val) {
     if (!eval(om, expr))
         return false;
@@ -107,6 +130,39 @@ static void test_expressions(owiz_machine_t *om) {
     TEST_ASSERT(eval_and_cmp_int(om, "(1+2)*3", 9));
     TEST_ASSERT(eval_and_cmp_int(om, "(((1)+(2))*(3))", 9));
 
+    TEST_ASSERT(eval_and_cmp_flt(om, "1.5 * 2 - 0.25", 2.75));
+    TEST_ASSERT(eval_and_cmp_flt(om, "7.5 % 2", 1.5));
+    TEST_ASSERT(eval_and_cmp_int(om, "4611686018427387903 + 1", INT64_C(4611686018427387904)));
+    TEST_ASSERT(eval_and_cmp_int(om, "-(4611686018427387903 + 1) - 1", -INT64_C(4611686018427387905)));
+    TEST_ASSERT(eval_and_cmp_bool(om, "4611686018427387903 * 2 > 1.0", true));
+    TEST_ASSERT(eval_and_cmp_int(om, "9223372036854775807 + 1", INT64_MIN));
+    TEST_ASSERT(eval_and_cmp_int(om, "x = 9223372036854775807; x + 1", INT64_MIN));
+    TEST_ASSERT(eval_and_cmp_int(om, "x = -9223372036854775807 - 1; x - 1", INT64_MAX));
+    TEST_ASSERT(eval_and_cmp_int(om, "x = 3037000500; x * x", -INT64_C(9223372036709301616)));
+    TEST_ASSERT(eval_and_cmp_int(om, "x = 4294967296; x * x", 0));
+    TEST_ASSERT(eval_and_cmp_int(om, "x = -9223372036854775807 - 1; x * -1", INT64_MIN));
+    TEST_ASSERT(eval_and_cmp_int(om, "x = -9223372036854775807 - 1; x / -1", INT64_MIN));
+    TEST_ASSERT(eval_and_cmp_int(om, "x = -9223372036854775807 - 1; x % -1", 0));
+    TEST_ASSERT(eval_and_cmp_int(om, "x = 1; x << 63", INT64_MIN));
+    TEST_ASSERT(eval_and_cmp_bool(om, "1 == 1.0", true));
+    TEST_ASSERT(eval_and_cmp_bool(om, "'abc' < 'abd'", true));
+    TEST_ASSERT(eval_and_cmp_bool(om, "'ab' < 'abc'", true));
+    TEST_ASSERT(eval_and_cmp_bool(om, "'abc' != 'abc'", false));
+    TEST_ASSERT(!eval(om, "1 / 0"));
+    TEST_ASSERT(!eval(om, "x = 0; if false; x = 1 / 0; end; 1 % 0"));
+    TEST_ASSERT(eval_and_cmp_int(om, "(1 << 20) - ~0 * -(3 >> 1)", 1048575));
+    TEST_ASSERT(eval_and_cmp_int(om, "-7 / 2 + -7 % 2", -4));
+    TEST_ASSERT(eval_and_cmp_flt(om, "1 + 0.5 * 3", 2.5));
+    TEST_ASSERT(eval_and_cmp_flt(om, "1.0 / 0.0", INFINITY));
+    TEST_ASSERT(eval_and_cmp_flt(om, "x = -1.0; x / 0.0", -INFINITY));
+    TEST_ASSERT(eval_and_check_nan(om, "0.0 / 0.0"));
+    TEST_ASSERT(eval_and_check_nan(om, "x = 0.0; x / x"));
+    TEST_ASSERT(eval_and_check_nan(om, "5 % 0.0"));
+    TEST_ASSERT(eval_and_check_nan(om, "x = 5.0; x % 0.0"));
+    TEST_ASSERT(eval_and_cmp_bool(om, "n = 0.0 / 0.0; n == n", false));
+    TEST_ASSERT(eval_and_cmp_bool(om, "n = 0.0 / 0.0; n != n", true));
+    TEST_ASSERT(eval_and_cmp_bool(om, "n = 5 % 0.0; n < 1.0 || n > 1.0 || 1 <= n || n >= n", false));
+
     TEST_ASSERT(check(om, "()"));
     TEST_ASSERT(check(om, "(1,)"));
     TEST_ASSERT(check(om, "(1, 2)"));
@@ -129,6 +185,8 @@ static void test_expressions(owiz_machine_t *om) {
     TEST_ASSERT(!check(om, "(,)"));
     TEST_ASSERT(!check(om, "[,]"));
     TEST_ASSERT(!check(om, "{,,}"));
+    // Each key is paired with its own value.
+    TEST_ASSERT(eval_and_cmp_int(om, "s=0; for k <- {1=>100,2=>200,4=>400}; s+=k; end; s", 7));
 
     TEST_ASSERT(check(om, "function()"));
     TEST_ASSERT(check(om, "function(1)"));
@@ -140,25 +198,162 @@ static void test_expressions(owiz_machine_t *om) {
 
     TEST_ASSERT(eval_and_cmp_int(om, "f=func(a,b,c)=>a*b+c; f(3,2,1)", 7));
     TEST_ASSERT(eval_and_cmp_int(om, "f=func(a,b) if a<b; return a; end; return b; end; f(-1,1)", -1));
+    TEST_ASSERT(eval_and_cmp_flt(
+        om, "f=func(a,b)=>a*b+a; x=f(2,3); y=f(0.5,3.0); z=f(2,3); x+y+z", 18.0));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "f=func(a,b) if a<b; return 1; end; return 0; end; f(1,2)+f(1.0,2)+f('b','a')+f(1,2)", 3));
 }
 
 static void test_statements(owiz_machine_t *om) {
     // return statement
     TEST_ASSERT(check(om, "func foo(); return; end"));
     TEST_ASSERT(eval_and_cmp_int(om, "func foo(); return 1; end; foo()", 1));
+    // Tail calls run in constant stack space.
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func f(n, a); if n==0; return a; end; return f(n-1, a+n); end; f(100000, 0)",
+        5000050000));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func e(n); if n==0; return 1; end; return o(n-1); end; "
+            "func o(n); if n==0; return 0; end; return e(n-1); end; e(10001)", 0));
+    TEST_ASSERT(!eval(om, "func f(n); if n==0; return 1/0; end; return f(n-1); end; f(10)"));
     // import statement
     TEST_ASSERT(check(om, "import sys"));
     // if-else statement
     TEST_ASSERT(eval_and_cmp_int(
         om, "a=1; b=0; if a<b; y=1; elif a==b; y=0; else; y=-1; end; y", -1));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "if 1 > 2; y=1; elif 2 > 1; y=2; else; y=3; end; y", 2));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func f(); return 1; x = 1 / 0; end; while false; x = 1 / 0; end; f()", 1));
+    // for statement
+    TEST_ASSERT(eval_and_cmp_int(om, "s=0; for i <- range(10); s+=i; end; s", 45));
+    TEST_ASSERT(eval_and_cmp_int(om, "s=0; for i <- range(-1); s+=1; end; s", 0));
+    TEST_ASSERT(eval_and_cmp_int(om, "s=0; for x <- [1,2,3]; s=s*10+x; end; s", 123));
+    TEST_ASSERT(eval_and_cmp_int(om, "s=0; for x <- (4,5,6); s=s*10+x; end; s", 456));
+    TEST_ASSERT(eval_and_cmp_int(om, "s=0; for x <- {1,2,4}; s+=x; end; s", 7));
+    TEST_ASSERT(eval_and_cmp_int(om, "s=0; for k <- {1=>10,2=>20}; s+=k; end; s", 3));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func f(a); for x <- a; if x>2; return x; end; end; return 0; end; f([1,5,3])+f([])", 5));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func f(n); s=0; for i <- range(n); for j <- range(i); s+=j; end; end; return s; end; f(300)",
+        4455100));
+    TEST_ASSERT(!eval(om, "for c <- 'abc'; end"));
+    TEST_ASSERT(!eval(om, "for i <- 10; end"));
+    TEST_ASSERT(eval_and_cmp_int(om, "s=0; for i <- range(3, 12, 4); s=s*100+i; end; s", 30711));
+    TEST_ASSERT(eval_and_cmp_int(om, "s=0; for i <- range(5, 0, -2); s=s*10+i; end; s", 531));
+    TEST_ASSERT(eval_and_cmp_int(om, "r=range(5, 50, 5); r:length()*100+r[2]", 915));
+    TEST_ASSERT(eval_and_cmp_int(om, "r=range(5, 50, 5); q=r:slice(2, 3); q:start()*100+q:stop()", 1530));
+    TEST_ASSERT(!eval(om, "range(1, 2, 0)"));
+    TEST_ASSERT(!eval(om, "r=range(10); r[1.5]"));
+    TEST_ASSERT(!eval(om, "r=range(10); r['1']"));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "r=range(-4611686018427387904, 4611686018427387903); r:length()", INT64_MAX));
+    // Slices past the end are empty even when one more step would overflow.
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "r=range(0, 4611686018427387903, 2305843009213693952); q=r:slice(5, 1); q:length()", 0));
+    TEST_ASSERT(eval_and_cmp_bool(
+        om, "r=range(0, 4611686018427387903, 2305843009213693952); q=r:slice(5, 1); q:start()==q:stop()", true));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "r=range(0, 4611686018427387903, 2305843009213693952); q=r:slice(1, 5); q:length()", 1));
+    TEST_ASSERT(eval_and_cmp_bool(om, "r=range(10); r:contains(3)", true));
+    TEST_ASSERT(eval_and_cmp_bool(om, "r=range(10); r:contains(4611686018427387904)", false));
+    TEST_ASSERT(eval_and_cmp_bool(om, "r=range(10); r:contains(1.5) || r:contains('1')", false));
     // while statement
     TEST_ASSERT(eval_and_cmp_int(om, "i=0; while i<100; i+=1; end; i", 100));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func f(n); i=0; s=0; while i<n; s+=i*100000; i+=1; end; return s; end; f(100)",
+        495000000));
+    // globals rebound after their sites have been run many times
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func g(); return 1; end; func h(); return g(); end; func two(); return 2; end; "
+            "s=0; i=0; while i<3000; s+=h(); if i==1499; g=two; end; i+=1; end; s", 4500));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func g(); return 1; end; func h(); return g(); end; "
+            "i=0; while i<3000; h(); i+=1; end; g=func(); return 100; end; h()", 100));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "x=5; func k(); return x; end; "
+            "s=0; i=0; while i<3000; s+=k(); if i==1499; x=7; end; i+=1; end; s", 18000));
+    // hot loops, which may run as native code
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func f(n); i=0; s=0; while i<n; s=s+i*i%7-i/3+(i&5)-(i^3); i+=1; end; return s; end; f(5000)",
+        -16639170));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func f(n); i=0; s=4611686018427387000; while i<n; s+=1; i+=1; end; return s; end; f(2000)",
+        4611686018427389000));
+    TEST_ASSERT(eval_and_cmp_flt(
+        om, "func f(n); i=0; x=0.5; while i<n; x=x*0.5+i/4.0; i+=1; end; return x; end; f(3000)",
+        1499.0));
+    TEST_ASSERT(!eval(om, "func f(n); i=0; while i<n; i+=1; x=1/(1500-i); end; end; f(2000)"));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func f(n); s=0; i=0; while i<n; s+=1; i+=1; end; i=0; while i<n; s+=2; i+=1; end; "
+            "i=0; while i<n; s+=3; i+=1; end; i=0; while i<n; s+=4; i+=1; end; "
+            "i=0; while i<n; s+=5; i+=1; end; return s; end; f(200)+f(300)", 7500));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func f(n); i=0; c=0; x=0.0/0.0; while i<n; if x<1.0 || x==x; c+=1; end; i+=1; end; return c; end; f(3000)",
+        0));
+    TEST_ASSERT(eval_and_cmp_int(
+        om, "func f(n); a=1; b=2; i=0; while i<n; t=a; a=b; b=(t+a)%1000; i+=1; end; return a*1000+b; end; f(500)",
+        751377));
+    TEST_ASSERT(eval_and_cmp_flt(
+        om, "func f(n); x=0; i=0; while i<n; if i==n/2; x=x+0.5; else; x=x+1; end; i+=1; end; return x; end; f(200)",
+        199.5));
+}
+
+static void test_code_generation(owiz_machine_t *om) {
+#if !OW_DEBUG_OPSTAT // Superinstructions are not written when counting opcodes.
+    // `StLoc x; LdLoc x` is not rewritten where it would split an `IncLoc`.
+    TEST_ASSERT(eval_and_cmp_str(
+        om,
+        "import owdb\n"
+        "func f(n)\n i = n\n i = i + 1\n if i > 5\n  return 0\n end\n return i\nend\n"
+        "owdb.disassemble(f)",
+        "LdArg 0\nStLoc 0\nIncLoc 0\nLdInt 1\nAdd\nStLoc 0\nLdLoc 0\nLdInt 5\n"
+        "CmpGtJmp\nJmpUnls 5\nLdInt 0\nRet\nRetLoc 0\n"));
+#else // OW_DEBUG_OPSTAT
+    (void)om;
+#endif // !OW_DEBUG_OPSTAT
+
+    // Peephole: `StLoc x; LdLoc x` => `Dup; StLoc x`.
+    TEST_ASSERT(eval_and_cmp_str(
+        om,
+        "import owdb\n"
+        "func f(n)\n i = n\n return i * i\nend\n"
+        "owdb.disassemble(f)",
+        "LdArg 0\nDup\nDup\nStLoc 0\nMul\nRet\n"));
+    // Jump threading: the inner `Jmp` goes to the end of the outer `if` directly.
+    TEST_ASSERT(eval_and_cmp_str(
+        om,
+        "import owdb\n"
+        "func f(x)\n"
+        " if x\n  if x\n   y = 1\n  else\n   y = 2\n  end\n else\n  y = 3\n end\n"
+        " return -y\nend\n"
+        "owdb.disassemble(f)",
+        "LdArg 0\nJmpUnls 18\nLdArg 0\nJmpUnls 8\nLdInt 1\nStLoc 0\nJmp 12\n"
+        "LdInt 2\nStLoc 0\nJmp 6\nLdInt 3\nStLoc 0\nLdLoc 0\nNeg\nRet\n"));
+    // Jump threading: a jump to a return becomes the return.
+    TEST_ASSERT(eval_and_cmp_str(
+        om,
+        "import owdb\n"
+        "func f(x)\n if x\n  y = 1\n else\n  y = 2\n end\n return y\nend\n"
+        "owdb.disassemble(f)",
+        "LdArg 0\nJmpUnls 8\nLdInt 1\nStLoc 0\nRetLoc 0\nLdInt 2\nStLoc 0\nRetLoc 0\n"));
+    // Dead code: the jump after a return, and the implicit return at the end.
+    TEST_ASSERT(eval_and_cmp_str(
+        om,
+        "import owdb\n"
+        "func f(x)\n if x\n  return 1\n else\n  return 2\n end\nend\n"
+        "owdb.disassemble(f)",
+        "LdArg 0\nJmpUnls 5\nLdInt 1\nRet\nLdInt 2\nRet\n"));
 }
 
 int main(void) {
+    // Run hot code as native code if a JIT compiler is built in.
+    owiz_sysctl(OWIZ_CTL_JIT, &(int){1000}, sizeof(int));
+    owiz_sysctl(OWIZ_CTL_JITTRACE, &(int){50}, sizeof(int));
     owiz_machine_t *const om = owiz_create();
     test_literals(om);
     test_expressions(om);
     test_statements(om);
+    test_code_generation(om);
     owiz_destroy(om);
 }
@@ -0,0 +1,138 @@
+#!/bin/env python3
+
+import argparse
+import dataclasses
+import os
+import pathlib
+import re
+import shlex
+import subprocess
+import time
+
+
+@dataclasses.dataclass
+class BenchScript:
+    path: pathlib.Path
+    instructions: int | None = None  # Executed instructions, see `count_instructions()`.
+
+
+@dataclasses.dataclass
+class BenchResult:
+    exe_index: int  # Index in the executable list.
+    script: BenchScript
+    seconds: float  # Best wall time of all rounds.
+
+    @property
+    def instr_per_sec(self) -> float | None:
+        if self.script.instructions is None:
+            return None
+        return self.script.instructions / self.seconds
+
+
+OPSTAT_TOTAL_PATTERN = re.compile(
+    r'^\[OWIZ/OpStat#\w+@[\d.]+\]\s+total\s+(\d+)\s*$', re.M)
+
+
+def find_scripts(paths: list[pathlib.Path]) -> list[BenchScript]:
+    scripts = []
+    for path in paths:
+        if path.is_dir():
+            scripts.extend(map(BenchScript, sorted(path.glob('*.ow'))))
+        else:
+            scripts.append(BenchScript(path))
+    return scripts
+
+
+def count_instructions(exe: pathlib.Path, script: BenchScript):
+    env = dict(os.environ)
+    env['OWIZ_DEBUGLOG'] = '3'  # INFO
+    # Native code is not counted, so keep everything in the interpreter.
+    proc = subprocess.run(
+        [exe, '--jit', '0', '--jit-trace', '0', script.path], env=env, check=True,
+        stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    m = OPSTAT_TOTAL_PATTERN.search(proc.stderr)
+    if not m:
+        print('*** No instruction count reported; '
+            + 'are OW_DEBUG_OPSTAT and OW_DEBUG_LOGGING enabled?')
+        exit(1)
+    script.instructions = int(m.group(1))
+
+
+def run_once(exe: list[str], script: BenchScript) -> float:
+    t0 = time.perf_counter_ns()
+    subprocess.run(
+        [*exe, script.path], check=True,
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    t1 = time.perf_counter_ns()
+    return (t1 - t0) / 1e9
+
+
+def run_bench(
+    exe_list: list[list[str]], exe_index: int, script: BenchScript, rounds: int,
+) -> BenchResult:
+    exe = exe_list[exe_index]
+    return BenchResult(
+        exe_index, script, min(run_once(exe, script) for _ in range(rounds)))
+
+
+def print_results(results: list[BenchResult], exe_list: list[list[str]]):
+    def put_bar():
+        print('-' * 20 + '+' + '-' * 50)
+
+    put_bar()
+    print(f'{"Script": <19} | {"Exe": >3} {"Time (s)": >10} '
+        + f'{"Minstr/s": >12} {"Speedup": >10}')
+    put_bar()
+    base_by_script: dict[pathlib.Path, BenchResult] = {}
+    for res in results:
+        exe_index = res.exe_index
+        base = base_by_script.setdefault(res.script.path, res)
+        ips = res.instr_per_sec
+        ips_str = f'{ips / 1e6:.1f}' if ips is not None else '-'
+        speedup = base.seconds / res.seconds
+        print(f'{res.script.path.stem: <19} | {exe_index: >3} '
+            + f'{res.seconds: >10.3f} {ips_str: >12} {speedup: >9.2f}x')
+    put_bar()
+    for i, exe in enumerate(exe_list):
+        print(f'[{i}] {shlex.join(exe)}')
+
+
+def main():
+    arg_parser = argparse.ArgumentParser()
+    arg_parser.description = \
+        'Run benchmark scripts with one or more owiz executables ' \
+        + 'and compare their speeds.'
+    arg_parser.add_argument(
+        '-e', '--exe', action='append', type=shlex.split, required=True,
+        help='owiz executable to test, optionally followed by options '
+            + '(e.g., "owiz --gc-threads 4"); the first one is the baseline')
+    arg_parser.add_argument(
+        '-n', '--rounds', type=int, default=3,
+        help='number of runs for each script; the best one is taken')
+    arg_parser.add_argument(
+        '-c', '--count-exe', type=pathlib.Path,
+        help='owiz executable built with OW_DEBUG_OPSTAT and OW_DEBUG_LOGGING, '
+            + 'used to count the executed instructions of each script; '
+            + 'instructions per second are shown only with this option')
+    arg_parser.add_argument(
+        'SCRIPT', nargs='*', type=pathlib.Path,
+        default=[pathlib.Path(__file__).parent / 'bench'],
+        help='benchmark scripts or directories containing them')
+    args = arg_parser.parse_args()
+
+    scripts = find_scripts(args.SCRIPT)
+    if not scripts:
+        print('*** No benchmark scripts found')
+        exit(1)
+    if args.count_exe:
+        for script in scripts:
+            count_instructions(args.count_exe, script)
+    results = [
+        run_bench(args.exe, exe_index, script, args.rounds)
+        for script in scripts for exe_index in range(len(args.exe))
+    ]
+    print_results(results, args.exe)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,81 @@
+#!/bin/env python3
+
+import argparse
+import collections
+import os
+import pathlib
+import re
+import subprocess
+
+
+OPSTAT_LINE_PATTERN = re.compile(
+    r'^\[OWIZ/OpStat#\w+@[\d.]+\]\s+(\w+)\s+(\w+)\s+(\d+)\s*$', re.M)
+
+
+def find_scripts(paths: list[pathlib.Path]) -> list[pathlib.Path]:
+    scripts = []
+    for path in paths:
+        if path.is_dir():
+            scripts.extend(sorted(path.glob('*.ow')))
+        else:
+            scripts.append(path)
+    return scripts
+
+
+def collect_pairs(exe: pathlib.Path, script: pathlib.Path) -> collections.Counter:
+    env = dict(os.environ)
+    env['OWIZ_DEBUGLOG'] = '3'  # INFO
+    # Native code is not counted, so keep everything in the interpreter.
+    proc = subprocess.run(
+        [exe, '--jit', '0', '--jit-trace', '0', script], env=env, check=True,
+        stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True)
+    pairs = collections.Counter()
+    for m in OPSTAT_LINE_PATTERN.finditer(proc.stderr):
+        pairs[(m.group(1), m.group(2))] += int(m.group(3))
+    return pairs
+
+
+def print_pairs(pairs: collections.Counter, top_n: int):
+    total = sum(pairs.values())
+    if not total:
+        print('*** No opcode pairs recorded; is OW_DEBUG_OPSTAT enabled?')
+        exit(1)
+    print('-' * 60)
+    print(f'{"First": <16} {"Second": <16} {"Count": >14} {"Percent": >10}')
+    print('-' * 60)
+    for (first, second), count in pairs.most_common(top_n):
+        print(f'{first: <16} {second: <16} {count: >14} {count / total: >10.2%}')
+    print('-' * 60)
+    print(f'{len(pairs)} distinct pairs, {total} in total')
+
+
+def main():
+    arg_parser = argparse.ArgumentParser()
+    arg_parser.description = \
+        'Count adjacent opcode pairs executed by scripts, ' \
+        + 'to find candidates for superinstructions. ' \
+        + 'The owiz executable must be built with OW_DEBUG_OPSTAT and OW_DEBUG_LOGGING.'
+    arg_parser.add_argument(
+        '-e', '--exe', type=pathlib.Path, required=True,
+        help='owiz executable built with OW_DEBUG_OPSTAT')
+    arg_parser.add_argument(
+        '-n', '--top', type=int, default=20,
+        help='number of most frequent pairs to show')
+    arg_parser.add_argument(
+        'SCRIPT', nargs='*', type=pathlib.Path,
+        default=[pathlib.Path(__file__).parent / 'bench'],
+        help='scripts or directories containing them')
+    args = arg_parser.parse_args()
+
+    scripts = find_scripts(args.SCRIPT)
+    if not scripts:
+        print('*** No scripts found')
+        exit(1)
+    pairs = collections.Counter()
+    for script in scripts:
+        pairs.update(collect_pairs(args.exe, script))
+    print_pairs(pairs, args.top)
+
+
+if __name__ == '__main__':
+    main()